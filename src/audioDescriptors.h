@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace myAudio {
+
+    //=========================================================================
+    // Spectral descriptors
+    // Centroid, 85% rolloff, flatness, flux and peak bin from one fused pass
+    // over the magnitude array. Rolloff needs the total before it can be
+    // located, so the pass also writes a running prefix sum and the rolloff
+    // bin is found afterwards by binary search (O(log n), not a second pass).
+    // Flatness uses a bit-level log2 approximation instead of logf per bin.
+    //
+    // One scalar pass over the bins at ~10 integer/float ops each; the
+    // serial sums and peak tracking keep it from vectorizing.
+    //=========================================================================
+
+    constexpr uint16_t DESCRIPTOR_MAX_BINS = 256;
+    constexpr float ROLLOFF_FRACTION = 0.85f;
+
+    struct SpectralDescriptors {
+        float centroidHz = 0.0f;    // magnitude-weighted mean frequency ("brightness")
+        float rolloffHz = 0.0f;     // frequency below which 85% of the magnitude lies
+        float flatness = 0.0f;      // 0 = tonal, 1 = noise-like
+        float flux = 0.0f;          // positive magnitude change since the last block
+        float dominantHz = 0.0f;    // frequency of the peak bin
+        uint16_t peakBin = 0;
+    };
+
+    // log2(x) for x >= 1, accurate to ~0.01 - plenty for a flatness ratio
+    inline float fastLog2(float x) {
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        float e = static_cast<float>(static_cast<int32_t>((bits >> 23) & 0xFF) - 127);
+        bits = (bits & 0x007FFFFF) | 0x3F800000;   // mantissa in [1,2)
+        float m;
+        memcpy(&m, &bits, sizeof(m));
+        return e + (-0.34484843f * m + 2.02466578f) * m - 1.67487759f;
+    }
+
+    class DescriptorExtractor {
+    public:
+        // binHz: spacing of the magnitude array; bins: its length
+        void init(float binHz, uint16_t bins) {
+            mBinHz = binHz;
+            mBins = bins > DESCRIPTOR_MAX_BINS ? DESCRIPTOR_MAX_BINS : bins;
+            reset();
+        }
+
+        // Forget the previous frame, so flux restarts from silence
+        void reset() {
+            memset(mPrev, 0, sizeof(mPrev));
+            mOut = SpectralDescriptors();
+        }
+
+        void process(const uint16_t* mag) {
+            uint32_t sum = 0;
+            uint64_t weighted = 0;
+            float logSum = 0.0f;
+            uint32_t flux = 0;
+            uint16_t peakBin = 1;
+            uint16_t peakVal = 0;
+
+            // DC (bin 0) is skipped: it carries offset, not timbre
+            for (uint16_t k = 1; k < mBins; k++) {
+                const uint16_t m = mag[k];
+                sum += m;
+                mPrefix[k] = sum;
+                weighted += static_cast<uint32_t>(m) * k;
+                logSum += fastLog2(static_cast<float>(m) + 1.0f);
+                const int32_t d = static_cast<int32_t>(m) - mPrev[k];
+                flux += d > 0 ? d : 0;
+                mPrev[k] = m;
+                if (m > peakVal) { peakVal = m; peakBin = k; }
+            }
+
+            const uint16_t n = mBins - 1;
+            if (sum == 0) {
+                mOut = SpectralDescriptors();
+                return;
+            }
+
+            mOut.centroidHz = (static_cast<float>(weighted) / sum) * mBinHz;
+
+            // Smallest k with prefix[k] >= 85% of total
+            const uint32_t target = static_cast<uint32_t>(sum * ROLLOFF_FRACTION);
+            uint16_t lo = 1, hi = mBins - 1;
+            while (lo < hi) {
+                uint16_t mid = (lo + hi) >> 1;
+                if (mPrefix[mid] < target) lo = mid + 1; else hi = mid;
+            }
+            mOut.rolloffHz = lo * mBinHz;
+
+            // Geometric mean / arithmetic mean, both on (m + 1)
+            const float meanLog = logSum / n;
+            const float arith = static_cast<float>(sum) / n + 1.0f;
+            mOut.flatness = exp2f(meanLog) / arith;
+
+            mOut.flux = static_cast<float>(flux);
+            mOut.peakBin = peakBin;
+            mOut.dominantHz = peakBin * mBinHz;
+        }
+
+        const SpectralDescriptors& descriptors() const { return mOut; }
+
+    private:
+        float mBinHz = 0.0f;
+        uint16_t mBins = 0;
+        uint32_t mPrefix[DESCRIPTOR_MAX_BINS] = {};
+        uint16_t mPrev[DESCRIPTOR_MAX_BINS];
+        SpectralDescriptors mOut;
+    };
+
+} // namespace myAudio
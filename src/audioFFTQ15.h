@@ -0,0 +1,230 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+//=============================================================================
+// Q15 fixed-point real-input FFT for the spectrum stage
+// Alternative to fl::FFT (float) behind AudioContext::getFFT. A 512-sample
+// real block is packed into a 256-point complex FFT, which runs radix-4 in
+// Q15 with a >>2 per stage (overall 1/N scaling), then split into the 256
+// positive-frequency bins.
+//
+// The scaling keeps magnitudes from growing, but it does not keep single
+// components in int16 range: a packed sample x[2m] + j*x[2m+1] can already
+// have magnitude sqrt(2)*32767 (~46340), and a stage can rotate that onto
+// one axis. Butterfly outputs therefore saturate instead of wrapping, and
+// the split works in 32 bits with 64-bit squares for the magnitude.
+//
+// On the ESP32 the complex FFT can be handed to esp-dsp instead. esp-dsp
+// has no 16-bit radix-4 transform, so that path uses its radix-2
+// dsps_fft2r_sc16 (PIE/AE32 optimized, likewise scaled by 1/N); the
+// portable radix-4 path below is the reference used everywhere else.
+//=============================================================================
+
+#if defined(ESP_PLATFORM) && __has_include("esp_dsp.h")
+    #include "esp_dsp.h"
+    #define Q15_FFT_USE_ESP_DSP 1
+#else
+    #define Q15_FFT_USE_ESP_DSP 0
+#endif
+
+#if defined(ESP_PLATFORM)
+    #include "esp_attr.h"
+    #define Q15_FFT_TABLE_ATTR DRAM_ATTR   // keep tables in internal RAM, not PSRAM/flash
+#else
+    #define Q15_FFT_TABLE_ATTR
+#endif
+
+namespace myAudio {
+
+    constexpr float Q15_FFT_SAMPLE_RATE = 44100.0f;
+    constexpr uint16_t Q15_FFT_SIZE = 512;                   // real samples per block
+    constexpr uint16_t Q15_FFT_COMPLEX = Q15_FFT_SIZE / 2;   // 256 = 4^4
+    constexpr uint8_t Q15_FFT_RADIX4_STAGES = 4;
+
+    // Tables are filled once by initQ15FFT()
+    Q15_FFT_TABLE_ATTR int16_t q15HannWindow[Q15_FFT_SIZE];
+    Q15_FFT_TABLE_ATTR int16_t q15TwiddleCos[Q15_FFT_SIZE];     // cos(2*pi*k/512), k < 512
+    Q15_FFT_TABLE_ATTR int16_t q15TwiddleSin[Q15_FFT_SIZE];     // -sin(2*pi*k/512)
+    Q15_FFT_TABLE_ATTR uint8_t q15DigitReverse[Q15_FFT_COMPLEX];
+
+    inline int16_t q15Mul(int16_t a, int16_t b) {
+        return static_cast<int16_t>((static_cast<int32_t>(a) * b + 0x4000) >> 15);
+    }
+
+    inline int16_t sat16(int32_t v) {
+        return static_cast<int16_t>(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    }
+
+    inline int16_t toQ15(float v) {
+        float s = v * 32767.0f;
+        return static_cast<int16_t>(s >= 32767.0f ? 32767 : (s <= -32768.0f ? -32768 : lrintf(s)));
+    }
+
+    void initQ15FFT() {
+        static bool initialized = false;
+        if (initialized) return;
+
+        for (uint16_t i = 0; i < Q15_FFT_SIZE; i++) {
+            q15HannWindow[i] = toQ15(0.5f - 0.5f * cosf(2.0f * float(M_PI) * i / Q15_FFT_SIZE));
+            q15TwiddleCos[i] = toQ15(cosf(2.0f * float(M_PI) * i / Q15_FFT_SIZE));
+            q15TwiddleSin[i] = toQ15(-sinf(2.0f * float(M_PI) * i / Q15_FFT_SIZE));
+        }
+
+        // Base-4 digit reversal of 8-bit indices (4 digits)
+        for (uint16_t i = 0; i < Q15_FFT_COMPLEX; i++) {
+            uint8_t v = i;
+            uint8_t r = 0;
+            for (uint8_t d = 0; d < Q15_FFT_RADIX4_STAGES; d++) {
+                r = (r << 2) | (v & 3);
+                v >>= 2;
+            }
+            q15DigitReverse[i] = r;
+        }
+
+        #if Q15_FFT_USE_ESP_DSP
+            dsps_fft2r_init_sc16(NULL, Q15_FFT_COMPLEX);
+        #endif
+
+        initialized = true;
+    }
+
+    //=========================================================================
+    // Portable radix-4 DIT complex FFT, in place on interleaved re/im Q15,
+    // input already in digit-reversed order. Twiddles for the 256-point
+    // transform are every other entry of the 512-point tables.
+    //=========================================================================
+
+    void fftRadix4Q15(int16_t* data) {
+        for (uint16_t L = 4; L <= Q15_FFT_COMPLEX; L <<= 2) {
+            const uint16_t q = L >> 2;
+            const uint16_t twStep = 2 * (Q15_FFT_COMPLEX / L);  // in 512-table units
+            for (uint16_t g = 0; g < Q15_FFT_COMPLEX; g += L) {
+                for (uint16_t j = 0; j < q; j++) {
+                    int16_t* p0 = &data[2 * (g + j)];
+                    int16_t* p1 = p0 + 2 * q;
+                    int16_t* p2 = p1 + 2 * q;
+                    int16_t* p3 = p2 + 2 * q;
+
+                    const uint16_t t1 = j * twStep;
+                    const uint16_t t2 = 2 * t1;
+                    const uint16_t t3 = 3 * t1;
+
+                    // a_k = x_k * W^(k*j)
+                    int32_t a0r = p0[0], a0i = p0[1];
+                    int32_t a1r = q15Mul(p1[0], q15TwiddleCos[t1]) - q15Mul(p1[1], q15TwiddleSin[t1]);
+                    int32_t a1i = q15Mul(p1[0], q15TwiddleSin[t1]) + q15Mul(p1[1], q15TwiddleCos[t1]);
+                    int32_t a2r = q15Mul(p2[0], q15TwiddleCos[t2]) - q15Mul(p2[1], q15TwiddleSin[t2]);
+                    int32_t a2i = q15Mul(p2[0], q15TwiddleSin[t2]) + q15Mul(p2[1], q15TwiddleCos[t2]);
+                    int32_t a3r = q15Mul(p3[0], q15TwiddleCos[t3]) - q15Mul(p3[1], q15TwiddleSin[t3]);
+                    int32_t a3i = q15Mul(p3[0], q15TwiddleSin[t3]) + q15Mul(p3[1], q15TwiddleCos[t3]);
+
+                    int32_t s02r = a0r + a2r, s02i = a0i + a2i;
+                    int32_t d02r = a0r - a2r, d02i = a0i - a2i;
+                    int32_t s13r = a1r + a3r, s13i = a1i + a3i;
+                    int32_t d13r = a1r - a3r, d13i = a1i - a3i;
+
+                    // y0 = s02 + s13, y2 = s02 - s13
+                    // y1 = d02 - j*d13, y3 = d02 + j*d13; each scaled by 1/4
+                    // and saturated (see the note at the top)
+                    p0[0] = sat16((s02r + s13r + 2) >> 2);
+                    p0[1] = sat16((s02i + s13i + 2) >> 2);
+                    p1[0] = sat16((d02r + d13i + 2) >> 2);
+                    p1[1] = sat16((d02i - d13r + 2) >> 2);
+                    p2[0] = sat16((s02r - s13r + 2) >> 2);
+                    p2[1] = sat16((s02i - s13i + 2) >> 2);
+                    p3[0] = sat16((d02r - d13i + 2) >> 2);
+                    p3[1] = sat16((d02i + d13r + 2) >> 2);
+                }
+            }
+        }
+    }
+
+    //=========================================================================
+    // Real-input spectrum: window, pack, transform, split.
+    // Writes 256 magnitudes (bins 0..255, 86 Hz apart at 44.1kHz) as |X|/256,
+    // so a full-scale Hann-windowed sine reads ~16384. Against a double
+    // precision DFT: ~65 dB SNR at full scale, ~24 dB at amplitude 200.
+    //=========================================================================
+
+    class Q15Spectrum {
+    public:
+        Q15Spectrum() { initQ15FFT(); }
+
+        // Contiguous block; samples past n are zero-padded
+        void compute(const int16_t* pcm, uint16_t n, uint16_t* magnitudes) {
+            transform([pcm, n](uint16_t i) -> int16_t { return (i < n) ? pcm[i] : 0; }, magnitudes);
+        }
+
+        // Frame of Q15_FFT_SIZE samples starting at ring[start], read with
+        // wrap-around indexing so an STFT never has to copy out of its ring.
+        // ringMask is ring length - 1 (ring length must be a power of two).
+        void computeRing(const int16_t* ring, uint16_t ringMask, uint16_t start, uint16_t* magnitudes) {
+            transform([ring, ringMask, start](uint16_t i) -> int16_t { return ring[(start + i) & ringMask]; }, magnitudes);
+        }
+
+    private:
+        template <typename Fetch>
+        void transform(Fetch sample, uint16_t* magnitudes) {
+            // Window and pack x[2m] + j*x[2m+1] into z[m]
+            #if Q15_FFT_USE_ESP_DSP
+                for (uint16_t m = 0; m < Q15_FFT_COMPLEX; m++) {
+                    mBuf[2 * m]     = q15Mul(sample(2 * m), q15HannWindow[2 * m]);
+                    mBuf[2 * m + 1] = q15Mul(sample(2 * m + 1), q15HannWindow[2 * m + 1]);
+                }
+                dsps_fft2r_sc16(mBuf, Q15_FFT_COMPLEX);
+                dsps_bit_rev_sc16_ansi(mBuf, Q15_FFT_COMPLEX);
+            #else
+                for (uint16_t m = 0; m < Q15_FFT_COMPLEX; m++) {
+                    uint8_t d = q15DigitReverse[m];
+                    mBuf[2 * d]     = q15Mul(sample(2 * m), q15HannWindow[2 * m]);
+                    mBuf[2 * d + 1] = q15Mul(sample(2 * m + 1), q15HannWindow[2 * m + 1]);
+                }
+                fftRadix4Q15(mBuf);
+            #endif
+
+            // Split: X[k] = (Z[k] + Z*[M-k])/2 + W^k (Z[k] - Z*[M-k])/(2j)
+            for (uint16_t k = 0; k < Q15_FFT_COMPLEX; k++) {
+                uint16_t mk = (Q15_FFT_COMPLEX - k) & (Q15_FFT_COMPLEX - 1);
+                int32_t zr = mBuf[2 * k], zi = mBuf[2 * k + 1];
+                int32_t cr = mBuf[2 * mk], ci = -mBuf[2 * mk + 1];
+
+                int32_t er = (zr + cr) >> 1, ei = (zi + ci) >> 1;
+                // (Z - Z*)/(2j) = (di, -dr)/2
+                int32_t orr = (zi - ci) >> 1, oi = -((zr - cr) >> 1);
+
+                int32_t wr = q15TwiddleCos[k], wi = q15TwiddleSin[k];
+                int32_t xr = er + ((orr * wr - oi * wi + 0x4000) >> 15);
+                int32_t xi = ei + ((orr * wi + oi * wr + 0x4000) >> 15);
+
+                // xr and xi can exceed 16 bits, so square in 64; above 32 bits
+                // of power take the root of power/4 and double it
+                uint64_t power = static_cast<uint64_t>(static_cast<int64_t>(xr) * xr) +
+                                 static_cast<uint64_t>(static_cast<int64_t>(xi) * xi);
+                uint32_t mag = (power >> 32) ? 2 * isqrt32(static_cast<uint32_t>(power >> 2))
+                                             : isqrt32(static_cast<uint32_t>(power));
+                magnitudes[k] = static_cast<uint16_t>(mag < 65535 ? mag : 65535);
+            }
+        }
+
+        static uint32_t isqrt32(uint32_t v) {
+            uint32_t r = 0;
+            uint32_t bit = 1UL << 30;
+            while (bit > v) bit >>= 2;
+            while (bit) {
+                if (v >= r + bit) {
+                    v -= r + bit;
+                    r = (r >> 1) + bit;
+                } else {
+                    r >>= 1;
+                }
+                bit >>= 2;
+            }
+            return r;
+        }
+
+        alignas(16) int16_t mBuf[2 * Q15_FFT_COMPLEX];
+    };
+
+} // namespace myAudio
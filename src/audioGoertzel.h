@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace myAudio {
+
+    //=========================================================================
+    // Goertzel bank
+    // For modes that only need a handful of band energies (bass ripple), a
+    // bank of Goertzel filters at named target frequencies replaces the full
+    // FFT plus band mapping. Each target costs one multiply-add per sample in
+    // fixed point (Q30 coefficient, 32-bit state, 64-bit product), plus one
+    // sqrt per block.
+    //
+    // The coefficient 2*cos(w) sits within 1e-4 of 2.0 for bass targets at
+    // 44.1 kHz, so it needs the fractional bits: in Q14, 45 Hz and 60 Hz both
+    // round to 32767 (~55 Hz). In Q30 they resolve to well under 0.01 Hz.
+    //
+    // The resonator state grows with block length and inversely with
+    // frequency: a full-scale 20 Hz sine reaches ~3.4e9 over 512 samples,
+    // past int32. Input is pre-shifted by GOERTZEL_INPUT_SHIFT (~8.4e8 peak)
+    // and targets are floored at GOERTZEL_MIN_FREQ to keep that bound.
+    //
+    //   targets   MACs per 512-sample block   vs 512-pt FFT (~2.3k butterflies)
+    //      3              1.5k                        cheaper
+    //      8              4.1k                        about even
+    //     16              8.2k                        FFT wins
+    //=========================================================================
+
+    constexpr uint8_t GOERTZEL_MAX_TARGETS = 16;
+    constexpr float GOERTZEL_SAMPLE_RATE = 44100.0f;
+    constexpr double GOERTZEL_Q30_ONE = 1073741824.0;
+    constexpr uint8_t GOERTZEL_INPUT_SHIFT = 2;
+    constexpr float GOERTZEL_MIN_FREQ = 20.0f;
+
+    class GoertzelBank {
+    public:
+        // Replace the target list. Frequencies in Hz; extra entries ignored.
+        void setTargets(const float* freqs, uint8_t count) {
+            if (count > GOERTZEL_MAX_TARGETS) count = GOERTZEL_MAX_TARGETS;
+            for (uint8_t i = 0; i < count; i++) {
+                mFreq[i] = freqs[i] > GOERTZEL_MIN_FREQ ? freqs[i] : GOERTZEL_MIN_FREQ;
+                double w = 2.0 * M_PI * mFreq[i] / GOERTZEL_SAMPLE_RATE;
+                mCoeff[i] = llrint(2.0 * cos(w) * GOERTZEL_Q30_ONE);
+                mLevel[i] = 0.0f;
+            }
+            mCount = count;
+        }
+
+        void clearTargets() { mCount = 0; }
+        uint8_t count() const { return mCount; }
+
+        // Run all targets over one block. Magnitudes are in sample units
+        // (a sine of amplitude A at a target frequency reads ~A).
+        void process(const int16_t* pcm, uint16_t n) {
+            if (mCount == 0 || n == 0) return;
+            for (uint8_t t = 0; t < mCount; t++) {
+                const int64_t c = mCoeff[t];
+                int32_t s1 = 0;
+                int32_t s2 = 0;
+                for (uint16_t i = 0; i < n; i++) {
+                    int32_t s0 = (pcm[i] >> GOERTZEL_INPUT_SHIFT) + static_cast<int32_t>((c * s1) >> 30) - s2;
+                    s2 = s1;
+                    s1 = s0;
+                }
+                // |X|^2 = s1^2 + s2^2 - coeff*s1*s2
+                float f1 = float(s1);
+                float f2 = float(s2);
+                float power = f1 * f1 + f2 * f2 - (float(c) * (1.0f / GOERTZEL_Q30_ONE)) * f1 * f2;
+                mLevel[t] = (power > 0.0f) ? sqrtf(power) * (float(2 << GOERTZEL_INPUT_SHIFT) / n) : 0.0f;
+            }
+        }
+
+        float level(uint8_t i) const { return i < mCount ? mLevel[i] : 0.0f; }
+        float frequency(uint8_t i) const { return i < mCount ? mFreq[i] : 0.0f; }
+
+    private:
+        int64_t mCoeff[GOERTZEL_MAX_TARGETS] = {};
+        float mFreq[GOERTZEL_MAX_TARGETS] = {};
+        float mLevel[GOERTZEL_MAX_TARGETS] = {};
+        uint8_t mCount = 0;
+    };
+
+} // namespace myAudio
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace myAudio {
+
+    //=========================================================================
+    // Low-band analysis path
+    // Bass and kick work only needs content below a few hundred Hz, so rather
+    // than running a larger FFT at the full 44.1kHz rate, the filtered PCM is
+    // decimated by 8 (44.1kHz -> ~5.5kHz) and analysed with a small FFT over
+    // a much longer window.
+    //
+    //   full rate, 512-pt FFT  : 86 Hz/bin,  11.6 ms window
+    //   decimated, 256-pt FFT  : 21.5 Hz/bin, 46 ms window
+    //   full rate, 2048-pt FFT : 21.5 Hz/bin (same resolution, ~10x the work)
+    //=========================================================================
+
+    constexpr uint32_t LOWBAND_INPUT_RATE = 44100;
+    constexpr uint8_t LOWBAND_DECIMATION = 8;
+    constexpr float LOWBAND_RATE = float(LOWBAND_INPUT_RATE) / LOWBAND_DECIMATION;
+
+    constexpr uint8_t LOWBAND_PHASE_TAPS = 8;                                   // taps per polyphase branch
+    constexpr uint8_t LOWBAND_TAPS = LOWBAND_DECIMATION * LOWBAND_PHASE_TAPS;  // 64-tap prototype filter
+    constexpr float LOWBAND_CUTOFF_HZ = 2000.0f;                                // below new Nyquist (2756 Hz)
+
+    constexpr uint16_t LOWBAND_FFT_SIZE = 256;
+    constexpr uint8_t LOWBAND_FFT_LOG2 = 8;
+    constexpr uint8_t LOWBAND_NUM_BANDS = 8;
+    constexpr float LOWBAND_MIN_FREQ = 30.0f;
+    constexpr float LOWBAND_MAX_FREQ = 400.0f;
+
+    // Kick detection: flux of the 40-120 Hz energy against a running mean
+    constexpr float KICK_MIN_FREQ = 40.0f;
+    constexpr float KICK_MAX_FREQ = 120.0f;
+    constexpr float KICK_THRESHOLD = 1.6f;       // flux must exceed mean * this
+    constexpr uint32_t KICK_REFRACTORY_MS = 150;
+
+    //=========================================================================
+    // Streaming polyphase decimator
+    // Decimating FIR in polyphase form: of the 8 outputs the full-rate filter
+    // would produce, only the one that survives decimation is computed, so
+    // the 64-tap filter costs 8 MACs per input sample. The history is stored
+    // twice (at i and i+TAPS) so the dot product never has to wrap.
+    //=========================================================================
+
+    class PolyphaseDecimator {
+    public:
+        PolyphaseDecimator() {
+            // Windowed-sinc (Hamming) lowpass, Q15, unity DC gain
+            float h[LOWBAND_TAPS];
+            float sum = 0.0f;
+            const float fc = LOWBAND_CUTOFF_HZ / LOWBAND_INPUT_RATE;
+            const float mid = (LOWBAND_TAPS - 1) * 0.5f;
+            for (uint8_t i = 0; i < LOWBAND_TAPS; i++) {
+                float t = i - mid;
+                float sinc = sinf(2.0f * float(M_PI) * fc * t) / (float(M_PI) * t);  // t is never 0 for even TAPS
+                float w = 0.54f - 0.46f * cosf(2.0f * float(M_PI) * i / (LOWBAND_TAPS - 1));
+                h[i] = sinc * w;
+                sum += h[i];
+            }
+            for (uint8_t i = 0; i < LOWBAND_TAPS; i++) {
+                mCoeff[i] = static_cast<int16_t>(lrintf(h[i] / sum * 32767.0f));
+            }
+            reset();
+        }
+
+        void reset() {
+            for (uint8_t i = 0; i < 2 * LOWBAND_TAPS; i++) mHistory[i] = 0;
+            mHead = 0;
+            mPhase = 0;
+        }
+
+        // Push a block of input samples, write decimated samples to out.
+        // Returns the number of samples written (n / 8, give or take one).
+        uint16_t process(const int16_t* in, uint16_t n, int16_t* out) {
+            uint16_t produced = 0;
+            for (uint16_t i = 0; i < n; i++) {
+                mHistory[mHead] = in[i];
+                mHistory[mHead + LOWBAND_TAPS] = in[i];
+                mHead = (mHead + 1) & (LOWBAND_TAPS - 1);
+
+                if (++mPhase < LOWBAND_DECIMATION) continue;
+                mPhase = 0;
+
+                // mHistory[mHead .. mHead+TAPS) is oldest -> newest
+                const int16_t* x = &mHistory[mHead];
+                int32_t acc = 0;
+                for (uint8_t k = 0; k < LOWBAND_TAPS; k++) {
+                    acc += static_cast<int32_t>(mCoeff[LOWBAND_TAPS - 1 - k]) * x[k];
+                }
+                int32_t y = acc >> 15;
+                out[produced++] = static_cast<int16_t>(y > 32767 ? 32767 : (y < -32768 ? -32768 : y));
+            }
+            return produced;
+        }
+
+    private:
+        int16_t mCoeff[LOWBAND_TAPS];
+        int16_t mHistory[2 * LOWBAND_TAPS];
+        uint8_t mHead = 0;
+        uint8_t mPhase = 0;
+    };
+
+    //=========================================================================
+    // Low-band analyser
+    // Keeps the last 256 decimated samples and re-analyses them every block
+    // (64 new samples per 512-sample input block, i.e. 75% overlap). Uses a
+    // small in-place radix-2 float FFT with precomputed Hann window and
+    // twiddles; at 256 points that is ~8k flops per block.
+    //=========================================================================
+
+    class LowBandAnalyzer {
+    public:
+        LowBandAnalyzer() {
+            for (uint16_t i = 0; i < LOWBAND_FFT_SIZE; i++) {
+                mWindow[i] = 0.5f - 0.5f * cosf(2.0f * float(M_PI) * i / LOWBAND_FFT_SIZE);
+                mRing[i] = 0;
+            }
+            for (uint16_t i = 0; i < LOWBAND_FFT_SIZE / 2; i++) {
+                mCos[i] = cosf(2.0f * float(M_PI) * i / LOWBAND_FFT_SIZE);
+                mSin[i] = -sinf(2.0f * float(M_PI) * i / LOWBAND_FFT_SIZE);
+            }
+            // Log-spaced band edges, in FFT bins
+            const float binHz = LOWBAND_RATE / LOWBAND_FFT_SIZE;
+            for (uint8_t b = 0; b <= LOWBAND_NUM_BANDS; b++) {
+                float f = LOWBAND_MIN_FREQ * powf(LOWBAND_MAX_FREQ / LOWBAND_MIN_FREQ, float(b) / LOWBAND_NUM_BANDS);
+                uint16_t bin = static_cast<uint16_t>(lrintf(f / binHz));
+                if (b > 0 && bin <= mBandEdge[b - 1]) bin = mBandEdge[b - 1] + 1;
+                mBandEdge[b] = bin;
+            }
+            mKickLo = static_cast<uint16_t>(lrintf(KICK_MIN_FREQ / binHz));
+            mKickHi = static_cast<uint16_t>(lrintf(KICK_MAX_FREQ / binHz));
+        }
+
+        // Feed one full-rate block (e.g. filteredPcmBuffer from sampleAudio)
+        void process(const int16_t* pcm, uint16_t n, uint32_t nowMs) {
+            mKick = false;
+            int16_t dec[64];
+            while (n > 0) {
+                uint16_t chunk = n > 512 ? 512 : n;
+                uint16_t got = mDecimator.process(pcm, chunk, dec);
+                for (uint16_t i = 0; i < got; i++) {
+                    mRing[mWrite] = dec[i];
+                    mWrite = (mWrite + 1) & (LOWBAND_FFT_SIZE - 1);
+                }
+                pcm += chunk;
+                n -= chunk;
+            }
+            analyze(nowMs);
+        }
+
+        // Drop history, e.g. when analysis resumes after being skipped, so
+        // the first block back is not diffed against a stale ring
+        void reset() {
+            mDecimator.reset();
+            for (uint16_t i = 0; i < LOWBAND_FFT_SIZE; i++) mRing[i] = 0;
+            mWrite = 0;
+            for (uint8_t b = 0; b < LOWBAND_NUM_BANDS; b++) mBand[b] = 0.0f;
+            mKickEnergy = 0.0f;
+            mFluxMean = 0.0f;
+            mKick = false;
+        }
+
+        float band(uint8_t b) const { return b < LOWBAND_NUM_BANDS ? mBand[b] : 0.0f; }
+        float kickEnergy() const { return mKickEnergy; }
+        bool kickDetected() const { return mKick; }
+
+        // Centre frequency of a band (Hz), for labelling/debug
+        float bandFrequency(uint8_t b) const {
+            const float binHz = LOWBAND_RATE / LOWBAND_FFT_SIZE;
+            return 0.5f * (mBandEdge[b] + mBandEdge[b + 1]) * binHz;
+        }
+
+    private:
+        void analyze(uint32_t nowMs) {
+            // Window straight out of the ring, oldest sample first, into
+            // bit-reversed order so the FFT can run in place
+            for (uint16_t i = 0; i < LOWBAND_FFT_SIZE; i++) {
+                uint16_t src = (mWrite + i) & (LOWBAND_FFT_SIZE - 1);
+                uint16_t dst = bitReverse(i);
+                mRe[dst] = mRing[src] * mWindow[i] * (1.0f / 32768.0f);
+                mIm[dst] = 0.0f;
+            }
+            fft();
+
+            float mag[LOWBAND_FFT_SIZE / 2];
+            for (uint16_t k = 0; k < LOWBAND_FFT_SIZE / 2; k++) {
+                mag[k] = sqrtf(mRe[k] * mRe[k] + mIm[k] * mIm[k]);
+            }
+            for (uint8_t b = 0; b < LOWBAND_NUM_BANDS; b++) {
+                float sum = 0.0f;
+                for (uint16_t k = mBandEdge[b]; k < mBandEdge[b + 1]; k++) sum += mag[k];
+                mBand[b] = sum;
+            }
+
+            // Kick onset: positive change of 40-120 Hz energy against a
+            // slowly adapting mean, with a refractory period
+            float kick = 0.0f;
+            for (uint16_t k = mKickLo; k <= mKickHi; k++) kick += mag[k];
+            float flux = kick - mKickEnergy;
+            if (flux < 0.0f) flux = 0.0f;
+            mKickEnergy = kick;
+            mFluxMean = mFluxMean * 0.95f + flux * 0.05f;
+            if (flux > mFluxMean * KICK_THRESHOLD && flux > 0.01f &&
+                nowMs - mLastKickMs > KICK_REFRACTORY_MS) {
+                mKick = true;
+                mLastKickMs = nowMs;
+            }
+        }
+
+        static uint16_t bitReverse(uint16_t v) {
+            uint16_t r = 0;
+            for (uint8_t b = 0; b < LOWBAND_FFT_LOG2; b++) {
+                r = (r << 1) | (v & 1);
+                v >>= 1;
+            }
+            return r;
+        }
+
+        // Iterative radix-2 DIT on bit-reversed input
+        void fft() {
+            for (uint16_t len = 2; len <= LOWBAND_FFT_SIZE; len <<= 1) {
+                uint16_t half = len >> 1;
+                uint16_t step = LOWBAND_FFT_SIZE / len;
+                for (uint16_t i = 0; i < LOWBAND_FFT_SIZE; i += len) {
+                    for (uint16_t j = 0; j < half; j++) {
+                        float wr = mCos[j * step];
+                        float wi = mSin[j * step];
+                        uint16_t a = i + j;
+                        uint16_t b = a + half;
+                        float tr = mRe[b] * wr - mIm[b] * wi;
+                        float ti = mRe[b] * wi + mIm[b] * wr;
+                        mRe[b] = mRe[a] - tr;
+                        mIm[b] = mIm[a] - ti;
+                        mRe[a] += tr;
+                        mIm[a] += ti;
+                    }
+                }
+            }
+        }
+
+        PolyphaseDecimator mDecimator;
+        int16_t mRing[LOWBAND_FFT_SIZE];
+        uint16_t mWrite = 0;
+
+        float mWindow[LOWBAND_FFT_SIZE];
+        float mCos[LOWBAND_FFT_SIZE / 2];
+        float mSin[LOWBAND_FFT_SIZE / 2];
+        float mRe[LOWBAND_FFT_SIZE];
+        float mIm[LOWBAND_FFT_SIZE];
+
+        uint16_t mBandEdge[LOWBAND_NUM_BANDS + 1];
+        float mBand[LOWBAND_NUM_BANDS] = {};
+
+        uint16_t mKickLo = 0;
+        uint16_t mKickHi = 0;
+        float mKickEnergy = 0.0f;
+        float mFluxMean = 0.0f;
+        uint32_t mLastKickMs = 0;
+        bool mKick = false;
+    };
+
+} // namespace myAudio
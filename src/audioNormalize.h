@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace myAudio {
+
+    //=========================================================================
+    // Running-quantile auto-scaling
+    // Every published audio feature gets a streaming P5/P95 estimate that is
+    // updated once per audio block. The features are then handed to the
+    // visualizers already normalized to 0-255, so no renderer needs to know
+    // the raw scale of a feature (or do a float division to get there).
+    //
+    // Each quantile is tracked with a stochastic-approximation estimator:
+    //     q += eta * (p - [x < q])
+    // which needs two floats per feature and no history. The step size eta is
+    // proportional to the current P5..P95 span, so the trackers converge at
+    // the same relative rate whether a feature lives in 0..1 or 0..5000.
+    //=========================================================================
+
+    enum NormFeature : uint8_t {
+        NORM_RMS = 0,
+        NORM_BASS,
+        NORM_MID,
+        NORM_TREBLE,
+        NORM_ENERGY,
+        NORM_PEAK,
+        NORM_CENTROID,
+        NORM_FLATNESS,
+        NORM_FLUX,
+        NORM_TONE0,                             // NORM_TONE_COUNT consecutive Goertzel targets
+        NORM_FFT_BIN0 = NORM_TONE0 + 4,         // 16 consecutive FFT bins
+        NORM_FEATURE_COUNT = NORM_FFT_BIN0 + 16
+    };
+
+    constexpr uint8_t NORM_TONE_COUNT = NORM_FFT_BIN0 - NORM_TONE0;
+
+    constexpr float NORM_P_LOW = 0.05f;
+    constexpr float NORM_P_HIGH = 0.95f;
+
+    // Fraction of the current span moved per block. At ~86 blocks/s
+    // (512 samples @ 44.1kHz) this settles in a few seconds of music.
+    constexpr float NORM_ADAPT_RATE = 0.02f;
+
+    // Minimum span per feature, in the feature's raw units. This keeps the
+    // normalizer from stretching residual noise to full scale when the room
+    // is quiet (the noise gate zeroes the block, but the callbacks still
+    // report small non-zero levels while smoothing decays).
+    constexpr float NORM_MIN_SPAN_RMS = 150.0f;
+    constexpr float NORM_MIN_SPAN_BAND = 20.0f;
+    constexpr float NORM_MIN_SPAN_FFT = 40.0f;
+    constexpr float NORM_MIN_SPAN_TONE = 100.0f;        // sample units, as RMS
+    constexpr float NORM_MIN_SPAN_CENTROID = 500.0f;    // Hz
+    constexpr float NORM_MIN_SPAN_FLATNESS = 0.1f;
+    constexpr float NORM_MIN_SPAN_FLUX = 200.0f;
+
+    struct QuantileRange {
+        float lo = 0.0f;
+        float hi = 0.0f;
+        float minSpan = 1.0f;
+        bool seeded = false;
+
+        void update(float x) {
+            if (!seeded) {
+                lo = x;
+                hi = x + minSpan;
+                seeded = true;
+                return;
+            }
+            float span = hi - lo;
+            if (span < minSpan) span = minSpan;
+            float eta = span * NORM_ADAPT_RATE;
+
+            lo += (x < lo) ? -eta * (1.0f - NORM_P_LOW) : eta * NORM_P_LOW;
+            hi += (x < hi) ? -eta * (1.0f - NORM_P_HIGH) : eta * NORM_P_HIGH;
+
+            // The floor of the range never drops below zero (all features
+            // are magnitudes) and the ceiling never collapses onto the floor
+            if (lo < 0.0f) lo = 0.0f;
+            if (hi < lo + minSpan) hi = lo + minSpan;
+        }
+    };
+
+    class FeatureNormalizer {
+    public:
+        FeatureNormalizer() {
+            for (uint8_t f = 0; f < NORM_FEATURE_COUNT; f++) {
+                switch (f) {
+                    case NORM_RMS:      mRange[f].minSpan = NORM_MIN_SPAN_RMS; break;
+                    case NORM_CENTROID: mRange[f].minSpan = NORM_MIN_SPAN_CENTROID; break;
+                    case NORM_FLATNESS: mRange[f].minSpan = NORM_MIN_SPAN_FLATNESS; break;
+                    case NORM_FLUX:     mRange[f].minSpan = NORM_MIN_SPAN_FLUX; break;
+                    default:
+                        if (f >= NORM_FFT_BIN0) mRange[f].minSpan = NORM_MIN_SPAN_FFT;
+                        else if (f >= NORM_TONE0) mRange[f].minSpan = NORM_MIN_SPAN_TONE;
+                        else mRange[f].minSpan = NORM_MIN_SPAN_BAND;
+                        break;
+                }
+                mLevel[f] = 0;
+            }
+        }
+
+        // Feed one raw value for this block. Call once per feature per block.
+        void update(NormFeature f, float raw) {
+            QuantileRange& r = mRange[f];
+            r.update(raw);
+            // The one division per feature per block lives here, not in the
+            // renderers
+            float scaled = (raw - r.lo) * (255.0f / (r.hi - r.lo));
+            mLevel[f] = (scaled <= 0.0f) ? 0 : (scaled >= 255.0f) ? 255 : static_cast<uint8_t>(scaled);
+        }
+
+        void updateBins(const float* bins, uint8_t count) {
+            if (count > 16) count = 16;
+            for (uint8_t i = 0; i < count; i++) {
+                update(static_cast<NormFeature>(NORM_FFT_BIN0 + i), bins[i]);
+            }
+        }
+
+        uint8_t level(NormFeature f) const { return mLevel[f]; }
+        uint8_t bin(uint8_t i) const { return mLevel[NORM_FFT_BIN0 + (i & 15)]; }
+
+        float low(NormFeature f) const { return mRange[f].lo; }
+        float high(NormFeature f) const { return mRange[f].hi; }
+
+        void reset() {
+            for (uint8_t f = 0; f < NORM_FEATURE_COUNT; f++) {
+                mRange[f].seeded = false;
+                mLevel[f] = 0;
+            }
+        }
+
+    private:
+        QuantileRange mRange[NORM_FEATURE_COUNT];
+        uint8_t mLevel[NORM_FEATURE_COUNT];
+    };
+
+} // namespace myAudio
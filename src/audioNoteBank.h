@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace myAudio {
+
+    //=========================================================================
+    // Note-aligned filterbank and chromagram
+    // Triangular filters centred on equal-tempered notes between
+    // NOTE_MIN_FREQ and NOTE_MAX_FREQ (same G3..D8 range as the 16-band
+    // spectrum), 12 or 24 per octave, applied to the 256-bin STFT magnitude
+    // spectrum. Only non-zero weights are stored (CSR: row start, column,
+    // Q15 weight), built once by init(), so apply() is O(non-zeros):
+    //
+    //   12/octave:  56 notes, ~150 non-zeros  (dense: 56 x 256 = 14.3k MACs)
+    //   24/octave: 111 notes, ~230 non-zeros  (dense: 111 x 256 = 28.4k MACs)
+    //
+    // At 86 Hz/bin a semitone is narrower than one bin below ~1.4 kHz; those
+    // notes fall back to linear interpolation between the two nearest bins.
+    //=========================================================================
+
+    constexpr float NOTE_MIN_FREQ = 196.0f;     // G3
+    constexpr float NOTE_MAX_FREQ = 4698.6f;    // D8
+    constexpr uint8_t NOTE_MAX_ROWS = 112;      // 24/octave over G3..D8 is 111
+    constexpr uint16_t NOTE_MAX_NONZERO = 640;
+    constexpr uint8_t CHROMA_BINS = 12;
+
+    class NoteFilterBank {
+    public:
+        // binsPerOctave: 12 or 24. binHz: spectrum bin spacing. numBins:
+        // length of the magnitude array apply() will be given.
+        void init(uint8_t binsPerOctave, float binHz, uint16_t numBins) {
+            mPerOctave = (binsPerOctave == 24) ? 24 : 12;
+            mRows = 0;
+            mNonZero = 0;
+
+            const float ratio = powf(2.0f, 1.0f / mPerOctave);
+            // Note index relative to A4 (440 Hz) of the first filter
+            const float firstStep = ceilf(mPerOctave * log2f(NOTE_MIN_FREQ / 440.0f) - 0.01f);
+
+            mRowStart[0] = 0;
+            for (uint8_t r = 0; r < NOTE_MAX_ROWS; r++) {
+                const float step = firstStep + r;
+                const float fc = 440.0f * powf(2.0f, step / mPerOctave);
+                if (fc > NOTE_MAX_FREQ * 1.001f) break;
+                const float fLo = fc / ratio;
+                const float fHi = fc * ratio;
+
+                // Pitch class of this note (C = 0, A = 9). With 24 per octave
+                // the quarter-tone rows are left out of the chromagram.
+                int istep = static_cast<int>(step);
+                if (mPerOctave == 24 && (istep & 1)) {
+                    mChromaOf[r] = NO_CHROMA;
+                } else {
+                    int semis = (mPerOctave == 24) ? istep / 2 : istep;
+                    mChromaOf[r] = static_cast<uint8_t>(((semis + 9) % 12 + 12) % 12);
+                }
+
+                float wsum = 0.0f;
+                float w[16];
+                uint16_t col[16];
+                uint8_t cnt = 0;
+
+                uint16_t kLo = static_cast<uint16_t>(ceilf(fLo / binHz));
+                uint16_t kHi = static_cast<uint16_t>(floorf(fHi / binHz));
+                for (uint16_t k = kLo; k <= kHi && k < numBins && cnt < 16; k++) {
+                    float f = k * binHz;
+                    float tri = (f <= fc) ? (f - fLo) / (fc - fLo) : (fHi - f) / (fHi - fc);
+                    if (tri <= 0.0f) continue;
+                    col[cnt] = k;
+                    w[cnt++] = tri;
+                    wsum += tri;
+                }
+
+                if (cnt < 2) {
+                    // Filter narrower than a bin: interpolate the neighbours
+                    float pos = fc / binHz;
+                    uint16_t k0 = static_cast<uint16_t>(pos);
+                    float frac = pos - k0;
+                    cnt = 0;
+                    wsum = 0.0f;
+                    if (k0 < numBins)     { col[cnt] = k0;     w[cnt++] = 1.0f - frac; wsum += 1.0f - frac; }
+                    if (k0 + 1 < numBins) { col[cnt] = k0 + 1; w[cnt++] = frac;        wsum += frac; }
+                }
+
+                for (uint8_t i = 0; i < cnt && mNonZero < NOTE_MAX_NONZERO; i++) {
+                    uint16_t q = static_cast<uint16_t>(lrintf(w[i] / wsum * 32767.0f));
+                    if (q == 0) continue;
+                    mCol[mNonZero] = col[i];
+                    mWeight[mNonZero] = q;
+                    mNonZero++;
+                }
+                mRows = r + 1;
+                mRowStart[mRows] = mNonZero;
+            }
+        }
+
+        // One pass over the non-zeros; fills note energies and the chromagram
+        void apply(const uint16_t* magnitudes) {
+            for (uint8_t c = 0; c < CHROMA_BINS; c++) mChroma[c] = 0;
+            for (uint8_t r = 0; r < mRows; r++) {
+                uint32_t acc = 0;
+                for (uint16_t i = mRowStart[r]; i < mRowStart[r + 1]; i++) {
+                    acc += static_cast<uint32_t>(magnitudes[mCol[i]]) * mWeight[i];
+                }
+                uint16_t v = static_cast<uint16_t>(acc >> 15);
+                mNote[r] = v;
+                if (mChromaOf[r] != NO_CHROMA) mChroma[mChromaOf[r]] += v;
+            }
+        }
+
+        uint8_t rows() const { return mRows; }
+        uint16_t nonZeros() const { return mNonZero; }
+        uint16_t note(uint8_t r) const { return r < mRows ? mNote[r] : 0; }
+
+        // Pitch class energies, C = 0 ... B = 11
+        uint32_t chroma(uint8_t c) const { return mChroma[c % CHROMA_BINS]; }
+
+        // Pitch class with the most energy this block
+        uint8_t dominantPitchClass() const {
+            uint8_t best = 0;
+            for (uint8_t c = 1; c < CHROMA_BINS; c++) {
+                if (mChroma[c] > mChroma[best]) best = c;
+            }
+            return best;
+        }
+
+    private:
+        static constexpr uint8_t NO_CHROMA = 0xFF;
+
+        uint8_t mPerOctave = 12;
+        uint8_t mRows = 0;
+        uint16_t mNonZero = 0;
+
+        uint16_t mRowStart[NOTE_MAX_ROWS + 1] = {};
+        uint16_t mCol[NOTE_MAX_NONZERO];
+        uint16_t mWeight[NOTE_MAX_NONZERO];        // Q15, each row sums to ~1
+        uint8_t mChromaOf[NOTE_MAX_ROWS];
+
+        uint16_t mNote[NOTE_MAX_ROWS] = {};
+        uint32_t mChroma[CHROMA_BINS] = {};
+    };
+
+} // namespace myAudio
@@ -2,6 +2,14 @@
 
 #include "bleControl.h"
 #include "audioInput.h"
+#include "audioNormalize.h"
+#include "audioLowBand.h"
+#include "audioSTFT.h"
+#include "audioGoertzel.h"
+#include "audioNoteBank.h"
+#include "audioDescriptors.h"
+#include "bandDynamics.h"
+#include "audioTelemetry.h"
 #include "fl/audio.h"
 #include "fl/fft.h"
 #include "fl/audio/audio_context.h"
@@ -26,6 +34,11 @@ namespace myAudio {
     constexpr float NOISE_GATE_OPEN = 80.0f;   // Signal must exceed this to open gate
     constexpr float NOISE_GATE_CLOSE = 50.0f;  // Signal must fall below this to close gate
 
+    // Idle mode: after this long with the gate closed and no onsets, the
+    // analysis stages are skipped and rendering drops to IDLE_FRAME_MS.
+    // The first block with the gate open wakes everything again.
+    constexpr uint32_t IDLE_ENTER_MS = 3000;
+
     //=========================================================================
     // Core audio objects
     //=========================================================================
@@ -56,6 +69,23 @@ namespace myAudio {
     float energyLevel = 0.0f;
     float peakLevel = 0.0f;
 
+    // Noise gate state and the block RMS it last decided on
+    bool gateOpen = false;
+    float gateRMS = 0.0f;
+
+    // Idle state (see updateIdleState)
+    bool audioIdle = false;
+    uint32_t lastActivityTime = 0;
+    uint32_t idleBlocks = 0;
+    uint32_t activeBlocks = 0;
+
+    // Blocks each optional analysis stage ran for (see activeAnalysisNeeds)
+    uint32_t processorBlocks = 0;
+    uint32_t lowBandBlocks = 0;
+    uint32_t stftBlocks = 0;
+    uint32_t timbreBlocks = 0;
+    uint32_t spectrumBlocks = 0;
+
     //=========================================================================
     // FFT configuration
     //=========================================================================
@@ -64,6 +94,73 @@ namespace myAudio {
     constexpr float FFT_MIN_FREQ = 174.6f;   // ~G3
     constexpr float FFT_MAX_FREQ = 4698.3f;  // ~D8
 
+    // Spectrum stage engine
+    //   false: fl::FFT (float) via AudioContext::getFFT
+    //   true:  in-tree Q15 radix-4 real FFT (audioFFTQ15.h)
+    constexpr bool USE_Q15_SPECTRUM = false;
+
+    // Band levels published by the spectrum stage, whichever engine produced them
+    float spectrumBins[NUM_FFT_BINS] = {0};
+
+    // Overlapping Q15 STFT (see audioSTFT.h). Hop is set over BLE (inStftHop);
+    // its latest frame backs the Q15 spectrum engine and its spectral-flux
+    // onsets are published as stftOnset
+    StftStage stft;
+    bool stftOnset = false;
+    uint32_t stftOnsetCount = 0;
+
+    // Goertzel bank (see audioGoertzel.h). Modes that only need a few band
+    // energies set targets here instead of asking for the spectrum stage
+    GoertzelBank goertzel;
+
+    //=========================================================================
+    // Analysis needs
+    // The visualizer in use declares which stages it reads (configureAnalysis()
+    // in audioTest sets analysisNeeds) and sampleAudio() skips the others.
+    // The gate, block RMS and the Goertzel bank (when it has targets) always
+    // run; with no needs set that is all a block costs. While BLE telemetry is
+    // streaming, the stages behind its fields (levels, onsets, spectrum bins)
+    // run as well, so the stream never shows stale features; the low band
+    // stays with the visualizer.
+    //=========================================================================
+
+    enum AnalysisNeed : uint8_t {
+        NEED_STFT = 0x01,       // STFT frames and onsets
+        NEED_SPECTRUM = 0x02,   // spectrumBins and the normalized bins
+        NEED_PROCESSOR = 0x04,  // AudioProcessor: beats, tempo, band/energy/peak levels
+        NEED_LOWBAND = 0x08,    // decimated bass bands and kick detection
+        NEED_TIMBRE = 0x10,     // note bank, chromagram and spectral descriptors; implies NEED_STFT
+        NEED_ALL = 0xFF
+    };
+
+    uint8_t analysisNeeds = NEED_ALL;
+
+    // Note-aligned filterbank and 12-bin chromagram over the STFT spectrum
+    // (see audioNoteBank.h). 12 or 24 filters per octave.
+    constexpr uint8_t NOTE_BANK_PER_OCTAVE = 12;
+    NoteFilterBank noteBank;
+
+    // Timbre descriptors over the STFT spectrum (see audioDescriptors.h).
+    // Raw values in spectral.descriptors(); centroid, flatness and flux are
+    // also auto-scaled through the normalizer for brightness/colour mapping
+    DescriptorExtractor spectral;
+
+    //=========================================================================
+    // Auto-scaling of published features (see audioNormalize.h)
+    // Visualizers read normalizer.level()/normalizer.bin() (0-255) instead of
+    // comparing raw levels against hand-tuned full-scale numbers
+    //=========================================================================
+
+    FeatureNormalizer normalizer;
+
+    //=========================================================================
+    // Decimated low-band analysis (see audioLowBand.h)
+    // 21.5 Hz resolution from 30-400 Hz and a kick detector, at a fraction
+    // of the cost of a larger full-rate FFT
+    //=========================================================================
+
+    LowBandAnalyzer lowBand;
+
     //=========================================================================
     // Initialize audio processing with callbacks
     //=========================================================================
@@ -75,6 +172,9 @@ namespace myAudio {
 
     void initAudioProcessing() {
 
+        noteBank.init(NOTE_BANK_PER_OCTAVE, Q15_FFT_SAMPLE_RATE / Q15_FFT_SIZE, Q15_FFT_COMPLEX);
+        spectral.init(Q15_FFT_SAMPLE_RATE / Q15_FFT_SIZE, Q15_FFT_COMPLEX);
+
         // Beat detection callbacks
         audioProcessor.onBeat([]() {
             beatCount++;
@@ -87,6 +187,7 @@ namespace myAudio {
         audioProcessor.onOnset([](float strength) {
             onsetCount++;
             lastOnsetStrength = strength;
+            lastActivityTime = fl::millis();
             // Serial.print("Onset strength=");
             // Serial.println(strength);
         });
@@ -128,6 +229,95 @@ namespace myAudio {
         Serial.println("AudioProcessor initialized with callbacks");
     }
 
+    //=========================================================================
+    // Spectrum stage
+    // Fills spectrumBins[] with NUM_FFT_BINS log-spaced bands between
+    // FFT_MIN_FREQ and FFT_MAX_FREQ from the selected FFT engine
+    //=========================================================================
+
+    void mapQ15Bands(const uint16_t* magnitudes) {
+        static uint8_t bandStart[NUM_FFT_BINS + 1];
+        static bool edgesReady = false;
+        constexpr float binHz = Q15_FFT_SAMPLE_RATE / Q15_FFT_SIZE;
+
+        if (!edgesReady) {
+            for (uint8_t b = 0; b <= NUM_FFT_BINS; b++) {
+                float f = FFT_MIN_FREQ * powf(FFT_MAX_FREQ / FFT_MIN_FREQ, float(b) / NUM_FFT_BINS);
+                bandStart[b] = static_cast<uint8_t>(lrintf(f / binHz));
+            }
+            edgesReady = true;
+        }
+
+        for (uint8_t b = 0; b < NUM_FFT_BINS; b++) {
+            uint8_t lo = bandStart[b];
+            uint8_t hi = bandStart[b + 1];
+            if (hi <= lo) {
+                // Low bands are narrower than one FFT bin: use the nearest bin
+                spectrumBins[b] = magnitudes[lo];
+                continue;
+            }
+            uint32_t sum = 0;
+            for (uint8_t k = lo; k < hi; k++) sum += magnitudes[k];
+            spectrumBins[b] = float(sum) / (hi - lo);
+        }
+    }
+
+    void updateSpectrum() {
+        if (USE_Q15_SPECTRUM) {
+            mapQ15Bands(stft.magnitudes());
+            return;
+        }
+
+        auto ctx = audioProcessor.getContext();
+        if (!ctx) return;
+        const fl::FFTBins& fft = ctx->getFFT(NUM_FFT_BINS, FFT_MIN_FREQ, FFT_MAX_FREQ);
+        for (uint8_t b = 0; b < NUM_FFT_BINS && b < fft.bins_raw.size(); b++) {
+            spectrumBins[b] = fft.bins_raw[b];
+        }
+    }
+
+    uint8_t activeAnalysisNeeds() {
+        uint8_t needs = analysisNeeds;
+        if (cTelemetryHz > 0) needs |= NEED_PROCESSOR | NEED_SPECTRUM | NEED_STFT;
+        // The note bank and descriptors run on the STFT's frames
+        if (needs & NEED_TIMBRE) needs |= NEED_STFT;
+        // The Q15 spectrum engine reads the STFT's latest frame; the fl::FFT
+        // engine reads the AudioProcessor's context
+        if (needs & NEED_SPECTRUM) needs |= USE_Q15_SPECTRUM ? NEED_STFT : NEED_PROCESSOR;
+        return needs;
+    }
+
+    //=========================================================================
+    // Idle state machine
+    // Active -> idle once the gate has been closed and no onset has fired for
+    // IDLE_ENTER_MS. Idle -> active on the first block that opens the gate,
+    // so wake-up costs at most one block.
+    //=========================================================================
+
+    void enterIdle() {
+        audioIdle = true;
+        beatDetected = false;
+        stftOnset = false;
+        bassLevel = midLevel = trebleLevel = 0.0f;
+        energyLevel = peakLevel = 0.0f;
+    }
+
+    bool updateIdleState(bool gateOpen) {
+        uint32_t now = fl::millis();
+        if (gateOpen) {
+            lastActivityTime = now;
+            audioIdle = false;
+        } else if (!audioIdle && now - lastActivityTime >= IDLE_ENTER_MS) {
+            enterIdle();
+        }
+        if (audioIdle) idleBlocks++; else activeBlocks++;
+        return audioIdle;
+    }
+
+    bool isIdle() {
+        return audioIdle;
+    }
+
     //=========================================================================
     // Sample audio and process
     //=========================================================================
@@ -202,12 +392,11 @@ namespace myAudio {
 
         // Calculate RMS of the filtered signal
         float blockRMS = (validSamples > 0) ? fl::sqrtf(static_cast<float>(sumSq) / validSamples) : 0.0f;
+        gateRMS = blockRMS;
 
         // NOISE GATE with hysteresis to prevent flickering
         // Gate opens when signal exceeds NOISE_GATE_OPEN
         // Gate closes when signal falls below NOISE_GATE_CLOSE
-        static bool gateOpen = false;
-
         if (blockRMS >= NOISE_GATE_OPEN) {
             gateOpen = true;
         } else if (blockRMS < NOISE_GATE_CLOSE) {
@@ -226,10 +415,76 @@ namespace myAudio {
         fl::span<const int16_t> filteredSpan(filteredPcmBuffer, n);
         filteredSample = AudioSample(filteredSpan, currentSample.timestamp());
 
+        // In idle only the gate runs: skip AudioProcessor (FFT, tempo) and all
+        // analysis stages, but keep the RMS range tracking silence
+        if (updateIdleState(gateOpen)) {
+            normalizer.update(NORM_RMS, 0.0f);
+            return;
+        }
+
+        const uint8_t needs = activeAnalysisNeeds();
+        static uint8_t lastNeeds = NEED_ALL;
+
         // Process through AudioProcessor (triggers callbacks)
         // TEST: Try raw sample to see if FFT crash is related to filtering
         //audioProcessor.update(currentSample);      // raw - for testing
-         audioProcessor.update(filteredSample);  // filtered
+        if (needs & NEED_PROCESSOR) {
+            audioProcessor.update(filteredSample);  // filtered
+            processorBlocks++;
+            normalizer.update(NORM_BASS, bassLevel);
+            normalizer.update(NORM_MID, midLevel);
+            normalizer.update(NORM_TREBLE, trebleLevel);
+            normalizer.update(NORM_ENERGY, energyLevel);
+            normalizer.update(NORM_PEAK, peakLevel);
+        } else {
+            bassLevel = midLevel = trebleLevel = 0.0f;
+            energyLevel = peakLevel = 0.0f;
+        }
+
+        // Decimated bass/kick analysis runs on the same gated, filtered block
+        if (needs & NEED_LOWBAND) {
+            if (!(lastNeeds & NEED_LOWBAND)) lowBand.reset();
+            lowBand.process(filteredPcmBuffer, static_cast<uint16_t>(n < 512 ? n : 512), fl::millis());
+            lowBandBlocks++;
+        }
+
+        // Overlapping STFT frames at the BLE-selected hop (two Q15 FFTs per
+        // block at the default hop), only for modes that read them
+        if (needs & NEED_STFT) {
+            if (!(lastNeeds & NEED_STFT)) stft.reset();
+            stft.setHop(cStftHop);
+            stft.process(filteredPcmBuffer, static_cast<uint16_t>(n < 512 ? n : 512));
+            stftBlocks++;
+            stftOnset = stft.onsetDetected();
+            if (stftOnset) stftOnsetCount++;
+            if (needs & NEED_TIMBRE) {
+                if (!(lastNeeds & NEED_TIMBRE)) spectral.reset();
+                noteBank.apply(stft.magnitudes());
+                spectral.process(stft.magnitudes());
+                timbreBlocks++;
+                normalizer.update(NORM_CENTROID, spectral.descriptors().centroidHz);
+                normalizer.update(NORM_FLATNESS, spectral.descriptors().flatness);
+                normalizer.update(NORM_FLUX, spectral.descriptors().flux);
+            }
+        } else {
+            stftOnset = false;
+        }
+        lastNeeds = needs;
+
+        // Update running P5/P95 ranges once per block (features above are
+        // updated only when their stage ran)
+        normalizer.update(NORM_RMS, gateOpen ? blockRMS : 0.0f);
+
+        goertzel.process(filteredPcmBuffer, static_cast<uint16_t>(n < 512 ? n : 512));
+        for (uint8_t t = 0; t < goertzel.count() && t < NORM_TONE_COUNT; t++) {
+            normalizer.update(static_cast<NormFeature>(NORM_TONE0 + t), goertzel.level(t));
+        }
+
+        if (needs & NEED_SPECTRUM) {
+            updateSpectrum();
+            spectrumBlocks++;
+            normalizer.updateBins(spectrumBins, NUM_FFT_BINS);
+        }
     }
 
     //=========================================================================
@@ -313,6 +568,40 @@ namespace myAudio {
         return currentSample.pcm();
     }
 
+    //=========================================================================
+    // Telemetry record (see audioTelemetry.h and AUDIO TELEMETRY in bleControl.h)
+    // Beat and onset flags latch every event since the previous record, so a
+    // 20 Hz stream still shows the ones that only lasted a single block
+    //=========================================================================
+
+    static_assert(NUM_FFT_BINS == TELEM_BINS, "Telemetry carries one byte per spectrum bin");
+
+    void fillTelemetryRecord(uint8_t* record) {
+        static uint32_t lastBeats = 0;
+        static uint32_t lastOnsets = 0;
+        const uint32_t onsets = onsetCount + stftOnsetCount;
+
+        uint8_t flags = 0;
+        if (gateOpen) flags |= TELEM_GATE_OPEN;
+        if (beatCount != lastBeats) flags |= TELEM_BEAT;
+        if (onsets != lastOnsets) flags |= TELEM_ONSET;
+        if (audioIdle) flags |= TELEM_IDLE;
+        lastBeats = beatCount;
+        lastOnsets = onsets;
+
+        const uint16_t rms = gateRMS < 65535.0f ? static_cast<uint16_t>(gateRMS) : 65535;
+        record[TELEM_FLAGS] = flags;
+        record[TELEM_BPM] = currentBPM < 255.0f ? static_cast<uint8_t>(currentBPM + 0.5f) : 255;
+        record[TELEM_RMS_LO] = rms & 0xFF;
+        record[TELEM_RMS_HI] = rms >> 8;
+        record[TELEM_BASS] = normalizer.level(NORM_BASS);
+        record[TELEM_MID] = normalizer.level(NORM_MID);
+        record[TELEM_TREBLE] = normalizer.level(NORM_TREBLE);
+        for (uint8_t b = 0; b < NUM_FFT_BINS; b++) {
+            record[TELEM_BIN0 + b] = normalizer.bin(b);
+        }
+    }
+
     //=========================================================================
     // Debug output
     //=========================================================================
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include "audioFFTQ15.h"
+
+namespace myAudio {
+
+    //=========================================================================
+    // Overlapping STFT stage
+    // Incoming PCM goes into a sample ring; a 512-point Q15 frame is taken
+    // every `hop` samples, windowed straight out of the ring (wrap-around
+    // indexing, no copy). Frequency resolution stays at 86 Hz/bin while the
+    // time step drops from the I2S block length to the hop:
+    //
+    //   hop   frames/block   onset time step   FFT cost vs hop 512
+    //   512        1             11.6 ms              1x
+    //   256        2              5.8 ms              2x
+    //   128        4              2.9 ms              4x
+    //    64        8              1.5 ms              8x
+    //
+    // A transient that straddles two I2S blocks lands in the middle of an
+    // overlapping frame instead of being split across two.
+    //=========================================================================
+
+    constexpr uint16_t STFT_RING_SIZE = 1024;   // power of two, >= frame + largest hop
+    constexpr uint16_t STFT_RING_MASK = STFT_RING_SIZE - 1;
+    constexpr uint16_t STFT_MIN_HOP = 64;
+    constexpr uint16_t STFT_MAX_HOP = Q15_FFT_SIZE;
+
+    // Spectral-flux onset detector on the STFT frames
+    constexpr uint16_t STFT_FLUX_MAX_BIN = 110;     // ~4.7 kHz, matches FFT_MAX_FREQ
+    constexpr float STFT_ONSET_THRESHOLD = 1.8f;    // flux must exceed mean * this
+    constexpr uint32_t STFT_ONSET_MIN_FLUX = 200;   // ignore flux from residual noise
+
+    class StftStage {
+    public:
+        void setHop(uint16_t hop) {
+            if (hop < STFT_MIN_HOP) hop = STFT_MIN_HOP;
+            if (hop > STFT_MAX_HOP) hop = STFT_MAX_HOP;
+            mHop = hop;
+        }
+        uint16_t hop() const { return mHop; }
+
+        // Forget the ring after the stage was paused: the next frame waits for
+        // a full window of new samples, and can't fire an onset against the
+        // stale previous frame
+        void reset() {
+            mFilled = 0;
+            mSinceFrame = 0;
+            mOnset = false;
+            mArmed = false;
+        }
+
+        // Push one block; runs as many frames as the hop calls for
+        void process(const int16_t* pcm, uint16_t n) {
+            mOnset = false;
+            mFramesThisBlock = 0;
+            for (uint16_t i = 0; i < n; i++) {
+                mRing[mWrite] = pcm[i];
+                mWrite = (mWrite + 1) & STFT_RING_MASK;
+                if (mFilled < Q15_FFT_SIZE) mFilled++;
+                if (++mSinceFrame >= mHop && mFilled >= Q15_FFT_SIZE) {
+                    mSinceFrame = 0;
+                    runFrame();
+                }
+            }
+        }
+
+        // Magnitudes of the most recent frame (Q15_FFT_COMPLEX bins)
+        const uint16_t* magnitudes() const { return mMag[mCurrent]; }
+
+        bool onsetDetected() const { return mOnset; }
+        uint32_t onsetFlux() const { return mOnsetFlux; }
+        uint8_t framesThisBlock() const { return mFramesThisBlock; }
+        uint32_t frameCount() const { return mFrameCount; }
+
+    private:
+        void runFrame() {
+            uint8_t prev = mCurrent;
+            mCurrent ^= 1;
+            uint16_t start = (mWrite - Q15_FFT_SIZE) & STFT_RING_MASK;
+            mSpectrum.computeRing(mRing, STFT_RING_MASK, start, mMag[mCurrent]);
+            mFrameCount++;
+            mFramesThisBlock++;
+
+            // Half-wave rectified spectral flux against the previous frame
+            const uint16_t* cur = mMag[mCurrent];
+            const uint16_t* old = mMag[prev];
+            uint32_t flux = 0;
+            for (uint16_t k = 1; k < STFT_FLUX_MAX_BIN; k++) {
+                if (cur[k] > old[k]) flux += cur[k] - old[k];
+            }
+
+            // Mean adapts per frame; scale the rate by hop so the time
+            // constant (~0.4 s) doesn't depend on the hop setting
+            float alpha = 0.03f * (float(mHop) / STFT_MAX_HOP);
+            bool onset = flux > STFT_ONSET_MIN_FLUX && flux > mFluxMean * STFT_ONSET_THRESHOLD;
+            mFluxMean += (float(flux) - mFluxMean) * alpha;
+
+            // Re-arm only after flux falls back, so one transient seen by
+            // several overlapping frames counts once
+            if (onset && mArmed) {
+                mOnset = true;
+                mOnsetFlux = flux;
+                mArmed = false;
+            } else if (!onset) {
+                mArmed = true;
+            }
+        }
+
+        Q15Spectrum mSpectrum;
+        int16_t mRing[STFT_RING_SIZE] = {};
+        uint16_t mWrite = 0;
+        uint16_t mFilled = 0;
+        uint16_t mSinceFrame = 0;
+        uint16_t mHop = 256;
+
+        uint16_t mMag[2][Q15_FFT_COMPLEX] = {};
+        uint8_t mCurrent = 0;
+
+        float mFluxMean = 0.0f;
+        uint32_t mOnsetFlux = 0;
+        uint32_t mFrameCount = 0;
+        uint8_t mFramesThisBlock = 0;
+        bool mOnset = false;
+        bool mArmed = true;
+    };
+
+} // namespace myAudio
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+//=============================================================================
+// Audio feature telemetry
+// A record is TELEM_FIELDS bytes laid out by TelemetryField: flags (gate,
+// beat, onset, idle), BPM, the gate's block RMS as 16 bits, the normalized
+// bass/mid/treble levels and the 16 normalized spectrum bins. Every field is
+// one byte so a change mask can address each of them.
+//
+// TelemetryEncoder sends a record as the fields that differ from what the
+// receiver already holds:
+//
+//    [seq] [mask, TELEM_MASK_BYTES LE] [value of each masked field, in field order]
+//
+// A packet never exceeds the payload budget it is given (20 bytes at the
+// default MTU). When more fields changed than fit, the header fields go
+// first and the bins take turns starting where the last full packet
+// stopped; the rest go in later packets, so the receiver's copy is always
+// made of real values, at worst a packet or two old. Each packet also
+// re-sends one field round-robin, which repairs a dropped notification
+// within TELEM_FIELDS packets. seq counts packets so gaps can be seen.
+// Fields are only ever appended; a decoder stops after the ones it knows.
+//=============================================================================
+
+enum TelemetryField : uint8_t {
+	TELEM_FLAGS = 0,
+	TELEM_BPM,			// whole beats per minute, 0 until the tempo tracker locks on
+	TELEM_RMS_LO,		// block RMS the noise gate decided on (int16 sample units)
+	TELEM_RMS_HI,
+	TELEM_BASS,			// normalized levels, 0-255
+	TELEM_MID,
+	TELEM_TREBLE,
+	TELEM_BIN0,			// 16 normalized spectrum bins, 0-255
+	TELEM_FIELDS = TELEM_BIN0 + 16
+};
+
+enum TelemetryFlag : uint8_t {
+	TELEM_GATE_OPEN = 0x01,
+	TELEM_BEAT = 0x02,		// a beat since the previous record
+	TELEM_ONSET = 0x04,		// an onset since the previous record
+	TELEM_IDLE = 0x08
+};
+
+constexpr uint8_t TELEM_BINS = TELEM_FIELDS - TELEM_BIN0;
+constexpr uint8_t TELEM_MASK_BYTES = (TELEM_FIELDS + 7) / 8;
+constexpr uint8_t TELEM_PACKET_HEADER = 1 + TELEM_MASK_BYTES;
+constexpr uint8_t TELEM_PACKET_MAX = TELEM_PACKET_HEADER + TELEM_FIELDS;
+
+static_assert(TELEM_FIELDS <= 32, "Telemetry change mask is 32 bits");
+static_assert(TELEM_PACKET_HEADER + TELEM_BIN0 <= 20, "Header fields must fit the default MTU");
+
+class TelemetryEncoder {
+public:
+	// The receiver holds nothing yet: the next packets send every field
+	void reset() {
+		memset(mSent, 0, sizeof(mSent));
+		mOwed = (TELEM_FIELDS == 32) ? 0xFFFFFFFFu : (1u << TELEM_FIELDS) - 1;
+		mRefresh = 0;
+		mNextBin = 0;
+	}
+
+	// Writes the packet for record into out (at least TELEM_PACKET_MAX
+	// bytes) and returns its length, at most budget
+	uint8_t encode(const uint8_t* record, uint8_t* out, uint8_t budget) {
+		mOwed |= 1u << mRefresh;
+		if (++mRefresh == TELEM_FIELDS) mRefresh = 0;
+
+		uint32_t changed = mOwed;
+		for (uint8_t i = 0; i < TELEM_FIELDS; i++) {
+			if (record[i] != mSent[i]) changed |= 1u << i;
+		}
+
+		if (budget > TELEM_PACKET_MAX) budget = TELEM_PACKET_MAX;
+		uint8_t room = budget > TELEM_PACKET_HEADER ? budget - TELEM_PACKET_HEADER : 0;
+		uint32_t mask = 0;
+		for (uint8_t i = 0; i < TELEM_BIN0 && room > 0; i++) {
+			if (changed & (1u << i)) {
+				mask |= 1u << i;
+				room--;
+			}
+		}
+		for (uint8_t k = 0; k < TELEM_BINS; k++) {
+			const uint8_t b = (mNextBin + k) % TELEM_BINS;
+			const uint32_t bit = 1u << (TELEM_BIN0 + b);
+			if (!(changed & bit)) continue;
+			if (room == 0) {
+				mNextBin = b;		// first bin left out goes first next time
+				break;
+			}
+			mask |= bit;
+			room--;
+		}
+
+		uint8_t len = 0;
+		out[len++] = mSeq++;
+		for (uint8_t i = 0; i < TELEM_MASK_BYTES; i++) {
+			out[len++] = static_cast<uint8_t>(mask >> (8 * i));
+		}
+		for (uint8_t i = 0; i < TELEM_FIELDS; i++) {
+			if (!(mask & (1u << i))) continue;
+			out[len++] = record[i];
+			mSent[i] = record[i];
+		}
+		mOwed &= ~mask;
+		return len;
+	}
+
+private:
+	uint8_t mSent[TELEM_FIELDS] = {};
+	uint32_t mOwed = (TELEM_FIELDS == 32) ? 0xFFFFFFFFu : (1u << TELEM_FIELDS) - 1;
+	uint8_t mSeq = 0;
+	uint8_t mRefresh = 0;
+	uint8_t mNextBin = 0;
+};
@@ -6,6 +6,7 @@ namespace audioTest {
     extern bool audioTestInstance;
     
     void initAudioTest(uint16_t (*xy_func)(uint8_t, uint8_t));
-    void runAudioTest();
+    bool runAudioTest();
+    void invalidateBars();
 
 } // namespace audioTest
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include "bleControl.h"
 #include "audioProcessing.h"
 #include "fl/xymap.h"
+#include "rowRing.h"
+#include "particles.h"
+#include "heatField.h"
+#include "barFrame.h"
+#include "scopeFrame.h"
 
 // Access to LED array from main.cpp
 extern CRGB leds[];
@@ -16,8 +21,28 @@ namespace audioTest {
     uint16_t (*xyFunc)(uint8_t x, uint8_t y);
 
 	uint8_t hue = 0;
-	uint8_t visualizationMode = 0;  // 0=spectrum, 1=VU meter, 2=beat pulse, 3=bass ripple
-	const uint8_t NUM_VIS_MODES = 4;
+	uint8_t visualizationMode = 0;  // 0=spectrum, 1=VU meter, 2=beat pulse, 3=bass ripple, 4=radial spectrum,
+									// 5=waterfall, 6=matrix rain, 7=oscilloscope, 8=particles, 9=fire
+	const uint8_t NUM_VIS_MODES = 10;
+
+	// Draw function (visualizationMode) for each BLE MODE, in AUDIOREACTIVE_MODES order
+	const uint8_t MODE_VISUALIZER[] = {
+		0,	// spectrumbars
+		4,	// radialspectrum
+		7,	// waveform
+		1,	// vumeter
+		6,	// matrixrain
+		9,	// fireeffect
+		5,	// waterfall
+		2,	// beatpulse
+		3,	// bassripple
+		8,	// particles
+	};
+	static_assert(sizeof(MODE_VISUALIZER) == sizeof(AUDIOREACTIVE_MODES) / sizeof(AUDIOREACTIVE_MODES[0]),
+				  "One draw function per AUDIOREACTIVE mode");
+
+	// Attack/release and falling peak markers shared by the spectrum-style views
+	BandDynamics<NUM_FFT_BINS> spectrumDynamics;
 
     void initAudioTest(uint16_t (*xy_func)(uint8_t, uint8_t)) {
         audioTestInstance = true;
@@ -45,59 +70,81 @@ namespace audioTest {
 	}
 
 	//===============================================================================================
-	// VISUALIZATION MODE 0: Spectrum Analyzer
-	// Shows 16 FFT frequency bins as vertical bars across the matrix
+	// Incremental bar rendering (see barFrame.h)
+	// The whole frame is cleared and redrawn when the palette, mapping or mode changes, or after
+	// something else wrote to leds[] (invalidateBars()).
 	//===============================================================================================
-	void drawSpectrum() {
-		CRGBPalette16 palette = getCurrentPalette();
+	struct BarFrameState {
+		BarFrame<WIDTH, HEIGHT> bars;
+		uint8_t palette = 255;
+		uint8_t mapping = 255;
+		uint8_t mode = 255;
+		bool valid = false;
+	};
+
+	BarFrameState barState;
+	uint8_t lastDrawnMode = 255;	// set by runAudioTest() after every draw
+	uint32_t pixelsTouched = 0;		// diagnostic: LED writes by bar visualizers
+
+	void invalidateBars() {
+		barState.valid = false;
+	}
 
-		// Clear the display
-		fill_solid(leds, WIDTH * HEIGHT, CRGB::Black);
+	// Prepares leds[] and the bar heights for an incremental frame of the given mode
+	void beginBarFrame(uint8_t mode) {
+		if (barState.valid && barState.mode == mode && lastDrawnMode == mode &&
+			barState.palette == cColorPalette && barState.mapping == cMapping) {
+			return;
+		}
+		pixelsTouched += barState.bars.clear(leds);
+		barState.palette = cColorPalette;
+		barState.mapping = cMapping;
+		barState.mode = mode;
+		barState.valid = true;
+	}
 
-		// DEBUG: Check where crash occurs
-		Serial.println("drawSpectrum: before getFFT");
+	//===============================================================================================
+	// VISUALIZATION MODE 0: Spectrum Analyzer
+	// Shows 16 FFT frequency bins as vertical bars across the matrix, with falling peak markers
+	//===============================================================================================
 
-		const fl::FFTBins* fft = myAudio::getFFT();
+	// Feed this block's auto-scaled bands through the shared attack/release/peak engine
+	void updateSpectrumDynamics() {
+		uint8_t bands[NUM_FFT_BINS];
+		for (uint8_t bin = 0; bin < NUM_FFT_BINS; bin++) {
+			bands[bin] = myAudio::normalizer.bin(bin);
+		}
+		spectrumDynamics.update(bands);
+	}
 
-		Serial.println("drawSpectrum: after getFFT");
+	void drawSpectrum() {
+		CRGBPalette16 palette = getCurrentPalette();
 
-		if (!fft || fft->bins_raw.size() == 0) {
-			Serial.println("drawSpectrum: no FFT data");
-			return;
-		}
+		beginBarFrame(0);
 
-		Serial.print("drawSpectrum: got ");
-		Serial.print(fft->bins_raw.size());
-		Serial.println(" bins");
+		// Bands come from the spectrum stage (fl::FFT or Q15, see
+		// USE_Q15_SPECTRUM), already auto-scaled by the normalizer
+		updateSpectrumDynamics();
 
 		// Calculate bar width - spread 16 bins across WIDTH
 		uint8_t barWidth = WIDTH / 16;
 		if (barWidth < 1) barWidth = 1;
 
-		for (uint8_t bin = 0; bin < 16 && bin < fft->bins_raw.size(); bin++) {
-			// Get bin value and scale it (bins can be 0-500+ based on our observations)
-			float rawValue = fft->bins_raw[bin];
-			// Scale: assume max around 300 for good visual range
-			uint8_t barHeight = constrain(map((int)rawValue, 0, 300, 0, HEIGHT), 0, HEIGHT);
+		for (uint8_t bin = 0; bin < NUM_FFT_BINS; bin++) {
+			uint8_t barHeight = spectrumDynamics.levelScaled(bin, HEIGHT);
+			uint8_t peakRow = spectrumDynamics.peakScaled(bin, HEIGHT);
 
 			// Calculate x position for this bar
 			uint8_t xStart = bin * barWidth;
 
-			// Draw the bar from bottom up
-			for (uint8_t y = 0; y < barHeight; y++) {
+			for (uint8_t xOff = 0; xOff < barWidth; xOff++) {
+				uint8_t x = xStart + xOff;
+				if (x >= WIDTH) break;
+
 				// Color based on height (low=green, mid=yellow, high=red style via palette)
-				uint8_t colorIndex = map(y, 0, HEIGHT - 1, 0, 255);
-				CRGB color = ColorFromPalette(palette, colorIndex);
-
-				// Draw bar width
-				for (uint8_t xOff = 0; xOff < barWidth; xOff++) {
-					uint8_t x = xStart + xOff;
-					if (x < WIDTH) {
-						// y=0 is top, so draw from bottom: HEIGHT-1-y
-						uint16_t idx = xyFunc(x, HEIGHT - 1 - y);
-						leds[idx] = color;
-					}
-				}
+				pixelsTouched += barState.bars.column(leds, xyFunc, x, barHeight, peakRow, [&](uint8_t y) {
+					return ColorFromPalette(palette, map(y, 0, HEIGHT - 1, 0, 255));
+				});
 			}
 		}
 	}
@@ -109,27 +156,11 @@ namespace audioTest {
 	void drawVUMeter() {
 		CRGBPalette16 palette = getCurrentPalette();
 
-		// Clear the display
-		fill_solid(leds, WIDTH * HEIGHT, CRGB::Black);
-
-		// Get RMS (with spike filtering and DC correction)
-		float rms = myAudio::getRMS();
-
-		// Observed ranges from INMP441 with spike filtering:
-		//   Quiet room: 10-50
-		//   Speech/claps: 100-400
-		//   Loud music nearby: 400-800+
-		// We use a noise floor cutoff and scale the rest
-
-		constexpr float NOISE_FLOOR = 35.0f;    // Below this = silence; was 40
-		constexpr float MAX_SIGNAL = 550.0f;    // Full scale signal;  was 600
-
-		// Subtract noise floor and scale
-		float signal = rms - NOISE_FLOOR;
-		if (signal < 0) signal = 0;
+		beginBarFrame(1);
 
-		// Map to display width
-		uint8_t level = constrain((int)((signal / (MAX_SIGNAL - NOISE_FLOOR)) * WIDTH), 0, WIDTH);
+		// RMS auto-scaled to 0-255 against its running P5/P95 range,
+		// so no per-venue NOISE_FLOOR/MAX_SIGNAL tuning is needed
+		uint8_t level = (static_cast<uint16_t>(myAudio::normalizer.level(NORM_RMS)) * (WIDTH + 1)) >> 8;
 
 		// Smooth the level to reduce jitter from occasional spikes
 		static uint8_t smoothedLevel = 0;
@@ -141,17 +172,10 @@ namespace audioTest {
 			smoothedLevel = (smoothedLevel * 3 + level) / 4;
 		}
 
-		// Draw horizontal bars across the full height
-		for (uint8_t x = 0; x < smoothedLevel; x++) {
-			// Color based on position (left=green, right=red via palette)
-			uint8_t colorIndex = map(x, 0, WIDTH - 1, 0, 255);
-			CRGB color = ColorFromPalette(palette, colorIndex);
-
-			for (uint8_t y = 0; y < HEIGHT; y++) {
-				uint16_t idx = xyFunc(x, y);
-				leds[idx] = color;
-			}
-		}
+		// Color based on position (left=green, right=red via palette)
+		pixelsTouched += barState.bars.meter(leds, xyFunc, smoothedLevel, [&](uint8_t x) {
+			return ColorFromPalette(palette, map(x, 0, WIDTH - 1, 0, 255));
+		});
 	}
 
 	//===============================================================================================
@@ -196,11 +220,17 @@ namespace audioTest {
 		// Fade existing content
 		fadeToBlackBy(leds, WIDTH * HEIGHT, 30);
 
-		// Get bass level and check for bass hit
-		float bass = myAudio::bassLevel;
+		// Loudest auto-scaled Goertzel tone (sub, kick, bass; see configureAnalysis)
+		uint8_t bass = 0;
+		for (uint8_t t = 0; t < myAudio::goertzel.count() && t < NORM_TONE_COUNT; t++) {
+			uint8_t tone = myAudio::normalizer.level(static_cast<NormFeature>(NORM_TONE0 + t));
+			if (tone > bass) bass = tone;
+		}
 
-		// Trigger new ripple on strong bass (threshold ~100 based on observed data)
-		if (bass > 100 && rippleRadius == 0) {
+		// Trigger new ripple on a detected kick, or when a bass tone reaches
+		// the top of its recent range
+		constexpr uint8_t BASS_HIT_LEVEL = 200;
+		if ((myAudio::lowBand.kickDetected() || bass > BASS_HIT_LEVEL) && rippleRadius == 0) {
 			rippleRadius = 1;
 			rippleHue = hue;
 			hue += 40;
@@ -234,16 +264,347 @@ namespace audioTest {
 	}
 
 	//===============================================================================================
-	// Cycle through visualization modes (can be triggered by MODE button via BLE)
+	// VISUALIZATION MODE 4: Radial Spectrum
+	// 16 bands as spokes from the centre, length from the shared band dynamics, with a peak dot
+	//===============================================================================================
+	void drawRadialSpectrum() {
+		CRGBPalette16 palette = getCurrentPalette();
+
+		fill_solid(leds, WIDTH * HEIGHT, CRGB::Black);
+		updateSpectrumDynamics();
+
+		constexpr uint8_t maxRadius = (WIDTH < HEIGHT ? WIDTH : HEIGHT) / 2;
+		const int16_t centerX = WIDTH / 2;
+		const int16_t centerY = HEIGHT / 2;
+
+		for (uint8_t bin = 0; bin < NUM_FFT_BINS; bin++) {
+			// 256/16 = 16 angle steps per spoke; cos8/sin8 return 128 +/- 127
+			uint8_t angle = bin * (256 / NUM_FFT_BINS);
+			int16_t dx = static_cast<int16_t>(cos8(angle)) - 128;
+			int16_t dy = static_cast<int16_t>(sin8(angle)) - 128;
+
+			uint8_t radius = spectrumDynamics.levelScaled(bin, maxRadius);
+			uint8_t peak = spectrumDynamics.peakScaled(bin, maxRadius);
+
+			for (uint8_t r = 0; r <= peak; r++) {
+				int16_t x = centerX + ((dx * r) >> 7);
+				int16_t y = centerY + ((dy * r) >> 7);
+				if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) break;
+
+				if (r < radius) {
+					leds[xyFunc(x, y)] = ColorFromPalette(palette, bin * (256 / NUM_FFT_BINS) + hue);
+				} else if (r == peak && peak > radius) {
+					leds[xyFunc(x, y)] = CRGB::White;
+				}
+			}
+		}
+	}
+
+	//===============================================================================================
+	// Scrolling views (waterfall, matrix rain)
+	// Both share one RowRing: each frame writes a single new row and the scroll happens as a row
+	// offset while remapping into leds[]. The ring is cleared when the scrolling mode changes and
+	// its LED index table is rebuilt when the mapping changes.
+	//===============================================================================================
+	RowRing<WIDTH, HEIGHT> scrollRing;
+	uint8_t scrollRingMode = 255;
+	uint8_t scrollRingMapping = 255;
+
+	void beginScrollFrame(uint8_t mode) {
+		if (scrollRingMode != mode) {
+			scrollRing.clear();
+			scrollRingMode = mode;
+		}
+		if (scrollRingMapping != cMapping) {
+			scrollRing.buildIndex(xyFunc);
+			scrollRingMapping = cMapping;
+		}
+	}
+
+	//===============================================================================================
+	// VISUALIZATION MODE 5: Waterfall
+	// Spectrogram: one row of band levels per audio block, newest at the top
+	//===============================================================================================
+	void drawWaterfall() {
+		CRGBPalette16 palette = getCurrentPalette();
+
+		beginScrollFrame(5);
+		updateSpectrumDynamics();
+
+		CRGB* row = scrollRing.nextRow();
+		for (uint8_t x = 0; x < WIDTH; x++) {
+			uint8_t band = (static_cast<uint16_t>(x) * NUM_FFT_BINS) / WIDTH;
+			uint8_t level = spectrumDynamics.level(band);
+			row[x] = ColorFromPalette(palette, level, level);
+		}
+		scrollRing.push();
+		scrollRing.remap(leds);
+	}
+
+	//===============================================================================================
+	// VISUALIZATION MODE 6: Matrix Rain
+	// Drops spawn on the top row in proportion to peak level and fall one row per frame, fading
+	// as they age. The fade is applied by age during the remap, so rows are never rewritten.
+	//===============================================================================================
+	void drawMatrixRain() {
+		static uint8_t fadeByAge[HEIGHT];
+		static bool fadeReady = false;
+		if (!fadeReady) {
+			// Same trail as the legacy fadeToBlackBy(40) per row step
+			uint8_t f = 255;
+			for (uint8_t age = 0; age < HEIGHT; age++) {
+				fadeByAge[age] = f;
+				f = scale8(f, 255 - 40);
+			}
+			fadeReady = true;
+		}
+
+		beginScrollFrame(6);
+
+		CRGB* row = scrollRing.nextRow();
+		fill_solid(row, WIDTH, CRGB::Black);
+
+		// Up to a quarter of the columns get a new drop at full peak level
+		uint8_t numDrops = (static_cast<uint16_t>(myAudio::normalizer.level(NORM_PEAK)) * WIDTH) >> 10;
+		for (uint8_t i = 0; i < numDrops; i++) {
+			row[random8(WIDTH)] = CHSV(96, 255, 255);  // Green
+		}
+		scrollRing.push();
+		scrollRing.remap(leds, fadeByAge);
+	}
+
+	//===============================================================================================
+	// VISUALIZATION MODE 7: Oscilloscope
+	// Triggered waveform over getPCM() with min/max columns and companded amplitude (see
+	// scopeFrame.h). With persistence the previous frame fades under the new one instead of
+	// being cleared.
+	//===============================================================================================
+	constexpr uint8_t SCOPE_PERSISTENCE = 160;		// 0 = off, higher = longer afterglow
+
+	ScopeFrame<WIDTH, HEIGHT> scopeFrame;
+
+	void drawOscilloscope() {
+		CRGBPalette16 palette = getCurrentPalette();
+
+		if (SCOPE_PERSISTENCE > 0) {
+			fadeToBlackBy(leds, WIDTH * HEIGHT, 255 - SCOPE_PERSISTENCE);
+		} else {
+			fill_solid(leds, WIDTH * HEIGHT, CRGB::Black);
+		}
+
+		auto pcm = myAudio::getPCM();
+		scopeFrame.draw(leds, xyFunc, pcm.data(), pcm.size(), [&](uint8_t swing) {
+			return ColorFromPalette(palette, swing + hue);
+		});
+	}
+
+	//===============================================================================================
+	// VISUALIZATION MODE 8: Particles
+	// Audio events feed emitters on a shared fixed-capacity pool, so any number of effects can be
+	// in flight at once: every kick (or bass hit) launches a ring of particles from the centre, so
+	// ripples overlap instead of waiting for the previous one; beats throw sparks up from the
+	// bottom under gravity; STFT onsets burst at a random spot; and the upper spectrum bands rain
+	// from the top at a rate that follows their level.
+	//===============================================================================================
+	constexpr uint16_t PARTICLE_CAPACITY = 256;
+	constexpr uint8_t RIPPLE_PARTICLES = 32;
+	constexpr uint8_t SPARK_PARTICLES = 12;
+	constexpr uint8_t ONSET_PARTICLES = 8;
+	constexpr int16_t PARTICLE_GRAVITY = 6;		// Q8.8 px/frame^2
+
+	ParticlePool<PARTICLE_CAPACITY, WIDTH, HEIGHT> particles;
+	uint32_t particlesDropped = 0;		// diagnostic: spawns refused by a full pool
+
+	void emitParticle(const ParticleSpawn& p) {
+		if (!particles.spawn(p)) particlesDropped++;
+	}
+
+	// Ring moving outwards at ~0.5 px/frame; cos8/sin8 give the direction directly in Q8.8
+	void emitRipple(uint8_t rippleHue) {
+		ParticleSpawn p;
+		p.x = (WIDTH / 2) << 8;
+		p.y = (HEIGHT / 2) << 8;
+		p.hue = rippleHue;
+		p.decay = 6;
+		for (uint8_t i = 0; i < RIPPLE_PARTICLES; i++) {
+			uint8_t angle = i * (256 / RIPPLE_PARTICLES);
+			p.vx = static_cast<int16_t>(cos8(angle)) - 128;
+			p.vy = static_cast<int16_t>(sin8(angle)) - 128;
+			emitParticle(p);
+		}
+	}
+
+	// Fountain from (x, y) with random upward velocity, falling back under gravity
+	void emitSparks(int16_t x, int16_t y, uint8_t count, uint8_t sparkHue) {
+		ParticleSpawn p;
+		p.x = x;
+		p.y = y;
+		p.ay = PARTICLE_GRAVITY;
+		p.decay = 5;
+		for (uint8_t i = 0; i < count; i++) {
+			p.vx = static_cast<int16_t>(random8()) - 128;
+			p.vy = -static_cast<int16_t>(random16(128, 320));
+			p.hue = sparkHue + random8(24);
+			emitParticle(p);
+		}
+	}
+
+	void drawParticles() {
+		CRGBPalette16 palette = getCurrentPalette();
+
+		if (lastDrawnMode != 8) {
+			particles.clear();
+			fill_solid(leds, WIDTH * HEIGHT, CRGB::Black);
+		}
+
+		constexpr uint8_t BASS_HIT_LEVEL = 200;
+		if (myAudio::lowBand.kickDetected() || myAudio::normalizer.level(NORM_BASS) > BASS_HIT_LEVEL) {
+			emitRipple(hue);
+			hue += 24;
+		}
+		if (myAudio::beatDetected) {
+			emitSparks((WIDTH / 2) << 8, (HEIGHT - 1) << 8, SPARK_PARTICLES, hue + 128);
+		}
+		if (myAudio::stftOnset) {
+			emitSparks(random16(WIDTH << 8), random16(HEIGHT << 8), ONSET_PARTICLES, hue + 64);
+		}
+
+		// Rain: one chance per upper band per frame, probability = band level
+		ParticleSpawn drop;
+		drop.y = 0;
+		drop.vx = 0;
+		drop.vy = 96;
+		drop.decay = 4;
+		for (uint8_t bin = NUM_FFT_BINS / 2; bin < NUM_FFT_BINS; bin++) {
+			if (random8() < myAudio::normalizer.bin(bin)) {
+				drop.x = random16(WIDTH << 8);
+				drop.hue = bin * (256 / NUM_FFT_BINS);
+				emitParticle(drop);
+			}
+		}
+
+		fadeToBlackBy(leds, WIDTH * HEIGHT, 64);
+		particles.update();
+		particles.render(leds, xyFunc, palette);
+	}
+
+	//===============================================================================================
+	// VISUALIZATION MODE 9: Fire
+	// Heat-diffusion fire field. Bass level sets how many columns get a spark each frame and how
+	// hot they are, overall energy lowers the cooling so flames reach higher when the music is
+	// loud, and kicks/onsets flare the whole base line. The colour table is rebuilt only when
+	// the palette changes.
+	//===============================================================================================
+	HeatField<WIDTH, HEIGHT> fireField;
+	uint8_t firePalette = 255;
+
+	void drawFire() {
+		if (lastDrawnMode != 9) {
+			fireField.clear();
+		}
+		if (firePalette != cColorPalette) {
+			fireField.setPalette(getCurrentPalette());
+			firePalette = cColorPalette;
+		}
+
+		uint8_t bass = myAudio::normalizer.level(NORM_BASS);
+		uint8_t energy = myAudio::normalizer.level(NORM_ENERGY);
+
+		// Cooling 40 (loud) .. 120 (quiet)
+		uint8_t cooling = 120 - scale8(energy, 80);
+		fireField.step(cooling);
+
+		// Sparks: up to half the columns, heat 160..255 with bass
+		uint8_t sparks = 1 + scale8(bass, WIDTH / 2);
+		uint8_t sparkHeat = 160 + scale8(bass, 95);
+		for (uint8_t i = 0; i < sparks; i++) {
+			fireField.spark(random8(WIDTH), sparkHeat);
+		}
+
+		if (myAudio::lowBand.kickDetected() || myAudio::stftOnset) {
+			for (uint8_t x = 0; x < WIDTH; x++) {
+				fireField.spark(x, 255);
+			}
+		}
+
+		fireField.render(leds, xyFunc);
+	}
+
+	//===============================================================================================
+	// Per-mode analysis setup
+	// Each mode asks myAudio for the stages it reads (see AnalysisNeed) and nothing else runs;
+	// bass ripple only needs a few band energies, so it gets a Goertzel bank instead of a
+	// spectrum. No mode reads the note bank or the timbre descriptors yet, so none asks for
+	// NEED_TIMBRE. Only reconfigures when the mode changes.
+	//===============================================================================================
+	void configureAnalysis(uint8_t mode) {
+		static uint8_t configuredMode = 255;
+		if (mode == configuredMode) return;
+		configuredMode = mode;
+
+		switch (mode) {
+			case 1:		// VU meter: block RMS only
+			case 7:		// Oscilloscope: filtered PCM only
+				myAudio::goertzel.clearTargets();
+				myAudio::analysisNeeds = 0;
+				break;
+			case 2:		// Beat pulse: AudioProcessor beats
+			case 6:		// Matrix rain: AudioProcessor peak level
+				myAudio::goertzel.clearTargets();
+				myAudio::analysisNeeds = NEED_PROCESSOR;
+				break;
+			case 3: {	// Bass ripple: sub, kick, bass tones plus the low-band kick
+				static const float rippleTargets[] = {45.0f, 80.0f, 120.0f};
+				myAudio::goertzel.setTargets(rippleTargets, 3);
+				myAudio::analysisNeeds = NEED_LOWBAND;
+				break;
+			}
+			case 8:		// Particles: bass, beats, kicks, STFT onsets and spectrum bins
+				myAudio::goertzel.clearTargets();
+				myAudio::analysisNeeds = NEED_PROCESSOR | NEED_LOWBAND | NEED_STFT | NEED_SPECTRUM;
+				break;
+			case 9:		// Fire: bass/energy levels, kicks and STFT onsets
+				myAudio::goertzel.clearTargets();
+				myAudio::analysisNeeds = NEED_PROCESSOR | NEED_LOWBAND | NEED_STFT;
+				break;
+			default:	// Spectrum, radial spectrum, waterfall: full spectrum stage
+				myAudio::goertzel.clearTargets();
+				myAudio::analysisNeeds = NEED_SPECTRUM;
+				break;
+		}
+	}
+
+	//===============================================================================================
+	// Cycle through the BLE modes; runAudioTest() picks up the new MODE on the next frame
 	//===============================================================================================
 	void nextVisualizationMode() {
-		visualizationMode = (visualizationMode + 1) % NUM_VIS_MODES;
+		MODE = (MODE + 1) % MODE_COUNTS[AUDIOREACTIVE];
 		Serial.print("Visualization mode: ");
-		Serial.println(visualizationMode);
+		Serial.println(MODE);
 	}
 
 	//===============================================================================================
 
+	//===============================================================================================
+	// Frame timing
+	// Interval between rendered frames in FRAME_HIST_BUCKET_MS buckets, the last one collecting
+	// everything longer (idle frames land there). testFunction() prints and clears it, so
+	// turning something on over BLE - telemetry, say - shows up as a shift between buckets.
+	//===============================================================================================
+	constexpr uint8_t FRAME_HIST_BUCKETS = 8;
+	constexpr uint32_t FRAME_HIST_BUCKET_MS = 4;
+	uint32_t frameHist[FRAME_HIST_BUCKETS] = {0};
+
+	void recordFrameInterval() {
+		static uint32_t lastFrameUs = 0;
+		const uint32_t now = micros();
+		if (lastFrameUs != 0) {
+			const uint32_t bucket = (now - lastFrameUs) / (FRAME_HIST_BUCKET_MS * 1000);
+			frameHist[bucket < FRAME_HIST_BUCKETS ? bucket : FRAME_HIST_BUCKETS - 1]++;
+		}
+		lastFrameUs = now;
+	}
+
 	// Set to true to run audio diagnostics instead of visualizations
 	// Use this to calibrate and verify audio input is working correctly
 	constexpr bool DIAGNOSTIC_MODE = false;
@@ -256,31 +617,111 @@ namespace audioTest {
 			Serial.print(" | RMS: ");
 			Serial.print(myAudio::getRMS());
 			Serial.print(" | Bass: ");
-			Serial.println(myAudio::bassLevel);
+			Serial.print(myAudio::bassLevel);
+			Serial.print(" | Idle: ");
+			Serial.print(myAudio::isIdle() ? "yes" : "no");
+			Serial.print(" (blocks idle/active ");
+			Serial.print(myAudio::idleBlocks);
+			Serial.print("/");
+			Serial.print(myAudio::activeBlocks);
+			Serial.print(", frames shown/skipped ");
+			Serial.print(ledOutput::framesShown);
+			Serial.print("/");
+			Serial.print(ledOutput::framesSkipped);
+			Serial.print(", bus ms saved ");
+			Serial.print(ledOutput::busTimeSavedMs);
+			Serial.print(", bar px touched ");
+			Serial.print(pixelsTouched);
+			Serial.print(", particles ");
+			Serial.print(particles.count());
+			Serial.print(" dropped ");
+			Serial.print(particlesDropped);
+			Serial.print(", telemetry packets/bytes ");
+			Serial.print(telemetryPacketsSent);
+			Serial.print("/");
+			Serial.print(telemetryBytesSent);
+			Serial.println(")");
+			Serial.print("Control: commands ");
+			Serial.print(commandsApplied);
+			Serial.print(" (drain overruns ");
+			Serial.print(drainOverruns);
+			Serial.print("), receipts marked/superseded ");
+			Serial.print(receiptsMarked);
+			Serial.print("/");
+			Serial.print(receiptsSuperseded);
+			Serial.print(", notifies/bytes ");
+			Serial.print(notificationsSent);
+			Serial.print("/");
+			Serial.print(notifyBytesSent);
+			Serial.print(", sync delta receipts ");
+			Serial.print(syncDeltaReceipts);
+			Serial.print(", live-state writes ");
+			Serial.print(liveStateWrites);
+			Serial.print(", JSON heap fallbacks ");
+			Serial.println(jsonHeapFallbacks);
+			Serial.print("Frame ms histogram (");
+			Serial.print(FRAME_HIST_BUCKET_MS);
+			Serial.print(" ms buckets):");
+			for (uint8_t i = 0; i < FRAME_HIST_BUCKETS; i++) {
+				Serial.print(" ");
+				Serial.print(frameHist[i]);
+				frameHist[i] = 0;
+			}
+			Serial.println();
 		}
 	}
 
 	//===============================================================================================
 
-	void runAudioTest() {
+	//===============================================================================================
+	// Idle throttling
+	// While myAudio reports idle, frames are rendered at IDLE_FRAME_MS; in between, the loop
+	// sleeps IDLE_POLL_MS (about one I2S block) so the gate is still checked every block.
+	// Unchanged frames are dropped by ledOutput::showFrame().
+	//===============================================================================================
+	constexpr uint32_t IDLE_FRAME_MS = 100;		// 10 fps while idle
+	constexpr uint32_t IDLE_POLL_MS = 10;
+
+	// Returns true if the caller should push the frame with ledOutput::showFrame()
+	bool runAudioTest() {
+
+		// BLE MODE selects the visualization; out-of-range values (e.g. a stale button id)
+		// fall back to the first mode
+		visualizationMode = MODE_VISUALIZER[MODE < MODE_COUNTS[AUDIOREACTIVE] ? MODE : 0];
 
+		configureAnalysis(visualizationMode);
 		myAudio::sampleAudio();
 
+		// Opt-in BLE feature stream, at its own rate and also while idle
+		if (telemetryDue()) {
+			uint8_t record[TELEM_FIELDS];
+			myAudio::fillTelemetryRecord(record);
+			sendTelemetry(record);
+		}
+
+		static uint32_t lastIdleFrame = 0;
+		if (myAudio::isIdle()) {
+			uint32_t now = millis();
+			if (now - lastIdleFrame < IDLE_FRAME_MS) {
+				delay(IDLE_POLL_MS);
+				return false;
+			}
+			lastIdleFrame = now;
+		}
+		recordFrameInterval();
+
 		// Run diagnostic mode for calibration testing
 		if (DIAGNOSTIC_MODE) {
 			myAudio::runAudioDiagnostic();
 			// Still run VU meter visualization so you can see audio response on LEDs
 			drawVUMeter();
-			return;
+			lastDrawnMode = 1;
+			return true;
 		}
 
 		testFunction();
 
-		// Use cMode from BLE to select visualization (or cycle with visualizationMode)
-		// For now, use the local visualizationMode variable
-		// You can map cMode to visualizationMode if desired: visualizationMode = cMode % NUM_VIS_MODES;
-
-		switch(visualizationMode=1) {
+		switch(visualizationMode) {
 			case 0:
 				drawSpectrum();
 				break;
@@ -293,21 +734,32 @@ namespace audioTest {
 			case 3:
 				drawBassRipple();
 				break;
+			case 4:
+				drawRadialSpectrum();
+				break;
+			case 5:
+				drawWaterfall();
+				break;
+			case 6:
+				drawMatrixRain();
+				break;
+			case 7:
+				drawOscilloscope();
+				break;
+			case 8:
+				drawParticles();
+				break;
+			case 9:
+				drawFire();
+				break;
 			default:
 				drawSpectrum();
 				break;
 		}
+		// Bar visualizers redraw fully if another mode drew the last frame
+		lastDrawnMode = (visualizationMode < NUM_VIS_MODES) ? visualizationMode : 0;
 
-		// Allow mode cycling via BLE MODE control
-		// Map MODE (0-255) to visualization mode
-		/*
-		static uint8_t lastMode = 255;  // Initialize to invalid so first check triggers
-		if (MODE != lastMode) {
-			visualizationMode = MODE % NUM_VIS_MODES;
-			lastMode = MODE;
-			Serial.print("Switched to visualization mode: ");
-			Serial.println(visualizationMode);
-		}*/
+		return true;
 
 	} // runAudioTest()
 		
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace myAudio {
+
+    //=========================================================================
+    // Per-band dynamics for bar-style visuals
+    // Attack/release smoothing, peak hold and gravity-falling peak markers for
+    // any number of bands. State is structure-of-arrays uint16_t (input 0-255
+    // is carried as 0-65280, so the one-pole filters don't lose resolution),
+    // and all coefficients are precomputed from the block rate by configure(),
+    // so update() is a handful of integer ops per band.
+    //=========================================================================
+
+    constexpr float DYNAMICS_BLOCK_RATE = 44100.0f / 512;    // updates per second
+
+    template <uint8_t N>
+    class BandDynamics {
+    public:
+        BandDynamics() {
+            configure(DYNAMICS_BLOCK_RATE, 10.0f, 150.0f, 400.0f, 2.0f);
+            reset();
+        }
+
+        // attack/release: one-pole time constants. hold: time a peak marker
+        // stays put. gravity: full-scale heights per second^2 the marker
+        // accelerates at once the hold expires.
+        void configure(float blockRate, float attackMs, float releaseMs, float holdMs, float gravity) {
+            mAttack = onePole(attackMs, blockRate);
+            mRelease = onePole(releaseMs, blockRate);
+            mHoldBlocks = static_cast<uint16_t>(holdMs * blockRate / 1000.0f);
+            float g = gravity * 65280.0f / (blockRate * blockRate);
+            mGravity = static_cast<uint16_t>(g < 1.0f ? 1.0f : g);
+        }
+
+        void reset() {
+            for (uint8_t i = 0; i < N; i++) {
+                mLevel[i] = 0;
+                mPeak[i] = 0;
+                mHold[i] = 0;
+                mFall[i] = 0;
+            }
+        }
+
+        // One block of 0-255 inputs, one per band
+        void update(const uint8_t* in) {
+            for (uint8_t i = 0; i < N; i++) {
+                const int32_t target = static_cast<int32_t>(in[i]) << 8;
+                const int32_t level = mLevel[i];
+                const int32_t diff = target - level;
+                const uint32_t coeff = (diff > 0) ? mAttack : mRelease;
+                // |diff| * coeff reaches 65280 * 65536, past int32
+                mLevel[i] = static_cast<uint16_t>(level + ((static_cast<int64_t>(diff) * coeff) >> 16));
+
+                if (mLevel[i] >= mPeak[i]) {
+                    mPeak[i] = mLevel[i];
+                    mHold[i] = mHoldBlocks;
+                    mFall[i] = 0;
+                } else if (mHold[i] > 0) {
+                    mHold[i]--;
+                } else {
+                    mFall[i] += mGravity;
+                    uint16_t floor = mLevel[i];
+                    mPeak[i] = (mPeak[i] - floor > mFall[i]) ? mPeak[i] - mFall[i] : floor;
+                }
+            }
+        }
+
+        uint8_t level(uint8_t i) const { return mLevel[i] >> 8; }
+        uint8_t peak(uint8_t i) const { return mPeak[i] >> 8; }
+
+        // Scaled to 0..range (e.g. matrix height) without division
+        uint8_t levelScaled(uint8_t i, uint8_t range) const {
+            return static_cast<uint8_t>((static_cast<uint32_t>(mLevel[i]) * (range + 1)) >> 16);
+        }
+        uint8_t peakScaled(uint8_t i, uint8_t range) const {
+            return static_cast<uint8_t>((static_cast<uint32_t>(mPeak[i]) * (range + 1)) >> 16);
+        }
+
+    private:
+        static uint32_t onePole(float ms, float blockRate) {
+            if (ms <= 0.0f) return 65536;
+            float a = 1.0f - expf(-1000.0f / (ms * blockRate));
+            return static_cast<uint32_t>(a * 65536.0f);
+        }
+
+        uint16_t mLevel[N];
+        uint16_t mPeak[N];
+        uint16_t mHold[N];
+        uint16_t mFall[N];
+
+        uint32_t mAttack = 65536;
+        uint32_t mRelease = 65536;
+        uint16_t mHoldBlocks = 0;
+        uint16_t mGravity = 1;
+    };
+
+} // namespace myAudio
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <FastLED.h>
+#include <string.h>
+
+//=============================================================================
+// Incremental bar rendering
+// Bar visualizers keep the height of every column from the previous frame
+// and only touch the pixels in between: a growing bar paints (prev, new], a
+// shrinking bar clears (new, prev]. Bar colours depend only on position, so
+// untouched pixels are already correct as long as nothing else wrote to
+// leds[] since the last frame - after that (and before the first frame),
+// clear() and draw again.
+//
+// Vertical bars (spectrum) grow up from the bottom row and may carry a peak
+// marker above the top. The horizontal meter (VU) fills columns from the
+// left across the full height and keeps its length in column 0.
+//=============================================================================
+
+template <uint8_t W, uint8_t H>
+class BarFrame {
+public:
+	static constexpr uint8_t NO_PEAK = 255;
+
+	// Blacks out the frame and forgets every bar; returns pixels written
+	uint16_t clear(CRGB* leds) {
+		fill_solid(leds, W * H, CRGB::Black);
+		memset(mHeight, 0, sizeof(mHeight));
+		memset(mPeakRow, NO_PEAK, sizeof(mPeakRow));
+		return W * H;
+	}
+
+	// Bring column x to the given height, counted in rows from the bottom.
+	// A peakRow above the bar and below H gets a white marker. colorAt(y)
+	// gives the bar colour at row y. Returns pixels written.
+	template <typename ColorAt>
+	uint16_t column(CRGB* leds, uint16_t (*xy)(uint8_t, uint8_t), uint8_t x,
+					uint8_t height, uint8_t peakRow, ColorAt colorAt) {
+		uint16_t touched = 0;
+		const uint8_t prevHeight = mHeight[x];
+		mHeight[x] = height;
+
+		// Lift the old peak marker unless it stays put above the bar; the grow
+		// loop repaints it if the bar covers it now
+		const bool showPeak = peakRow > height && peakRow < H;
+		const uint8_t oldPeak = mPeakRow[x];
+		if (oldPeak != NO_PEAK && !(showPeak && oldPeak == peakRow)) {
+			leds[xy(x, H - 1 - oldPeak)] = CRGB::Black;
+			touched++;
+		}
+
+		// Grow: paint the new top of the bar (y=0 is the top row)
+		for (uint8_t y = prevHeight; y < height; y++) {
+			leds[xy(x, H - 1 - y)] = colorAt(y);
+		}
+		// Shrink: clear what fell away
+		for (uint8_t y = height; y < prevHeight; y++) {
+			leds[xy(x, H - 1 - y)] = CRGB::Black;
+		}
+		touched += (height > prevHeight) ? height - prevHeight : prevHeight - height;
+
+		if (showPeak) {
+			if (peakRow != oldPeak) {
+				leds[xy(x, H - 1 - peakRow)] = CRGB::White;
+				touched++;
+			}
+			mPeakRow[x] = peakRow;
+		} else {
+			mPeakRow[x] = NO_PEAK;
+		}
+		return touched;
+	}
+
+	// Bring the horizontal meter to the given length in columns.
+	// colorAt(x) gives the colour of column x. Returns pixels written.
+	template <typename ColorAt>
+	uint16_t meter(CRGB* leds, uint16_t (*xy)(uint8_t, uint8_t), uint8_t length, ColorAt colorAt) {
+		const uint8_t prevLength = mHeight[0];
+		mHeight[0] = length;
+
+		// Grow: paint new columns across the full height
+		for (uint8_t x = prevLength; x < length; x++) {
+			const CRGB color = colorAt(x);
+			for (uint8_t y = 0; y < H; y++) {
+				leds[xy(x, y)] = color;
+			}
+		}
+		// Shrink: clear columns that fell away
+		for (uint8_t x = length; x < prevLength; x++) {
+			for (uint8_t y = 0; y < H; y++) {
+				leds[xy(x, y)] = CRGB::Black;
+			}
+		}
+		return H * ((length > prevLength) ? length - prevLength : prevLength - length);
+	}
+
+private:
+	uint8_t mHeight[W] = {};
+	uint8_t mPeakRow[W] = {};	// row of the peak marker, NO_PEAK if none drawn
+};
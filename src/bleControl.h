@@ -3,9 +3,9 @@
 #include "FastLED.h"
 #include <ArduinoJson.h>
 
-/* If you use more than ~4 characteristics, you need to increase numHandles in this file:
-C:\Users\...\.platformio\packages\framework-arduinoespressif32\libraries\BLE\src\BLEServer.h
-Setting numHandles = 60 has worked for 7 characteristics.  
+/* If you use more than ~4 characteristics, the service needs more handles than the
+createService() default of 15. bleSetup() passes SERVICE_NUM_HANDLES explicitly, so
+raise that when adding characteristics (60 has worked for 7).
 */
 
 #include <BLEDevice.h>
@@ -13,11 +13,18 @@ Setting numHandles = 60 has worked for 7 characteristics.
 #include <BLEUtils.h>
 #include <BLE2902.h>
 #include <string>
+#include <atomic>
+#include <cmath>
 
 #include <FS.h>
 #include "LittleFS.h"
 #define FORMAT_LITTLEFS_IF_FAILED true 
 
+#include "spscQueue.h"
+#include "jsonArena.h"
+#include "paramRamp.h"
+#include "audioTelemetry.h"
+
 bool displayOn = true;
 bool debug = false;
 bool pauseAnimation = false;
@@ -28,6 +35,10 @@ extern uint8_t PROGRAM;
 extern uint8_t MODE;
 extern uint8_t BRIGHTNESS;
 
+namespace myAudio {
+    extern float currentBPM;
+}
+
 //using namespace fl;
 using namespace ArduinoJson;
 
@@ -52,95 +63,48 @@ using namespace ArduinoJson;
    const char vumeter_str[] PROGMEM = "vumeter";
    const char matrixrain_str[] PROGMEM = "matrixrain";
    const char fireeffect_str[] PROGMEM = "fireeffect";
-   const char plasmawave_str[] PROGMEM = "plasmawave";
+   const char waterfall_str[] PROGMEM = "waterfall";
+   const char beatpulse_str[] PROGMEM = "beatpulse";
+   const char bassripple_str[] PROGMEM = "bassripple";
+   const char particles_str[] PROGMEM = "particles";
   
   const char* const AUDIOREACTIVE_MODES[] PROGMEM = {
       spectrumbars_str, radialspectrum_str, waveform_str, vumeter_str, matrixrain_str, 
-      fireeffect_str, plasmawave_str, 
+      fireeffect_str, waterfall_str, beatpulse_str, bassripple_str, particles_str, 
   };  
     
-   const uint8_t MODE_COUNTS[] = {7};
-
-   // Visualizer parameter mappings - PROGMEM arrays for memory efficiency
-   // Individual parameter arrays for each visualizer
- 
-   /*
-   const char* const AUDIOREACTIVE_SPECTRUMBARS_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-   const char* const AUDIOREACTIVE_RADIALSPECTRUM_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-   const char* const AUDIOREACTIVE_WAVEFORM_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-   const char* const AUDIOREACTIVE_VUMETER_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-   const char* const AUDIOREACTIVE_MATRIXRAIN_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-   const char* const AUDIOREACTIVE_FIREEFFECT_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-   const char* const AUDIOREACTIVE_PLASMAWAVE_PARAMS[] PROGMEM = {"audioGain", "noiseFloor", "fadeSpeed", "beatSensitivity"};
-  */
-
-   // Struct to hold visualizer name and parameter array reference
-   struct VisualizerParamEntry {
-      const char* visualizerName;
-      const char* const* params;
-      uint8_t count;
-   };
-
-   // String-based lookup table - mirrors JavaScript VISUALIZER_PARAMS
-   // Can number values be replace by an array element count?
-   const VisualizerParamEntry VISUALIZER_PARAM_LOOKUP[] PROGMEM = {
-      /*
-      {"audioreactive-spectrumbars", AUDIOREACTIVE_SPECTRUMBARS_PARAMS, 4},
-      {"audioreactive-radialspectrum", AUDIOREACTIVE_RADIALSPECTRUM_PARAMS, 4}, 
-      {"audioreactive-waveform", AUDIOREACTIVE_WAVEFORM_PARAMS, 4},
-      {"audioreactive-vumeter", AUDIOREACTIVE_VUMETER_PARAMS, 4},
-      {"audioreactive-matrixrain", AUDIOREACTIVE_MATRIXRAIN_PARAMS, 4},
-      {"audioreactive-fireeffect", AUDIOREACTIVE_FIREEFFECT_PARAMS, 4},
-      {"audioreactive-plasmawave", AUDIOREACTIVE_PLASMAWAVE_PARAMS, 4}
-      */
-   };
+   const uint8_t MODE_COUNTS[] = {10};
 
   class VisualizerManager {
   public:
-      static String getVisualizerName(int programNum, int mode = -1) {
-          if (programNum < 0 || programNum > PROGRAM_COUNT-1) return "";
+      // Writes "program" or "program-mode" into out and returns it
+      static const char* getVisualizerName(char* out, size_t capacity, int programNum, int mode = -1) {
+          out[0] = '\0';
+          if (programNum < 0 || programNum > PROGRAM_COUNT-1) return out;
 
           // Get program name from flash memory
-          char progName[16];
-          ::strcpy(progName,(char*)pgm_read_ptr(&PROGRAM_NAMES[programNum]));
+          const char* progName = (const char*)pgm_read_ptr(&PROGRAM_NAMES[programNum]);
 
           if (mode < 0 || MODE_COUNTS[programNum] == 0) {
-              return String(progName);
+              snprintf(out, capacity, "%s", progName);
+              return out;
           }
 
           // Get mode name
           const char* const* modeArray = nullptr;
           switch (programNum) {
               case AUDIOREACTIVE: modeArray = AUDIOREACTIVE_MODES; break;
-              default: return String(progName);
+              default: snprintf(out, capacity, "%s", progName); return out;
           }
 
-          if (mode >= MODE_COUNTS[programNum]) return String(progName);
-
-          char modeName[20];
-          ::strcpy(modeName,(char*)pgm_read_ptr(&modeArray[mode]));
-
-         //return String(progName) + "-" + String(modeName);
-         String result = "";
-         result += String(progName);
-         result += "-";
-         result += String(modeName);
-         return result;
-      }
-      
-      // Get parameter list based on visualizer name
-      static const VisualizerParamEntry* getVisualizerParams(const String& visualizerName) {
-          const int LOOKUP_SIZE = sizeof(VISUALIZER_PARAM_LOOKUP) / sizeof(VisualizerParamEntry);
-          
-          for (int i = 0; i < LOOKUP_SIZE; i++) {
-              char entryName[32];
-              ::strcpy(entryName, (char*)pgm_read_ptr(&VISUALIZER_PARAM_LOOKUP[i].visualizerName));
-              
-              if (visualizerName.equals(entryName)) {
-                  return &VISUALIZER_PARAM_LOOKUP[i];
-              }
+          if (mode >= MODE_COUNTS[programNum]) {
+              snprintf(out, capacity, "%s", progName);
+              return out;
           }
-          return nullptr;
+
+          const char* modeName = (const char*)pgm_read_ptr(&modeArray[mode]);
+          snprintf(out, capacity, "%s-%s", progName, modeName);
+          return out;
       }
   };  // class VisualizerManager
 
@@ -165,6 +129,15 @@ uint8_t cAgcSensitivity = 128;
 uint8_t cMagnitudeScale = 128;
 float cGainAdjust = 1.0f;
 uint8_t cFadeSpeed = 20;
+uint16_t cStftHop = 256;
+
+// Parameter ramps
+uint16_t cGlideMs = 100;
+uint8_t cMorphBeats = 4;
+uint8_t cRampEase = 9;
+
+// Audio telemetry stream rate, 0 = off (see AUDIO TELEMETRY)
+uint8_t cTelemetryHz = 0;
 
 //float cNoiseFloor = 0.1f;
 //float cBeatSensitivity = 1.5f;
@@ -261,8 +234,15 @@ bool Layer3 = true;
 bool Layer4 = true;
 bool Layer5 = true;
 
-ArduinoJson::JsonDocument sendDoc;
-ArduinoJson::JsonDocument receivedJSON;
+// Control-plane JSON never uses the heap: incoming writes are parsed into
+// receivedJSON (BLE task only) on a fixed arena, and receipts are formatted
+// straight into stack buffers by writeReceipt().
+#define VISUALIZER_NAME_MAX 40
+#define RECEIPT_STRING_MAX 1024
+#define BLE_WRITE_MAX 512      // largest attribute value a client can write
+
+JsonArena<jsonArenaSize(BLE_WRITE_MAX)> receiveArena;
+ArduinoJson::JsonDocument receivedJSON(&receiveArena);
 
 //*******************************************************************************
 //BLE CONFIGURATION *************************************************************
@@ -272,6 +252,8 @@ BLECharacteristic* pButtonCharacteristic = NULL;
 BLECharacteristic* pCheckboxCharacteristic = NULL;
 BLECharacteristic* pNumberCharacteristic = NULL;
 BLECharacteristic* pStringCharacteristic = NULL;
+BLECharacteristic* pBinaryCharacteristic = NULL;
+BLECharacteristic* pTelemetryCharacteristic = NULL;
 
 bool deviceConnected = false;
 bool wasConnected = false;
@@ -281,6 +263,11 @@ bool wasConnected = false;
 #define CHECKBOX_CHARACTERISTIC_UUID   "19b10002-e8f2-537e-4f6c-d104768a1214"
 #define NUMBER_CHARACTERISTIC_UUID     "19b10003-e8f2-537e-4f6c-d104768a1214"
 #define STRING_CHARACTERISTIC_UUID     "19b10004-e8f2-537e-4f6c-d104768a1214"
+#define BINARY_CHARACTERISTIC_UUID     "19b10005-e8f2-537e-4f6c-d104768a1214"
+#define TELEMETRY_CHARACTERISTIC_UUID  "19b10006-e8f2-537e-4f6c-d104768a1214"
+
+// Service handle budget: 1 + 3 per characteristic (decl, value, CCCD), with headroom
+#define SERVICE_NUM_HANDLES 30
 
 //BLEDescriptor pButtonDescriptor(BLEUUID((uint16_t)0x2902));
 //BLEDescriptor pCheckboxDescriptor(BLEUUID((uint16_t)0x2902));
@@ -297,8 +284,67 @@ void startingPalette() {
 
 // UI update functions ***********************************************
 
+// Appends s as a quoted, escaped JSON string; false if it didn't fit
+bool appendJsonString(char* out, size_t capacity, size_t& len, const char* s) {
+   if (len + 2 > capacity) return false;
+   out[len++] = '"';
+   for (; *s; s++) {
+      const char c = *s;
+      const char* esc = nullptr;
+      switch (c) {
+         case '"':  esc = "\\\""; break;
+         case '\\': esc = "\\\\"; break;
+         case '\n': esc = "\\n"; break;
+         case '\r': esc = "\\r"; break;
+         case '\t': esc = "\\t"; break;
+      }
+      if (esc) {
+         if (len + 3 > capacity) return false;
+         out[len++] = esc[0];
+         out[len++] = esc[1];
+      } else if ((uint8_t)c < 0x20) {
+         if (len + 7 > capacity) return false;
+         len += snprintf(&out[len], capacity - len, "\\u%04x", c);
+      } else {
+         if (len + 2 > capacity) return false;
+         out[len++] = c;
+      }
+   }
+   out[len++] = '"';
+   return true;
+}
+
+// {"id":<id>,"val":<value>} into out; value is quoted and escaped when
+// quoteValue is set, otherwise written as is (a number or true/false).
+// Returns the length, 0 if it didn't fit.
+size_t writeReceipt(char* out, size_t capacity, const char* id, const char* value, bool quoteValue) {
+   static const char head[] = "{\"id\":";
+   static const char mid[] = ",\"val\":";
+   if (capacity < sizeof(head)) return 0;
+   memcpy(out, head, sizeof(head) - 1);
+   size_t len = sizeof(head) - 1;
+   if (!appendJsonString(out, capacity, len, id)) return 0;
+   if (len + sizeof(mid) - 1 >= capacity) return 0;
+   memcpy(&out[len], mid, sizeof(mid) - 1);
+   len += sizeof(mid) - 1;
+   if (quoteValue) {
+      if (!appendJsonString(out, capacity, len, value)) return 0;
+   } else {
+      const size_t valueLen = strlen(value);
+      if (len + valueLen >= capacity) return 0;
+      memcpy(&out[len], value, valueLen);
+      len += valueLen;
+   }
+   if (len + 1 >= capacity) return 0;
+   out[len++] = '}';
+   out[len] = '\0';
+   return len;
+}
+
 void sendReceiptButton(uint8_t receivedValue) {
-   pButtonCharacteristic->setValue(String(receivedValue).c_str());
+   char value[4];
+   int len = snprintf(value, sizeof(value), "%u", receivedValue);
+   pButtonCharacteristic->setValue((uint8_t*)value, len);
    pButtonCharacteristic->notify();
    if (debug) {
       Serial.print("Button value received: ");
@@ -306,18 +352,21 @@ void sendReceiptButton(uint8_t receivedValue) {
    }
 }
 
-void sendReceiptCheckbox(String receivedID, bool receivedValue) {
-  
-   sendDoc.clear();
-   sendDoc["id"] = receivedID;
-   sendDoc["val"] = receivedValue;
+void sendReceiptString(const char* receivedID, const char* receivedValue) {
 
-   String jsonString;
-   serializeJson(sendDoc, jsonString);
+   char jsonBuffer[RECEIPT_STRING_MAX];
+   size_t len = writeReceipt(jsonBuffer, sizeof(jsonBuffer), receivedID, receivedValue, true);
+   if (len == 0) {
+      if (debug) {
+         Serial.print("Receipt too large for ");
+         Serial.println(receivedID);
+      }
+      return;
+   }
 
-   pCheckboxCharacteristic->setValue(jsonString);
-   
-   pCheckboxCharacteristic->notify();
+   pStringCharacteristic->setValue((uint8_t*)jsonBuffer, len);
+
+   pStringCharacteristic->notify();
    
    if (debug) {
       Serial.print("Sent receipt for ");
@@ -327,273 +376,1713 @@ void sendReceiptCheckbox(String receivedID, bool receivedValue) {
    }
 }
 
-void sendReceiptNumber(String receivedID, float receivedValue) {
+//***********************************************************************
+// PARAMETER/PRESET MANAGEMENT SYSTEM ("PPMS")
+// X-Macro table 
+#define PARAMETER_TABLE \
+   X(uint8_t, OverrideMapping, 0, 0, 255) \
+   X(uint8_t, ColorPalette, 0, 0, 6) \
+   X(uint8_t, ColOrd, 1.0f, 0, 5) \
+   X(float, Speed, 1.0f, -100.0f, 100.0f) \
+   X(float, Zoom, 1.0f, -100.0f, 100.0f) \
+   X(float, Scale, 1.0f, -100.0f, 100.0f) \
+   X(float, Angle, 1.0f, -100.0f, 100.0f) \
+   X(float, Twist, 1.0f, -100.0f, 100.0f) \
+   X(float, Radius, 1.0f, -100.0f, 100.0f) \
+   X(float, Edge, 1.0f, -100.0f, 100.0f) \
+   X(float, Z, 1.0f, -100.0f, 100.0f) \
+   X(float, RatBase, 1.0f, -100.0f, 100.0f) \
+   X(float, RatDiff, 1.0f, -100.0f, 100.0f) \
+   X(float, OffBase, 1.0f, -100.0f, 100.0f) \
+   X(float, OffDiff, 1.0f, -100.0f, 100.0f) \
+   X(float, Red, 1.0f, 0.1f, 3.0f) \
+   X(float, Green, 1.0f, 0.1f, 3.0f) \
+   X(float, Blue, 1.0f, 0.1f, 3.0f) \
+   X(uint8_t, SpeedInt, 1, 0, 255) \
+   X(float, HueIncMax, 2500.0f, 0.0f, 10000.0f) \
+   X(uint8_t, BlendFract, 128, 0, 255) \
+   X(float, BrightTheta, 1.0f, -100.0f, 100.0f) \
+   X(float, SpeedLower, .16f, 0.0f, 10.0f) \
+   X(float, DampLower, 8.0f, 0.0f, 100.0f) \
+   X(float, SpeedUpper, .24f, 0.0f, 10.0f) \
+   X(float, DampUpper, 6.0f, 0.0f, 100.0f) \
+   X(float, BlurGlobFact, 1.0f, 0.0f, 100.0f) \
+   X(float, Movement, 1.0f, -100.0f, 100.0f) \
+   X(float, Tail, 1.0f, -100.0f, 100.0f) \
+   X(uint8_t, EaseSat, 0, 0, 9) \
+   X(uint8_t, EaseLum, 0, 0, 9) \
+   X(float, BloomEdge, 1.0f, 0.0f, 100.0f) \
+   X(double, DecayBase, .95, 0.0, 1.0) \
+   X(double, DecayChaos, .04, 0.0, 1.0) \
+   X(double, IgnitionBase, .16, 0.0, 1.0) \
+   X(double, IgnitionChaos, .05, 0.0, 1.0) \
+   X(double, NeighborBase, .48, 0.0, 1.0) \
+   X(double, NeighborChaos, .06, 0.0, 1.0) \
+   X(float, SpatialDecay, 0.002f, 0.0f, 1.0f) \
+   X(float, DecayZones, 1.0f, 0.0f, 100.0f) \
+   X(float, TimeDrift, 1.0f, 0.0f, 100.0f) \
+   X(float, Pulse, 1.0f, 0.0f, 100.0f) \
+   X(double, InfluenceBase, 0.7, 0.0, 1.0) \
+   X(double, InfluenceChaos, 0.35, 0.0, 1.0) \
+   X(uint16_t, EntropyRate, 180, 0, 65535) \
+   X(float, EntropyBase, 0.05f, 0.0f, 1.0f) \
+   X(float, EntropyChaos, 0.15f, 0.0f, 1.0f) \
+   
+// Controls that are not part of presets: same X signature as PARAMETER_TABLE
+// (type, name, default, min, max); the variable is c<name>, the wire id in<name>
+#define CONTROL_TABLE \
+   X(uint8_t, Bright, 75, 5, 150) \
+   X(uint8_t, InputGain, 128, 1, 255) \
+   X(uint8_t, MagnitudeScale, 128, 1, 255) \
+   X(float, GainAdjust, 1.0f, 0.1f, 10.0f) \
+   X(uint8_t, FadeSpeed, 20, 1, 255) \
+   X(uint8_t, AgcSensitivity, 128, 1, 255) \
+   X(float, GateThreshold, 0.02f, 0.001f, 0.1f) \
+   X(uint16_t, StftHop, 256, 64, 512) \
+
+// Controls added after binary protocol v1 shipped. Same X signature as
+// CONTROL_TABLE, but expanded after PARAMETER_TABLE so the ids v1 clients
+// already use stay where they are; new controls go at the end of this one
+#define APPENDED_CONTROL_TABLE \
+   X(uint16_t, GlideMs, 100, 0, 5000) \
+   X(uint8_t, MorphBeats, 4, 0, 64) \
+   X(uint8_t, RampEase, 9, 0, 9) \
+   X(uint8_t, TelemetryHz, 0, 0, 30) \
+
+// Checkboxes: B(name, variable, wire id, default)
+#define CHECKBOX_TABLE \
+   B(RotateWaves, rotateWaves, "cx10", true) \
+   B(Layer1, Layer1, "cxLayer1", true) \
+   B(Layer2, Layer2, "cxLayer2", true) \
+   B(Layer3, Layer3, "cxLayer3", true) \
+   B(Layer4, Layer4, "cxLayer4", true) \
+   B(Layer5, Layer5, "cxLayer5", true) \
+   B(MappingOverride, mappingOverride, "cx11", false) \
+   B(EnableAudio, cEnableAudio, "cx12", true) \
+   B(AutoGain, cAutoGain, "cx13", false) \
+   B(NoiseGate, cNoiseGate, "cx14", true) \
 
-   sendDoc.clear();
-   sendDoc["id"] = receivedID;
-   sendDoc["val"] = receivedValue;
+//***********************************************************************
+// PARAMETER REGISTRY
+// One entry per control, generated from the tables above, in ParamId order
+// so PARAM_REGISTRY[id] is a direct index. Wire ids ("inSpeed", "cx12") are
+// resolved by binary search over a hash-sorted index built at compile time,
+// then confirmed with one strcasecmp. Lookup, capture, apply and the binary
+// protocol all go through this table instead of per-name string compares.
+// Ids are also the binary protocol's parameter ids, so new controls go at
+// the end of APPENDED_CONTROL_TABLE; a new preset parameter shifts that
+// table and needs a BINARY_PROTOCOL_VERSION bump.
+
+enum ParamId : uint8_t {
+   #define X(type, parameter, def, lo, hi) PID_##parameter,
+   CONTROL_TABLE
+   #undef X
+   #define B(name, variable, wireId, def) PID_##name,
+   CHECKBOX_TABLE
+   #undef B
+   #define X(type, parameter, def, lo, hi) PID_##parameter,
+   PARAMETER_TABLE
+   APPENDED_CONTROL_TABLE
+   #undef X
+   PID_COUNT
+};
 
-   String jsonString;
-   serializeJson(sendDoc, jsonString);
+// Preset parameters are the contiguous PARAMETER_TABLE ids
+#define X(type, parameter, def, lo, hi) + 1
+#define B(name, variable, wireId, def) + 1
+constexpr uint8_t PID_PRESET_FIRST = 0 CONTROL_TABLE CHECKBOX_TABLE;
+constexpr uint8_t PRESET_PARAM_COUNT = 0 PARAMETER_TABLE;
+#undef B
+#undef X
+
+static_assert(PID_COUNT <= 255, "Parameter ids are one byte");
+
+enum ParamType : uint8_t {
+   PARAM_U8,
+   PARAM_U16,
+   PARAM_FLOAT,
+   PARAM_DOUBLE,
+   PARAM_BOOL
+};
 
-   pNumberCharacteristic->setValue(jsonString);
-   
-   pNumberCharacteristic->notify();
-   
-   if (debug) {
-      Serial.print("Sent receipt for ");
-      Serial.print(receivedID);
-      Serial.print(": ");
-      Serial.println(receivedValue);
+template <typename T> struct ParamTypeOf;
+template <> struct ParamTypeOf<uint8_t>  { static constexpr ParamType value = PARAM_U8; };
+template <> struct ParamTypeOf<uint16_t> { static constexpr ParamType value = PARAM_U16; };
+template <> struct ParamTypeOf<float>    { static constexpr ParamType value = PARAM_FLOAT; };
+template <> struct ParamTypeOf<double>   { static constexpr ParamType value = PARAM_DOUBLE; };
+template <> struct ParamTypeOf<bool>     { static constexpr ParamType value = PARAM_BOOL; };
+
+struct ParamInfo {
+   const char* wireId;
+   uint32_t hash;
+   void* value;
+   ParamType type;
+   float def;
+   float lo;
+   float hi;
+};
+
+// Case-insensitive FNV-1a, usable at compile time
+constexpr uint32_t paramHash(const char* s) {
+   uint32_t h = 2166136261u;
+   while (*s) {
+      char c = *s++;
+      if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+      h = (h ^ (uint8_t)c) * 16777619u;
    }
+   return h;
 }
 
-void sendReceiptString(String receivedID, String receivedValue) {
+constexpr ParamInfo PARAM_REGISTRY[PID_COUNT] = {
+   #define X(type, parameter, def, lo, hi) \
+      { "in" #parameter, paramHash("in" #parameter), &c##parameter, ParamTypeOf<type>::value, \
+        static_cast<float>(def), static_cast<float>(lo), static_cast<float>(hi) },
+   CONTROL_TABLE
+   #undef X
+   #define B(name, variable, wireId, def) \
+      { wireId, paramHash(wireId), &variable, PARAM_BOOL, static_cast<float>(def), 0.0f, 1.0f },
+   CHECKBOX_TABLE
+   #undef B
+   #define X(type, parameter, def, lo, hi) \
+      { "in" #parameter, paramHash("in" #parameter), &c##parameter, ParamTypeOf<type>::value, \
+        static_cast<float>(def), static_cast<float>(lo), static_cast<float>(hi) },
+   PARAMETER_TABLE
+   APPENDED_CONTROL_TABLE
+   #undef X
+};
 
-   sendDoc.clear();
-   sendDoc["id"] = receivedID;
-   sendDoc["val"] = receivedValue;
+struct ParamHashIndex {
+   uint8_t order[PID_COUNT];
+};
 
-   String jsonString;
-   serializeJson(sendDoc, jsonString);
+constexpr ParamHashIndex buildParamHashIndex() {
+   ParamHashIndex index{};
+   for (uint8_t i = 0; i < PID_COUNT; i++) {
+      uint8_t j = i;
+      while (j > 0 && PARAM_REGISTRY[index.order[j - 1]].hash > PARAM_REGISTRY[i].hash) {
+         index.order[j] = index.order[j - 1];
+         j--;
+      }
+      index.order[j] = i;
+   }
+   return index;
+}
 
-   pStringCharacteristic->setValue(jsonString);
+constexpr ParamHashIndex PARAM_BY_HASH = buildParamHashIndex();
+
+constexpr bool paramHashesUnique() {
+   for (uint8_t i = 1; i < PID_COUNT; i++) {
+      if (PARAM_REGISTRY[PARAM_BY_HASH.order[i]].hash == PARAM_REGISTRY[PARAM_BY_HASH.order[i - 1]].hash) {
+         return false;
+      }
+   }
+   return true;
+}
+
+static_assert(paramHashesUnique(), "Two parameter wire ids hash alike; rename one");
+
+// ParamId for a wire id hash, or -1
+int findParamByHash(uint32_t h) {
+   int lo = 0;
+   int hi = PID_COUNT - 1;
+   while (lo <= hi) {
+      const int mid = (lo + hi) >> 1;
+      const ParamInfo& p = PARAM_REGISTRY[PARAM_BY_HASH.order[mid]];
+      if (p.hash < h) {
+         lo = mid + 1;
+      } else if (p.hash > h) {
+         hi = mid - 1;
+      } else {
+         return PARAM_BY_HASH.order[mid];
+      }
+   }
+   return -1;
+}
+
+// ParamId for a wire id, or -1
+int findParam(const char* wireId) {
+   const int id = findParamByHash(paramHash(wireId));
+   return (id >= 0 && strcasecmp(PARAM_REGISTRY[id].wireId, wireId) == 0) ? id : -1;
+}
+
+//***********************************************************************
+// VISUALIZER PARAMETER SETS
+// The registry parameters each visualizer reads, declared at compile time
+// as ParamId lists and indexed by program and mode. They drive the device
+// state reply and the per-visualizer part of the schema the web UI fetches
+// (see STATE SYNC). Audio tuning controls apply to every visualizer and
+// have their own panel, so they are not repeated here. A list names only
+// what the draw function reads (matrix rain reads none).
+
+constexpr uint8_t AUDIOREACTIVE_SPECTRUMBARS_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_RADIALSPECTRUM_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_WAVEFORM_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_VUMETER_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_FIREEFFECT_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_WATERFALL_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_BEATPULSE_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_BASSRIPPLE_PARAMS[] = { PID_ColorPalette };
+constexpr uint8_t AUDIOREACTIVE_PARTICLES_PARAMS[] = { PID_ColorPalette };
+
+struct VisualizerParamEntry {
+   const uint8_t* params;
+   uint8_t count;
+};
+
+#define VISUALIZER_PARAMS(list) { list, sizeof(list) }
+#define NO_VISUALIZER_PARAMS { nullptr, 0 }
+
+// In AUDIOREACTIVE_MODES order
+constexpr VisualizerParamEntry AUDIOREACTIVE_VISUALIZER_PARAMS[] = {
+   VISUALIZER_PARAMS(AUDIOREACTIVE_SPECTRUMBARS_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_RADIALSPECTRUM_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_WAVEFORM_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_VUMETER_PARAMS),
+   NO_VISUALIZER_PARAMS,      // matrixrain
+   VISUALIZER_PARAMS(AUDIOREACTIVE_FIREEFFECT_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_WATERFALL_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_BEATPULSE_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_BASSRIPPLE_PARAMS),
+   VISUALIZER_PARAMS(AUDIOREACTIVE_PARTICLES_PARAMS)
+};
+
+static_assert(sizeof(AUDIOREACTIVE_VISUALIZER_PARAMS) / sizeof(VisualizerParamEntry)
+              == sizeof(AUDIOREACTIVE_MODES) / sizeof(AUDIOREACTIVE_MODES[0]),
+              "One parameter set per AUDIOREACTIVE mode");
+
+struct ProgramParamSets {
+   const VisualizerParamEntry* modes;
+   uint8_t count;
+};
+
+// In Program order
+constexpr ProgramParamSets PROGRAM_PARAM_SETS[PROGRAM_COUNT] = {
+   { AUDIOREACTIVE_VISUALIZER_PARAMS, sizeof(AUDIOREACTIVE_VISUALIZER_PARAMS) / sizeof(VisualizerParamEntry) }
+};
+
+constexpr uint8_t countVisualizerParamSets() {
+   uint8_t n = 0;
+   for (uint8_t p = 0; p < PROGRAM_COUNT; p++) n += PROGRAM_PARAM_SETS[p].count;
+   return n;
+}
+
+constexpr uint8_t VISUALIZER_PARAM_SET_COUNT = countVisualizerParamSets();
+
+// Parameter set for a program and mode, nullptr if none is declared
+const VisualizerParamEntry* getVisualizerParams(int programNum, int mode) {
+   if (programNum < 0 || programNum >= PROGRAM_COUNT) return nullptr;
+   const ProgramParamSets& sets = PROGRAM_PARAM_SETS[programNum];
+   if (mode < 0 || mode >= sets.count) return nullptr;
+   return &sets.modes[mode];
+}
+
+double getParam(uint8_t id) {
+   const ParamInfo& p = PARAM_REGISTRY[id];
+   switch (p.type) {
+      case PARAM_U8:     return *static_cast<uint8_t*>(p.value);
+      case PARAM_U16:    return *static_cast<uint16_t*>(p.value);
+      case PARAM_FLOAT:  return *static_cast<float*>(p.value);
+      case PARAM_DOUBLE: return *static_cast<double*>(p.value);
+      case PARAM_BOOL:   return *static_cast<bool*>(p.value) ? 1.0 : 0.0;
+   }
+   return 0.0;
+}
+
+// Work a control needs beyond storing its value
+void applyParamSideEffects(uint8_t id) {
+   switch (id) {
+      case PID_Bright:
+         BRIGHTNESS = cBright;
+         FastLED.setBrightness(BRIGHTNESS);
+         break;
+   }
+}
+
+// Clamps to the registry range and stores; returns true if the stored value changed
+bool setParam(uint8_t id, double value) {
+   if (id >= PID_COUNT || !std::isfinite(value)) return false;
+   const ParamInfo& p = PARAM_REGISTRY[id];
+   if (value < p.lo) value = p.lo;
+   if (value > p.hi) value = p.hi;
+
+   bool changed = false;
+   switch (p.type) {
+      case PARAM_U8: {
+         uint8_t v = (uint8_t)value;
+         changed = *static_cast<uint8_t*>(p.value) != v;
+         *static_cast<uint8_t*>(p.value) = v;
+         break;
+      }
+      case PARAM_U16: {
+         uint16_t v = (uint16_t)value;
+         changed = *static_cast<uint16_t*>(p.value) != v;
+         *static_cast<uint16_t*>(p.value) = v;
+         break;
+      }
+      case PARAM_FLOAT: {
+         float v = (float)value;
+         changed = *static_cast<float*>(p.value) != v;
+         *static_cast<float*>(p.value) = v;
+         break;
+      }
+      case PARAM_DOUBLE: {
+         changed = *static_cast<double*>(p.value) != value;
+         *static_cast<double*>(p.value) = value;
+         break;
+      }
+      case PARAM_BOOL: {
+         bool v = value != 0.0;
+         changed = *static_cast<bool*>(p.value) != v;
+         *static_cast<bool*>(p.value) = v;
+         break;
+      }
+   }
+   applyParamSideEffects(id);
+   return changed;
+}
+
+//***********************************************************************
+// PARAMETER RAMPS
+// Float and double parameters glide instead of jumping: slider moves ramp
+// over cGlideMs and preset loads morph over cMorphBeats beats at the
+// current tempo, both along the cRampEase curve. updateParamRamps() advances
+// them once per frame right after the command drain. Integer and bool
+// parameters (palette, ease and mapping indices, checkboxes) always change
+// at once. Receipts report a ramp's target, not the values in between.
+
+#define PARAM_RAMP_SLOTS 64
+#define MORPH_FALLBACK_BPM 120.0f     // until the tempo tracker has locked on
+#define MORPH_MAX_MS 30000
+
+RampPool<PARAM_RAMP_SLOTS> paramRamps;
+
+inline bool paramRampable(uint8_t id) {
+   return PARAM_REGISTRY[id].type == PARAM_FLOAT || PARAM_REGISTRY[id].type == PARAM_DOUBLE;
+}
+
+// Both ends of a ramp are clamped, so values in between need no checks
+void writeRampValue(uint8_t id, double value) {
+   const ParamInfo& p = PARAM_REGISTRY[id];
+   if (p.type == PARAM_FLOAT) {
+      *static_cast<float*>(p.value) = value;
+   } else {
+      *static_cast<double*>(p.value) = value;
+   }
+}
+
+// Moves a parameter to value over durationMs. Returns false, with any ramp
+// on it cancelled, if the caller should set it directly instead.
+bool rampParam(uint8_t id, double value, uint32_t durationMs) {
+   if (durationMs == 0 || !paramRampable(id)) {
+      paramRamps.cancel(id);
+      return false;
+   }
+   const ParamInfo& p = PARAM_REGISTRY[id];
+   if (value < p.lo) value = p.lo;
+   if (value > p.hi) value = p.hi;
+   return paramRamps.start(id, (float)getParam(id), value, millis(), durationMs, getEaseType(cRampEase));
+}
+
+// The value a parameter is settling on: a ramp's target, else its current value
+double paramTarget(uint8_t id) {
+   double target;
+   return paramRamps.target(id, target) ? target : getParam(id);
+}
+
+uint32_t morphDurationMs() {
+   if (cMorphBeats == 0) return 0;
+   float bpm = myAudio::currentBPM > 0.0f ? myAudio::currentBPM : MORPH_FALLBACK_BPM;
+   uint32_t ms = (uint32_t)(cMorphBeats * 60000.0f / bpm);
+   return ms < MORPH_MAX_MS ? ms : MORPH_MAX_MS;
+}
+
+// Call once per frame from loop(), after drainControlCommands()
+void updateParamRamps() {
+   if (paramRamps.count() == 0) return;
+   paramRamps.update(millis(), writeRampValue);
+}
+
+//*******************************************************************************
+// BINARY CONTROL PROTOCOL ******************************************************
+// Compact alternative to the JSON characteristics, on its own characteristic.
+// One write carries a version byte followed by any number of records:
+//
+//    [version] { [param id] [type] [value, little-endian] } ...
+//
+//    type 1 = uint8 (1 byte), 2 = uint16 (2), 3 = float32 (4), 4 = bool (1)
+//
+// Ids are ParamIds and index PARAM_REGISTRY directly, so dispatch is one
+// table load per record instead of a chain of String compares; values are
+// clamped to the registry range. Records are queued like any other control
+// command. Once applied, the accepted ones are echoed back on the same
+// characteristic in the same format, carrying the stored (clamped) value,
+// from the render loop's notification flush (see flushBinaryReceipts()).
+// The JSON characteristics are unchanged.
+
+#define BINARY_PROTOCOL_VERSION 1
+
+enum BinaryType : uint8_t {
+   BIN_U8 = 1,
+   BIN_U16 = 2,
+   BIN_F32 = 3,
+   BIN_BOOL = 4
+};
+
+// Value size for a type byte, 0 if unknown
+uint8_t binaryTypeSize(uint8_t type) {
+   switch (type) {
+      case BIN_U8:   return 1;
+      case BIN_U16:  return 2;
+      case BIN_F32:  return 4;
+      case BIN_BOOL: return 1;
+   }
+   return 0;
+}
+
+//***********************************************************************
+// NOTIFICATION SCHEDULER
+// Receipts for registry parameters are not sent from the write callback.
+// Applying a parameter only marks it dirty; flushNotifications() runs once
+// per frame after the command drain and sends every dirty parameter's
+// current value, packed as a JSON array of {"id","val"} receipts into as few
+// notifications as the negotiated MTU allows. A value that changes again
+// before the flush just stays dirty, so superseded values are never sent,
+// and a preset load goes out as a handful of batches instead of one notify
+// per parameter. A token bucket caps notifications per connection; whatever
+// doesn't fit waits for the next frame.
+
+#define NOTIFY_RATE_PER_SEC 20
+#define NOTIFY_BURST 4
+#define NOTIFY_MAX_PAYLOAD 512
+#define NOTIFY_MAX_BATCH 48
+
+uint8_t receiptDirty[(PID_COUNT + 7) / 8];
+uint8_t binaryReceiptDirty[(PID_COUNT + 7) / 8];
+uint8_t notifyTokens = NOTIFY_BURST;
+uint32_t notifyRefillMs = 0;
+
+uint32_t receiptsMarked = 0;
+uint32_t receiptsSuperseded = 0;
+uint32_t notificationsSent = 0;
+uint32_t notifyBytesSent = 0;
+
+// Delta sync versions: every change stamps its parameter with the next
+// stateVersion (see STATE SYNC)
+uint32_t stateVersion = 0;
+uint32_t paramVersion[PID_COUNT];
+
+// Render loop only: send id's current value with the next flush
+void queueReceipt(uint8_t id) {
+   uint8_t bit = 1 << (id & 7);
+   if (receiptDirty[id >> 3] & bit) receiptsSuperseded++;
+   receiptDirty[id >> 3] |= bit;
+   receiptsMarked++;
+}
+
+// Render loop only: echo id on the binary characteristic with the next flush
+void queueBinaryReceipt(uint8_t id) {
+   binaryReceiptDirty[id >> 3] |= 1 << (id & 7);
+}
+
+// Render loop only: id has changed
+void markParamDirty(uint8_t id) {
+   paramVersion[id] = ++stateVersion;
+   queueReceipt(id);
+}
+
+bool receiptsPending() {
+   for (uint8_t i = 0; i < sizeof(receiptDirty); i++) {
+      if (receiptDirty[i]) return true;
+   }
+   return false;
+}
+
+// New connection: fresh rate budget, nothing owed to the previous client
+void resetNotifications() {
+   memset(receiptDirty, 0, sizeof(receiptDirty));
+   memset(binaryReceiptDirty, 0, sizeof(binaryReceiptDirty));
+   notifyTokens = NOTIFY_BURST;
+   notifyRefillMs = millis();
+}
+
+uint16_t notifyPayloadSize() {
+   uint16_t mtu = pServer ? pServer->getPeerMTU(pServer->getConnId()) : 23;
+   if (mtu < 23) mtu = 23;
+   uint16_t payload = mtu - 3;
+   return payload < NOTIFY_MAX_PAYLOAD ? payload : NOTIFY_MAX_PAYLOAD;
+}
+
+bool takeNotifyToken() {
+   uint32_t now = millis();
+   uint32_t refill = (now - notifyRefillMs) * NOTIFY_RATE_PER_SEC / 1000;
+   if (refill > 0) {
+      notifyTokens = (notifyTokens + refill > NOTIFY_BURST) ? NOTIFY_BURST : notifyTokens + refill;
+      notifyRefillMs += refill * 1000 / NOTIFY_RATE_PER_SEC;
+   }
+   if (notifyTokens == 0) return false;
+   notifyTokens--;
+   return true;
+}
+
+size_t formatReceipt(char* out, size_t capacity, uint8_t id) {
+   const ParamInfo& p = PARAM_REGISTRY[id];
+   const double value = paramTarget(id);
+   int n;
+   if (p.type == PARAM_BOOL) {
+      n = snprintf(out, capacity, "{\"id\":\"%s\",\"val\":%s}", p.wireId, value != 0.0 ? "true" : "false");
+   } else {
+      n = snprintf(out, capacity, "{\"id\":\"%s\",\"val\":%.6g}", p.wireId, value);
+   }
+   return (n > 0 && (size_t)n < capacity) ? n : 0;
+}
+
+// Sends one batch and clears its ids; false if the rate cap says wait
+bool sendReceiptBatch(BLECharacteristic* characteristic, char* batch, size_t len,
+                      const uint8_t* ids, uint8_t count) {
+   if (!takeNotifyToken()) return false;
+   batch[len++] = ']';
+   characteristic->setValue((uint8_t*)batch, len);
+   characteristic->notify();
+   for (uint8_t i = 0; i < count; i++) {
+      receiptDirty[ids[i] >> 3] &= ~(1 << (ids[i] & 7));
+   }
+   notificationsSent++;
+   notifyBytesSent += len;
+   return true;
+}
+
+// Batches dirty checkbox (bool) or number receipts onto their characteristic
+void flushReceipts(bool checkboxes) {
+   BLECharacteristic* characteristic = checkboxes ? pCheckboxCharacteristic : pNumberCharacteristic;
+   const size_t payload = notifyPayloadSize();
+
+   char batch[NOTIFY_MAX_PAYLOAD + 1];
+   size_t len = 0;
+   uint8_t ids[NOTIFY_MAX_BATCH];
+   uint8_t count = 0;
+
+   for (uint8_t id = 0; id < PID_COUNT; id++) {
+      if (!(receiptDirty[id >> 3] & (1 << (id & 7)))) continue;
+      if ((PARAM_REGISTRY[id].type == PARAM_BOOL) != checkboxes) continue;
+
+      char entry[80];
+      size_t n = formatReceipt(entry, sizeof(entry), id);
+      if (n == 0) continue;
+
+      // '[' or ',' before the entry, ']' after the last one
+      if (count > 0 && (len + 1 + n + 1 > payload || count == NOTIFY_MAX_BATCH)) {
+         if (!sendReceiptBatch(characteristic, batch, len, ids, count)) return;
+         count = 0;
+         len = 0;
+      }
+      batch[len++] = (count == 0) ? '[' : ',';
+      memcpy(&batch[len], entry, n);
+      len += n;
+      ids[count++] = id;
+   }
+   if (count > 0) sendReceiptBatch(characteristic, batch, len, ids, count);
+}
+
+// [type] [value] for id's target value; returns the bytes written (at most 5)
+size_t encodeBinaryValue(uint8_t* out, uint8_t id) {
+   const double value = paramTarget(id);
+   switch (PARAM_REGISTRY[id].type) {
+      case PARAM_U8:
+         out[0] = BIN_U8;
+         out[1] = (uint8_t)value;
+         return 2;
+      case PARAM_BOOL:
+         out[0] = BIN_BOOL;
+         out[1] = value != 0.0;
+         return 2;
+      case PARAM_U16: {
+         uint16_t v = (uint16_t)value;
+         out[0] = BIN_U16;
+         out[1] = v & 0xFF;
+         out[2] = v >> 8;
+         return 3;
+      }
+      default: {
+         float f = (float)value;
+         out[0] = BIN_F32;
+         memcpy(&out[1], &f, sizeof(f));
+         return 1 + sizeof(f);
+      }
+   }
+}
+
+bool sendBinaryReceipt(const uint8_t* packet, size_t len, const uint8_t* ids, uint8_t count) {
+   if (!takeNotifyToken()) return false;
+   pBinaryCharacteristic->setValue((uint8_t*)packet, len);
+   pBinaryCharacteristic->notify();
+   for (uint8_t i = 0; i < count; i++) {
+      binaryReceiptDirty[ids[i] >> 3] &= ~(1 << (ids[i] & 7));
+   }
+   notificationsSent++;
+   notifyBytesSent += len;
+   return true;
+}
+
+// Echoes parameters written over the binary protocol, as binary records
+void flushBinaryReceipts() {
+   const size_t payload = notifyPayloadSize();
+
+   uint8_t packet[NOTIFY_MAX_PAYLOAD];
+   size_t len = 0;
+   uint8_t ids[NOTIFY_MAX_BATCH];
+   uint8_t count = 0;
+
+   for (uint8_t id = 0; id < PID_COUNT; id++) {
+      if (!(binaryReceiptDirty[id >> 3] & (1 << (id & 7)))) continue;
+
+      uint8_t entry[6];
+      entry[0] = id;
+      size_t n = 1 + encodeBinaryValue(&entry[1], id);
+
+      if (count > 0 && (len + n > payload || count == NOTIFY_MAX_BATCH)) {
+         if (!sendBinaryReceipt(packet, len, ids, count)) return;
+         count = 0;
+         len = 0;
+      }
+      if (count == 0) packet[len++] = BINARY_PROTOCOL_VERSION;
+      memcpy(&packet[len], entry, n);
+      len += n;
+      ids[count++] = id;
+   }
+   if (count > 0) sendBinaryReceipt(packet, len, ids, count);
+}
+
+//***********************************************************************
+// AUDIO TELEMETRY
+// Opt-in feedback for tuning gain and gate from the UI. While cTelemetryHz
+// is above zero and a client is connected, the render loop fills an audio
+// feature record at that rate right after the audio block is analysed and
+// notifies it on the telemetry characteristic, delta-encoded to fit one
+// notification at the negotiated MTU (see audioTelemetry.h). It has its own
+// rate rather than the receipt token bucket, and a tick costs one record
+// fill, a 23-byte compare and one notify. A disconnect turns it off again.
+
+#define TELEMETRY_MAX_HZ 30
+
+TelemetryEncoder telemetryEncoder;
+uint32_t telemetryLastMs = 0;
+
+uint32_t telemetryPacketsSent = 0;
+uint32_t telemetryBytesSent = 0;
+
+// Render loop: true when a record is due; fill one and pass it to sendTelemetry()
+bool telemetryDue() {
+   static uint8_t lastHz = 0;
+   if (cTelemetryHz != lastHz) {
+      if (lastHz == 0) telemetryEncoder.reset();    // newly enabled: send everything
+      lastHz = cTelemetryHz;
+   }
+   if (cTelemetryHz == 0 || !deviceConnected || !pTelemetryCharacteristic) return false;
+
+   const uint32_t now = millis();
+   const uint32_t interval = 1000 / (cTelemetryHz < TELEMETRY_MAX_HZ ? cTelemetryHz : TELEMETRY_MAX_HZ);
+   if (now - telemetryLastMs < interval) return false;
+   // Keep the cadence from drifting with frame time, but don't try to catch up
+   telemetryLastMs = (now - telemetryLastMs < 2 * interval) ? telemetryLastMs + interval : now;
+   return true;
+}
+
+void sendTelemetry(const uint8_t* record) {
+   uint8_t packet[TELEM_PACKET_MAX];
+   const uint16_t payload = notifyPayloadSize();
+   const uint8_t len = telemetryEncoder.encode(record, packet,
+      payload < TELEM_PACKET_MAX ? payload : TELEM_PACKET_MAX);
+   pTelemetryCharacteristic->setValue(packet, len);
+   pTelemetryCharacteristic->notify();
+   telemetryPacketsSent++;
+   telemetryBytesSent += len;
+}
+
+// Connection change: the stream is opt-in per connection
+void resetTelemetry() {
+   if (setParam(PID_TelemetryHz, 0)) markParamDirty(PID_TelemetryHz);
+   telemetryEncoder.reset();
+}
+
+//***********************************************************************
+// STATE SYNC
+// The web UI fetches the parameter schema once and afterwards only asks for
+// what has changed. The schema lists every registry entry (wire id, type,
+// range, default) and every visualizer parameter set. SCHEMA_HASH is
+// computed from it at compile time, so the UI can cache the schema across
+// sessions and only request it again (button 93) when the firmware
+// changes. Pages go out on the string characteristic as
+// {"id":"schema","val":{"v":hash,"i":first,"e":[entries],"end":bool}}.
+//
+// On connect the UI writes {"id":"syncState","val":"<epoch>:<version>"}
+// with the last version it saw. Parameters stamped after that version are
+// receipted through the normal batched flush. If the epoch doesn't match
+// (the device has rebooted) or no version is sent, every parameter is
+// receipted. Once no receipts are pending the device sends
+// {"id":"syncVersion","val":"<epoch>:<version>:<schema hash>"}, and sends
+// it again after each later burst of changes has gone out. The version the
+// UI holds therefore always matches the values it has.
+
+#define SCHEMA_ENTRY_MAX 160
+
+constexpr uint32_t schemaHash() {
+   uint32_t h = 2166136261u;
+   for (uint8_t id = 0; id < PID_COUNT; id++) {
+      const ParamInfo& p = PARAM_REGISTRY[id];
+      const uint32_t fields[] = { p.hash, p.type, (uint32_t)(int32_t)(p.lo * 1000.0f),
+                                  (uint32_t)(int32_t)(p.hi * 1000.0f), (uint32_t)(int32_t)(p.def * 1000.0f) };
+      for (uint32_t f : fields) h = (h ^ f) * 16777619u;
+   }
+   for (uint8_t prog = 0; prog < PROGRAM_COUNT; prog++) {
+      for (uint8_t mode = 0; mode < PROGRAM_PARAM_SETS[prog].count; mode++) {
+         const VisualizerParamEntry& set = PROGRAM_PARAM_SETS[prog].modes[mode];
+         for (uint8_t i = 0; i < set.count; i++) h = (h ^ set.params[i]) * 16777619u;
+         h = (h ^ 0xFFu) * 16777619u;
+      }
+   }
+   return h;
+}
+
+constexpr uint32_t SCHEMA_HASH = schemaHash();
+constexpr uint16_t SCHEMA_ENTRY_COUNT = PID_COUNT + VISUALIZER_PARAM_SET_COUNT;
+
+uint32_t syncEpoch = 1;          // random per boot, set in bleSetup()
+
+// Written by the BLE task before it queues CMD_STATE_SYNC
+std::atomic<bool> syncRequestFull{true};
+std::atomic<uint32_t> syncRequestVersion{0};
+
+bool syncActive = false;         // this connection has synced; keep its version current
+bool syncMarkerPending = false;
+uint32_t syncMarkerVersion = 0;
+int16_t schemaCursor = -1;       // next schema entry to send, -1 = idle
+uint32_t programVersion = 0;
+
+uint32_t syncDeltaReceipts = 0;
+uint32_t schemaPagesSent = 0;
+
+// Program and mode are changed directly, not through the registry; stamp
+// them when they move
+void stampProgramChange() {
+   static uint8_t seenProgram = PROGRAM;
+   static uint8_t seenMode = MODE;
+   if (PROGRAM != seenProgram || MODE != seenMode) {
+      seenProgram = PROGRAM;
+      seenMode = MODE;
+      programVersion = ++stateVersion;
+   }
+}
+
+void resetStateSync() {
+   syncActive = false;
+   syncMarkerPending = false;
+   schemaCursor = -1;
+}
+
+// Render loop: receipt everything the client hasn't seen
+void beginStateSync(bool full, uint32_t since) {
+   if (since > stateVersion) full = true;
+   stampProgramChange();
+   uint8_t sent = 0;
+   for (uint8_t id = 0; id < PID_COUNT; id++) {
+      if (full || paramVersion[id] > since) {
+         queueReceipt(id);
+         sent++;
+      }
+   }
+   if (full || programVersion > since) {
+      sendReceiptButton(PROGRAM);
+      if (MODE_COUNTS[PROGRAM] > 0) sendReceiptButton(MODE + 20);
+   }
+   syncDeltaReceipts += sent;
+   syncActive = true;
+   syncMarkerPending = true;
 
-   pStringCharacteristic->notify();
-   
    if (debug) {
-      Serial.print("Sent receipt for ");
-      Serial.print(receivedID);
-      Serial.print(": ");
-      Serial.println(receivedValue);
+      Serial.print(full ? "Full state sync: " : "Delta state sync: ");
+      Serial.print(sent);
+      Serial.println(" parameters");
+   }
+}
+
+void requestSchema() {
+   schemaCursor = 0;
+}
+
+// One schema entry as JSON; 0 if it didn't fit
+size_t formatSchemaEntry(char* out, size_t capacity, uint16_t index) {
+   int n;
+   if (index < PID_COUNT) {
+      const ParamInfo& p = PARAM_REGISTRY[index];
+      n = snprintf(out, capacity, "[\"%s\",%u,%.6g,%.6g,%.6g]", p.wireId, p.type, p.lo, p.hi, p.def);
+      return (n > 0 && (size_t)n < capacity) ? n : 0;
+   }
+
+   // Visualizer sets follow the parameters, in program then mode order
+   uint16_t set = index - PID_COUNT;
+   uint8_t prog = 0;
+   while (prog < PROGRAM_COUNT && set >= PROGRAM_PARAM_SETS[prog].count) {
+      set -= PROGRAM_PARAM_SETS[prog].count;
+      prog++;
+   }
+   if (prog >= PROGRAM_COUNT) return 0;
+
+   char name[VISUALIZER_NAME_MAX];
+   VisualizerManager::getVisualizerName(name, sizeof(name), prog, set);
+   const VisualizerParamEntry& entry = PROGRAM_PARAM_SETS[prog].modes[set];
+   n = snprintf(out, capacity, "{\"n\":\"%s\",\"p\":[", name);
+   for (uint8_t i = 0; i < entry.count && n > 0 && (size_t)n < capacity; i++) {
+      n += snprintf(&out[n], capacity - n, "%s\"%s\"", i ? "," : "", PARAM_REGISTRY[entry.params[i]].wireId);
+   }
+   if (n > 0 && (size_t)n < capacity) n += snprintf(&out[n], capacity - n, "]}");
+   return (n > 0 && (size_t)n < capacity) ? n : 0;
+}
+
+// Sends schema pages while the rate cap allows
+void flushSchema() {
+   static const char tail[] = "],\"end\":false}}";
+   const size_t payload = notifyPayloadSize();
+
+   while (schemaCursor >= 0 && takeNotifyToken()) {
+      char page[NOTIFY_MAX_PAYLOAD + 1];
+      size_t len = snprintf(page, sizeof(page), "{\"id\":\"schema\",\"val\":{\"v\":%lu,\"i\":%d,\"e\":[",
+                            (unsigned long)SCHEMA_HASH, schemaCursor);
+      uint8_t count = 0;
+      while (schemaCursor < SCHEMA_ENTRY_COUNT) {
+         char entry[SCHEMA_ENTRY_MAX];
+         size_t n = formatSchemaEntry(entry, sizeof(entry), schemaCursor);
+         // At least one entry per page, even if a small MTU truncates it
+         if (count > 0 && len + 1 + n + sizeof(tail) - 1 > payload) break;
+         if (len + 1 + n + sizeof(tail) > sizeof(page)) break;
+         if (count > 0) page[len++] = ',';
+         memcpy(&page[len], entry, n);
+         len += n;
+         count++;
+         schemaCursor++;
+      }
+      const bool end = schemaCursor >= SCHEMA_ENTRY_COUNT;
+      len += snprintf(&page[len], sizeof(page) - len, "],\"end\":%s}}", end ? "true" : "false");
+      pStringCharacteristic->setValue((uint8_t*)page, len);
+      pStringCharacteristic->notify();
+      schemaPagesSent++;
+      notificationsSent++;
+      notifyBytesSent += len;
+      if (end) schemaCursor = -1;
    }
 }
 
+void flushStateSync() {
+   stampProgramChange();
+   flushSchema();
+
+   // The version goes out only once every receipt it covers has
+   if (!syncActive || receiptsPending()) return;
+   if (!syncMarkerPending && syncMarkerVersion == stateVersion) return;
+   if (!takeNotifyToken()) return;
+
+   char version[40];
+   snprintf(version, sizeof(version), "%lu:%lu:%lu",
+            (unsigned long)syncEpoch, (unsigned long)stateVersion, (unsigned long)SCHEMA_HASH);
+   sendReceiptString("syncVersion", version);
+   syncMarkerVersion = stateVersion;
+   syncMarkerPending = false;
+}
+
+// Call once per frame from loop(), after drainControlCommands()
+void flushNotifications() {
+   static bool wasDeviceConnected = false;
+   if (deviceConnected != wasDeviceConnected) {
+      wasDeviceConnected = deviceConnected;
+      resetTelemetry();
+      resetNotifications();
+      resetStateSync();
+   }
+   if (!deviceConnected) return;
+   flushReceipts(false);
+   flushReceipts(true);
+   flushBinaryReceipts();
+   flushStateSync();
+}
+
 //***********************************************************************
-// PARAMETER/PRESET MANAGEMENT SYSTEM ("PPMS")
-// X-Macro table 
-#define PARAMETER_TABLE \
-   X(uint8_t, OverrideMapping, 0) \
-   X(uint8_t, ColorPalette, 0) \
-   X(uint8_t, ColOrd, 1.0f) \
-   X(float, Speed, 1.0f) \
-   X(float, Zoom, 1.0f) \
-   X(float, Scale, 1.0f) \
-   X(float, Angle, 1.0f) \
-   X(float, Twist, 1.0f) \
-   X(float, Radius, 1.0f) \
-   X(float, Edge, 1.0f) \
-   X(float, Z, 1.0f) \
-   X(float, RatBase, 1.0f) \
-   X(float, RatDiff, 1.0f) \
-   X(float, OffBase, 1.0f) \
-   X(float, OffDiff, 1.0f) \
-   X(float, Red, 1.0f) \
-   X(float, Green, 1.0f) \
-   X(float, Blue, 1.0f) \
-   X(uint8_t, SpeedInt, 1) \
-   X(float, HueIncMax, 2500.0f) \
-   X(uint8_t, BlendFract, 128) \
-   X(float, BrightTheta, 1.0f) \
-   X(float, SpeedLower, .16f) \
-   X(float, DampLower, 8.0f) \
-   X(float, SpeedUpper, .24f) \
-   X(float, DampUpper, 6.0f) \
-   X(float, BlurGlobFact, 1.0f) \
-   X(float, Movement, 1.0f) \
-   X(float, Tail, 1.0f) \
-   X(uint8_t, EaseSat, 0) \
-   X(uint8_t, EaseLum, 0) \
-   X(float, BloomEdge, 1.0f) \
-   X(double, DecayBase, .95) \
-   X(double, DecayChaos, .04) \
-   X(double, IgnitionBase, .16) \
-   X(double, IgnitionChaos, .05) \
-   X(double, NeighborBase, .48) \
-   X(double, NeighborChaos, .06) \
-   X(float, SpatialDecay, 0.002f) \
-   X(float, DecayZones, 1.0f) \
-   X(float, TimeDrift, 1.0f) \
-   X(float, Pulse, 1.0f) \
-   X(double, InfluenceBase, 0.7) \
-   X(double, InfluenceChaos, 0.35) \
-   X(uint16_t, EntropyRate, 180) \
-   X(float, EntropyBase, 0.05f) \
-   X(float, EntropyChaos, 0.15f) \
-   
-// Auto-generated helper functions using X-macros
-void captureCurrentParameters(ArduinoJson::JsonObject& params) {
-    #define X(type, parameter, def) params[#parameter] = c##parameter;
+// PRESET CACHE
+// Presets are stored as compact binary records keyed by preset parameter:
+//
+//    /preset_N.bin   'P' 'R' [version] [programNum] [modeNum] [count]
+//                    count x { [index] [ParamType] [value, native size, LE] }
+//
+// index is the parameter's position in PARAMETER_TABLE (its ParamId minus
+// PID_PRESET_FIRST), which only changes if the table is reordered. At boot
+// every slot is decoded once into presetCache, one PresetValues struct per
+// slot with a field per PARAMETER_TABLE entry; loading a preset is then a
+// field-by-field copy into the live variables at a frame boundary, with no
+// flash access or parsing on the render loop. A file written before
+// parameters were appended still loads (the new ones take their defaults);
+// records with an unknown index or a changed type are skipped.
+//
+// JSON stays the interchange format: /preset_N.json is imported at boot
+// when a slot has no binary file yet, and the presetImport/presetExport
+// string commands convert one slot either way on the preset worker.
+
+#define PRESET_SLOTS 50
+#define PRESET_FORMAT_VERSION 1
+#define PRESET_JSON_MAX 3072
+#define PRESET_FILENAME_MAX 24
+
+constexpr size_t PRESET_BIN_HEADER = 6;
+constexpr size_t PRESET_BIN_MAX = PRESET_BIN_HEADER + PRESET_PARAM_COUNT * (2 + sizeof(double));
+
+struct PresetValues {
+    #define X(type, parameter, def, lo, hi) type parameter;
+    PARAMETER_TABLE
+    #undef X
+};
+
+constexpr PresetValues PRESET_DEFAULTS = {
+    #define X(type, parameter, def, lo, hi) static_cast<type>(def),
+    PARAMETER_TABLE
+    #undef X
+};
+
+// Where each preset parameter lives in PresetValues, by preset index
+constexpr uint16_t PRESET_OFFSETS[PRESET_PARAM_COUNT] = {
+    #define X(type, parameter, def, lo, hi) offsetof(PresetValues, parameter),
+    PARAMETER_TABLE
+    #undef X
+};
+
+struct PresetSlot {
+    bool valid;
+    uint8_t programNum;
+    uint8_t modeNum;
+    PresetValues values;
+};
+
+// PRESET_SLOTS entries (slot N at N - 1), in PSRAM when the board has it.
+// Filled by loadPresetCache() in setup(); render loop only after that.
+PresetSlot* presetCache = nullptr;
+
+constexpr uint8_t paramTypeSize(ParamType type) {
+    return type == PARAM_U16 ? 2 : type == PARAM_FLOAT ? 4 : type == PARAM_DOUBLE ? 8 : 1;
+}
+
+// Preset JSON keys are the wire id without its "in" prefix
+inline const char* presetKey(uint8_t id) {
+    return PARAM_REGISTRY[id].wireId + 2;
+}
+
+const char* presetFilename(char* out, size_t capacity, int presetNumber, const char* extension) {
+    snprintf(out, capacity, "/preset_%d.%s", presetNumber, extension);
+    return out;
+}
+
+PresetSlot* presetSlot(int presetNumber) {
+    if (presetCache == nullptr || presetNumber < 1 || presetNumber > PRESET_SLOTS) return nullptr;
+    return &presetCache[presetNumber - 1];
+}
+
+// Ramping parameters are saved at their targets
+void capturePresetSlot(PresetSlot& slot) {
+    slot.programNum = PROGRAM;
+    slot.modeNum = MODE_COUNTS[PROGRAM] > 0 ? MODE : 0;
+    #define X(type, parameter, def, lo, hi) slot.values.parameter = static_cast<type>(paramTarget(PID_##parameter));
     PARAMETER_TABLE
     #undef X
+    slot.valid = true;
 }
 
-void applyCurrentParameters(const ArduinoJson::JsonObjectConst& params) {
-    #define X(type, parameter, def) \
-        if (!params[#parameter].isNull()) { \
-            auto newValue = params[#parameter].as<type>(); \
-            if (c##parameter != newValue) { \
-                c##parameter = newValue; \
-                sendReceiptNumber("in" #parameter, c##parameter); \
+// Copies a cached preset into the live parameters, morphing float and
+// double ones over morphMs (0 = at once). Only parameters that change, or
+// were still ramping, are marked for a receipt.
+void applyPresetSlot(const PresetSlot& slot, uint32_t morphMs = 0) {
+    PROGRAM = slot.programNum;
+    if (MODE_COUNTS[PROGRAM] > 0) {
+      MODE = slot.modeNum;
+    }
+    #define X(type, parameter, def, lo, hi) \
+        if (c##parameter != slot.values.parameter || paramRamps.active(PID_##parameter)) { \
+            if (!rampParam(PID_##parameter, slot.values.parameter, morphMs)) { \
+                c##parameter = slot.values.parameter; \
             } \
+            markParamDirty(PID_##parameter); \
         }
     PARAMETER_TABLE
     #undef X
 }
 
+// Binary record for a slot; returns its length, 0 if it didn't fit
+size_t encodePresetSlot(const PresetSlot& slot, uint8_t* out, size_t capacity) {
+    if (capacity < PRESET_BIN_MAX) return 0;
+    size_t len = 0;
+    out[len++] = 'P';
+    out[len++] = 'R';
+    out[len++] = PRESET_FORMAT_VERSION;
+    out[len++] = slot.programNum;
+    out[len++] = slot.modeNum;
+    out[len++] = PRESET_PARAM_COUNT;
+
+    const uint8_t* values = reinterpret_cast<const uint8_t*>(&slot.values);
+    for (uint8_t i = 0; i < PRESET_PARAM_COUNT; i++) {
+        const ParamType type = PARAM_REGISTRY[PID_PRESET_FIRST + i].type;
+        const uint8_t size = paramTypeSize(type);
+        out[len++] = i;
+        out[len++] = type;
+        memcpy(&out[len], values + PRESET_OFFSETS[i], size);     // the S3 is little-endian
+        len += size;
+    }
+    return len;
+}
 
-// Preset file persistence functions with JSON structure
-bool savePreset(int presetNumber) {
-    String filename = "/preset_";
-    filename += presetNumber;
-    filename += ".json";
-    
-    ArduinoJson::JsonDocument preset;
-    preset["programNum"] = PROGRAM;
-    if (MODE_COUNTS[PROGRAM] > 0) { 
-      preset["modeNum"] = MODE;
-    }    
+bool decodePresetSlot(const uint8_t* data, size_t len, PresetSlot& slot) {
+    if (len < PRESET_BIN_HEADER || data[0] != 'P' || data[1] != 'R' || data[2] != PRESET_FORMAT_VERSION) {
+        return false;
+    }
+    slot.programNum = data[3];
+    slot.modeNum = data[4];
+    slot.values = PRESET_DEFAULTS;
+
+    uint8_t* values = reinterpret_cast<uint8_t*>(&slot.values);
+    uint8_t count = data[5];
+    size_t pos = PRESET_BIN_HEADER;
+    for (; count > 0; count--) {
+        if (pos + 2 > len || data[pos + 1] > PARAM_BOOL) return false;
+        const uint8_t index = data[pos];
+        const ParamType type = (ParamType)data[pos + 1];
+        const uint8_t size = paramTypeSize(type);
+        if (pos + 2 + size > len) return false;
+
+        if (index < PRESET_PARAM_COUNT && PARAM_REGISTRY[PID_PRESET_FIRST + index].type == type) {
+            if (type == PARAM_BOOL) {
+                values[PRESET_OFFSETS[index]] = data[pos + 2] != 0;
+            } else {
+                memcpy(values + PRESET_OFFSETS[index], &data[pos + 2], size);
+            }
+        }
+        pos += 2 + size;
+    }
+    slot.valid = true;
+    return true;
+}
+
+// Stores a JSON value into a slot, clamped to the registry range
+void setPresetValue(PresetValues& values, uint8_t index, double value) {
+    const ParamInfo& p = PARAM_REGISTRY[PID_PRESET_FIRST + index];
+    if (value < p.lo) value = p.lo;
+    if (value > p.hi) value = p.hi;
+    void* field = reinterpret_cast<uint8_t*>(&values) + PRESET_OFFSETS[index];
+    switch (p.type) {
+        case PARAM_U8:     *static_cast<uint8_t*>(field) = (uint8_t)value; break;
+        case PARAM_U16:    *static_cast<uint16_t*>(field) = (uint16_t)value; break;
+        case PARAM_FLOAT:  *static_cast<float*>(field) = (float)value; break;
+        case PARAM_DOUBLE: *static_cast<double*>(field) = value; break;
+        case PARAM_BOOL:   *static_cast<bool*>(field) = value != 0.0; break;
+    }
+}
+
+// Slot as preset JSON ({"programNum","modeNum","parameters":{...}});
+// returns its length, 0 if it didn't fit
+size_t presetSlotToJson(const PresetSlot& slot, char* out, size_t capacity, ArduinoJson::Allocator* allocator) {
+    ArduinoJson::JsonDocument preset(allocator);
+    preset["programNum"] = slot.programNum;
+    if (MODE_COUNTS[slot.programNum < PROGRAM_COUNT ? slot.programNum : 0] > 0) {
+      preset["modeNum"] = slot.modeNum;
+    }
     ArduinoJson::JsonObject params = preset["parameters"].to<ArduinoJson::JsonObject>();
-    captureCurrentParameters(params);
-    
-    File file = LittleFS.open(filename, "w");
+    const uint8_t* values = reinterpret_cast<const uint8_t*>(&slot.values);
+    for (uint8_t i = 0; i < PRESET_PARAM_COUNT; i++) {
+        const uint8_t id = PID_PRESET_FIRST + i;
+        const void* field = values + PRESET_OFFSETS[i];
+        switch (PARAM_REGISTRY[id].type) {
+            case PARAM_U8:     params[presetKey(id)] = *static_cast<const uint8_t*>(field); break;
+            case PARAM_U16:    params[presetKey(id)] = *static_cast<const uint16_t*>(field); break;
+            case PARAM_FLOAT:  params[presetKey(id)] = *static_cast<const float*>(field); break;
+            case PARAM_DOUBLE: params[presetKey(id)] = *static_cast<const double*>(field); break;
+            case PARAM_BOOL:   params[presetKey(id)] = *static_cast<const bool*>(field); break;
+        }
+    }
+    size_t len = serializeJson(preset, out, capacity);
+    return len < capacity ? len : 0;
+}
+
+// Parses preset JSON into a slot; parameters it doesn't name take their defaults
+bool presetSlotFromJson(const char* json, size_t len, PresetSlot& slot, ArduinoJson::Allocator* allocator) {
+    ArduinoJson::JsonDocument preset(allocator);
+    ArduinoJson::DeserializationError error = deserializeJson(preset, json, len);
+    if (error || preset["programNum"].isNull() || preset["parameters"].isNull()) {
+        return false;
+    }
+
+    slot.programNum = (uint8_t)preset["programNum"];
+    slot.modeNum = preset["modeNum"] | 0;
+    slot.values = PRESET_DEFAULTS;
+    ArduinoJson::JsonObjectConst params = preset["parameters"];
+    for (uint8_t i = 0; i < PRESET_PARAM_COUNT; i++) {
+        ArduinoJson::JsonVariantConst v = params[presetKey(PID_PRESET_FIRST + i)];
+        if (!v.isNull()) {
+            setPresetValue(slot.values, i, v.as<double>());
+        }
+    }
+    slot.valid = true;
+    return true;
+}
+
+// Writes /preset_N.<extension>.tmp and renames it over the old file, so a
+// brown-out mid-save leaves the previous preset intact
+bool writePresetFile(int presetNumber, const char* extension, const uint8_t* data, size_t len) {
+    char filename[PRESET_FILENAME_MAX];
+    char tempname[PRESET_FILENAME_MAX + 4];
+    presetFilename(filename, sizeof(filename), presetNumber, extension);
+    snprintf(tempname, sizeof(tempname), "%s.tmp", filename);
+
+    File file = LittleFS.open(tempname, "w");
     if (!file) {
         Serial.print("Failed to save preset: ");
         Serial.println(filename);
         return false;
     }
     
-    serializeJson(preset, file);
+    size_t written = file.write(data, len);
     file.close();
+    if (written != len || !LittleFS.rename(tempname, filename)) {
+        LittleFS.remove(tempname);
+        Serial.print("Failed to save preset: ");
+        Serial.println(filename);
+        return false;
+    }
     
     Serial.print("Preset saved: ");
     Serial.println(filename);
     return true;
 }
 
-bool loadPreset(int presetNumber) {
-    String filename = "/preset_";
-    filename += presetNumber;
-    filename += ".json";
-    
+// Reads a preset file into buffer; returns its length, 0 if missing or empty
+size_t readPresetFile(int presetNumber, const char* extension, uint8_t* buffer, size_t capacity) {
+    char filename[PRESET_FILENAME_MAX];
+    presetFilename(filename, sizeof(filename), presetNumber, extension);
+    if (!LittleFS.exists(filename)) return 0;
     File file = LittleFS.open(filename, "r");
     if (!file) {
         Serial.print("Failed to load preset: ");
         Serial.println(filename);
-        return false;
+        return 0;
     }
     
-    ArduinoJson::JsonDocument preset;
-    ArduinoJson::DeserializationError error = deserializeJson(preset, file);
+    size_t len = file.read(buffer, capacity);
     file.close();
-    
-    if (preset["programNum"].isNull() || preset["parameters"].isNull()) {
-        Serial.print("Invalid preset format: ");
-        Serial.println(filename);
+    return len;
+}
+
+//***********************************************************************
+// LIVE STATE PERSISTENCE
+// The current look survives a power cycle: every registry parameter plus
+// program and mode is written behind to /live_state.bin once changes have
+// been quiet for LIVE_STATE_QUIET_MS, at most once per
+// LIVE_STATE_MIN_INTERVAL_MS to spare the flash, by the preset worker.
+//
+//    'L' 'S' [version] [programNum] [modeNum] [count]
+//    count x { [wire id hash, 4 bytes LE] [ParamType] [value, native size, LE] }
+//    [FNV-1a of all the bytes above, 4 bytes LE]
+//
+// Records are keyed by wire id hash so the file outlives reordered or
+// appended tables. The worker writes /live_state.tmp and renames it over
+// the old file; LittleFS renames atomically, so a brown-out leaves either
+// the old or the new state. At boot a file whose checksum doesn't match
+// is ignored, and a complete temp file that missed its rename is used in
+// preference to the older live file.
+
+#define LIVE_STATE_FORMAT_VERSION 1
+#define LIVE_STATE_FILE "/live_state.bin"
+#define LIVE_STATE_TEMP "/live_state.tmp"
+#define LIVE_STATE_QUIET_MS 2000
+#define LIVE_STATE_MIN_INTERVAL_MS 30000
+
+constexpr size_t LIVE_STATE_HEADER = 6;
+constexpr size_t LIVE_STATE_MAX = LIVE_STATE_HEADER + PID_COUNT * (5 + sizeof(double)) + 4;
+
+uint8_t liveStateBuffer[LIVE_STATE_MAX];
+std::atomic<bool> liveStateBusy{false};
+uint32_t liveStateWrites = 0;
+
+uint32_t liveStateChecksum(const uint8_t* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Render loop: current state (ramps at their targets) as a record; returns its length
+size_t encodeLiveState(uint8_t* out, size_t capacity) {
+    if (capacity < LIVE_STATE_MAX) return 0;
+    size_t len = 0;
+    out[len++] = 'L';
+    out[len++] = 'S';
+    out[len++] = LIVE_STATE_FORMAT_VERSION;
+    out[len++] = PROGRAM;
+    out[len++] = MODE;
+    out[len++] = PID_COUNT;
+
+    for (uint8_t id = 0; id < PID_COUNT; id++) {
+        const ParamInfo& p = PARAM_REGISTRY[id];
+        memcpy(&out[len], &p.hash, 4);
+        len += 4;
+        out[len++] = p.type;
+        const double value = paramTarget(id);
+        switch (p.type) {
+            case PARAM_U8:     out[len] = (uint8_t)value; break;
+            case PARAM_U16:    { uint16_t v = (uint16_t)value; memcpy(&out[len], &v, 2); break; }
+            case PARAM_FLOAT:  { float v = (float)value; memcpy(&out[len], &v, 4); break; }
+            case PARAM_DOUBLE: memcpy(&out[len], &value, 8); break;
+            case PARAM_BOOL:   out[len] = value != 0.0; break;
+        }
+        len += paramTypeSize(p.type);
+    }
+
+    const uint32_t checksum = liveStateChecksum(out, len);
+    memcpy(&out[len], &checksum, 4);
+    return len + 4;
+}
+
+// True if data is a complete record of this version
+bool liveStateValid(const uint8_t* data, size_t len) {
+    if (len < LIVE_STATE_HEADER + 4 || data[0] != 'L' || data[1] != 'S' || data[2] != LIVE_STATE_FORMAT_VERSION) {
         return false;
     }
+    uint32_t checksum;
+    memcpy(&checksum, &data[len - 4], 4);
+    return checksum == liveStateChecksum(data, len - 4);
+}
 
-    PROGRAM = (uint8_t)preset["programNum"];
-    if (!preset["modeNum"].isNull()) {
-      MODE = (uint8_t)preset["modeNum"];
+// Applies a validated record; unknown hashes and changed types are skipped
+void applyLiveState(const uint8_t* data, size_t len) {
+    len -= 4;
+    size_t pos = LIVE_STATE_HEADER;
+    for (uint8_t count = data[5]; count > 0; count--) {
+        if (pos + 5 > len || data[pos + 4] > PARAM_BOOL) break;
+        uint32_t hash;
+        memcpy(&hash, &data[pos], 4);
+        const ParamType type = (ParamType)data[pos + 4];
+        const uint8_t size = paramTypeSize(type);
+        if (pos + 5 + size > len) break;
+
+        const uint8_t* v = &data[pos + 5];
+        const int id = findParamByHash(hash);
+        if (id >= 0 && PARAM_REGISTRY[id].type == type) {
+            double value = 0.0;
+            switch (type) {
+                case PARAM_U8:
+                case PARAM_BOOL:   value = v[0]; break;
+                case PARAM_U16:    { uint16_t u; memcpy(&u, v, 2); value = u; break; }
+                case PARAM_FLOAT:  { float f; memcpy(&f, v, 4); value = f; break; }
+                case PARAM_DOUBLE: memcpy(&value, v, 8); break;
+            }
+            setParam(id, value);
+        }
+        pos += 5 + size;
     }
-    pauseAnimation = true;
-    applyCurrentParameters(preset["parameters"]);
-    pauseAnimation = false;
-    
-    Serial.print("Preset loaded: ");
-    Serial.println(filename);
+    if (data[3] < PROGRAM_COUNT) {
+        PROGRAM = data[3];
+        MODE = data[4] < MODE_COUNTS[PROGRAM] ? data[4] : 0;
+        cFxIndex = MODE;
+    }
+}
+
+// Worker: temp file, then rename over the live one
+bool writeLiveStateFile(const uint8_t* data, size_t len) {
+    File file = LittleFS.open(LIVE_STATE_TEMP, "w");
+    if (!file) {
+        Serial.println("Failed to save live state");
+        return false;
+    }
+    size_t written = file.write(data, len);
+    file.close();
+    if (written != len) {
+        LittleFS.remove(LIVE_STATE_TEMP);
+        Serial.println("Failed to save live state");
+        return false;
+    }
+    return LittleFS.rename(LIVE_STATE_TEMP, LIVE_STATE_FILE);
+}
+
+size_t readLiveStateFile(const char* filename, uint8_t* buffer, size_t capacity) {
+    if (!LittleFS.exists(filename)) return 0;
+    File file = LittleFS.open(filename, "r");
+    if (!file) return 0;
+    size_t len = file.read(buffer, capacity);
+    file.close();
+    return len;
+}
+
+// Call from setup() after LittleFS is mounted. A complete temp file is
+// newer than the live one (only its rename was cut off), so it wins and
+// is moved into place before the next write can overwrite it.
+bool restoreLiveState() {
+    size_t len = readLiveStateFile(LIVE_STATE_TEMP, liveStateBuffer, sizeof(liveStateBuffer));
+    if (liveStateValid(liveStateBuffer, len)) {
+        LittleFS.rename(LIVE_STATE_TEMP, LIVE_STATE_FILE);
+    } else {
+        len = readLiveStateFile(LIVE_STATE_FILE, liveStateBuffer, sizeof(liveStateBuffer));
+        if (!liveStateValid(liveStateBuffer, len)) return false;
+    }
+    applyLiveState(liveStateBuffer, len);
+    Serial.println("Live state restored");
     return true;
 }
 
 //***********************************************************************
+// PRESET WORKER
+// A low-priority task that owns LittleFS after setup. The render loop hands
+// it one job at a time per direction through a FreeRTOS queue: a save
+// (binary record already encoded into presetSaveBuffer), or a JSON import
+// or export through presetJsonSlot, or a live state snapshot in
+// liveStateBuffer. Neither the BLE task nor the render
+// loop ever waits on flash. A finished import is copied into the cache by
+// drainControlCommands() at the next frame boundary.
+
+enum PresetJobType : uint8_t {
+   PRESET_JOB_SAVE,
+   PRESET_JOB_EXPORT,
+   PRESET_JOB_IMPORT,
+   PRESET_JOB_LIVE_STATE
+};
+
+struct PresetJob {
+   PresetJobType type;
+   uint8_t presetNumber;
+   uint16_t length;      // save, live state: bytes in the job's buffer
+};
+
+QueueHandle_t presetJobs = NULL;
+uint8_t presetSaveBuffer[PRESET_BIN_MAX];
+std::atomic<bool> presetSaveBusy{false};
+
+char presetJsonBuffer[PRESET_JSON_MAX];
+PresetSlot presetJsonSlot;
+std::atomic<bool> presetJsonBusy{false};
+std::atomic<int8_t> presetImportReady{0};    // preset number decoded into presetJsonSlot, 0 = none
+
+// JSON conversion runs on the worker, or in setup() before it starts
+JsonArena<jsonArenaSize(PRESET_JSON_MAX)> presetJsonArena;
+
+// Imports /preset_N.json into slot and writes its binary file
+bool importPresetJson(int presetNumber, PresetSlot& slot) {
+   size_t len = readPresetFile(presetNumber, "json", (uint8_t*)presetJsonBuffer, sizeof(presetJsonBuffer));
+   if (len == 0) return false;
+   if (!presetSlotFromJson(presetJsonBuffer, len, slot, &presetJsonArena)) {
+      char filename[PRESET_FILENAME_MAX];
+      Serial.print("Invalid preset format: ");
+      Serial.println(presetFilename(filename, sizeof(filename), presetNumber, "json"));
+      return false;
+   }
+   uint8_t record[PRESET_BIN_MAX];
+   writePresetFile(presetNumber, "bin", record, encodePresetSlot(slot, record, sizeof(record)));
+   return true;
+}
 
+// Worker: one job, start to finish
+void runPresetJob(const PresetJob& job) {
+   switch (job.type) {
+      case PRESET_JOB_SAVE:
+         writePresetFile(job.presetNumber, "bin", presetSaveBuffer, job.length);
+         presetSaveBusy.store(false, std::memory_order_release);
+         break;
+      case PRESET_JOB_EXPORT: {
+         size_t len = presetSlotToJson(presetJsonSlot, presetJsonBuffer, sizeof(presetJsonBuffer), &presetJsonArena);
+         if (len > 0) {
+            writePresetFile(job.presetNumber, "json", (const uint8_t*)presetJsonBuffer, len);
+         }
+         presetJsonBusy.store(false, std::memory_order_release);
+         break;
+      }
+      case PRESET_JOB_IMPORT:
+         if (importPresetJson(job.presetNumber, presetJsonSlot)) {
+            presetImportReady.store(job.presetNumber, std::memory_order_release);
+         } else {
+            presetJsonBusy.store(false, std::memory_order_release);
+         }
+         break;
+      case PRESET_JOB_LIVE_STATE:
+         writeLiveStateFile(liveStateBuffer, job.length);
+         liveStateBusy.store(false, std::memory_order_release);
+         break;
+   }
+}
+
+void presetWorkerTask(void*) {
+   PresetJob job;
+   for (;;) {
+      if (xQueueReceive(presetJobs, &job, portMAX_DELAY) == pdTRUE) {
+         runPresetJob(job);
+      }
+   }
+}
+
+// Call from setup() after LittleFS is mounted, before startPresetWorker().
+// Decodes every slot into the cache; a slot with only a JSON file is
+// imported and gets its binary file written.
+void loadPresetCache() {
+   presetCache = (PresetSlot*)(psramFound() ? ps_calloc(PRESET_SLOTS, sizeof(PresetSlot))
+                                            : calloc(PRESET_SLOTS, sizeof(PresetSlot)));
+   if (presetCache == nullptr) {
+      Serial.println("Preset cache allocation failed");
+      return;
+   }
+
+   uint32_t start = millis();
+   uint8_t loaded = 0;
+   uint8_t imported = 0;
+   for (int n = 1; n <= PRESET_SLOTS; n++) {
+      PresetSlot& slot = presetCache[n - 1];
+      size_t len = readPresetFile(n, "bin", presetSaveBuffer, sizeof(presetSaveBuffer));
+      if (len > 0 && decodePresetSlot(presetSaveBuffer, len, slot)) {
+         loaded++;
+      } else if (importPresetJson(n, slot)) {
+         imported++;
+      }
+   }
+
+   Serial.print("Presets cached: ");
+   Serial.print(loaded + imported);
+   Serial.print(" (");
+   Serial.print(imported);
+   Serial.print(" imported from JSON) in ");
+   Serial.print(millis() - start);
+   Serial.println(" ms");
+}
+
+// Call from setup() after LittleFS is mounted
+void startPresetWorker() {
+   presetJobs = xQueueCreate(4, sizeof(PresetJob));
+   xTaskCreatePinnedToCore(presetWorkerTask, "presets", 4096, NULL, 1, NULL, 0);
+}
+
+// Render loop: snapshot the current state into the cache and queue the write
+bool savePreset(int presetNumber) {
+   PresetSlot* slot = presetSlot(presetNumber);
+   if (slot == nullptr || presetJobs == NULL) return false;
+   if (presetSaveBusy.load(std::memory_order_acquire)) {
+      Serial.println("Preset save already in progress");
+      return false;
+   }
+   capturePresetSlot(*slot);
+   size_t len = encodePresetSlot(*slot, presetSaveBuffer, sizeof(presetSaveBuffer));
+   presetSaveBusy.store(true, std::memory_order_release);
+   PresetJob job = { PRESET_JOB_SAVE, (uint8_t)presetNumber, (uint16_t)len };
+   xQueueSend(presetJobs, &job, 0);
+   return true;
+}
+
+// Render loop: applies a cached preset, morphing to it over cMorphBeats
+bool loadPreset(int presetNumber) {
+   PresetSlot* slot = presetSlot(presetNumber);
+   if (slot == nullptr || !slot->valid) {
+      Serial.print("Preset not found: ");
+      Serial.println(presetNumber);
+      return false;
+   }
+   uint32_t start = micros();
+   applyPresetSlot(*slot, morphDurationMs());
+   uint32_t elapsed = micros() - start;
+
+   Serial.print("Preset loaded: ");
+   Serial.println(presetNumber);
+   if (debug) {
+      Serial.print("Preset apply us: ");
+      Serial.println(elapsed);
+   }
+   return true;
+}
+
+// Render loop: write a cached slot out as /preset_N.json
+bool exportPreset(int presetNumber) {
+   PresetSlot* slot = presetSlot(presetNumber);
+   if (slot == nullptr || !slot->valid || presetJobs == NULL) return false;
+   if (presetJsonBusy.load(std::memory_order_acquire)) {
+      Serial.println("Preset import/export already in progress");
+      return false;
+   }
+   presetJsonSlot = *slot;
+   presetJsonBusy.store(true, std::memory_order_release);
+   PresetJob job = { PRESET_JOB_EXPORT, (uint8_t)presetNumber, 0 };
+   xQueueSend(presetJobs, &job, 0);
+   return true;
+}
+
+// Render loop: queue a re-import of /preset_N.json; the slot is replaced
+// once the worker has parsed it
+bool importPreset(int presetNumber) {
+   if (presetSlot(presetNumber) == nullptr || presetJobs == NULL) return false;
+   if (presetJsonBusy.load(std::memory_order_acquire)) {
+      Serial.println("Preset import/export already in progress");
+      return false;
+   }
+   presetJsonBusy.store(true, std::memory_order_release);
+   PresetJob job = { PRESET_JOB_IMPORT, (uint8_t)presetNumber, 0 };
+   xQueueSend(presetJobs, &job, 0);
+   return true;
+}
+
+// Render loop: move a finished import into the cache, if any
+void applyImportedPreset() {
+   int8_t presetNumber = presetImportReady.load(std::memory_order_acquire);
+   if (presetNumber == 0) return;
+   PresetSlot* slot = presetSlot(presetNumber);
+   if (slot != nullptr) {
+      *slot = presetJsonSlot;
+      Serial.print("Preset imported: ");
+      Serial.println(presetNumber);
+   }
+   presetImportReady.store(0, std::memory_order_relaxed);
+   presetJsonBusy.store(false, std::memory_order_release);
+}
+
+// Render loop, once per frame: schedules a write-behind of the live state.
+// Every parameter change goes through markParamDirty() and bumps
+// stateVersion, so a moving version (or a program/mode switch) is the
+// change signal.
+void persistLiveState() {
+   static uint32_t seenVersion = 0;
+   static uint8_t seenProgram = PROGRAM;
+   static uint8_t seenMode = MODE;
+   static bool dirty = false;
+   static uint32_t lastChangeMs = 0;
+   static uint32_t lastWriteMs = 0;
+
+   uint32_t now = millis();
+   if (stateVersion != seenVersion || PROGRAM != seenProgram || MODE != seenMode) {
+      seenVersion = stateVersion;
+      seenProgram = PROGRAM;
+      seenMode = MODE;
+      dirty = true;
+      lastChangeMs = now;
+   }
+
+   if (!dirty || presetJobs == NULL) return;
+   if (now - lastChangeMs < LIVE_STATE_QUIET_MS) return;
+   if (lastWriteMs != 0 && now - lastWriteMs < LIVE_STATE_MIN_INTERVAL_MS) return;
+   if (liveStateBusy.load(std::memory_order_acquire)) return;
+
+   size_t len = encodeLiveState(liveStateBuffer, sizeof(liveStateBuffer));
+   liveStateBusy.store(true, std::memory_order_release);
+   PresetJob job = { PRESET_JOB_LIVE_STATE, 0, (uint16_t)len };
+   if (xQueueSend(presetJobs, &job, 0) != pdTRUE) {
+      liveStateBusy.store(false, std::memory_order_release);
+      return;
+   }
+   dirty = false;
+   lastWriteMs = now;
+   liveStateWrites++;
+}
+
+//***********************************************************************
+
+#define STATE_JSON_MAX 768
+
+JsonArena<jsonArenaSize(STATE_JSON_MAX)> stateArena;      // render loop only
+
+// Program, mode and the current visualizer's parameters, keyed by wire id
+// without its "in" prefix. The web UI now syncs through STATE SYNC; this
+// full reply stays for button 92.
 void sendDeviceState() { 
    if (debug) {
       Serial.println("Sending device state...");
    }
    
-   ArduinoJson::JsonDocument stateDoc;
+   ArduinoJson::JsonDocument stateDoc(&stateArena);
    stateDoc["program"] = PROGRAM;
    stateDoc["mode"] = MODE;
    
-   String currentVisualizer = VisualizerManager::getVisualizerName(PROGRAM, MODE); 
-   
-   // Get parameter list for current visualizer
-   const VisualizerParamEntry* visualizerParams = VisualizerManager::getVisualizerParams(currentVisualizer);
-
    ArduinoJson::JsonObject params = stateDoc["parameters"].to<ArduinoJson::JsonObject>();
 
+   const VisualizerParamEntry* visualizerParams = getVisualizerParams(PROGRAM, MODE);
+
    if (debug) {
-       String currentVisualizer = VisualizerManager::getVisualizerName(PROGRAM, MODE);
+       char currentVisualizer[VISUALIZER_NAME_MAX];
        Serial.print("Current visualizer: ");
-       Serial.println(currentVisualizer);
-       Serial.print("Found params: ");
-       Serial.println(visualizerParams != nullptr ? "YES" : "NO");
-       if (visualizerParams != nullptr) {
-           Serial.print("Param count: ");
-           Serial.println(visualizerParams->count);
-       }
+       Serial.println(VisualizerManager::getVisualizerName(currentVisualizer, sizeof(currentVisualizer), PROGRAM, MODE));
+       Serial.print("Param count: ");
+       Serial.println(visualizerParams != nullptr ? visualizerParams->count : 0);
    }
    
    if (visualizerParams != nullptr) {
-       // Loop through parameters for current visualizer
        for (uint8_t i = 0; i < visualizerParams->count; i++) {
-           char paramName[32];
-           ::strcpy(paramName, (char*)pgm_read_ptr(&visualizerParams->params[i]));
-           
-           if (debug) {
-               Serial.print("Processing parameter: ");
-               Serial.println(paramName);
-           }
+           const uint8_t id = visualizerParams->params[i];
+           params[PARAM_REGISTRY[id].wireId + 2] = paramTarget(id);
        }
    }
 
-   // Add parameter values to JSON based on visualizer params
-   for (uint8_t i = 0; i < visualizerParams->count; i++) {
-       char paramName[32];
-       ::strcpy(paramName, (char*)pgm_read_ptr(&visualizerParams->params[i]));
-       
-       bool paramFound = false;
-       // Use X-macro to match parameter names and add values
-       // Handle case-insensitive comparison for parameter names
-       #define X(type, parameter, def) \
-           if (strcasecmp(paramName, #parameter) == 0) { \
-               params[paramName] = c##parameter; \
-               if (debug) { \
-                   Serial.print("Added parameter "); \
-                   Serial.print(paramName); \
-                   Serial.print(": "); \
-                   Serial.println(c##parameter); \
-               } \
-               paramFound = true; \
-           }
-       PARAMETER_TABLE
-       #undef X
-       
-       if (!paramFound && debug) {
-           Serial.print("Warning: Parameter not found in X-macro table: ");
-           Serial.println(paramName);
-       }
+   char stateJson[STATE_JSON_MAX];
+   if (serializeJson(stateDoc, stateJson, sizeof(stateJson)) >= sizeof(stateJson) - 1) {
+       Serial.println("Device state too large to send");
+       return;
    }
-
-   
-   String stateJson;
-   serializeJson(stateDoc, stateJson);
    sendReceiptString("deviceState", stateJson);
 }
 
 
-// Handle UI request functions ***********************************************
-
 std::string convertToStdString(const String& flStr) {
    return std::string(flStr.c_str());
 }
 
-void processButton(uint8_t receivedValue) {
+//*******************************************************************************
+// CONTROL COMMAND QUEUE
+// BLE callbacks run on the Bluedroid host task. They parse and validate the
+// write and push a compact command; they never touch render state, flash or
+// a characteristic. Receipts go out from the render loop, as the command is
+// applied or with the next notification flush, so only one task ever sets
+// and notifies a characteristic. The render loop calls drainControlCommands() once
+// per frame, before drawing, so a frame always sees one consistent set of
+// parameters. Draining stops when the budget runs out; the rest waits for
+// the next frame.
+
+#define CONTROL_QUEUE_SIZE 64
+#define CONTROL_DRAIN_BUDGET_US 2000
+
+enum ControlCommandType : uint8_t {
+   CMD_SET_PARAM,    // id = ParamId
+   CMD_SET_PARAM_BINARY,   // id = ParamId, also echoed on the binary characteristic
+   CMD_BUTTON,       // id = button value
+   CMD_PRESET_EXPORT,   // id = preset number
+   CMD_PRESET_IMPORT,   // id = preset number
+   CMD_STATE_SYNC       // request in syncRequestFull/syncRequestVersion
+};
+
+struct ControlCommand {
+   ControlCommandType type;
+   uint8_t id;
+   double value;     // double, so double parameters keep the precision they were sent with
+};
+
+SpscQueue<ControlCommand, CONTROL_QUEUE_SIZE> controlQueue;
+
+uint32_t commandsApplied = 0;
+uint32_t drainOverruns = 0;      // frames that left commands for the next one
+
+void queueParam(uint8_t id, double value, ControlCommandType type = CMD_SET_PARAM) {
+   ControlCommand cmd = { type, id, value };
+   if (!controlQueue.push(cmd) && debug) {
+      Serial.println("Control queue full, command dropped");
+   }
+}
+
+void queueButton(uint8_t value) {
+   ControlCommand cmd = { CMD_BUTTON, value, 0.0f };
+   if (!controlQueue.push(cmd) && debug) {
+      Serial.println("Control queue full, button dropped");
+   }
+}
+
+// Commands that carry at most a one-byte argument
+void queueCommand(ControlCommandType type, uint8_t id) {
+   ControlCommand cmd = { type, id, 0.0f };
+   if (!controlQueue.push(cmd) && debug) {
+      Serial.println("Control queue full, command dropped");
+   }
+}
+
+// Render loop side of a button press
+void applyButton(uint8_t receivedValue) {
 
-   sendReceiptButton(receivedValue);
-      
    if (receivedValue < 20) { // Program selection
       PROGRAM = receivedValue;
       MODE = 0;
@@ -607,12 +2096,14 @@ void processButton(uint8_t receivedValue) {
    }
 
    if (debug) {
+      char visualizerName[VISUALIZER_NAME_MAX];
       Serial.print("Current visualizer: ");
-      Serial.println(VisualizerManager::getVisualizerName(PROGRAM, MODE));
+      Serial.println(VisualizerManager::getVisualizerName(visualizerName, sizeof(visualizerName), PROGRAM, MODE));
    }
 
    //if (receivedValue == 91) { updateUI(); }
    if (receivedValue == 92) { sendDeviceState(); }
+   if (receivedValue == 93) { requestSchema(); }
    if (receivedValue == 94) { fancyTrigger = true; }
    //if (receivedValue == 95) { resetAll(); }
    
@@ -626,81 +2117,166 @@ void processButton(uint8_t receivedValue) {
 
    if (receivedValue >= 151 && receivedValue <= 200) { 
        uint8_t presetToLoad = receivedValue - 150;
-       if (loadPreset(presetToLoad)) {
-           loadPreset(presetToLoad);
-           Serial.print("Loaded preset: ");
-           Serial.println(presetToLoad);
-       }
+       loadPreset(presetToLoad);
    }
 }
 
-//*****************************************************************************
-
-void processNumber(String receivedID, float receivedValue ) {
+void sendReceiptPreset(const char* receivedID, uint8_t presetNumber) {
+   char value[4];
+   snprintf(value, sizeof(value), "%u", presetNumber);
+   sendReceiptString(receivedID, value);
+}
 
-   sendReceiptNumber(receivedID, receivedValue);
-  
-   if (receivedID == "inBright") {
-      cBright = receivedValue;
-      BRIGHTNESS = cBright;
-      FastLED.setBrightness(BRIGHTNESS);
-   };
-
-   if (receivedID == "inInputGain") {
-      cInputGain = receivedValue;
-   };
-  
-   if (receivedID == "inMagnitudeScale") {
-      cMagnitudeScale = receivedValue;
-   };
+// Call once per frame from loop(), before rendering
+void drainControlCommands(uint32_t budgetUs = CONTROL_DRAIN_BUDGET_US) {
+   applyImportedPreset();
+
+   uint32_t start = micros();
+   ControlCommand cmd;
+   while (controlQueue.pop(cmd)) {
+      switch (cmd.type) {
+         case CMD_SET_PARAM:
+         case CMD_SET_PARAM_BINARY:
+            if (!rampParam(cmd.id, cmd.value, cGlideMs)) {
+               setParam(cmd.id, cmd.value);
+            }
+            markParamDirty(cmd.id);      // receipt goes out with the next flush
+            if (cmd.type == CMD_SET_PARAM_BINARY) queueBinaryReceipt(cmd.id);
+            break;
+         case CMD_BUTTON:
+            sendReceiptButton(cmd.id);
+            applyButton(cmd.id);
+            break;
+         case CMD_PRESET_EXPORT:
+            sendReceiptPreset("presetExport", cmd.id);
+            exportPreset(cmd.id);
+            break;
+         case CMD_PRESET_IMPORT:
+            sendReceiptPreset("presetImport", cmd.id);
+            importPreset(cmd.id);
+            break;
+         case CMD_STATE_SYNC:
+            beginStateSync(syncRequestFull.load(std::memory_order_acquire),
+                           syncRequestVersion.load(std::memory_order_acquire));
+            break;
+      }
+      commandsApplied++;
+      if (micros() - start >= budgetUs) {
+         if (!controlQueue.empty()) drainOverruns++;
+         break;
+      }
+   }
+}
 
-   if (receivedID == "inGainAdjust") {
-      cGainAdjust = receivedValue;
-   };
+// Handle UI request functions ***********************************************
 
-   if (receivedID == "inFadeSpeed") {
-      cFadeSpeed = receivedValue;
-   };
+// The receipt goes out when the render loop applies the button
+void processButton(uint8_t receivedValue) {
+   queueButton(receivedValue);
+}
 
-   if (receivedID == "inAgcSensitivity") {
-      cAgcSensitivity = receivedValue;
-   };
+//*****************************************************************************
 
-   if (receivedID == "inGateThreshold") {
-      cGateThreshold = receivedValue;
-   };
+// Registry parameters are receipted by flushNotifications() once applied;
+// unknown ids change nothing and get no receipt
+void processNumber(const char* receivedID, double receivedValue ) {
+
+   int id = findParam(receivedID);
+   if (id >= 0) {
+      queueParam(id, receivedValue);
+   } else {
+      if (debug) {
+         Serial.print("Unknown number parameter: ");
+         Serial.println(receivedID);
+      }
+   }
+}
 
+void processCheckbox(const char* receivedID, bool receivedValue ) {
+   
+   int id = findParam(receivedID);
+   if (id >= 0 && PARAM_REGISTRY[id].type == PARAM_BOOL) {
+      queueParam(id, receivedValue);
+   } else if (debug) {
+      Serial.print("Unknown checkbox: ");
+      Serial.println(receivedID);
+   }
+   //cx15 (mirror mode) and cx16 (beat detect) are not implemented
+}
 
+// presetExport / presetImport take a preset number and convert that slot
+// to or from /preset_N.json; syncState takes "<epoch>:<version>" (see STATE SYNC)
+void processString(const char* receivedID, const char* receivedValue ) {
+   if (strcmp(receivedID, "syncState") == 0) {
+      unsigned long epoch = 0;
+      unsigned long version = 0;
+      bool delta = sscanf(receivedValue, "%lu:%lu", &epoch, &version) == 2 && epoch == syncEpoch;
+      syncRequestVersion.store(delta ? version : 0, std::memory_order_relaxed);
+      syncRequestFull.store(!delta, std::memory_order_release);
+      queueCommand(CMD_STATE_SYNC, 0);
+      return;
+   }
 
-   // Auto-generated custom parameter handling using X-macros
-   #define X(type, parameter, def) \
-       if (receivedID == "in" #parameter) { c##parameter = receivedValue; return; }
-   PARAMETER_TABLE
-   #undef X
+   // Receipted by the render loop when the command runs
+   int presetNumber = atoi(receivedValue);
+   if (presetNumber < 1 || presetNumber > PRESET_SLOTS) return;
+   if (strcmp(receivedID, "presetExport") == 0) {
+      queueCommand(CMD_PRESET_EXPORT, presetNumber);
+   } else if (strcmp(receivedID, "presetImport") == 0) {
+      queueCommand(CMD_PRESET_IMPORT, presetNumber);
+   }
+}
 
+// Binary writes (see BINARY CONTROL PROTOCOL) *********************************
+
+float readBinaryValue(uint8_t type, const uint8_t* p) {
+   switch (type) {
+      case BIN_U8:
+      case BIN_BOOL:
+         return p[0];
+      case BIN_U16:
+         return (uint16_t)(p[0] | (p[1] << 8));
+      case BIN_F32: {
+         float f;
+         memcpy(&f, p, sizeof(f));
+         return f;
+      }
+   }
+   return 0.0f;
 }
 
-void processCheckbox(String receivedID, bool receivedValue ) {
-   
-   sendReceiptCheckbox(receivedID, receivedValue);
-   
-   if (receivedID == "cx10") {rotateWaves = receivedValue;};
-   if (receivedID == "cxLayer1") {Layer1 = receivedValue;};
-   if (receivedID == "cxLayer2") {Layer2 = receivedValue;};
-   if (receivedID == "cxLayer3") {Layer3 = receivedValue;};
-   if (receivedID == "cxLayer4") {Layer4 = receivedValue;};
-   if (receivedID == "cxLayer5") {Layer5 = receivedValue;};
-   if (receivedID == "cx11") {mappingOverride = receivedValue;};
-   if (receivedID == "cx12") {cEnableAudio = receivedValue;};
-   if (receivedID == "cx13") {cAutoGain  = receivedValue;};
-   if (receivedID == "cx14") {cNoiseGate = receivedValue;};
-   //if (receivedID == "cx15") {cMirrorMode = receivedValue;};
-   //if (receivedID == "cx16") {cBeatDetect = receivedValue;};
+// Queues every valid record in one write; returns the number accepted.
+// A record with an unknown type ends the parse (its length is unknown);
+// a record with an unknown id or a NaN/infinite F32 value is skipped.
+uint8_t processBinary(const uint8_t* data, size_t len) {
+   if (len < 1 || data[0] != BINARY_PROTOCOL_VERSION) {
+      if (debug) {
+         Serial.print("Binary write ignored, version ");
+         Serial.println(len ? data[0] : 0);
+      }
+      return 0;
+   }
 
-}
+   uint8_t accepted = 0;
+   size_t pos = 1;
+   while (pos + 2 <= len) {
+      const uint8_t id = data[pos];
+      const uint8_t type = data[pos + 1];
+      const uint8_t size = binaryTypeSize(type);
+      if (size == 0 || pos + 2 + size > len) break;
+
+      const float value = readBinaryValue(type, &data[pos + 2]);
+      if (id < PID_COUNT && std::isfinite(value)) {
+         queueParam(id, value, CMD_SET_PARAM_BINARY);
+         accepted++;
+      } else if (debug) {
+         Serial.print(id < PID_COUNT ? "Binary write: non-finite value for id " : "Binary write: unknown parameter id ");
+         Serial.println(id);
+      }
+      pos += 2 + size;
+   }
 
-void processString(String receivedID, String receivedValue ) {
-   sendReceiptString(receivedID, receivedValue);
+   return accepted;
 }
 
 //*******************************************************************************
@@ -722,10 +2298,9 @@ class MyServerCallbacks: public BLEServerCallbacks {
 class ButtonCharacteristicCallbacks : public BLECharacteristicCallbacks {
    void onWrite(BLECharacteristic *characteristic) {
 
-      String value = characteristic->getValue();
-      if (value.length() > 0) {
+      if (characteristic->getLength() > 0) {
          
-         uint8_t receivedValue = value[0];
+         uint8_t receivedValue = characteristic->getData()[0];
          
          if (debug) {
             Serial.print("Button value received: ");
@@ -741,17 +2316,20 @@ class ButtonCharacteristicCallbacks : public BLECharacteristicCallbacks {
 class CheckboxCharacteristicCallbacks : public BLECharacteristicCallbacks {
    void onWrite(BLECharacteristic *characteristic) {
   
-      String receivedBuffer = characteristic->getValue();
+      // Read the attribute buffer in place rather than copying it into a String
+      const char* receivedBuffer = (const char*)characteristic->getData();
+      size_t receivedLength = characteristic->getLength();
   
-      if (receivedBuffer.length() > 0) {
+      if (receivedLength > 0) {
                   
          if (debug) {
             Serial.print("Received buffer: ");
-            Serial.println(receivedBuffer);
+            Serial.write((const uint8_t*)receivedBuffer, receivedLength);
+            Serial.println();
          }
       
-         ArduinoJson::deserializeJson(receivedJSON, receivedBuffer);
-         String receivedID = receivedJSON["id"] ;
+         ArduinoJson::deserializeJson(receivedJSON, receivedBuffer, receivedLength);
+         const char* receivedID = receivedJSON["id"] | "";
          bool receivedValue = receivedJSON["val"];
       
          if (debug) {
@@ -769,18 +2347,21 @@ class CheckboxCharacteristicCallbacks : public BLECharacteristicCallbacks {
 class NumberCharacteristicCallbacks : public BLECharacteristicCallbacks {
    void onWrite(BLECharacteristic *characteristic) {
       
-      String receivedBuffer = characteristic->getValue();
+      // Read the attribute buffer in place rather than copying it into a String
+      const char* receivedBuffer = (const char*)characteristic->getData();
+      size_t receivedLength = characteristic->getLength();
       
-      if (receivedBuffer.length() > 0) {
+      if (receivedLength > 0) {
       
          if (debug) {
             Serial.print("Received buffer: ");
-            Serial.println(receivedBuffer);
+            Serial.write((const uint8_t*)receivedBuffer, receivedLength);
+            Serial.println();
          }
       
-         ArduinoJson::deserializeJson(receivedJSON, receivedBuffer);
-         String receivedID = receivedJSON["id"] ;
-         float receivedValue = receivedJSON["val"];
+         ArduinoJson::deserializeJson(receivedJSON, receivedBuffer, receivedLength);
+         const char* receivedID = receivedJSON["id"] | "";
+         double receivedValue = receivedJSON["val"];
       
          if (debug) {
             Serial.print(receivedID);
@@ -796,18 +2377,21 @@ class NumberCharacteristicCallbacks : public BLECharacteristicCallbacks {
 class StringCharacteristicCallbacks : public BLECharacteristicCallbacks {
    void onWrite(BLECharacteristic *characteristic) {
       
-      String receivedBuffer = characteristic->getValue();
+      // Read the attribute buffer in place rather than copying it into a String
+      const char* receivedBuffer = (const char*)characteristic->getData();
+      size_t receivedLength = characteristic->getLength();
       
-      if (receivedBuffer.length() > 0) {
+      if (receivedLength > 0) {
       
          if (debug) {
             Serial.print("Received buffer: ");
-            Serial.println(receivedBuffer);
+            Serial.write((const uint8_t*)receivedBuffer, receivedLength);
+            Serial.println();
          }
       
-         ArduinoJson::deserializeJson(receivedJSON, receivedBuffer);
-         String receivedID = receivedJSON["id"] ;
-         String receivedValue = receivedJSON["val"];
+         ArduinoJson::deserializeJson(receivedJSON, receivedBuffer, receivedLength);
+         const char* receivedID = receivedJSON["id"] | "";
+         const char* receivedValue = receivedJSON["val"] | "";
       
          if (debug) {
             Serial.print(receivedID);
@@ -820,17 +2404,39 @@ class StringCharacteristicCallbacks : public BLECharacteristicCallbacks {
    }
 };
 
+class BinaryCharacteristicCallbacks : public BLECharacteristicCallbacks {
+   void onWrite(BLECharacteristic *characteristic) {
+
+      uint8_t* data = characteristic->getData();
+      size_t len = characteristic->getLength();
+
+      if (len > 0) {
+         uint8_t accepted = processBinary(data, len);
+
+         if (debug) {
+            Serial.print("Binary write: ");
+            Serial.print(len);
+            Serial.print(" bytes, ");
+            Serial.print(accepted);
+            Serial.println(" params queued");
+         }
+      }
+   }
+};
+
 //*******************************************************************************
 // BLE SETUP FUNCTION ***********************************************************
 
 void bleSetup() {
 
    BLEDevice::init("Aurora Portal");
+   BLEDevice::setMTU(517);      // let batched receipts and schema pages use the client's MTU
+   syncEpoch = esp_random() | 1;
 
    pServer = BLEDevice::createServer();
    pServer->setCallbacks(new MyServerCallbacks());
 
-   BLEService *pService = pServer->createService(SERVICE_UUID);
+   BLEService *pService = pServer->createService(BLEUUID(SERVICE_UUID), SERVICE_NUM_HANDLES);
 
    pButtonCharacteristic = pService->createCharacteristic(
                      BUTTON_CHARACTERISTIC_UUID,
@@ -871,6 +2477,23 @@ void bleSetup() {
    pStringCharacteristic->setCallbacks(new StringCharacteristicCallbacks());
    pStringCharacteristic->setValue(String(dummy).c_str());
    //pStringCharacteristic->addDescriptor(new BLE2902());
+
+   pBinaryCharacteristic = pService->createCharacteristic(
+                     BINARY_CHARACTERISTIC_UUID,
+                     BLECharacteristic::PROPERTY_WRITE |
+                     BLECharacteristic::PROPERTY_WRITE_NR |
+                     BLECharacteristic::PROPERTY_READ |
+                     BLECharacteristic::PROPERTY_NOTIFY
+                  );
+   pBinaryCharacteristic->setCallbacks(new BinaryCharacteristicCallbacks());
+   pBinaryCharacteristic->setValue(&dummy, 1);
+
+   pTelemetryCharacteristic = pService->createCharacteristic(
+                     TELEMETRY_CHARACTERISTIC_UUID,
+                     BLECharacteristic::PROPERTY_READ |
+                     BLECharacteristic::PROPERTY_NOTIFY
+                  );
+   pTelemetryCharacteristic->setValue(&dummy, 1);
    
 
    //**********************************************************
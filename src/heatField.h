@@ -0,0 +1,79 @@
+#pragma once
+
+#include <FastLED.h>
+#include <string.h>
+
+//=============================================================================
+// Heat-diffusion fire field
+// A W x H grid of uint8_t heat (row 0 is the top, sparks enter at the
+// bottom). Each step cools every cell by a random amount scaled in fixed
+// point, then lets heat rise: a cell becomes a weighted average of the three
+// cells below it and the one two rows down. The update runs top to bottom in
+// place - row y only reads rows y+1 and y+2, which have not been written yet
+// this step - so there is no second buffer.
+//
+// Colour comes from a 256-entry CRGB table built from a palette once and
+// reused until the palette changes; rendering is one table load per cell.
+// Per cell and step that is one random8, a saturating subtract, four loads
+// and a shift - roughly 15 cycles on the S3 (~0.1 ms for 32x48), plus a
+// table load and store to render; test_heat_field times both per cell.
+//=============================================================================
+
+template <uint8_t W, uint8_t H>
+class HeatField {
+public:
+	void clear() {
+		memset(mHeat, 0, sizeof(mHeat));
+	}
+
+	// cooling: 0-255, max heat lost per cell per step at the top of the
+	// range (taller flames at lower values)
+	void step(uint8_t cooling) {
+		for (uint8_t y = 0; y < H; y++) {
+			uint8_t* row = mHeat[y];
+			const uint8_t* below = mHeat[y + 1 < H ? y + 1 : y];
+			const uint8_t* below2 = mHeat[y + 2 < H ? y + 2 : H - 1];
+			for (uint8_t x = 0; x < W; x++) {
+				uint8_t h = row[x];
+				if (y + 1 < H) {
+					const uint8_t xl = x > 0 ? x - 1 : x;
+					const uint8_t xr = x + 1 < W ? x + 1 : x;
+					// (left + 2*centre + right + 2*two-below) / 6, as * 171 >> 10
+					const uint32_t sum = below[xl] + 2 * below[x] + below[xr] + 2 * below2[x];
+					h = static_cast<uint8_t>((sum * 171) >> 10);
+				}
+				const uint8_t loss = (static_cast<uint16_t>(random8()) * cooling) >> 8;
+				row[x] = qsub8(h, loss);
+			}
+		}
+	}
+
+	// Adds heat at column x in the bottom two rows
+	void spark(uint8_t x, uint8_t heat) {
+		if (x >= W) return;
+		mHeat[H - 1][x] = qadd8(mHeat[H - 1][x], heat);
+		if (H > 1) mHeat[H - 2][x] = qadd8(mHeat[H - 2][x], heat >> 1);
+	}
+
+	// Rebuilds the colour table; heat is mapped to palette index 0..240 so
+	// the hottest cells don't wrap around to the coldest colour
+	void setPalette(const CRGBPalette16& palette) {
+		for (uint16_t i = 0; i < 256; i++) {
+			mColor[i] = ColorFromPalette(palette, scale8(i, 240), 255, LINEARBLEND);
+		}
+	}
+
+	void render(CRGB* out, uint16_t (*xy)(uint8_t, uint8_t)) const {
+		for (uint8_t y = 0; y < H; y++) {
+			for (uint8_t x = 0; x < W; x++) {
+				out[xy(x, y)] = mColor[mHeat[y][x]];
+			}
+		}
+	}
+
+	uint8_t heat(uint8_t x, uint8_t y) const { return mHeat[y][x]; }
+
+private:
+	uint8_t mHeat[H][W] = {};
+	CRGB mColor[256];
+};
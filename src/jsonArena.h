@@ -0,0 +1,108 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//=============================================================================
+// Fixed-buffer allocator for JsonDocument
+// ArduinoJson 7 documents allocate their slot pools and copied strings
+// through an Allocator. JsonArena hands out memory from a fixed buffer
+// instead of the heap: allocation is a bump of an offset, and once every
+// block has been released (deserializeJson() and clear() release all of
+// them) the offset goes back to zero. A document reused for one message at
+// a time therefore runs out of the same bytes forever and never touches
+// malloc.
+//
+// If a message needs more than the arena holds, the block comes from the
+// heap so the message still parses, and jsonHeapFallbacks counts it; in
+// steady state that counter should stay at zero.
+//
+// Variant slots are not allocated one at a time: the first value a
+// document stores pulls in a whole pool of ARDUINOJSON_POOL_CAPACITY slots
+// (128 x 8 bytes on the ESP32), which is only shrunk to what was used once
+// parsing finishes. An arena therefore has to hold a full pool on top of
+// the strings it is sized for; jsonArenaSize() adds it.
+//=============================================================================
+
+uint32_t jsonHeapFallbacks = 0;
+
+// A slot is two words: 8 bytes on the ESP32, 16 on a 64-bit host
+constexpr size_t JSON_POOL_BYTES = ARDUINOJSON_POOL_CAPACITY * 2 * sizeof(void*);
+
+// Arena size for documents whose copied strings need up to stringBytes
+constexpr size_t jsonArenaSize(size_t stringBytes) {
+	return JSON_POOL_BYTES + stringBytes;
+}
+
+template <size_t N>
+class JsonArena : public ArduinoJson::Allocator {
+public:
+	void* allocate(size_t size) override {
+		size = align(size);
+		if (mUsed + size <= N) {
+			void* p = mBuffer + mUsed;
+			mLast = mUsed;
+			mUsed += size;
+			mLive++;
+			return p;
+		}
+		jsonHeapFallbacks++;
+		return malloc(size);
+	}
+
+	void deallocate(void* ptr) override {
+		if (!owns(ptr)) {
+			free(ptr);
+			return;
+		}
+		if (mLive > 0 && --mLive == 0) {
+			mUsed = 0;
+			mLast = 0;
+		}
+	}
+
+	void* reallocate(void* ptr, size_t newSize) override {
+		if (!owns(ptr)) {
+			jsonHeapFallbacks++;
+			return realloc(ptr, newSize);
+		}
+		newSize = align(newSize);
+		const size_t offset = static_cast<uint8_t*>(ptr) - mBuffer;
+
+		// The newest block can grow or shrink in place (pools shrink after parsing)
+		if (offset == mLast && mLast + newSize <= N) {
+			mUsed = mLast + newSize;
+			return ptr;
+		}
+
+		// Otherwise move it; the old block is reclaimed with the rest of the arena.
+		// Its size isn't tracked, so copy up to newSize (memmove: the copy may
+		// run into the new block, which starts after it).
+		void* moved = allocate(newSize);
+		if (moved) {
+			const size_t available = N - offset;
+			memmove(moved, ptr, newSize < available ? newSize : available);
+			deallocate(ptr);
+		}
+		return moved;
+	}
+
+	size_t used() const { return mUsed; }
+	size_t capacity() const { return N; }
+
+private:
+	static size_t align(size_t size) {
+		return (size + 7) & ~static_cast<size_t>(7);
+	}
+
+	bool owns(const void* ptr) const {
+		return ptr >= mBuffer && ptr < mBuffer + N;
+	}
+
+	alignas(8) uint8_t mBuffer[N];
+	size_t mUsed = 0;
+	size_t mLast = 0;
+	uint16_t mLive = 0;
+};
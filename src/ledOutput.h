@@ -0,0 +1,88 @@
+#pragma once
+
+#include <FastLED.h>
+#include <string.h>
+
+// Access to LED array from main.cpp
+extern CRGB leds[];
+
+//=============================================================================
+// LED output stage
+// Keeps a shadow copy of the last frame actually transmitted and compares
+// leds[] against it before every show. Unchanged frames (steady VU level,
+// beat pulse decayed to black, idle) are not retransmitted at all. Because
+// the comparison is exact, a changed frame can never be suppressed.
+//
+// WS2812 strips latch only the bytes they receive, so when only a prefix of
+// the chain changed it is enough to clock out LEDs 0..lastDirty. That is
+// opt-in (OUTPUT_PARTIAL_TRANSMIT) and single-segment only, since it resizes
+// the controller's LED count for the one show.
+//=============================================================================
+
+namespace ledOutput {
+
+	constexpr bool OUTPUT_PARTIAL_TRANSMIT = false;
+	constexpr uint32_t WS2812_US_PER_LED = 30;	// 24 bits @ 800 kHz
+
+	CRGB lastShown[NUM_LEDS];
+	uint8_t lastBrightness = 0;
+	bool primed = false;
+
+	uint32_t framesShown = 0;
+	uint32_t framesSkipped = 0;
+	uint32_t partialFrames = 0;
+	uint32_t busTimeSavedMs = 0;
+	uint32_t busTimeSavedUs = 0;	// remainder below 1 ms
+
+	void addSavedTime(uint32_t ledCount) {
+		busTimeSavedUs += ledCount * WS2812_US_PER_LED;
+		busTimeSavedMs += busTimeSavedUs / 1000;
+		busTimeSavedUs %= 1000;
+	}
+
+	// Index of the last LED that differs from what was last shown, or -1
+	int lastDirtyIndex() {
+		for (int i = NUM_LEDS - 1; i >= 0; i--) {
+			if (leds[i] != lastShown[i]) return i;
+		}
+		return -1;
+	}
+
+	// Call instead of FastLED.show()
+	void showFrame() {
+		uint8_t brightness = FastLED.getBrightness();
+		int dirty = lastDirtyIndex();
+
+		// Brightness and correction are applied at transmit time, so a
+		// brightness change needs a full frame even if leds[] is unchanged
+		bool fullFrame = !primed || brightness != lastBrightness;
+
+		if (!fullFrame && dirty < 0) {
+			framesSkipped++;
+			addSavedTime(NUM_LEDS);
+			return;
+		}
+
+		if (OUTPUT_PARTIAL_TRANSMIT && NUM_SEGMENTS == 1 && !fullFrame && dirty < NUM_LEDS - 1) {
+			uint16_t count = dirty + 1;
+			FastLED[0].setLeds(leds, count);
+			FastLED.show();
+			FastLED[0].setLeds(leds, NUM_LEDS);
+			partialFrames++;
+			addSavedTime(NUM_LEDS - count);
+		} else {
+			FastLED.show();
+		}
+
+		memcpy(lastShown, leds, sizeof(lastShown));
+		lastBrightness = brightness;
+		primed = true;
+		framesShown++;
+	}
+
+	// Force the next showFrame() to transmit (e.g. after FastLED.clear(true))
+	void invalidate() {
+		primed = false;
+	}
+
+} // namespace ledOutput
@@ -69,6 +69,7 @@ uint8_t defaultMapping = 0;
 bool mappingOverride = false;
 
 #include "bleControl.h"
+#include "ledOutput.h"
 //#include "audioInput.h"
 #include "audioTest.hpp"
 
@@ -178,6 +179,9 @@ void setup() {
         	return;
 		}
 		Serial.println("LittleFS mounted successfully.");   
+		restoreLiveState();
+		loadPresetCache();
+		startPresetWorker();
 		
 }
 
@@ -192,8 +196,17 @@ void loop() {
   	hue ++;
 	*/
 	
+	// Apply BLE commands queued since the last frame and advance parameter
+	// ramps before anything is drawn, then send receipts in batches and
+	// schedule a write-behind of the live state
+	drainControlCommands();
+	updateParamRamps();
+	flushNotifications();
+	persistLiveState();
+
 	if (!displayOn){
 			FastLED.clear();
+			audioTest::invalidateBars();
 		}
 		
 		else {
@@ -204,9 +217,11 @@ void loop() {
 			if (!audioTest::audioTestInstance) {
 				audioTest::initAudioTest(myXY);
 			}
-			audioTest::runAudioTest();
-					
-			FastLED.show();
+			// runAudioTest() returns false when an idle frame is throttled;
+			// showFrame() skips frames identical to the last one shown
+			if (audioTest::runAudioTest()) {
+				ledOutput::showFrame();
+			}
 	
 		}
 
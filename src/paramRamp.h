@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <FastLED.h>
+#include "fl/ease.h"
+
+//=============================================================================
+// Parameter ramps
+// A fixed pool of active ramps, each moving one parameter from a start value
+// to a target over a duration along an easing curve. Like ParticlePool, live
+// ramps are kept packed in [0, count) as structure-of-arrays: start()
+// appends, a finished ramp is replaced by the last one, and update() walks
+// only live entries. Per frame and ramp that is a float multiply for the
+// phase, one ease16() and a multiply-add, so the cost follows the number of
+// ramps in flight, not the number of parameters.
+//
+// Starting a ramp for an id that already has one retargets it from the
+// value it is given (normally where the old ramp had got to).
+//
+// Targets are kept in double: a double parameter read back through target()
+// or left at the end of its ramp is the exact value it was sent, not that
+// value rounded through float.
+//=============================================================================
+
+template <uint8_t N>
+class RampPool {
+public:
+	void clear() {
+		mCount = 0;
+	}
+
+	uint8_t count() const { return mCount; }
+	uint8_t capacity() const { return N; }
+
+	// Returns false when the pool is full; set the value directly then
+	bool start(uint8_t id, float from, double to, uint32_t now, uint32_t durationMs, fl::EaseType curve) {
+		uint8_t i = find(id);
+		if (i == mCount) {
+			if (mCount >= N) return false;
+			i = mCount++;
+			mId[i] = id;
+		}
+		mCurve[i] = static_cast<uint8_t>(curve);
+		mStart[i] = now;
+		mDuration[i] = durationMs ? durationMs : 1;
+		mInvDuration[i] = 1.0f / mDuration[i];
+		mFrom[i] = from;
+		mDelta[i] = static_cast<float>(to - from);
+		mTo[i] = to;
+		return true;
+	}
+
+	void cancel(uint8_t id) {
+		uint8_t i = find(id);
+		if (i < mCount) remove(i);
+	}
+
+	bool active(uint8_t id) const {
+		return find(id) < mCount;
+	}
+
+	// Where an active ramp is heading
+	bool target(uint8_t id, double& to) const {
+		uint8_t i = find(id);
+		if (i == mCount) return false;
+		to = mTo[i];
+		return true;
+	}
+
+	// Passes every ramp's value at time now to write(id, value). Finished
+	// ramps write their exact target and are removed.
+	template <typename Write>
+	void update(uint32_t now, Write&& write) {
+		uint8_t i = 0;
+		while (i < mCount) {
+			const uint32_t elapsed = now - mStart[i];
+			if (elapsed >= mDuration[i]) {
+				write(mId[i], mTo[i]);
+				remove(i);		// re-examine index i, it now holds the old last ramp
+				continue;
+			}
+			const uint16_t phase = static_cast<uint16_t>(elapsed * mInvDuration[i] * 65535.0f);
+			const uint16_t eased = fl::ease16(static_cast<fl::EaseType>(mCurve[i]), phase);
+			write(mId[i], mFrom[i] + mDelta[i] * (eased * (1.0f / 65535.0f)));
+			i++;
+		}
+	}
+
+private:
+	uint8_t find(uint8_t id) const {
+		uint8_t i = 0;
+		while (i < mCount && mId[i] != id) i++;
+		return i;
+	}
+
+	void remove(uint8_t i) {
+		uint8_t last = --mCount;
+		if (i == last) return;
+		mId[i] = mId[last];
+		mCurve[i] = mCurve[last];
+		mStart[i] = mStart[last];
+		mDuration[i] = mDuration[last];
+		mInvDuration[i] = mInvDuration[last];
+		mFrom[i] = mFrom[last];
+		mDelta[i] = mDelta[last];
+		mTo[i] = mTo[last];
+	}
+
+	uint8_t mId[N];
+	uint8_t mCurve[N];
+	uint32_t mStart[N];
+	uint32_t mDuration[N];
+	float mInvDuration[N];
+	float mFrom[N];
+	float mDelta[N];
+	double mTo[N];
+	uint8_t mCount = 0;
+};
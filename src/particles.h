@@ -0,0 +1,109 @@
+#pragma once
+
+#include <FastLED.h>
+
+//=============================================================================
+// Fixed-point particle pool
+// Fixed capacity, structure-of-arrays, no heap. Live particles are kept
+// packed in [0, count): spawn() appends and kill() moves the last particle
+// into the hole, so both are O(1) and update/render walk only live entries.
+//
+// Position, velocity and acceleration are Q8.8 (1.0 = one pixel, velocity
+// per frame). Life counts down from 255 by a per-particle decay and doubles
+// as brightness. Particles that leave the W x H area or run out of life are
+// killed during update().
+//
+// Cost per live particle is ~10 integer ops in update() plus one palette
+// lookup and one additive write in render(); a full 256-particle pool is
+// well under 0.1 ms per frame on the S3 at 240 MHz. The budget for 1,000
+// live particles is 0.5 ms (~120 cycles each); test_particle_pool times
+// that load on the host, where render() is about three quarters of it.
+//=============================================================================
+
+struct ParticleSpawn {
+	int16_t x, y;		// Q8.8 pixels
+	int16_t vx, vy;		// Q8.8 pixels per frame
+	int16_t ay = 0;		// Q8.8 pixels per frame^2 (positive = down)
+	uint8_t hue = 0;
+	uint8_t decay = 8;	// life lost per frame
+};
+
+template <uint16_t N, uint8_t W, uint8_t H>
+class ParticlePool {
+public:
+	void clear() {
+		mCount = 0;
+	}
+
+	uint16_t count() const { return mCount; }
+	uint16_t capacity() const { return N; }
+	bool full() const { return mCount >= N; }
+
+	// Returns false (and drops the particle) when the pool is full
+	bool spawn(const ParticleSpawn& p) {
+		if (mCount >= N) return false;
+		uint16_t i = mCount++;
+		mX[i] = p.x;
+		mY[i] = p.y;
+		mVX[i] = p.vx;
+		mVY[i] = p.vy;
+		mAY[i] = p.ay;
+		mHue[i] = p.hue;
+		mDecay[i] = p.decay ? p.decay : 1;
+		mLife[i] = 255;
+		return true;
+	}
+
+	void kill(uint16_t i) {
+		uint16_t last = --mCount;
+		if (i == last) return;
+		mX[i] = mX[last];
+		mY[i] = mY[last];
+		mVX[i] = mVX[last];
+		mVY[i] = mVY[last];
+		mAY[i] = mAY[last];
+		mHue[i] = mHue[last];
+		mDecay[i] = mDecay[last];
+		mLife[i] = mLife[last];
+	}
+
+	// Advance one frame
+	void update() {
+		constexpr int32_t maxX = static_cast<int32_t>(W) << 8;
+		constexpr int32_t maxY = static_cast<int32_t>(H) << 8;
+		uint16_t i = 0;
+		while (i < mCount) {
+			mVY[i] += mAY[i];
+			int32_t x = mX[i] + mVX[i];
+			int32_t y = mY[i] + mVY[i];
+			if (mLife[i] <= mDecay[i] || x < 0 || x >= maxX || y < 0 || y >= maxY) {
+				kill(i);		// re-examine index i, it now holds the old last particle
+				continue;
+			}
+			mX[i] = static_cast<int16_t>(x);
+			mY[i] = static_cast<int16_t>(y);
+			mLife[i] -= mDecay[i];
+			i++;
+		}
+	}
+
+	// Additive draw; brightness follows remaining life
+	void render(CRGB* out, uint16_t (*xy)(uint8_t, uint8_t), const CRGBPalette16& palette) const {
+		for (uint16_t i = 0; i < mCount; i++) {
+			uint8_t px = static_cast<uint8_t>(mX[i] >> 8);
+			uint8_t py = static_cast<uint8_t>(mY[i] >> 8);
+			out[xy(px, py)] += ColorFromPalette(palette, mHue[i], mLife[i]);
+		}
+	}
+
+private:
+	int16_t mX[N];
+	int16_t mY[N];
+	int16_t mVX[N];
+	int16_t mVY[N];
+	int16_t mAY[N];
+	uint8_t mHue[N];
+	uint8_t mDecay[N];
+	uint8_t mLife[N];
+	uint16_t mCount = 0;
+};
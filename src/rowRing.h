@@ -0,0 +1,71 @@
+#pragma once
+
+#include <FastLED.h>
+#include <string.h>
+
+//=============================================================================
+// Circular row buffer for scrolling visuals
+// Waterfall and matrix rain both scroll the whole image one row per step.
+// Instead of copying every pixel down a row through xyFunc each frame, new
+// rows are written into a ring (O(W) per step) and the scroll is a row offset
+// applied while remapping the ring into leds[]. The remap uses a row-major
+// LED index table built once per mapping, and can apply a per-age fade in
+// the same pass (matrix rain trails), so there is no separate fade pass.
+//=============================================================================
+
+template <uint8_t W, uint8_t H>
+class RowRing {
+public:
+	void clear() {
+		memset(mRows, 0, sizeof(mRows));
+		mHead = 0;
+	}
+
+	// Row that the next push() will become the newest; fill then push()
+	CRGB* nextRow() {
+		return mRows[(mHead + H - 1) % H];
+	}
+
+	// Newest row becomes age 0; everything else ages by one
+	void push() {
+		mHead = (mHead + H - 1) % H;
+	}
+
+	const CRGB* row(uint8_t age) const {
+		return mRows[(mHead + age) % H];
+	}
+
+	// Rebuild the LED index table for display row y / column x
+	void buildIndex(uint16_t (*xy)(uint8_t, uint8_t)) {
+		for (uint8_t y = 0; y < H; y++) {
+			for (uint8_t x = 0; x < W; x++) {
+				mIndex[y][x] = xy(x, y);
+			}
+		}
+	}
+
+	// Age 0 goes to display row 0 (top), older rows below. fadeByAge, if
+	// given, holds H nscale8 factors.
+	void remap(CRGB* out, const uint8_t* fadeByAge = nullptr) const {
+		for (uint8_t age = 0; age < H; age++) {
+			const CRGB* src = row(age);
+			const uint16_t* dst = mIndex[age];
+			if (fadeByAge) {
+				const uint8_t scale = fadeByAge[age];
+				for (uint8_t x = 0; x < W; x++) {
+					CRGB c = src[x];
+					out[dst[x]] = c.nscale8(scale);
+				}
+			} else {
+				for (uint8_t x = 0; x < W; x++) {
+					out[dst[x]] = src[x];
+				}
+			}
+		}
+	}
+
+private:
+	CRGB mRows[H][W];
+	uint16_t mIndex[H][W];
+	uint8_t mHead = 0;
+};
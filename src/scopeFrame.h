@@ -0,0 +1,91 @@
+#pragma once
+
+#include <FastLED.h>
+#include <math.h>
+
+//=============================================================================
+// Triggered oscilloscope frame
+// One PCM block becomes W columns: the window starts at a rising crossing of
+// SCOPE_TRIGGER_LEVEL (after dipping SCOPE_TRIGGER_HYSTERESIS below it), so
+// a steady tone holds still, and each column spans the min..max of the
+// samples it covers, so peaks between columns are never skipped. Amplitude
+// is companded (log-like, so quiet signals stay visible) through a 256-entry
+// LUT built once - no log10f/powf per pixel. The caller clears or fades the
+// frame first; draw() only paints the column spans.
+//=============================================================================
+
+constexpr int16_t SCOPE_TRIGGER_LEVEL = 0;			// 0 = zero-crossing trigger
+constexpr int16_t SCOPE_TRIGGER_HYSTERESIS = 200;	// must dip this far below the level first
+
+template <uint8_t W, uint8_t H>
+class ScopeFrame {
+public:
+	ScopeFrame() {
+		for (uint16_t i = 0; i < 256; i++) {
+			const float a = (i + 0.5f) / 256.0f;
+			const float v = powf(log10f(1.0f + a * 9.0f), 0.6f);
+			mCompand[i] = static_cast<uint8_t>(v * 255.0f + 0.5f);
+		}
+	}
+
+	// Index of the first rising trigger crossing in [1, limit), or 0 to free-run
+	static size_t findTrigger(const int16_t* pcm, size_t limit) {
+		bool armed = false;
+		for (size_t i = 1; i < limit; i++) {
+			if (pcm[i] < SCOPE_TRIGGER_LEVEL - SCOPE_TRIGGER_HYSTERESIS) {
+				armed = true;
+			} else if (armed && pcm[i - 1] < SCOPE_TRIGGER_LEVEL && pcm[i] >= SCOPE_TRIGGER_LEVEL) {
+				return i;
+			}
+		}
+		return 0;
+	}
+
+	// |sample| >> 7 -> 0..255
+	uint8_t compand(uint8_t magnitude) const { return mCompand[magnitude]; }
+
+	// Shows half the block, triggered somewhere in the first half. colorOf(a)
+	// gives the colour of a column whose larger companded swing is a. Returns
+	// the trigger index, or 0 if it free-ran (or the block was too short to draw).
+	template <typename ColorOf>
+	size_t draw(CRGB* leds, uint16_t (*xy)(uint8_t, uint8_t), const int16_t* pcm, size_t n, ColorOf colorOf) {
+		if (n < W * 2) return 0;
+
+		const size_t span = n / 2;
+		const size_t start = findTrigger(pcm, n - span);
+		const size_t perColumn = span / W;
+
+		constexpr uint8_t halfHeight = H / 2;
+		constexpr uint8_t centerY = H / 2;
+
+		for (uint8_t x = 0; x < W; x++) {
+			const size_t i0 = start + x * perColumn;
+			int16_t lo = pcm[i0];
+			int16_t hi = pcm[i0];
+			for (size_t i = i0 + 1; i < i0 + perColumn; i++) {
+				if (pcm[i] < lo) lo = pcm[i];
+				if (pcm[i] > hi) hi = pcm[i];
+			}
+
+			// Companded pixel offsets above (hi) and below (lo) the centre line
+			const uint8_t up = hi > 0 ? mCompand[hi >> 7] : 0;
+			const uint8_t down = lo < 0 ? mCompand[(-(lo + 1)) >> 7] : 0;	// -(lo+1) avoids overflow at -32768
+			const uint8_t upPx = (static_cast<uint16_t>(up) * halfHeight) >> 8;
+			const uint8_t downPx = (static_cast<uint16_t>(down) * halfHeight) >> 8;
+
+			const CRGB color = colorOf(up > down ? up : down);
+
+			int16_t yTop = centerY - upPx;
+			int16_t yBottom = centerY + downPx;
+			if (yTop < 0) yTop = 0;
+			if (yBottom > H - 1) yBottom = H - 1;
+			for (int16_t y = yTop; y <= yBottom; y++) {
+				leds[xy(x, y)] = color;
+			}
+		}
+		return start;
+	}
+
+private:
+	uint8_t mCompand[256];
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+//=============================================================================
+// Single-producer single-consumer ring
+// Lock-free hand-off between exactly two tasks (here: the BLE host task
+// pushes, the render loop pops). The producer only writes mHead and the
+// consumer only writes mTail; release/acquire ordering on those indices
+// publishes the slot contents, so no mutex or critical section is needed
+// and neither side can block the other. One slot is kept empty to tell
+// full from empty, so capacity is N - 1.
+//=============================================================================
+
+template <typename T, uint16_t N>
+class SpscQueue {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+	// Producer side; returns false (and counts a drop) when full
+	bool push(const T& item) {
+		const uint16_t head = mHead.load(std::memory_order_relaxed);
+		const uint16_t next = (head + 1) & (N - 1);
+		if (next == mTail.load(std::memory_order_acquire)) {
+			mDropped++;
+			return false;
+		}
+		mItems[head] = item;
+		mHead.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side
+	bool pop(T& item) {
+		const uint16_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail == mHead.load(std::memory_order_acquire)) return false;
+		item = mItems[tail];
+		mTail.store((tail + 1) & (N - 1), std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const {
+		return mTail.load(std::memory_order_acquire) == mHead.load(std::memory_order_acquire);
+	}
+
+	// Producer-side count, read it from the producer or for diagnostics only
+	uint32_t dropped() const { return mDropped; }
+
+private:
+	T mItems[N];
+	std::atomic<uint16_t> mHead{0};
+	std::atomic<uint16_t> mTail{0};
+	uint32_t mDropped = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+//=============================================================================
+// Host stand-in for the parts of the ESP32 Arduino core the firmware
+// headers use. Time only moves when a test sets mockMillis, unless it points
+// mockMicros at a clock of its own; FreeRTOS queues are plain FIFOs, and
+// tasks are never started (tests call a task's work directly).
+//=============================================================================
+
+#define PROGMEM
+#define pgm_read_ptr(addr) (*(const void* const*)(addr))
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+inline uint32_t mockMillis = 0;
+inline uint32_t (*mockMicros)() = nullptr;
+
+inline uint32_t millis() { return mockMillis; }
+inline uint32_t micros() { return mockMicros ? mockMicros() : mockMillis * 1000; }
+inline void delay(uint32_t ms) { mockMillis += ms; }
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+inline long random(long max) { return max > 0 ? rand() % max : 0; }
+inline long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+inline uint32_t esp_random() { return (uint32_t)rand() * 2654435761u; }
+
+inline bool psramFound() { return false; }
+inline void* ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+
+class String {
+public:
+	String(const char* s = "") : mValue(s) {}
+	String(int value) : mValue(std::to_string(value)) {}
+	String(unsigned value) : mValue(std::to_string(value)) {}
+	String(long value) : mValue(std::to_string(value)) {}
+	String(unsigned long value) : mValue(std::to_string(value)) {}
+	String(unsigned char value) : mValue(std::to_string(value)) {}
+	String(float value) : mValue(std::to_string(value)) {}
+	String(double value) : mValue(std::to_string(value)) {}
+
+	const char* c_str() const { return mValue.c_str(); }
+	size_t length() const { return mValue.size(); }
+
+private:
+	std::string mValue;
+};
+
+// Swallows everything; set echo to see it
+struct MockSerial {
+	bool echo = false;
+
+	void begin(unsigned long) {}
+	template <typename T> void print(const T& value) { if (echo) ::printf("%s", String(value).c_str()); }
+	template <typename T> void print(const T& value, int) { print(value); }
+	template <typename T> void println(const T& value) { print(value); println(); }
+	template <typename T> void println(const T& value, int) { println(value); }
+	void println() { if (echo) ::printf("\n"); }
+	size_t write(const uint8_t* data, size_t len) { if (echo) fwrite(data, 1, len, stdout); return len; }
+	template <typename... Args> void printf(const char* format, Args... args) { if (echo) ::printf(format, args...); }
+};
+
+inline MockSerial Serial;
+
+//*****************************************************************************
+// FreeRTOS
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define portMAX_DELAY 0xFFFFFFFFu
+
+struct MockQueue {
+	size_t length;
+	size_t itemSize;
+	std::deque<std::vector<uint8_t>> items;
+};
+typedef MockQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) {
+	return new MockQueue{length, itemSize, {}};
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t) {
+	if (queue == nullptr || queue->items.size() >= queue->length) return pdFALSE;
+	const uint8_t* bytes = static_cast<const uint8_t*>(item);
+	queue->items.emplace_back(bytes, bytes + queue->itemSize);
+	return pdTRUE;
+}
+
+// Never blocks: an empty queue returns pdFALSE whatever the timeout
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t) {
+	if (queue == nullptr || queue->items.empty()) return pdFALSE;
+	memcpy(item, queue->items.front().data(), queue->itemSize);
+	queue->items.pop_front();
+	return pdTRUE;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, unsigned, TaskHandle_t*, int) {
+	return pdPASS;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "BLEDevice.h"
+
+// Client Characteristic Configuration descriptor; subscriptions are not modelled
+class BLE2902 : public BLEDescriptor {};
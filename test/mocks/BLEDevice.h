@@ -0,0 +1,152 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+//=============================================================================
+// Host stand-in for the Bluedroid BLE classes bleControl.h uses.
+// A characteristic keeps its current value and every notification it sent;
+// mockWrite() plays a client write through its callbacks. The server's peer
+// MTU is a plain field so tests can negotiate any size. With
+// keepNotifications off a characteristic only counts what it sent. Servers own their
+// services and services their characteristics, and BLEDevice keeps the
+// servers until exit, so nothing created through them leaks. Callbacks
+// belong to what they are set on: the firmware allocates them once and
+// never frees them.
+//=============================================================================
+
+class BLECharacteristic;
+class BLEServer;
+
+class BLEUUID {
+public:
+	BLEUUID(const char* uuid = "") : mUuid(uuid) {}
+	BLEUUID(uint16_t uuid) : mUuid(std::to_string(uuid)) {}
+
+private:
+	std::string mUuid;
+};
+
+class BLEDescriptor {
+public:
+	virtual ~BLEDescriptor() = default;
+};
+
+class BLECharacteristicCallbacks {
+public:
+	virtual ~BLECharacteristicCallbacks() = default;
+	virtual void onWrite(BLECharacteristic*) {}
+};
+
+class BLECharacteristic {
+public:
+	static const uint32_t PROPERTY_READ = 1 << 0;
+	static const uint32_t PROPERTY_WRITE = 1 << 1;
+	static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+	static const uint32_t PROPERTY_INDICATE = 1 << 3;
+	static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+	BLECharacteristic(const char* uuid = "", uint32_t properties = 0) : mUuid(uuid), mProperties(properties) {}
+
+	void setValue(const uint8_t* data, size_t len) { mValue.assign(data, data + len); }
+	void setValue(const char* value) { setValue(reinterpret_cast<const uint8_t*>(value), strlen(value)); }
+	void setValue(const std::string& value) { setValue(reinterpret_cast<const uint8_t*>(value.data()), value.size()); }
+
+	uint8_t* getData() { return mValue.data(); }
+	size_t getLength() const { return mValue.size(); }
+
+	void notify() {
+		notifyCount++;
+		if (keepNotifications) notifications.push_back(mValue);
+	}
+	void setCallbacks(BLECharacteristicCallbacks* callbacks) { mCallbacks.reset(callbacks); }
+	void addDescriptor(BLEDescriptor*) {}
+
+	// A client write: the value lands in the attribute, then onWrite runs
+	void mockWrite(const uint8_t* data, size_t len) {
+		setValue(data, len);
+		if (mCallbacks) mCallbacks->onWrite(this);
+	}
+	void mockWrite(const char* value) { mockWrite(reinterpret_cast<const uint8_t*>(value), strlen(value)); }
+
+	std::vector<std::vector<uint8_t>> notifications;
+	uint32_t notifyCount = 0;
+	bool keepNotifications = true;	// off: only count, so notify() never allocates
+
+private:
+	std::string mUuid;
+	uint32_t mProperties;
+	std::vector<uint8_t> mValue;
+	std::unique_ptr<BLECharacteristicCallbacks> mCallbacks;
+};
+
+class BLEService {
+public:
+	BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties) {
+		mCharacteristics.emplace_back(new BLECharacteristic(uuid, properties));
+		return mCharacteristics.back().get();
+	}
+	void start() {}
+
+private:
+	std::vector<std::unique_ptr<BLECharacteristic>> mCharacteristics;
+};
+
+class BLEServerCallbacks {
+public:
+	virtual ~BLEServerCallbacks() = default;
+	virtual void onConnect(BLEServer*) {}
+	virtual void onDisconnect(BLEServer*) {}
+};
+
+class BLEServer {
+public:
+	uint16_t peerMtu = 23;
+
+	BLEService* createService(BLEUUID, uint32_t = 15, uint8_t = 0) {
+		mServices.emplace_back(new BLEService());
+		return mServices.back().get();
+	}
+	void setCallbacks(BLEServerCallbacks* callbacks) { mCallbacks.reset(callbacks); }
+	uint16_t getConnId() const { return 0; }
+	uint16_t getPeerMTU(uint16_t) const { return peerMtu; }
+	void startAdvertising() {}
+
+	void mockConnect() { if (mCallbacks) mCallbacks->onConnect(this); }
+	void mockDisconnect() { if (mCallbacks) mCallbacks->onDisconnect(this); }
+
+private:
+	std::unique_ptr<BLEServerCallbacks> mCallbacks;
+	std::vector<std::unique_ptr<BLEService>> mServices;
+};
+
+class BLEAdvertising {
+public:
+	void addServiceUUID(const char*) {}
+	void setScanResponse(bool) {}
+	void setMinPreferred(uint16_t) {}
+};
+
+class BLEDevice {
+public:
+	static void init(const char*) {}
+	static void setMTU(uint16_t) {}
+	static BLEServer* createServer() {
+		servers().emplace_back(new BLEServer());
+		return servers().back().get();
+	}
+	static BLEAdvertising* getAdvertising() {
+		static BLEAdvertising advertising;
+		return &advertising;
+	}
+	static void startAdvertising() {}
+
+private:
+	static std::vector<std::unique_ptr<BLEServer>>& servers() {
+		static std::vector<std::unique_ptr<BLEServer>> owned;
+		return owned;
+	}
+};
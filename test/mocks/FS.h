@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//=============================================================================
+// Host stand-in for the Arduino FS API, backed by a map of byte vectors.
+// Power loss is simulated by truncating writes: with writeBudget >= 0, the
+// device "dies" once that many more bytes have reached the flash, every
+// later write stores nothing, and a rename fails. A test then "reboots" by
+// clearing powerLost and reading back what is on the flash.
+//=============================================================================
+
+namespace fs {
+
+	struct MockFlash {
+		std::map<std::string, std::vector<uint8_t>> files;
+		long writeBudget = -1;		// bytes left before power is lost, -1 = never
+		bool powerLost = false;
+		uint32_t renames = 0;
+
+		// Bytes of a write of len that make it to the flash
+		size_t take(size_t len) {
+			if (powerLost) return 0;
+			if (writeBudget < 0) return len;
+			if ((long)len >= writeBudget) {
+				len = writeBudget;
+				writeBudget = -1;
+				powerLost = true;
+				return len;
+			}
+			writeBudget -= len;
+			return len;
+		}
+
+		void reboot() {
+			powerLost = false;
+			writeBudget = -1;
+		}
+	};
+
+	class File {
+	public:
+		File() = default;
+		File(MockFlash* flash, const std::string& path) : mFlash(flash), mPath(path) {}
+
+		explicit operator bool() const { return mFlash != nullptr; }
+
+		size_t write(const uint8_t* data, size_t len) {
+			if (!mFlash) return 0;
+			const size_t n = mFlash->take(len);
+			std::vector<uint8_t>& file = mFlash->files[mPath];
+			file.insert(file.end(), data, data + n);
+			return n;
+		}
+
+		size_t read(uint8_t* buffer, size_t capacity) {
+			if (!mFlash || !mFlash->files.count(mPath)) return 0;
+			const std::vector<uint8_t>& file = mFlash->files[mPath];
+			const size_t n = file.size() - mPos < capacity ? file.size() - mPos : capacity;
+			if (n > 0) memcpy(buffer, file.data() + mPos, n);
+			mPos += n;
+			return n;
+		}
+
+		size_t size() const { return mFlash && mFlash->files.count(mPath) ? mFlash->files.at(mPath).size() : 0; }
+		void close() { mFlash = nullptr; }
+
+	private:
+		MockFlash* mFlash = nullptr;
+		std::string mPath;
+		size_t mPos = 0;
+	};
+
+	class FS {
+	public:
+		MockFlash flash;
+
+		bool begin(bool = false) { return true; }
+
+		File open(const char* path, const char* mode = "r") {
+			if (mode[0] == 'w') {
+				if (flash.powerLost) return File();
+				flash.files[path].clear();
+			} else if (!flash.files.count(path)) {
+				return File();
+			}
+			return File(&flash, path);
+		}
+
+		bool exists(const char* path) const { return flash.files.count(path) > 0; }
+
+		bool remove(const char* path) {
+			if (flash.powerLost) return false;
+			return flash.files.erase(path) > 0;
+		}
+
+		// Atomic, and replaces an existing file, like LittleFS
+		bool rename(const char* from, const char* to) {
+			if (flash.powerLost || !flash.files.count(from)) return false;
+			flash.files[to] = flash.files[from];
+			flash.files.erase(from);
+			flash.renames++;
+			return true;
+		}
+	};
+
+} // namespace fs
+
+using fs::File;
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include "fl/ease.h"
+
+//=============================================================================
+// Host stand-in for the FastLED types and calls the firmware headers use.
+// FastLED.show() only counts frames and records how many LEDs the first
+// controller would have clocked out, so output-stage tests can see what
+// would have been transmitted. The 8-bit math follows FastLED's portable C
+// versions; palettes and CHSV are close enough to draw with, not exact.
+//=============================================================================
+
+#define FL_ASSERT(cond, msg) ((void)(cond))
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) {
+	return static_cast<uint8_t>((static_cast<uint16_t>(i) * (1 + static_cast<uint16_t>(scale))) >> 8);
+}
+inline uint8_t qadd8(uint8_t i, uint8_t j) { return i + j > 255 ? 255 : i + j; }
+inline uint8_t qsub8(uint8_t i, uint8_t j) { return i > j ? i - j : 0; }
+
+// FastLED's 16-bit LCG, so draws cost what they do on the device and a
+// seed replays the same sequence
+inline uint16_t rand16seed = 1337;
+inline void random16_set_seed(uint16_t seed) { rand16seed = seed; }
+inline uint16_t random16() {
+	rand16seed = static_cast<uint16_t>(rand16seed * 2053 + 13849);
+	return rand16seed;
+}
+inline uint8_t random8() {
+	random16();
+	return static_cast<uint8_t>((rand16seed & 0xFF) + (rand16seed >> 8));
+}
+inline uint8_t random8(uint8_t lim) { return static_cast<uint8_t>((random8() * lim) >> 8); }
+inline uint8_t random8(uint8_t min, uint8_t lim) { return min + random8(lim - min); }
+inline uint16_t random16(uint16_t lim) { return static_cast<uint16_t>((static_cast<uint32_t>(random16()) * lim) >> 16); }
+inline uint16_t random16(uint16_t min, uint16_t lim) { return min + random16(lim - min); }
+
+// 128 + 127 * sin over a 256-step turn
+inline uint8_t sin8(uint8_t theta) { return static_cast<uint8_t>(lrintf(128.0f + 127.0f * sinf(theta * 6.2831853f / 256.0f))); }
+inline uint8_t cos8(uint8_t theta) { return sin8(theta + 64); }
+
+struct CHSV {
+	uint8_t h = 0;
+	uint8_t s = 0;
+	uint8_t v = 0;
+
+	CHSV() = default;
+	constexpr CHSV(uint8_t hue, uint8_t sat, uint8_t val) : h(hue), s(sat), v(val) {}
+};
+
+struct CRGB {
+	uint8_t r = 0;
+	uint8_t g = 0;
+	uint8_t b = 0;
+
+	CRGB() = default;
+	constexpr CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+	constexpr CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+
+	// Six-sector HSV, not FastLED's rainbow curve
+	CRGB(const CHSV& hsv) {
+		const uint8_t sector = hsv.h / 43;
+		const uint8_t f = (hsv.h - sector * 43) * 6;
+		const uint8_t p = scale8(hsv.v, 255 - hsv.s);
+		const uint8_t q = scale8(hsv.v, 255 - scale8(hsv.s, f));
+		const uint8_t t = scale8(hsv.v, 255 - scale8(hsv.s, 255 - f));
+		switch (sector) {
+			case 0: r = hsv.v; g = t; b = p; break;
+			case 1: r = q; g = hsv.v; b = p; break;
+			case 2: r = p; g = hsv.v; b = t; break;
+			case 3: r = p; g = q; b = hsv.v; break;
+			case 4: r = t; g = p; b = hsv.v; break;
+			default: r = hsv.v; g = p; b = q; break;
+		}
+	}
+
+	bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+	bool operator!=(const CRGB& other) const { return !(*this == other); }
+
+	CRGB& nscale8(uint8_t scale) {
+		r = scale8(r, scale);
+		g = scale8(g, scale);
+		b = scale8(b, scale);
+		return *this;
+	}
+	CRGB& operator+=(const CRGB& other) {
+		r = qadd8(r, other.r);
+		g = qadd8(g, other.g);
+		b = qadd8(b, other.b);
+		return *this;
+	}
+
+	enum HTMLColorCode : uint32_t {
+		Black = 0x000000,
+		White = 0xFFFFFF,
+		Red = 0xFF0000,
+		Green = 0x008000,
+		Blue = 0x0000FF
+	};
+};
+
+inline void fill_solid(CRGB* leds, int count, const CRGB& color) {
+	for (int i = 0; i < count; i++) leds[i] = color;
+}
+
+inline void fadeToBlackBy(CRGB* leds, uint16_t count, uint8_t fadeBy) {
+	for (uint16_t i = 0; i < count; i++) leds[i].nscale8(255 - fadeBy);
+}
+
+enum TBlendType { NOBLEND = 0, LINEARBLEND = 1 };
+
+typedef uint32_t TProgmemRGBPalette16[16];
+
+struct CRGBPalette16 {
+	CRGB entries[16];
+
+	CRGBPalette16() = default;
+	CRGBPalette16(const TProgmemRGBPalette16& codes) {
+		for (uint8_t i = 0; i < 16; i++) entries[i] = CRGB(codes[i]);
+	}
+	const CRGB& operator[](uint8_t i) const { return entries[i]; }
+};
+
+// Sixteen entries, blended linearly between neighbours (wrapping at the end)
+inline CRGB ColorFromPalette(const CRGBPalette16& pal, uint8_t index, uint8_t brightness = 255,
+							 TBlendType blendType = LINEARBLEND) {
+	const uint8_t hi4 = index >> 4;
+	const uint8_t lo4 = index & 0x0F;
+	CRGB c = pal[hi4];
+	if (lo4 && blendType != NOBLEND) {
+		const CRGB& next = pal[(hi4 + 1) & 15];
+		const uint8_t f2 = lo4 << 4;
+		const uint8_t f1 = 255 - f2;
+		c = CRGB(scale8(c.r, f1) + scale8(next.r, f2), scale8(c.g, f1) + scale8(next.g, f2),
+				 scale8(c.b, f1) + scale8(next.b, f2));
+	}
+	if (brightness != 255) c.nscale8(brightness);
+	return c;
+}
+
+const TProgmemRGBPalette16 RainbowColors_p = {
+	0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00, 0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+	0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5, 0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B
+};
+const TProgmemRGBPalette16 HeatColors_p = {
+	0x000000, 0x330000, 0x660000, 0x990000, 0xCC0000, 0xFF0000, 0xFF3300, 0xFF6600,
+	0xFF9900, 0xFFCC00, 0xFFFF00, 0xFFFF33, 0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF
+};
+const TProgmemRGBPalette16 OceanColors_p = {
+	0x191970, 0x00008B, 0x191970, 0x000080, 0x00008B, 0x0000CD, 0x2E8B57, 0x008080,
+	0x5F9EA0, 0x0000FF, 0x008B8B, 0x6495ED, 0x7FFFD4, 0x2E8B57, 0x00FFFF, 0x87CEFA
+};
+const TProgmemRGBPalette16 ForestColors_p = {
+	0x006400, 0x006400, 0x556B2F, 0x006400, 0x008000, 0x228B22, 0x6B8E23, 0x008000,
+	0x2E8B57, 0x66CDAA, 0x32CD32, 0x9ACD32, 0x90EE90, 0x7CFC00, 0x66CDAA, 0x228B22
+};
+const TProgmemRGBPalette16 PartyColors_p = {
+	0x5500AB, 0x84007C, 0xB5004B, 0xE5001B, 0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
+	0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E, 0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9
+};
+const TProgmemRGBPalette16 LavaColors_p = {
+	0x000000, 0x800000, 0x000000, 0x800000, 0x8B0000, 0x800000, 0x8B0000, 0x8B0000,
+	0x8B0000, 0xFF0000, 0xFFA500, 0xFFFFFF, 0xFFA500, 0xFF0000, 0x8B0000, 0x000000
+};
+const TProgmemRGBPalette16 CloudColors_p = {
+	0x0000FF, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B,
+	0x0000FF, 0x00008B, 0x87CEEB, 0x87CEEB, 0xADD8E6, 0xFFFFFF, 0xADD8E6, 0x87CEEB
+};
+
+struct MockController {
+	CRGB* leds = nullptr;
+	int count = 0;
+
+	MockController& setLeds(CRGB* data, int n) {
+		leds = data;
+		count = n;
+		return *this;
+	}
+};
+
+struct MockFastLED {
+	uint8_t brightness = 255;
+	uint32_t shows = 0;
+	int lastShowCount = 0;		// LEDs the first controller sent on the last show
+	MockController controller;
+
+	void setBrightness(uint8_t value) { brightness = value; }
+	uint8_t getBrightness() const { return brightness; }
+	void show() {
+		shows++;
+		lastShowCount = controller.count;
+	}
+	MockController& operator[](int) { return controller; }
+};
+
+inline MockFastLED FastLED;
+
+// EVERY_N_MILLISECONDS/EVERY_N_SECONDS on the mock clock
+struct MockEveryN {
+	uint32_t periodMs;
+	uint32_t last = 0;
+
+	bool ready() {
+		const uint32_t now = millis();
+		if (now - last < periodMs) return false;
+		last = now;
+		return true;
+	}
+};
+
+#define MOCK_EVERY_N_CAT2(a, b) a##b
+#define MOCK_EVERY_N_CAT(a, b) MOCK_EVERY_N_CAT2(a, b)
+#define EVERY_N_MILLISECONDS(n) \
+	static MockEveryN MOCK_EVERY_N_CAT(everyN, __LINE__){(n)}; \
+	if (MOCK_EVERY_N_CAT(everyN, __LINE__).ready())
+#define EVERY_N_SECONDS(n) EVERY_N_MILLISECONDS((n) * 1000u)
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+//=============================================================================
+// Host stand-in for FastLED's audio sample type and the fl:: helpers the
+// audio headers use. An AudioSample owns a copy of its PCM block, like the
+// real one; pcm() views it.
+//=============================================================================
+
+namespace fl {
+
+	template <typename T>
+	class span {
+	public:
+		span() = default;
+		span(T* data, size_t size) : mData(data), mSize(size) {}
+
+		size_t size() const { return mSize; }
+		T* data() const { return mData; }
+		T& operator[](size_t i) const { return mData[i]; }
+		T* begin() const { return mData; }
+		T* end() const { return mData + mSize; }
+
+	private:
+		T* mData = nullptr;
+		size_t mSize = 0;
+	};
+
+	template <typename T>
+	using Slice = span<T>;
+
+	template <typename T>
+	using shared_ptr = std::shared_ptr<T>;
+
+	template <typename T, typename... Args>
+	shared_ptr<T> make_shared(Args&&... args) { return std::make_shared<T>(static_cast<Args&&>(args)...); }
+
+	using string = std::string;
+
+	using ::millis;		// the same clock, so unqualified calls stay unambiguous
+	inline float sqrtf(float x) { return ::sqrtf(x); }
+
+	class AudioSample {
+	public:
+		AudioSample() = default;
+		AudioSample(span<const int16_t> pcm, uint32_t timestamp)
+			: mPcm(pcm.begin(), pcm.end()), mTimestamp(timestamp), mValid(true) {}
+
+		bool isValid() const { return mValid; }
+		uint32_t timestamp() const { return mTimestamp; }
+		span<const int16_t> pcm() const { return span<const int16_t>(mPcm.data(), mPcm.size()); }
+
+		float rms() const {
+			if (mPcm.empty()) return 0.0f;
+			double sumSq = 0;
+			for (int16_t s : mPcm) sumSq += double(s) * s;
+			return static_cast<float>(::sqrt(sumSq / mPcm.size()));
+		}
+
+	private:
+		std::vector<int16_t> mPcm;
+		uint32_t mTimestamp = 0;
+		bool mValid = false;
+	};
+
+} // namespace fl
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <math.h>
+#include "fl/audio.h"
+#include "fl/fft.h"
+
+//=============================================================================
+// Host stand-in for FastLED's AudioContext. getFFT() measures each of the
+// log-spaced bands with a Goertzel filter at its centre frequency on the
+// current block - not what fl::FFT does, but the same inputs give the same
+// kind of answer, and a test can see which band lit up.
+//=============================================================================
+
+namespace fl {
+
+	class AudioContext {
+	public:
+		static constexpr float SAMPLE_RATE = 44100.0f;
+
+		void setSample(const AudioSample& sample) {
+			mSample = sample;
+			mFftReady = false;
+		}
+		const AudioSample& getSample() const { return mSample; }
+
+		const FFTBins& getFFT(int bands, float fmin, float fmax) {
+			if (mFftReady) return mFft;
+			const span<const int16_t> pcm = mSample.pcm();
+			mFft.bins_raw.assign(bands, 0.0f);
+			for (int b = 0; b < bands; b++) {
+				const float f = fmin * powf(fmax / fmin, (b + 0.5f) / bands);
+				const float coeff = 2.0f * cosf(2.0f * float(M_PI) * f / SAMPLE_RATE);
+				float s1 = 0.0f, s2 = 0.0f;
+				for (size_t i = 0; i < pcm.size(); i++) {
+					const float s0 = pcm[i] + coeff * s1 - s2;
+					s2 = s1;
+					s1 = s0;
+				}
+				const float power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+				mFft.bins_raw[b] = pcm.size() ? sqrtf(power > 0.0f ? power : 0.0f) / pcm.size() : 0.0f;
+			}
+			mFftReady = true;
+			return mFft;
+		}
+
+	private:
+		AudioSample mSample;
+		FFTBins mFft;
+		bool mFftReady = false;
+	};
+
+} // namespace fl
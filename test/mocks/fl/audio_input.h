@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include "fl/audio.h"
+
+//=============================================================================
+// Host stand-in for FastLED's I2S audio input. read() hands out one block
+// of blockSize samples from the test's source function (silence if none
+// is set), stamped with millis().
+//=============================================================================
+
+namespace fl {
+
+	enum AudioChannel { Left, Right };
+
+	struct AudioConfig {
+		static AudioConfig CreateInmp441(int, int, int, AudioChannel) { return AudioConfig(); }
+	};
+
+	class IAudioInput {
+	public:
+		size_t blockSize = 512;
+		std::function<void(int16_t* pcm, size_t n)> source;
+
+		static shared_ptr<IAudioInput> create(const AudioConfig&, string* = nullptr) {
+			return make_shared<IAudioInput>();
+		}
+
+		void start() {}
+		bool error(string* = nullptr) const { return false; }
+
+		AudioSample read() {
+			mBlock.assign(blockSize, 0);
+			if (source) source(mBlock.data(), mBlock.size());
+			return AudioSample(span<const int16_t>(mBlock.data(), mBlock.size()), ::millis());
+		}
+
+	private:
+		std::vector<int16_t> mBlock;
+	};
+
+} // namespace fl
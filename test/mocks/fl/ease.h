@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Host stand-in for FastLED's easing curves (same names, float maths)
+
+namespace fl {
+
+	enum EaseType : uint8_t {
+		EASE_NONE,
+		EASE_IN_QUAD,
+		EASE_OUT_QUAD,
+		EASE_IN_OUT_QUAD,
+		EASE_IN_CUBIC,
+		EASE_OUT_CUBIC,
+		EASE_IN_OUT_CUBIC,
+		EASE_IN_SINE,
+		EASE_OUT_SINE,
+		EASE_IN_OUT_SINE
+	};
+
+	inline uint16_t ease16(EaseType type, uint16_t i) {
+		const float x = i / 65535.0f;
+		float y = x;
+		switch (type) {
+			case EASE_NONE: return i;
+			case EASE_IN_QUAD: y = x * x; break;
+			case EASE_OUT_QUAD: y = 1 - (1 - x) * (1 - x); break;
+			case EASE_IN_OUT_QUAD: y = x < 0.5f ? 2 * x * x : 1 - 2 * (1 - x) * (1 - x); break;
+			case EASE_IN_CUBIC: y = x * x * x; break;
+			case EASE_OUT_CUBIC: y = 1 - (1 - x) * (1 - x) * (1 - x); break;
+			case EASE_IN_OUT_CUBIC: y = x < 0.5f ? 4 * x * x * x : 1 - 4 * (1 - x) * (1 - x) * (1 - x); break;
+			case EASE_IN_SINE: y = 1 - cosf(x * 1.5707963f); break;
+			case EASE_OUT_SINE: y = sinf(x * 1.5707963f); break;
+			case EASE_IN_OUT_SINE: y = 0.5f - 0.5f * cosf(x * 3.1415927f); break;
+		}
+		return static_cast<uint16_t>(y * 65535.0f + 0.5f);
+	}
+
+} // namespace fl
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+// Host stand-in for FastLED's FFT result: one raw magnitude per band
+
+namespace fl {
+
+	struct FFTBins {
+		std::vector<float> bins_raw;
+	};
+
+} // namespace fl
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include "fl/audio.h"
+#include "fl/audio/audio_context.h"
+
+//=============================================================================
+// Host stand-in for FastLED's AudioProcessor. update() stores the block in
+// the context and fires the level callbacks from its RMS, peak and three
+// FFT bands; a block whose energy jumps past twice the running average
+// counts as an onset and a beat. No tempo tracking. updates counts calls so
+// tests can see whether the stage ran.
+//=============================================================================
+
+namespace fl {
+
+	class AudioProcessor {
+	public:
+		uint32_t updates = 0;
+
+		AudioProcessor() : mContext(make_shared<AudioContext>()) {}
+
+		void onBeat(std::function<void()> cb) { mOnBeat = cb; }
+		void onOnset(std::function<void(float)> cb) { mOnOnset = cb; }
+		void onTempoChange(std::function<void(float, float)> cb) { mOnTempo = cb; }
+		void onBass(std::function<void(float)> cb) { mOnBass = cb; }
+		void onMid(std::function<void(float)> cb) { mOnMid = cb; }
+		void onTreble(std::function<void(float)> cb) { mOnTreble = cb; }
+		void onEnergy(std::function<void(float)> cb) { mOnEnergy = cb; }
+		void onPeak(std::function<void(float)> cb) { mOnPeak = cb; }
+
+		shared_ptr<AudioContext> getContext() const { return mContext; }
+
+		void update(const AudioSample& sample) {
+			updates++;
+			mContext->setSample(sample);
+
+			const float rms = sample.rms();
+			float peak = 0.0f;
+			for (int16_t s : sample.pcm()) peak = fmaxf(peak, fabsf(s));
+			if (mOnEnergy) mOnEnergy(rms);
+			if (mOnPeak) mOnPeak(peak);
+
+			const FFTBins& bands = mContext->getFFT(3, 20.0f, 8000.0f);
+			if (mOnBass) mOnBass(bands.bins_raw[0]);
+			if (mOnMid) mOnMid(bands.bins_raw[1]);
+			if (mOnTreble) mOnTreble(bands.bins_raw[2]);
+
+			if (rms > 2.0f * mAverage && rms > 1.0f) {
+				if (mOnOnset) mOnOnset(rms / (mAverage + 1.0f));
+				if (mOnBeat) mOnBeat();
+			}
+			mAverage += 0.1f * (rms - mAverage);
+		}
+
+	private:
+		shared_ptr<AudioContext> mContext;
+		float mAverage = 0.0f;
+		std::function<void()> mOnBeat;
+		std::function<void(float)> mOnOnset;
+		std::function<void(float, float)> mOnTempo;
+		std::function<void(float)> mOnBass;
+		std::function<void(float)> mOnMid;
+		std::function<void(float)> mOnTreble;
+		std::function<void(float)> mOnEnergy;
+		std::function<void(float)> mOnPeak;
+	};
+
+} // namespace fl
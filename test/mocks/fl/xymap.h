@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in: the firmware headers include it, but only main.cpp uses XYMap
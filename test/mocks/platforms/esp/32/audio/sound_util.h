@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in: nothing from the ESP32 sound utilities is used on the host
@@ -0,0 +1,213 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "audioProcessing.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+
+using myAudio::NEED_STFT;
+using myAudio::NEED_SPECTRUM;
+using myAudio::NEED_PROCESSOR;
+using myAudio::NEED_LOWBAND;
+using myAudio::NEED_TIMBRE;
+using myAudio::NEED_ALL;
+
+//=============================================================================
+// Analysis stages with the telemetry stream on and off
+// Each frame is what runAudioTest() does before drawing: sampleAudio() on a
+// 512-sample block from the mock I2S input, then a telemetry record when one
+// is due. The stage counters show which stages ran; host frame times go into
+// log2 microsecond histograms so the cost of turning the stream on shows up
+// as a shift between buckets, like frameHist does on the device.
+//=============================================================================
+
+constexpr uint8_t HIST_BUCKETS = 14;	// [2^i, 2^(i+1)) us, last one open-ended
+constexpr uint32_t BLOCK_MS = 12;		// 512 samples at 44.1 kHz
+constexpr int FRAMES = 400;
+constexpr uint8_t STREAM_HZ = 20;
+constexpr uint8_t TELEMETRY_STAGES = NEED_PROCESSOR | NEED_SPECTRUM | NEED_STFT;
+
+struct FrameRun {
+	uint32_t hist[HIST_BUCKETS] = {};
+	std::vector<uint32_t> frameUs;
+	uint32_t processor = 0;
+	uint32_t lowBand = 0;
+	uint32_t stft = 0;
+	uint32_t timbre = 0;
+	uint32_t spectrum = 0;
+	uint32_t packets = 0;
+
+	uint32_t medianUs() const {
+		std::vector<uint32_t> sorted = frameUs;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[sorted.size() / 2];
+	}
+};
+
+// 440 Hz tone with a 60 Hz kick every 500 ms and a little noise
+uint32_t samplePos = 0;
+void toneWithKicks(int16_t* pcm, size_t n) {
+	for (size_t i = 0; i < n; i++, samplePos++) {
+		const float t = samplePos / 44100.0f;
+		float s = 3000.0f * sinf(2.0f * float(M_PI) * 440.0f * t);
+		if (fmodf(t, 0.5f) < 0.05f) s += 8000.0f * sinf(2.0f * float(M_PI) * 60.0f * t);
+		pcm[i] = static_cast<int16_t>(s + (rand() % 200 - 100));
+	}
+}
+
+void playFrame() {
+	myAudio::sampleAudio();
+	if (telemetryDue()) {
+		uint8_t record[TELEM_FIELDS];
+		myAudio::fillTelemetryRecord(record);
+		sendTelemetry(record);
+	}
+	mockMillis += BLOCK_MS;
+}
+
+FrameRun runFrames(uint8_t needs, uint8_t telemetryHz) {
+	myAudio::analysisNeeds = needs;
+	cTelemetryHz = telemetryHz;
+	for (int i = 0; i < 50; i++) playFrame();	// settle stage resets and ranges
+
+	FrameRun run;
+	const uint32_t processor = myAudio::processorBlocks;
+	const uint32_t lowBand = myAudio::lowBandBlocks;
+	const uint32_t stft = myAudio::stftBlocks;
+	const uint32_t timbre = myAudio::timbreBlocks;
+	const uint32_t spectrum = myAudio::spectrumBlocks;
+	const uint32_t packets = telemetryPacketsSent;
+
+	for (int i = 0; i < FRAMES; i++) {
+		const auto start = std::chrono::steady_clock::now();
+		playFrame();
+		const uint32_t us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count());
+		uint8_t bucket = 0;
+		while (bucket < HIST_BUCKETS - 1 && (us >> (bucket + 1)) != 0) bucket++;
+		run.hist[bucket]++;
+		run.frameUs.push_back(us);
+	}
+
+	run.processor = myAudio::processorBlocks - processor;
+	run.lowBand = myAudio::lowBandBlocks - lowBand;
+	run.stft = myAudio::stftBlocks - stft;
+	run.timbre = myAudio::timbreBlocks - timbre;
+	run.spectrum = myAudio::spectrumBlocks - spectrum;
+	run.packets = telemetryPacketsSent - packets;
+	return run;
+}
+
+void printHistogram(const char* label, const FrameRun& run) {
+	printf("%-28s median %5u us |", label, (unsigned)run.medianUs());
+	for (uint8_t i = 0; i < HIST_BUCKETS; i++) printf(" %u", (unsigned)run.hist[i]);
+	printf("\n");
+}
+
+void assertStages(uint8_t expected, const FrameRun& run) {
+	TEST_ASSERT_EQUAL_UINT32((expected & NEED_PROCESSOR) ? FRAMES : 0, run.processor);
+	TEST_ASSERT_EQUAL_UINT32((expected & NEED_LOWBAND) ? FRAMES : 0, run.lowBand);
+	TEST_ASSERT_EQUAL_UINT32((expected & NEED_STFT) ? FRAMES : 0, run.stft);
+	TEST_ASSERT_EQUAL_UINT32((expected & NEED_TIMBRE) ? FRAMES : 0, run.timbre);
+	TEST_ASSERT_EQUAL_UINT32((expected & NEED_SPECTRUM) ? FRAMES : 0, run.spectrum);
+}
+
+void setUp() {
+	static bool started = false;
+	if (!started) {
+		bleSetup();
+		pServer->mockConnect();
+		myAudio::initAudioInput();
+		myAudio::initAudioProcessing();
+		myAudio::audioSource->source = toneWithKicks;
+		started = true;
+	}
+	srand(7);
+}
+
+void tearDown() {
+	cTelemetryHz = 0;
+	myAudio::analysisNeeds = NEED_ALL;
+}
+
+// Per visualizer: VU/scope, beat pulse, bass ripple, spectrum, particles,
+// and a mode reading the note bank and timbre descriptors
+const uint8_t MODE_NEEDS[] = {
+	0,
+	NEED_PROCESSOR,
+	NEED_LOWBAND,
+	NEED_SPECTRUM,
+	NEED_PROCESSOR | NEED_LOWBAND | NEED_STFT | NEED_SPECTRUM,
+	NEED_TIMBRE
+};
+
+// The fl::FFT spectrum engine reads the AudioProcessor's context, and the
+// timbre stage reads the STFT's frames
+uint8_t withImpliedStages(uint8_t needs) {
+	if (needs & NEED_SPECTRUM) needs |= NEED_PROCESSOR;
+	if (needs & NEED_TIMBRE) needs |= NEED_STFT;
+	return needs;
+}
+
+void test_stream_off_runs_only_what_the_mode_needs() {
+	for (uint8_t needs : MODE_NEEDS) {
+		const FrameRun run = runFrames(needs, 0);
+		assertStages(withImpliedStages(needs), run);
+		TEST_ASSERT_EQUAL_UINT32(0, run.packets);
+	}
+}
+
+void test_stream_adds_its_stages_but_not_the_low_band() {
+	for (uint8_t needs : MODE_NEEDS) {
+		const FrameRun run = runFrames(needs, STREAM_HZ);
+		assertStages(withImpliedStages(needs) | TELEMETRY_STAGES, run);
+		TEST_ASSERT_GREATER_THAN_UINT32(0, run.packets);
+	}
+}
+
+// With the stream on, a mode that reads nothing still sends live levels and bins
+void test_stream_fields_are_live_without_visual_needs() {
+	runFrames(0, STREAM_HZ);
+	uint8_t record[TELEM_FIELDS];
+	myAudio::fillTelemetryRecord(record);
+	TEST_ASSERT_TRUE(record[TELEM_FLAGS] & TELEM_GATE_OPEN);
+	uint32_t binSum = 0;
+	for (uint8_t b = 0; b < TELEM_BINS; b++) binSum += record[TELEM_BIN0 + b];
+	TEST_ASSERT_GREATER_THAN_UINT32(0, binSum);
+	TEST_ASSERT_GREATER_THAN_UINT32(0, myAudio::callbackEnergyCount);
+}
+
+// Host frame times. A mode that already runs the telemetry stages costs the
+// same with the stream on; a mode that runs none pays for them.
+void test_frame_time_histograms() {
+	printf("Frame time, log2 us buckets from 1 us:\n");
+	const uint8_t full = NEED_PROCESSOR | NEED_LOWBAND | NEED_STFT | NEED_SPECTRUM;
+	const FrameRun fullOff = runFrames(full, 0);
+	const FrameRun fullOn = runFrames(full, STREAM_HZ);
+	const FrameRun vuOff = runFrames(0, 0);
+	const FrameRun vuOn = runFrames(0, STREAM_HZ);
+	printHistogram("particles, stream off", fullOff);
+	printHistogram("particles, stream on", fullOn);
+	printHistogram("VU meter, stream off", vuOff);
+	printHistogram("VU meter, stream on", vuOn);
+
+	TEST_ASSERT_LESS_THAN_UINT32(2 * fullOff.medianUs() + 5, fullOn.medianUs());
+	TEST_ASSERT_GREATER_THAN_UINT32(vuOff.medianUs(), vuOn.medianUs());
+	TEST_ASSERT_LESS_THAN_UINT32(fullOn.medianUs(), vuOff.medianUs());
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_stream_off_runs_only_what_the_mode_needs);
+	RUN_TEST(test_stream_adds_its_stages_but_not_the_low_band);
+	RUN_TEST(test_stream_fields_are_live_without_visual_needs);
+	RUN_TEST(test_frame_time_histograms);
+	return UNITY_END();
+}
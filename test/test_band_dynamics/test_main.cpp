@@ -0,0 +1,216 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "bandDynamics.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Band dynamics against a float reference, at 16, 32 and 64 bands
+// The reference is the straightforward version: one struct of floats per
+// band, one-pole smoothing with the exp() coefficients, a hold counter and
+// a falling peak, all on the same 0-65280 scale. The integer engine has to
+// track it within a step or two of 255 on random band levels for every band
+// count; peaks too, bar the rare block where a tie restarts one hold only. The benchmark times one block's update() of each size against the
+// reference, the per-block cost quoted for any band count.
+//=============================================================================
+
+constexpr float BLOCK_RATE = DYNAMICS_BLOCK_RATE;
+constexpr float ATTACK_MS = 10.0f;
+constexpr float RELEASE_MS = 150.0f;
+constexpr float HOLD_MS = 400.0f;
+constexpr float GRAVITY = 2.0f;
+constexpr int BLOCKS = 3000;
+constexpr int BENCH_BLOCKS = 200000;
+constexpr uint8_t LEVEL_TOLERANCE = 2;		// of 255
+constexpr float PEAK_MISS_RATE = 0.01f;
+
+template <uint8_t N>
+struct FloatDynamics {
+	struct Band {
+		float level = 0.0f;
+		float peak = 0.0f;
+		float fall = 0.0f;
+		int hold = 0;
+	};
+	Band band[N];
+	float attack = 1.0f - expf(-1000.0f / (ATTACK_MS * BLOCK_RATE));
+	float release = 1.0f - expf(-1000.0f / (RELEASE_MS * BLOCK_RATE));
+	int holdBlocks = static_cast<int>(HOLD_MS * BLOCK_RATE / 1000.0f);
+	// The engine keeps gravity in whole units per block^2 (17 rather than
+	// 17.6 here); the reference falls at the same rate so the comparison
+	// is about the arithmetic, not that choice
+	float gravity = floorf(GRAVITY * 65280.0f / (BLOCK_RATE * BLOCK_RATE));
+
+	void update(const uint8_t* in) {
+		for (uint8_t i = 0; i < N; i++) {
+			Band& b = band[i];
+			const float target = in[i] * 256.0f;
+			b.level += (target - b.level) * (target > b.level ? attack : release);
+			if (b.level >= b.peak) {
+				b.peak = b.level;
+				b.hold = holdBlocks;
+				b.fall = 0.0f;
+			} else if (b.hold > 0) {
+				b.hold--;
+			} else {
+				b.fall += gravity;
+				b.peak = fmaxf(b.peak - b.fall, b.level);
+			}
+		}
+	}
+};
+
+// Bursty per-band levels: each band jumps now and then, decays otherwise
+template <uint8_t N>
+void nextInput(uint8_t* in) {
+	for (uint8_t i = 0; i < N; i++) {
+		if (rand() % 8 == 0) in[i] = rand() & 255;
+		else in[i] = in[i] > 6 ? in[i] - 6 : 0;
+	}
+}
+
+struct Comparison {
+	uint8_t worstLevel = 0;
+	uint32_t peakMisses = 0;		// band-blocks with the peak out of tolerance
+};
+
+template <uint8_t N>
+Comparison compareWithReference() {
+	static BandDynamics<N> dynamics;
+	static FloatDynamics<N> reference;
+	dynamics.configure(BLOCK_RATE, ATTACK_MS, RELEASE_MS, HOLD_MS, GRAVITY);
+	dynamics.reset();
+	reference = FloatDynamics<N>();
+	uint8_t in[N] = {};
+	Comparison result;
+	for (int b = 0; b < BLOCKS; b++) {
+		nextInput<N>(in);
+		dynamics.update(in);
+		reference.update(in);
+		for (uint8_t i = 0; i < N; i++) {
+			const int level = static_cast<int>(reference.band[i].level / 256.0f);
+			const int peak = static_cast<int>(reference.band[i].peak / 256.0f);
+			TEST_ASSERT_INT_WITHIN(LEVEL_TOLERANCE, level, dynamics.level(i));
+			const int d = abs(level - dynamics.level(i));
+			if (d > result.worstLevel) result.worstLevel = d;
+			// Peak and hold agree too, except where the level ties a falling
+			// peak to within rounding: then one restarts the hold and the
+			// other doesn't, and they differ until the next new peak
+			if (abs(peak - dynamics.peak(i)) > LEVEL_TOLERANCE) result.peakMisses++;
+		}
+	}
+	const float missRate = result.peakMisses / float(BLOCKS * N);
+	printf("%2u bands: worst level difference %u, peak out by more than %u in %.2f%% of band-blocks\n",
+	       N, result.worstLevel, LEVEL_TOLERANCE, 100.0f * missRate);
+	TEST_ASSERT_TRUE(missRate < PEAK_MISS_RATE);
+	return result;
+}
+
+void setUp() { srand(36); }
+void tearDown() {}
+
+void test_tracks_the_float_reference() {
+	compareWithReference<16>();
+	compareWithReference<32>();
+	compareWithReference<64>();
+}
+
+// A step reaches 63% after one attack time constant, and falls to 37%
+// after one release time constant
+void test_time_constants() {
+	BandDynamics<1> dynamics;
+	const uint8_t full = 255;
+	const uint8_t none = 0;
+	int blocks = 0;
+	while (dynamics.level(0) < 161) { dynamics.update(&full); blocks++; }
+	TEST_ASSERT_INT_WITHIN(1, lrintf(ATTACK_MS * BLOCK_RATE / 1000.0f), blocks);
+	for (int b = 0; b < 200; b++) dynamics.update(&full);
+
+	blocks = 0;
+	while (dynamics.level(0) > 94) { dynamics.update(&none); blocks++; }
+	TEST_ASSERT_INT_WITHIN(1, lrintf(RELEASE_MS * BLOCK_RATE / 1000.0f), blocks);
+}
+
+// The peak holds, then falls under gravity: slowly at first, faster later
+void test_peak_hold_then_fall() {
+	BandDynamics<1> dynamics;
+	const uint8_t full = 255;
+	const uint8_t none = 0;
+	for (int b = 0; b < 100; b++) dynamics.update(&full);
+	const uint8_t held = dynamics.peak(0);
+	TEST_ASSERT_GREATER_OR_EQUAL_UINT8(254, held);
+	const int holdBlocks = static_cast<int>(HOLD_MS * BLOCK_RATE / 1000.0f);
+	for (int b = 0; b < holdBlocks; b++) {
+		dynamics.update(&none);
+		TEST_ASSERT_EQUAL_UINT8(held, dynamics.peak(0));
+	}
+	uint8_t last = dynamics.peak(0);
+	int firstDrop = 0, lastDrop = 0;
+	for (int b = 0; b < 30; b++) {
+		dynamics.update(&none);
+		const int drop = last - dynamics.peak(0);
+		if (b == 1) firstDrop = drop;
+		if (b == 20) lastDrop = drop;
+		last = dynamics.peak(0);
+	}
+	TEST_ASSERT_LESS_THAN_UINT8(held, dynamics.peak(0));
+	TEST_ASSERT_GREATER_THAN(firstDrop, lastDrop);
+}
+
+// Zero-ms attack: a full-scale step lands in one block (the int64 product)
+void test_instant_attack() {
+	BandDynamics<1> dynamics;
+	dynamics.configure(BLOCK_RATE, 0.0f, 0.0f, 0.0f, GRAVITY);
+	const uint8_t full = 255;
+	const uint8_t none = 0;
+	dynamics.update(&full);
+	TEST_ASSERT_EQUAL_UINT8(255, dynamics.level(0));
+	dynamics.update(&none);
+	TEST_ASSERT_EQUAL_UINT8(0, dynamics.level(0));
+}
+
+template <uint8_t N>
+void benchmark() {
+	static BandDynamics<N> dynamics;
+	static FloatDynamics<N> reference;
+	static uint8_t inputs[64][N];
+	for (uint8_t b = 0; b < 64; b++) nextInput<N>(inputs[b]);
+	volatile uint32_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BENCH_BLOCKS; b++) {
+		dynamics.update(inputs[b & 63]);
+		sink += dynamics.peak(b % N);
+	}
+	const double intNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_BLOCKS;
+
+	start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BENCH_BLOCKS; b++) {
+		reference.update(inputs[b & 63]);
+		sink += static_cast<uint32_t>(reference.band[b % N].peak);
+	}
+	const double floatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_BLOCKS;
+
+	printf("%2u bands: update %.0f ns per block (%.1f ns per band), float reference %.0f ns\n",
+	       N, intNs, intNs / N, floatNs);
+	TEST_ASSERT_TRUE(intNs > 0.0);
+}
+
+void test_block_benchmark() {
+	benchmark<16>();
+	benchmark<32>();
+	benchmark<64>();
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_tracks_the_float_reference);
+	RUN_TEST(test_time_constants);
+	RUN_TEST(test_peak_hold_then_fall);
+	RUN_TEST(test_instant_attack);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
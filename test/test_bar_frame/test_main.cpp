@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <stdlib.h>
+
+#include "barFrame.h"
+
+//=============================================================================
+// Golden frames for incremental bar rendering
+// Every frame drawn incrementally by BarFrame is compared with the same
+// bars drawn from scratch onto a black frame, the way the visualizers did
+// before they went incremental. The matrix is serpentine-mapped so a
+// wrong row or column shows up as a mismatch.
+//=============================================================================
+
+constexpr uint8_t W = 16;
+constexpr uint8_t H = 24;
+constexpr uint8_t NO_PEAK = BarFrame<W, H>::NO_PEAK;
+constexpr int FRAMES = 3000;
+
+CRGB leds[W * H];
+CRGB golden[W * H];
+BarFrame<W, H> bars;
+
+uint16_t serpentine(uint8_t x, uint8_t y) {
+	return (y & 1) ? y * W + (W - 1 - x) : y * W + x;
+}
+
+CRGB rowColor(uint8_t y) { return CRGB(10 * y + 1, 255 - 7 * y, 3 * y); }
+CRGB columnColor(uint8_t x) { return CRGB(255 - 9 * x, 16 * x, 77); }
+
+// Full redraw of vertical bars with optional peak markers
+void drawColumnsFromScratch(const uint8_t* height, const uint8_t* peakRow) {
+	fill_solid(golden, W * H, CRGB::Black);
+	for (uint8_t x = 0; x < W; x++) {
+		for (uint8_t y = 0; y < height[x]; y++) {
+			golden[serpentine(x, H - 1 - y)] = rowColor(y);
+		}
+		if (peakRow[x] > height[x] && peakRow[x] < H) {
+			golden[serpentine(x, H - 1 - peakRow[x])] = CRGB::White;
+		}
+	}
+}
+
+// Full redraw of a horizontal meter across the full height
+void drawMeterFromScratch(uint8_t length) {
+	fill_solid(golden, W * H, CRGB::Black);
+	for (uint8_t x = 0; x < length; x++) {
+		for (uint8_t y = 0; y < H; y++) {
+			golden[serpentine(x, y)] = columnColor(x);
+		}
+	}
+}
+
+// Random walk that mixes small steps with jumps to the ends
+uint8_t nextLevel(uint8_t level, uint8_t max) {
+	switch (rand() % 8) {
+		case 0: return 0;
+		case 1: return max;
+		case 2: return rand() % (max + 1);
+		default: {
+			int next = level + rand() % 5 - 2;
+			return next < 0 ? 0 : (next > max ? max : next);
+		}
+	}
+}
+
+// Peaks sit above the bar, on it, off the top, or are absent
+uint8_t nextPeak(uint8_t height) {
+	switch (rand() % 5) {
+		case 0: return NO_PEAK;
+		case 1: return height;
+		case 2: return H + rand() % 3;
+		default: return height + rand() % (H + 1 - height);
+	}
+}
+
+// Incremental draw of every column; returns pixels written
+uint32_t drawColumns(const uint8_t* height, const uint8_t* peakRow) {
+	uint32_t touched = 0;
+	for (uint8_t x = 0; x < W; x++) {
+		touched += bars.column(leds, serpentine, x, height[x], peakRow[x], rowColor);
+	}
+	return touched;
+}
+
+void setUp() {
+	bars.clear(leds);
+	srand(42);
+}
+void tearDown() {}
+
+void test_clear_blacks_out_the_frame() {
+	fill_solid(leds, W * H, CRGB::Red);
+	TEST_ASSERT_EQUAL_UINT16(W * H, bars.clear(leds));
+	fill_solid(golden, W * H, CRGB::Black);
+	TEST_ASSERT_EQUAL_MEMORY(golden, leds, sizeof(leds));
+}
+
+void test_columns_match_full_redraw() {
+	uint8_t height[W] = {};
+	uint8_t peakRow[W];
+	for (uint8_t x = 0; x < W; x++) peakRow[x] = NO_PEAK;
+
+	for (int frame = 0; frame < FRAMES; frame++) {
+		for (uint8_t x = 0; x < W; x++) {
+			height[x] = nextLevel(height[x], H);
+			// Peaks mostly hold still so the keep-in-place path is covered
+			if (rand() % 3 == 0 || peakRow[x] <= height[x]) peakRow[x] = nextPeak(height[x]);
+		}
+		drawColumns(height, peakRow);
+		drawColumnsFromScratch(height, peakRow);
+		TEST_ASSERT_EQUAL_MEMORY_MESSAGE(golden, leds, sizeof(leds), "column frame differs from full redraw");
+	}
+}
+
+void test_meter_matches_full_redraw() {
+	uint8_t length = 0;
+	for (int frame = 0; frame < FRAMES; frame++) {
+		length = nextLevel(length, W);
+		bars.meter(leds, serpentine, length, columnColor);
+		drawMeterFromScratch(length);
+		TEST_ASSERT_EQUAL_MEMORY_MESSAGE(golden, leds, sizeof(leds), "meter frame differs from full redraw");
+	}
+}
+
+void test_touches_only_changed_pixels() {
+	uint8_t height[W] = {};
+	uint8_t peakRow[W];
+	for (uint8_t x = 0; x < W; x++) peakRow[x] = NO_PEAK;
+
+	for (int frame = 0; frame < FRAMES; frame++) {
+		CRGB before[W * H];
+		memcpy(before, leds, sizeof(leds));
+		for (uint8_t x = 0; x < W; x++) {
+			height[x] = nextLevel(height[x], H);
+			if (rand() % 3 == 0 || peakRow[x] <= height[x]) peakRow[x] = nextPeak(height[x]);
+		}
+
+		const uint32_t touched = drawColumns(height, peakRow);
+		uint32_t changed = 0;
+		for (int i = 0; i < W * H; i++) {
+			if (leds[i] != before[i]) changed++;
+		}
+		// Every changed pixel was counted; a lifted peak the bar grows over
+		// is the only pixel written twice, at most once per column
+		TEST_ASSERT_TRUE(touched >= changed);
+		TEST_ASSERT_TRUE(touched <= changed + W);
+	}
+
+	// A steady frame writes nothing
+	TEST_ASSERT_EQUAL_UINT32(0, drawColumns(height, peakRow));
+}
+
+void test_switching_modes_after_clear() {
+	uint8_t height[W];
+	uint8_t peakRow[W];
+	for (uint8_t x = 0; x < W; x++) {
+		height[x] = (x * 5) % (H + 1);
+		peakRow[x] = height[x] + 1;
+	}
+	drawColumns(height, peakRow);
+
+	bars.clear(leds);
+	bars.meter(leds, serpentine, W / 2, columnColor);
+	drawMeterFromScratch(W / 2);
+	TEST_ASSERT_EQUAL_MEMORY(golden, leds, sizeof(leds));
+
+	bars.clear(leds);
+	drawColumns(height, peakRow);
+	drawColumnsFromScratch(height, peakRow);
+	TEST_ASSERT_EQUAL_MEMORY(golden, leds, sizeof(leds));
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_clear_blacks_out_the_frame);
+	RUN_TEST(test_columns_match_full_redraw);
+	RUN_TEST(test_meter_matches_full_redraw);
+	RUN_TEST(test_touches_only_changed_pixels);
+	RUN_TEST(test_switching_modes_after_clear);
+	return UNITY_END();
+}
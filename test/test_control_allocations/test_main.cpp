@@ -0,0 +1,175 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Heap allocations on the control path
+// Global operator new/delete are replaced with counting versions, and on
+// glibc builds without AddressSanitizer (which owns malloc there) so are
+// malloc, calloc and realloc. Client writes then go through the real
+// characteristic callbacks, drainControlCommands() and flushNotifications()
+// with counting on, and the count has to stay at zero. The characteristics
+// only count notifications, so the mock itself never allocates on the way.
+//=============================================================================
+
+bool countingAllocations = false;
+uint32_t allocations = 0;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+	#define HOOK_MALLOC 1
+	extern "C" void* __libc_malloc(size_t size);
+	extern "C" void* __libc_calloc(size_t count, size_t size);
+	extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+	extern "C" void* malloc(size_t size) {
+		if (countingAllocations) allocations++;
+		return __libc_malloc(size);
+	}
+	extern "C" void* calloc(size_t count, size_t size) {
+		if (countingAllocations) allocations++;
+		return __libc_calloc(count, size);
+	}
+	extern "C" void* realloc(void* ptr, size_t size) {
+		if (countingAllocations) allocations++;
+		return __libc_realloc(ptr, size);
+	}
+	extern "C" void __libc_free(void* ptr);
+	inline void* rawAllocate(size_t size) { return __libc_malloc(size); }
+	inline void rawFree(void* ptr) { __libc_free(ptr); }
+#else
+	#define HOOK_MALLOC 0
+	inline void* rawAllocate(size_t size) { return malloc(size); }
+	inline void rawFree(void* ptr) { free(ptr); }
+#endif
+
+void* operator new(size_t size) {
+	if (countingAllocations) allocations++;
+	if (void* p = rawAllocate(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { rawFree(p); }
+void operator delete[](void* p) noexcept { rawFree(p); }
+void operator delete(void* p, size_t) noexcept { rawFree(p); }
+void operator delete[](void* p, size_t) noexcept { rawFree(p); }
+
+constexpr int FRAMES = 500;
+
+// Every characteristic the control path notifies on
+uint32_t notifyCount() {
+	return pButtonCharacteristic->notifyCount + pCheckboxCharacteristic->notifyCount
+	     + pNumberCharacteristic->notifyCount + pStringCharacteristic->notifyCount;
+}
+
+// A frame's worth of client writes, then the frame that applies them.
+// The JSON is formatted into a stack buffer, as a client's bytes would
+// arrive in the attribute, and every value changes from frame to frame.
+void playFrame(int frame) {
+	char json[64];
+	for (uint8_t i = 0; i < 6; i++) {
+		snprintf(json, sizeof(json), "{\"id\":\"%s\",\"val\":%.6g}",
+		         PARAM_REGISTRY[PID_Speed + i].wireId, 0.37 * ((frame + i) % 200) - 37.0);
+		pNumberCharacteristic->mockWrite(json);
+	}
+	snprintf(json, sizeof(json), "{\"id\":\"cxLayer2\",\"val\":%s}", (frame & 1) ? "true" : "false");
+	pCheckboxCharacteristic->mockWrite(json);
+	const uint8_t button = (frame & 1) ? 98 : 94;
+	pButtonCharacteristic->mockWrite(&button, 1);
+
+	drainControlCommands();
+	updateParamRamps();
+	flushNotifications();
+	mockMillis += 16;
+}
+
+// Runs the frames with counting on; returns allocations made
+uint32_t countFrames(int first, int frames) {
+	allocations = 0;
+	countingAllocations = true;
+	for (int frame = first; frame < first + frames; frame++) playFrame(frame);
+	countingAllocations = false;
+	return allocations;
+}
+
+void setUp() {
+	if (pServer == NULL) {
+		bleSetup();
+		pServer->mockConnect();
+	}
+	pServer->peerMtu = 517;
+	for (BLECharacteristic* c : { pButtonCharacteristic, pCheckboxCharacteristic,
+	                              pNumberCharacteristic, pStringCharacteristic }) {
+		c->keepNotifications = false;
+	}
+	// Warm up: first-use setup and attribute buffers at their working size
+	for (int frame = 0; frame < 50; frame++) playFrame(frame);
+	mockMillis += 1000;
+}
+
+void tearDown() {}
+
+// The hook is live: an allocation inside the window is seen. The pointers
+// go through a volatile so the optimizer can't drop the pair.
+void* volatile allocated;
+
+void test_hook_counts_allocations() {
+	allocations = 0;
+	countingAllocations = true;
+	allocated = new int(7);
+	countingAllocations = false;
+	delete static_cast<int*>(allocated);
+	TEST_ASSERT_EQUAL_UINT32(1, allocations);
+
+#if HOOK_MALLOC
+	allocations = 0;
+	countingAllocations = true;
+	allocated = malloc(48);
+	countingAllocations = false;
+	free(allocated);
+	TEST_ASSERT_EQUAL_UINT32(1, allocations);
+#endif
+}
+
+void test_writes_apply_and_notify_without_allocating() {
+	cGlideMs = 0;
+	const uint32_t applied = commandsApplied;
+	const uint32_t notified = notifyCount();
+
+	TEST_ASSERT_EQUAL_UINT32(0, countFrames(1000, FRAMES));
+
+	// Everything written was applied and receipted
+	TEST_ASSERT_EQUAL_UINT32(FRAMES * 8, commandsApplied - applied);
+	TEST_ASSERT_GREATER_OR_EQUAL_UINT32(FRAMES, notifyCount() - notified);
+	TEST_ASSERT_EQUAL_UINT32(0, jsonHeapFallbacks);
+	printf("%d frames, %u commands: %u allocations (malloc %s)\n", FRAMES,
+	       (unsigned)(commandsApplied - applied), (unsigned)allocations, HOOK_MALLOC ? "hooked" : "not hooked");
+}
+
+// With a glide the writes start ramps instead of setting values directly
+void test_gliding_writes_do_not_allocate() {
+	cGlideMs = 200;
+	const uint32_t applied = commandsApplied;
+
+	TEST_ASSERT_EQUAL_UINT32(0, countFrames(5000, FRAMES));
+	TEST_ASSERT_EQUAL_UINT32(FRAMES * 8, commandsApplied - applied);
+	cGlideMs = 0;
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_hook_counts_allocations);
+	RUN_TEST(test_writes_apply_and_notify_without_allocating);
+	RUN_TEST(test_gliding_writes_do_not_allocate);
+	return UNITY_END();
+}
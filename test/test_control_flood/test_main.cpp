@@ -0,0 +1,221 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Control queue under a flood
+// A producer thread stands in for the BLE task: it calls processNumber()
+// and processButton() as fast as it can, sending a command again whenever
+// the queue dropped it. The main thread plays render frames with
+// drainControlCommands() + flushNotifications(). micros() is either the
+// host's steady clock, to check the drain budget in real time, or a clock
+// that steps a fixed amount per read, so a budget is a known number of
+// commands and overruns can be counted exactly.
+//=============================================================================
+
+constexpr uint32_t COMMANDS = 20000;
+constexpr uint8_t FLOAT_IDS = 6;
+constexpr uint32_t BUTTON_EVERY = 50;
+
+// A drain checks the clock after each command, so it can run over by one
+// command; the rest is room for the host scheduler
+constexpr uint32_t DRAIN_SLACK_US = 1000;
+
+// Stepping clock: drainControlCommands() reads it once before the first
+// command and once after each, so a budget of STEP_US * n applies n commands
+constexpr uint32_t STEP_US = 10;
+constexpr uint32_t STEPS_PER_FRAME = 10;
+uint32_t steppedMicros = 0;
+
+uint32_t steppingClock() { return steppedMicros += STEP_US; }
+
+uint32_t steadyClock() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Speed and the float parameters after it, -100..100
+uint8_t floatParam(uint32_t i) { return PID_Speed + i % FLOAT_IDS; }
+double floatValue(uint32_t i) { return (i % 400) * 0.25 - 50.0; }
+
+// What the producer sent last, to compare with the applied state; the
+// last button turns the display off, which it starts out as on
+double lastValue[FLOAT_IDS];
+bool lastDisplayOn;
+
+// Sends command i, retrying while the queue is full; returns the retries
+uint32_t sendCommand(uint32_t i) {
+	uint32_t retries = 0;
+	for (;;) {
+		const uint32_t dropped = controlQueue.dropped();
+		if (i % BUTTON_EVERY == BUTTON_EVERY - 1) {
+			processButton((i / BUTTON_EVERY) & 1 ? 99 : 98);
+		} else {
+			processNumber(PARAM_REGISTRY[floatParam(i)].wireId, floatValue(i));
+		}
+		if (controlQueue.dropped() == dropped) return retries;
+		retries++;
+		std::this_thread::yield();
+	}
+}
+
+struct FloodResult {
+	uint32_t frames = 0;
+	uint32_t retries = 0;
+	uint32_t applied = 0;
+	uint32_t overruns = 0;
+	uint32_t maxPerFrame = 0;
+	uint32_t maxDrainUs = 0;
+	uint32_t overrunsShort = 0;		// stepped clock: overruns on a frame that applied less than a budget
+};
+
+// Floods from a producer thread while the main thread plays frames
+FloodResult flood(uint32_t budgetUs) {
+	FloodResult result;
+	std::atomic<bool> done{false};
+	const uint32_t applied = commandsApplied;
+	const uint32_t overruns = drainOverruns;
+
+	std::thread producer([&result, &done] {
+		uint32_t retries = 0;
+		for (uint32_t i = 0; i < COMMANDS; i++) {
+			retries += sendCommand(i);
+		}
+		result.retries = retries;
+		done.store(true, std::memory_order_release);
+	});
+
+	for (;;) {
+		const bool finished = done.load(std::memory_order_acquire);
+		const uint32_t before = commandsApplied;
+		const uint32_t overrunsBefore = drainOverruns;
+		const auto start = std::chrono::steady_clock::now();
+		drainControlCommands(budgetUs);
+		const uint32_t drainUs = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		flushNotifications();
+		mockMillis += 16;
+
+		const uint32_t perFrame = commandsApplied - before;
+		if (perFrame > result.maxPerFrame) result.maxPerFrame = perFrame;
+		if (drainUs > result.maxDrainUs) result.maxDrainUs = drainUs;
+		if (drainOverruns != overrunsBefore && perFrame < STEPS_PER_FRAME) result.overrunsShort++;
+		result.frames++;
+		if (finished && controlQueue.empty()) break;
+		if (perFrame == 0) std::this_thread::yield();
+	}
+	producer.join();
+
+	result.applied = commandsApplied - applied;
+	result.overruns = drainOverruns - overruns;
+	return result;
+}
+
+// The last value sent for every parameter is the one that stuck
+void assertLastCommandsApplied() {
+	for (uint8_t i = 0; i < FLOAT_IDS; i++) {
+		TEST_ASSERT_EQUAL_FLOAT(lastValue[i], getParam(PID_Speed + i));
+	}
+	TEST_ASSERT_EQUAL(lastDisplayOn, displayOn);
+}
+
+void setUp() {
+	if (pServer == NULL) {
+		bleSetup();
+		pServer->mockConnect();
+	}
+	pServer->peerMtu = 517;
+	for (BLECharacteristic* c : { pButtonCharacteristic, pCheckboxCharacteristic,
+	                              pNumberCharacteristic, pStringCharacteristic }) {
+		c->keepNotifications = false;
+	}
+	cGlideMs = 0;
+	mockMicros = nullptr;
+
+	for (uint32_t i = 0; i < COMMANDS; i++) {
+		if (i % BUTTON_EVERY == BUTTON_EVERY - 1) {
+			lastDisplayOn = !((i / BUTTON_EVERY) & 1);
+		} else {
+			lastValue[floatParam(i) - PID_Speed] = floatValue(i);
+		}
+	}
+}
+
+void tearDown() {
+	mockMicros = nullptr;
+}
+
+// No producer: a known backlog drains a budget's worth per frame, and
+// only frames that leave commands behind count as overruns
+void test_budget_splits_a_backlog() {
+	mockMicros = steppingClock;
+	for (uint32_t i = 0; i < 60; i++) {
+		processNumber(PARAM_REGISTRY[floatParam(i)].wireId, floatValue(i));
+	}
+	const uint32_t overruns = drainOverruns;
+
+	for (int frame = 0; frame < 6; frame++) {
+		const uint32_t before = commandsApplied;
+		drainControlCommands(STEP_US * STEPS_PER_FRAME);
+		TEST_ASSERT_EQUAL_UINT32(STEPS_PER_FRAME, commandsApplied - before);
+	}
+	// The sixth frame emptied the queue exactly, so it didn't overrun
+	TEST_ASSERT_EQUAL_UINT32(5, drainOverruns - overruns);
+	TEST_ASSERT_TRUE(controlQueue.empty());
+
+	const uint32_t before = commandsApplied;
+	drainControlCommands(STEP_US * STEPS_PER_FRAME);
+	TEST_ASSERT_EQUAL_UINT32(0, commandsApplied - before);
+	TEST_ASSERT_EQUAL_UINT32(5, drainOverruns - overruns);
+}
+
+// Real time, the firmware's budget: every command arrives and no drain
+// runs past the budget by more than one command
+void test_flood_applies_everything_within_the_budget() {
+	mockMicros = steadyClock;
+	const FloodResult r = flood(CONTROL_DRAIN_BUDGET_US);
+
+	printf("%u commands in %u frames (%u retries), longest drain %u us, at most %u per frame, %u overruns\n",
+	       (unsigned)r.applied, (unsigned)r.frames, (unsigned)r.retries, (unsigned)r.maxDrainUs,
+	       (unsigned)r.maxPerFrame, (unsigned)r.overruns);
+	TEST_ASSERT_EQUAL_UINT32(COMMANDS, r.applied);
+	TEST_ASSERT_LESS_THAN_UINT32(CONTROL_DRAIN_BUDGET_US + DRAIN_SLACK_US, r.maxDrainUs);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(r.frames, r.overruns);
+	assertLastCommandsApplied();
+}
+
+// Stepped time and a budget of STEPS_PER_FRAME commands: the flood keeps
+// the queue ahead of the drain, so frames overrun, but only full ones do
+void test_flood_overruns_only_full_frames() {
+	mockMicros = steppingClock;
+	const FloodResult r = flood(STEP_US * STEPS_PER_FRAME);
+
+	printf("%u commands in %u frames (%u retries), %u overruns\n",
+	       (unsigned)r.applied, (unsigned)r.frames, (unsigned)r.retries, (unsigned)r.overruns);
+	TEST_ASSERT_EQUAL_UINT32(COMMANDS, r.applied);
+	TEST_ASSERT_EQUAL_UINT32(STEPS_PER_FRAME, r.maxPerFrame);
+	TEST_ASSERT_GREATER_THAN_UINT32(0, r.overruns);
+	TEST_ASSERT_EQUAL_UINT32(0, r.overrunsShort);
+	// No frame went past its budget, so the flood took at least this many
+	TEST_ASSERT_GREATER_OR_EQUAL_UINT32((COMMANDS + STEPS_PER_FRAME - 1) / STEPS_PER_FRAME, r.frames);
+	assertLastCommandsApplied();
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_budget_splits_a_backlog);
+	RUN_TEST(test_flood_applies_everything_within_the_budget);
+	RUN_TEST(test_flood_overruns_only_full_frames);
+	return UNITY_END();
+}
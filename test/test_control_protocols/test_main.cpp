@@ -0,0 +1,224 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// JSON and binary control writes, parse + dispatch
+// Both protocols are driven through the real characteristic callbacks: a
+// {"id":...,"val":...} write to the number characteristic goes through
+// deserializeJson() and the wire-id lookup, a binary write through
+// processBinary()'s typed records. Every numeric parameter is written
+// both ways with the same value and the applied state has to agree. The
+// benchmark times the write alone - parse and queue, up to the render
+// loop's drain - per message for JSON, for one binary record per write and
+// for several records per write. Both include the mock's copy of the
+// bytes into the attribute.
+//=============================================================================
+
+constexpr uint8_t MESSAGES = 64;
+constexpr uint8_t BATCH = 48;		// below CONTROL_QUEUE_SIZE, drained between batches
+constexpr uint8_t RECORDS_PER_WRITE = 6;
+constexpr int BENCH_BATCHES = 2000;
+
+struct JsonMessage {
+	char text[64];
+};
+
+struct BinaryMessage {
+	uint8_t bytes[1 + RECORDS_PER_WRITE * 6];
+	uint8_t len;
+};
+
+// Every parameter a slider can write: no checkboxes, and GlideMs stays 0
+// so writes apply directly
+uint8_t numericIds[PID_COUNT];
+uint8_t numericCount = 0;
+
+JsonMessage jsonMessages[MESSAGES];
+BinaryMessage binaryMessages[MESSAGES];
+BinaryMessage multiMessages[MESSAGES];
+
+// A value in range, exact as a float and as %.9g text: whole numbers for
+// the integer types, steps of 1/64 of the range for floats
+float valueFor(uint8_t id, uint32_t n) {
+	const ParamInfo& p = PARAM_REGISTRY[id];
+	if (p.type == PARAM_U8 || p.type == PARAM_U16) {
+		const uint32_t span = static_cast<uint32_t>(p.hi - p.lo) + 1;
+		return p.lo + n % span;
+	}
+	return p.lo + (p.hi - p.lo) * (n % 65) / 64.0f;
+}
+
+void formatJson(JsonMessage& m, uint8_t id, float value) {
+	snprintf(m.text, sizeof(m.text), "{\"id\":\"%s\",\"val\":%.9g}", PARAM_REGISTRY[id].wireId, value);
+}
+
+// One typed record: U8/U16 for the integer parameters, F32 otherwise
+uint8_t appendRecord(uint8_t* out, uint8_t id, float value) {
+	out[0] = id;
+	switch (PARAM_REGISTRY[id].type) {
+		case PARAM_U8:
+			out[1] = BIN_U8;
+			out[2] = static_cast<uint8_t>(value);
+			return 3;
+		case PARAM_U16: {
+			const uint16_t v = static_cast<uint16_t>(value);
+			out[1] = BIN_U16;
+			out[2] = v & 0xFF;
+			out[3] = v >> 8;
+			return 4;
+		}
+		default:
+			out[1] = BIN_F32;
+			memcpy(&out[2], &value, sizeof(value));
+			return 6;
+	}
+}
+
+void applyQueued() {
+	drainControlCommands();
+	updateParamRamps();
+	flushNotifications();
+}
+
+void setUp() {
+	if (pServer == NULL) {
+		bleSetup();
+		pServer->mockConnect();
+		for (uint8_t id = 0; id < PID_COUNT; id++) {
+			if (PARAM_REGISTRY[id].type != PARAM_BOOL && id != PID_GlideMs) numericIds[numericCount++] = id;
+		}
+	}
+	cGlideMs = 0;
+}
+void tearDown() {}
+
+// Each parameter is set to a through the binary characteristic, then to b
+// through JSON; then back to a and on to b through binary. JSON and binary
+// have to land on the same value for b
+void test_both_protocols_apply_the_same_value() {
+	for (uint32_t round = 0; round < 20; round++) {
+		for (uint8_t k = 0; k < numericCount; k++) {
+			const uint8_t id = numericIds[k];
+			const float a = valueFor(id, round * 7 + k);
+			const float b = valueFor(id, round * 7 + k + 3);
+			TEST_ASSERT_TRUE(a != b);
+			BinaryMessage m;
+			JsonMessage json;
+
+			m.bytes[0] = BINARY_PROTOCOL_VERSION;
+			m.len = 1 + appendRecord(&m.bytes[1], id, a);
+			pBinaryCharacteristic->mockWrite(m.bytes, m.len);
+			applyQueued();
+			TEST_ASSERT_EQUAL_FLOAT(a, float(paramTarget(id)));
+
+			formatJson(json, id, b);
+			pNumberCharacteristic->mockWrite(json.text);
+			applyQueued();
+			const float viaJson = float(paramTarget(id));
+			TEST_ASSERT_EQUAL_FLOAT(b, viaJson);
+
+			pBinaryCharacteristic->mockWrite(m.bytes, m.len);
+			applyQueued();
+			m.len = 1 + appendRecord(&m.bytes[1], id, b);
+			pBinaryCharacteristic->mockWrite(m.bytes, m.len);
+			applyQueued();
+			TEST_ASSERT_EQUAL_FLOAT(viaJson, float(paramTarget(id)));
+		}
+	}
+	printf("%u numeric parameters, 20 rounds: JSON and binary writes applied the same values\n", numericCount);
+}
+
+// Several records in one write apply like the same records one per write
+void test_multi_record_write() {
+	BinaryMessage m;
+	m.bytes[0] = BINARY_PROTOCOL_VERSION;
+	m.len = 1;
+	float expected[RECORDS_PER_WRITE];
+	for (uint8_t r = 0; r < RECORDS_PER_WRITE; r++) {
+		const uint8_t id = numericIds[(r * 5) % numericCount];
+		expected[r] = valueFor(id, 11 * r + 1);
+		m.len += appendRecord(&m.bytes[m.len], id, expected[r]);
+	}
+	pBinaryCharacteristic->mockWrite(m.bytes, m.len);
+	applyQueued();
+	for (uint8_t r = 0; r < RECORDS_PER_WRITE; r++) {
+		TEST_ASSERT_EQUAL_FLOAT(expected[r], float(paramTarget(numericIds[(r * 5) % numericCount])));
+	}
+}
+
+// Runs BENCH_BATCHES batches of BATCH writes, timing only the writes;
+// returns ns per write
+template <typename Write>
+double timeWrites(Write write) {
+	double ns = 0.0;
+	uint32_t n = 0;
+	for (int b = 0; b < BENCH_BATCHES; b++) {
+		const auto start = std::chrono::steady_clock::now();
+		for (uint8_t i = 0; i < BATCH; i++, n++) write(n % MESSAGES);
+		ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		applyQueued();
+	}
+	return ns / (BENCH_BATCHES * BATCH);
+}
+
+void test_parse_and_dispatch_benchmark() {
+	for (uint8_t i = 0; i < MESSAGES; i++) {
+		const uint8_t id = numericIds[(i * 13) % numericCount];
+		const float value = valueFor(id, i * 3);
+		formatJson(jsonMessages[i], id, value);
+		binaryMessages[i].bytes[0] = BINARY_PROTOCOL_VERSION;
+		binaryMessages[i].len = 1 + appendRecord(&binaryMessages[i].bytes[1], id, value);
+
+		multiMessages[i].bytes[0] = BINARY_PROTOCOL_VERSION;
+		multiMessages[i].len = 1;
+		for (uint8_t r = 0; r < RECORDS_PER_WRITE; r++) {
+			const uint8_t rid = numericIds[(i * 13 + r * 7) % numericCount];
+			multiMessages[i].len += appendRecord(&multiMessages[i].bytes[multiMessages[i].len], rid, valueFor(rid, i + r));
+		}
+	}
+	const uint32_t applied = commandsApplied;
+
+	const double jsonNs = timeWrites([](uint8_t i) { pNumberCharacteristic->mockWrite(jsonMessages[i].text); });
+	const double binaryNs = timeWrites([](uint8_t i) {
+		pBinaryCharacteristic->mockWrite(binaryMessages[i].bytes, binaryMessages[i].len);
+	});
+	// BATCH / RECORDS_PER_WRITE writes fill the same queue space
+	double multiNs = 0.0;
+	for (int b = 0; b < BENCH_BATCHES; b++) {
+		const auto start = std::chrono::steady_clock::now();
+		for (uint8_t i = 0; i < BATCH / RECORDS_PER_WRITE; i++) {
+			const BinaryMessage& m = multiMessages[(b * 8 + i) % MESSAGES];
+			pBinaryCharacteristic->mockWrite(m.bytes, m.len);
+		}
+		multiNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		applyQueued();
+	}
+	multiNs /= BENCH_BATCHES * (BATCH / RECORDS_PER_WRITE) * RECORDS_PER_WRITE;
+
+	printf("Per parameter: JSON write %.0f ns, binary one record per write %.0f ns (%.1fx faster), "
+	       "%u records per write %.0f ns (%.1fx)\n",
+	       jsonNs, binaryNs, jsonNs / binaryNs, RECORDS_PER_WRITE, multiNs, jsonNs / multiNs);
+	// Nothing was dropped: every write of every run was applied
+	TEST_ASSERT_EQUAL_UINT32(3 * BENCH_BATCHES * BATCH, commandsApplied - applied);
+	TEST_ASSERT_TRUE(binaryNs < jsonNs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_both_protocols_apply_the_same_value);
+	RUN_TEST(test_multi_record_write);
+	RUN_TEST(test_parse_and_dispatch_benchmark);
+	return UNITY_END();
+}
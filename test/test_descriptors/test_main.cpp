@@ -0,0 +1,154 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "audioFFTQ15.h"
+#include "audioDescriptors.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Spectral descriptors against a two-pass reference
+// The reference is the textbook version: a first pass for the sum, centroid,
+// log2 (libm) and flux, then a second pass walking up to the 85% rolloff.
+// The fused pass has to agree on everything but flatness, where the fast
+// log2 may cost ~1%. The benchmark times one block of each.
+//=============================================================================
+
+constexpr uint16_t BINS = Q15_FFT_COMPLEX;
+constexpr float BIN_HZ = Q15_FFT_SAMPLE_RATE / Q15_FFT_SIZE;
+constexpr int SPECTRA = 500;
+constexpr int BLOCKS = 20000;
+
+DescriptorExtractor spectral;
+uint16_t mag[BINS];
+uint16_t refPrev[BINS];
+
+SpectralDescriptors reference(const uint16_t* m) {
+	SpectralDescriptors out;
+	double sum = 0.0, weighted = 0.0, logSum = 0.0, flux = 0.0;
+	uint16_t peakBin = 1;
+	for (uint16_t k = 1; k < BINS; k++) {
+		sum += m[k];
+		weighted += double(m[k]) * k;
+		logSum += log2(m[k] + 1.0);
+		flux += m[k] > refPrev[k] ? m[k] - refPrev[k] : 0;
+		refPrev[k] = m[k];
+		if (m[k] > m[peakBin]) peakBin = k;
+	}
+	if (sum == 0.0) return out;
+
+	// Second pass: first bin where the running sum reaches 85%
+	const uint32_t target = static_cast<uint32_t>(static_cast<uint32_t>(sum) * ROLLOFF_FRACTION);
+	uint32_t running = 0;
+	uint16_t rolloff = 1;
+	for (uint16_t k = 1; k < BINS; k++) {
+		running += m[k];
+		if (running >= target) { rolloff = k; break; }
+	}
+
+	const uint16_t n = BINS - 1;
+	out.centroidHz = static_cast<float>(weighted / sum * BIN_HZ);
+	out.rolloffHz = rolloff * BIN_HZ;
+	out.flatness = static_cast<float>(exp2(logSum / n) / (sum / n + 1.0));
+	out.flux = static_cast<float>(flux);
+	out.peakBin = peakBin;
+	out.dominantHz = peakBin * BIN_HZ;
+	return out;
+}
+
+// Tonal (a few peaks), noisy (flat) and sparse spectra, with silence mixed in
+void fillSpectrum(int s) {
+	switch (s % 4) {
+		case 0:
+			for (uint16_t k = 0; k < BINS; k++) mag[k] = rand() % 50;
+			for (int p = 0; p < 3; p++) mag[1 + rand() % (BINS - 1)] = 5000 + rand() % 25000;
+			break;
+		case 1:
+			for (uint16_t k = 0; k < BINS; k++) mag[k] = 1000 + rand() % 2000;
+			break;
+		case 2:
+			memset(mag, 0, sizeof(mag));
+			mag[1 + rand() % (BINS - 1)] = rand() % 65536;
+			break;
+		default:
+			if (s % 16 == 3) memset(mag, 0, sizeof(mag));
+			else for (uint16_t k = 0; k < BINS; k++) mag[k] = rand() % 65536;
+			break;
+	}
+}
+
+void setUp() {
+	srand(3);
+	spectral.init(BIN_HZ, BINS);
+	memset(refPrev, 0, sizeof(refPrev));
+}
+void tearDown() {}
+
+void test_matches_two_pass_reference() {
+	float worstFlatness = 0.0f;
+	for (int s = 0; s < SPECTRA; s++) {
+		fillSpectrum(s);
+		spectral.process(mag);
+		const SpectralDescriptors ref = reference(mag);
+		const SpectralDescriptors& d = spectral.descriptors();
+
+		TEST_ASSERT_FLOAT_WITHIN(ref.centroidHz * 1e-5f + 1e-3f, ref.centroidHz, d.centroidHz);
+		TEST_ASSERT_EQUAL_FLOAT(ref.rolloffHz, d.rolloffHz);
+		TEST_ASSERT_EQUAL_FLOAT(ref.flux, d.flux);
+		TEST_ASSERT_EQUAL_UINT16(ref.peakBin, d.peakBin);
+		TEST_ASSERT_EQUAL_FLOAT(ref.dominantHz, d.dominantHz);
+		TEST_ASSERT_FLOAT_WITHIN(0.01f * ref.flatness + 1e-4f, ref.flatness, d.flatness);
+		if (ref.flatness > 0.0f) worstFlatness = fmaxf(worstFlatness, fabsf(d.flatness / ref.flatness - 1.0f));
+	}
+	printf("Worst flatness error %.3f%%\n", 100.0f * worstFlatness);
+}
+
+// Flatness orders noise above a tone, and reset() restarts flux from zero
+void test_flatness_and_reset() {
+	for (uint16_t k = 0; k < BINS; k++) mag[k] = 2000;
+	spectral.process(mag);
+	const float noise = spectral.descriptors().flatness;
+	TEST_ASSERT_GREATER_THAN(0.99f, noise);
+
+	memset(mag, 0, sizeof(mag));
+	mag[40] = 30000;
+	spectral.process(mag);
+	TEST_ASSERT_LESS_THAN(0.05f, spectral.descriptors().flatness);
+	TEST_ASSERT_EQUAL_UINT16(40, spectral.descriptors().peakBin);
+
+	spectral.reset();
+	spectral.process(mag);
+	TEST_ASSERT_EQUAL_FLOAT(30000.0f, spectral.descriptors().flux);
+}
+
+void test_block_benchmark() {
+	fillSpectrum(0);
+	volatile float sink = 0.0f;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BLOCKS; b++) {
+		mag[b & 255] ^= 1;
+		spectral.process(mag);
+		sink += spectral.descriptors().centroidHz;
+	}
+	const double fusedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BLOCKS; b++) {
+		mag[b & 255] ^= 1;
+		sink += reference(mag).centroidHz;
+	}
+	const double refNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	printf("Per %u-bin block: fused pass %.0f ns, two-pass reference with log2() %.0f ns\n", BINS, fusedNs, refNs);
+	TEST_ASSERT_TRUE(fusedNs > 0.0);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_two_pass_reference);
+	RUN_TEST(test_flatness_and_reset);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+#include "audioNormalize.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Running P5/P95 auto-scaling against an exact windowed quantile
+// The reference keeps the last WINDOW raw values of a feature and takes
+// P5/P95 with nth_element, the textbook way and the memory the streaming
+// estimator avoids. On a stationary stream the two ranges must agree within
+// a few percent of the span; after the feature's scale jumps the estimator
+// must follow within a few seconds of blocks. The benchmark times one
+// block's update of every feature both ways.
+//=============================================================================
+
+constexpr float BLOCKS_PER_SECOND = 44100.0f / 512.0f;
+constexpr uint16_t WINDOW = 1024;		// ~12 s of blocks
+constexpr int SETTLE_BLOCKS = 3000;
+constexpr int BENCH_BLOCKS = 20000;
+constexpr float RANGE_TOLERANCE = 0.06f;	// of the reference span
+
+struct WindowQuantile {
+	float history[WINDOW];
+	float scratch[WINDOW];
+	uint16_t count = 0;
+	uint16_t next = 0;
+
+	void push(float x) {
+		history[next] = x;
+		next = (next + 1) % WINDOW;
+		if (count < WINDOW) count++;
+	}
+
+	float quantile(float p) {
+		memcpy(scratch, history, count * sizeof(float));
+		const uint16_t k = static_cast<uint16_t>(p * (count - 1));
+		std::nth_element(scratch, scratch + k, scratch + count);
+		return scratch[k];
+	}
+};
+
+WindowQuantile reference[NORM_FEATURE_COUNT];
+FeatureNormalizer normalizer;
+
+float uniform(float lo, float hi) {
+	return lo + (hi - lo) * (rand() / float(RAND_MAX));
+}
+
+// A skewed, music-like level: mostly low, with loud bursts
+float skewed(float scale) {
+	const float u = rand() / float(RAND_MAX);
+	return scale * u * u * u;
+}
+
+void setUp() {
+	srand(26);
+	normalizer.reset();
+	for (WindowQuantile& w : reference) w.count = w.next = 0;
+}
+void tearDown() {}
+
+void checkRange(NormFeature f) {
+	const float lo = reference[f].quantile(NORM_P_LOW);
+	const float hi = reference[f].quantile(NORM_P_HIGH);
+	const float tol = RANGE_TOLERANCE * (hi - lo);
+	printf("feature %u: P5 %.1f vs %.1f, P95 %.1f vs %.1f\n", f, normalizer.low(f), lo, normalizer.high(f), hi);
+	TEST_ASSERT_FLOAT_WITHIN(tol, lo, normalizer.low(f));
+	TEST_ASSERT_FLOAT_WITHIN(tol, hi, normalizer.high(f));
+}
+
+void test_tracks_the_windowed_quantiles() {
+	for (int b = 0; b < SETTLE_BLOCKS; b++) {
+		const float rms = uniform(200.0f, 1800.0f);
+		const float bass = skewed(400.0f);
+		normalizer.update(NORM_RMS, rms);
+		normalizer.update(NORM_BASS, bass);
+		reference[NORM_RMS].push(rms);
+		reference[NORM_BASS].push(bass);
+	}
+	checkRange(NORM_RMS);
+	checkRange(NORM_BASS);
+
+	// A value at the reference P95 maps close to full scale, one at P5 to 0
+	normalizer.update(NORM_RMS, reference[NORM_RMS].quantile(NORM_P_HIGH));
+	TEST_ASSERT_GREATER_THAN_UINT8(230, normalizer.level(NORM_RMS));
+	normalizer.update(NORM_RMS, reference[NORM_RMS].quantile(NORM_P_LOW));
+	TEST_ASSERT_LESS_THAN_UINT8(25, normalizer.level(NORM_RMS));
+}
+
+// A feature that gets 5x louder is rescaled within a few seconds
+void test_follows_a_scale_change() {
+	for (int b = 0; b < SETTLE_BLOCKS; b++) normalizer.update(NORM_ENERGY, uniform(20.0f, 120.0f));
+
+	int blocks = 0;
+	while (normalizer.high(NORM_ENERGY) < 0.9f * 570.0f && blocks < 20 * BLOCKS_PER_SECOND) {
+		normalizer.update(NORM_ENERGY, uniform(100.0f, 600.0f));
+		blocks++;
+	}
+	printf("5x louder: P95 within 10%% after %d blocks (%.1f s)\n", blocks, blocks / BLOCKS_PER_SECOND);
+	TEST_ASSERT_LESS_THAN(5 * BLOCKS_PER_SECOND, blocks);
+}
+
+// Silence never stretches the floor below zero or the span under its
+// minimum; the floor sits within one step of zero
+void test_silence_keeps_the_minimum_span() {
+	for (int b = 0; b < SETTLE_BLOCKS; b++) normalizer.update(NORM_RMS, 0.0f);
+	TEST_ASSERT_FLOAT_WITHIN(NORM_MIN_SPAN_RMS * NORM_ADAPT_RATE, 0.0f, normalizer.low(NORM_RMS));
+	TEST_ASSERT_FLOAT_WITHIN(NORM_MIN_SPAN_RMS * NORM_ADAPT_RATE, NORM_MIN_SPAN_RMS, normalizer.high(NORM_RMS) - normalizer.low(NORM_RMS));
+	normalizer.update(NORM_RMS, 30.0f);
+	TEST_ASSERT_LESS_THAN_UINT8(60, normalizer.level(NORM_RMS));
+}
+
+void test_block_benchmark() {
+	float raw[NORM_FEATURE_COUNT];
+	for (uint8_t f = 0; f < NORM_FEATURE_COUNT; f++) raw[f] = uniform(0.0f, 1000.0f);
+	volatile uint32_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BENCH_BLOCKS; b++) {
+		raw[b % NORM_FEATURE_COUNT] = uniform(0.0f, 1000.0f);
+		for (uint8_t f = 0; f < NORM_FEATURE_COUNT; f++) normalizer.update(static_cast<NormFeature>(f), raw[f]);
+		sink += normalizer.level(NORM_RMS);
+	}
+	const double streamNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_BLOCKS;
+
+	const int refBlocks = BENCH_BLOCKS / 20;
+	start = std::chrono::steady_clock::now();
+	for (int b = 0; b < refBlocks; b++) {
+		raw[b % NORM_FEATURE_COUNT] = uniform(0.0f, 1000.0f);
+		for (uint8_t f = 0; f < NORM_FEATURE_COUNT; f++) {
+			reference[f].push(raw[f]);
+			sink += static_cast<uint32_t>(reference[f].quantile(NORM_P_LOW) + reference[f].quantile(NORM_P_HIGH));
+		}
+	}
+	const double windowNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / refBlocks;
+
+	printf("Per block, %u features: streaming %.0f ns in %u bytes, %u-block window %.0f ns in %u bytes\n",
+	       NORM_FEATURE_COUNT, streamNs, (unsigned)sizeof(FeatureNormalizer), WINDOW, windowNs,
+	       (unsigned)(NORM_FEATURE_COUNT * WINDOW * sizeof(float)));
+	TEST_ASSERT_LESS_THAN(32 * NORM_FEATURE_COUNT, sizeof(FeatureNormalizer));
+	TEST_ASSERT_TRUE(streamNs < windowNs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_tracks_the_windowed_quantiles);
+	RUN_TEST(test_follows_a_scale_change);
+	RUN_TEST(test_silence_keeps_the_minimum_span);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "audioFFTQ15.h"
+#include "audioGoertzel.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Goertzel bank against a double-precision DFT, and against the FFT
+// The reference evaluates the DFT of the block at each target frequency in
+// double (rectangular window, scaled by 2/n so a sine of amplitude A reads
+// A). The fixed-point bank has to agree within a small fraction of full
+// scale for bass to treble targets, including a full-scale tone at the
+// 20 Hz floor, where the int32 state is closest to overflowing (UBSan
+// reports it if it does). The benchmark times one 512-sample block of 3, 8
+// and 16 targets against Q15Spectrum's 512-point FFT, the trade-off the
+// header tabulates, cycling through different blocks so the FFT's
+// data-dependent square roots aren't learned by the host's predictor.
+//=============================================================================
+
+constexpr uint16_t BLOCK = 512;
+constexpr int BLOCKS = 20000;
+constexpr float LEVEL_TOLERANCE = 40.0f;		// sample units, of 32767
+constexpr float FLOOR_TOLERANCE_REL = 0.015f;	// full scale at 20 Hz reads up to ~1% low
+constexpr uint8_t BENCH_SIGNAL_BLOCKS = 64;
+
+const float TARGETS[GOERTZEL_MAX_TARGETS] = { 45.0f, 60.0f, 80.0f, 110.0f, 150.0f, 220.0f, 330.0f, 440.0f,
+                                              660.0f, 880.0f, 1200.0f, 1800.0f, 2500.0f, 3500.0f, 5000.0f, 8000.0f };
+
+GoertzelBank bank;
+int16_t pcm[BLOCK];
+
+double referenceLevel(const int16_t* x, uint16_t n, double hz) {
+	const double w = 2.0 * M_PI * hz / GOERTZEL_SAMPLE_RATE;
+	double re = 0.0, im = 0.0;
+	for (uint16_t i = 0; i < n; i++) {
+		re += x[i] * cos(w * i);
+		im -= x[i] * sin(w * i);
+	}
+	return sqrt(re * re + im * im) * 2.0 / n;
+}
+
+// Sines at the given frequencies and amplitudes, random phases, plus noise
+void fillBlock(const float* hz, const float* amplitude, uint8_t count) {
+	float phase[4];
+	for (uint8_t j = 0; j < count; j++) phase[j] = rand() / float(RAND_MAX) * 6.2831853f;
+	for (uint16_t i = 0; i < BLOCK; i++) {
+		float s = rand() % 201 - 100;
+		for (uint8_t j = 0; j < count; j++) s += amplitude[j] * sinf(2.0f * float(M_PI) * hz[j] * i / GOERTZEL_SAMPLE_RATE + phase[j]);
+		pcm[i] = static_cast<int16_t>(fmaxf(-32768.0f, fminf(32767.0f, s)));
+	}
+}
+
+// Returns the worst relative error
+float checkAgainstReference(float relTolerance = 0.0f) {
+	bank.process(pcm, BLOCK);
+	float worst = 0.0f;
+	for (uint8_t t = 0; t < bank.count(); t++) {
+		const double ref = referenceLevel(pcm, BLOCK, bank.frequency(t));
+		TEST_ASSERT_FLOAT_WITHIN(LEVEL_TOLERANCE + relTolerance * float(ref), float(ref), bank.level(t));
+		if (ref > 0.0) worst = fmaxf(worst, float(fabs(bank.level(t) - ref) / ref));
+	}
+	return worst;
+}
+
+void setUp() {
+	srand(30);
+	bank.setTargets(TARGETS, GOERTZEL_MAX_TARGETS);
+}
+void tearDown() {}
+
+void test_matches_dft_at_every_target() {
+	float worst = 0.0f;
+	for (int b = 0; b < 200; b++) {
+		const float hz[3] = { 30.0f + rand() % 200, 200.0f + rand() % 2000, 2000.0f + rand() % 6000 };
+		const float amplitude[3] = { 12000.0f, 6000.0f, 3000.0f };
+		fillBlock(hz, amplitude, 3);
+		checkAgainstReference();
+		for (uint8_t t = 0; t < bank.count(); t++) {
+			worst = fmaxf(worst, fabsf(bank.level(t) - float(referenceLevel(pcm, BLOCK, bank.frequency(t)))));
+		}
+	}
+	printf("Worst difference from the DFT over 200 blocks of mixed tones: %.1f of 32767\n", worst);
+}
+
+// Full scale at the 20 Hz floor: the largest state the bank can see
+void test_full_scale_at_the_floor() {
+	const float belowFloor[1] = { 5.0f };
+	bank.setTargets(belowFloor, 1);
+	TEST_ASSERT_EQUAL_FLOAT(20.0f, bank.frequency(0));
+	const float hz[1] = { 20.0f };
+	const float amplitude[1] = { 40000.0f };		// clipped to full scale
+	float worst = 0.0f;
+	for (int b = 0; b < 20; b++) {
+		fillBlock(hz, amplitude, 1);
+		worst = fmaxf(worst, checkAgainstReference(FLOOR_TOLERANCE_REL));
+	}
+	printf("Full scale at 20 Hz: worst %.2f%% from the DFT\n", 100.0f * worst);
+}
+
+// 45 and 60 Hz no longer share a coefficient: the bank reads each target's
+// own DFT value, which differ by far more than the tolerance on a 52 Hz tone
+// with a 300 Hz neighbour
+void test_close_bass_targets_stay_apart() {
+	const float close[2] = { 45.0f, 60.0f };
+	bank.setTargets(close, 2);
+	const float hz[2] = { 52.0f, 300.0f };
+	const float amplitude[2] = { 20000.0f, 20000.0f };
+	fillBlock(hz, amplitude, 2);
+	checkAgainstReference();
+	const double apart = fabs(referenceLevel(pcm, BLOCK, 45.0) - referenceLevel(pcm, BLOCK, 60.0));
+	printf("52 Hz tone: 45 Hz target %.0f, 60 Hz target %.0f\n", bank.level(0), bank.level(1));
+	TEST_ASSERT_GREATER_THAN(4.0f * LEVEL_TOLERANCE, float(apart));
+}
+
+void test_block_benchmark() {
+	static int16_t blocks[BENCH_SIGNAL_BLOCKS][BLOCK];
+	for (uint8_t b = 0; b < BENCH_SIGNAL_BLOCKS; b++) {
+		const float hz[2] = { 40.0f + rand() % 100, 200.0f + rand() % 2000 };
+		const float amplitude[2] = { 10000.0f, 5000.0f };
+		fillBlock(hz, amplitude, 2);
+		memcpy(blocks[b], pcm, sizeof(pcm));
+	}
+	Q15Spectrum spectrum;
+	uint16_t magnitudes[Q15_FFT_COMPLEX];
+	volatile float sink = 0.0f;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BLOCKS; b++) {
+		spectrum.compute(blocks[b % BENCH_SIGNAL_BLOCKS], BLOCK, magnitudes);
+		sink += magnitudes[3];
+	}
+	const double fftNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	const uint8_t counts[3] = { 3, 8, 16 };
+	double goertzelNs[3];
+	for (uint8_t c = 0; c < 3; c++) {
+		bank.setTargets(TARGETS, counts[c]);
+		start = std::chrono::steady_clock::now();
+		for (int b = 0; b < BLOCKS; b++) {
+			bank.process(blocks[b % BENCH_SIGNAL_BLOCKS], BLOCK);
+			sink += bank.level(0);
+		}
+		goertzelNs[c] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+		printf("%2u targets: %.0f ns per block (%.2fx the FFT)\n", counts[c], goertzelNs[c], goertzelNs[c] / fftNs);
+	}
+	printf("512-point Q15 FFT + magnitudes: %.0f ns per block\n", fftNs);
+	TEST_ASSERT_TRUE(goertzelNs[0] < goertzelNs[2]);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_dft_at_every_target);
+	RUN_TEST(test_full_scale_at_the_floor);
+	RUN_TEST(test_close_bass_targets_stay_apart);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,185 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "heatField.h"
+
+//=============================================================================
+// Heat-diffusion fire at 32x48 against a two-buffer update
+// The reference is the usual way to write the cellular step: read the whole
+// previous grid, write a second one, then copy it back. Fed the same
+// random8() sequence and the same sparks, the in-place field has to match
+// it cell for cell, every step - row y only reads rows that haven't been
+// written yet. The * 171 >> 10 average is checked against / 6 for every
+// possible neighbourhood sum. A fed fire must keep a flame that cools
+// going up, and render() must be the palette lookup per cell. The
+// benchmark times step() and render() per frame and per cell on the 48x32
+// panel against the two-buffer step.
+//=============================================================================
+
+constexpr uint8_t W = 48;
+constexpr uint8_t H = 32;
+constexpr int STEPS = 2000;
+constexpr int BENCH_FRAMES = 20000;
+constexpr uint8_t COOLING_LOUD = 40;		// drawFire()'s range is 40..120
+constexpr uint8_t COOLING_QUIET = 120;
+
+struct TwoBufferField {
+	uint8_t heat[H][W] = {};
+	uint8_t next[H][W];
+
+	void step(uint8_t cooling) {
+		for (uint8_t y = 0; y < H; y++) {
+			for (uint8_t x = 0; x < W; x++) {
+				uint8_t h = heat[y][x];
+				if (y + 1 < H) {
+					const uint8_t* below = heat[y + 1];
+					const uint8_t* below2 = heat[y + 2 < H ? y + 2 : H - 1];
+					const uint8_t xl = x > 0 ? x - 1 : x;
+					const uint8_t xr = x + 1 < W ? x + 1 : x;
+					h = ((below[xl] + 2 * below[x] + below[xr] + 2 * below2[x]) * 171) >> 10;
+				}
+				next[y][x] = qsub8(h, (static_cast<uint16_t>(random8()) * cooling) >> 8);
+			}
+		}
+		memcpy(heat, next, sizeof(heat));
+	}
+
+	void spark(uint8_t x, uint8_t amount) {
+		heat[H - 1][x] = qadd8(heat[H - 1][x], amount);
+		heat[H - 2][x] = qadd8(heat[H - 2][x], amount >> 1);
+	}
+};
+
+HeatField<W, H> field;
+TwoBufferField reference;
+CRGB frame[W * H];
+
+uint16_t serpentine(uint8_t x, uint8_t y) {
+	return (y & 1) ? y * W + (W - 1 - x) : y * W + x;
+}
+
+// A bass-driven base: up to half the columns spark per step, as drawFire()
+// does on a loud bass
+void sparkBoth() {
+	const uint8_t sparks = 1 + rand() % (W / 2);
+	for (uint8_t s = 0; s < sparks; s++) {
+		const uint8_t x = rand() % W;
+		const uint8_t amount = 160 + rand() % 96;
+		field.spark(x, amount);
+		reference.spark(x, amount);
+	}
+}
+
+void stepBoth(uint8_t cooling) {
+	const uint16_t seed = static_cast<uint16_t>(rand());
+	random16_set_seed(seed);
+	field.step(cooling);
+	random16_set_seed(seed);
+	reference.step(cooling);
+}
+
+void setUp() {
+	srand(40);
+	field.clear();
+	reference = TwoBufferField();
+}
+void tearDown() {}
+
+void test_matches_the_two_buffer_step() {
+	for (int s = 0; s < STEPS; s++) {
+		sparkBoth();
+		stepBoth(s % 500 < 250 ? COOLING_LOUD : COOLING_QUIET);
+		for (uint8_t y = 0; y < H; y++) {
+			uint8_t row[W];
+			for (uint8_t x = 0; x < W; x++) row[x] = field.heat(x, y);
+			TEST_ASSERT_EQUAL_UINT8_ARRAY(reference.heat[y], row, W);
+		}
+	}
+}
+
+// The neighbourhood sum is at most 6 * 255; * 171 >> 10 is / 6 rounded
+// at worst one step up
+void test_average_is_within_a_step_of_divide_by_six() {
+	uint16_t high = 0;
+	for (uint16_t sum = 0; sum <= 6 * 255; sum++) {
+		const uint16_t fast = (sum * 171) >> 10;
+		TEST_ASSERT_TRUE(fast == sum / 6 || fast == sum / 6 + 1);
+		high += fast != sum / 6;
+	}
+	printf("* 171 >> 10 is one above / 6 for %u of %u sums\n", high, 6 * 255 + 1);
+}
+
+// Steady sparks: the bottom stays hot, the top stays near cold, and the
+// row averages fall off going up
+void test_fed_fire_cools_going_up() {
+	uint32_t rowSum[H] = {};
+	for (int s = 0; s < 600; s++) {
+		sparkBoth();
+		stepBoth(COOLING_LOUD);
+		for (uint8_t y = 0; s >= 100 && y < H; y++) {
+			for (uint8_t x = 0; x < W; x++) rowSum[y] += field.heat(x, y);
+		}
+	}
+	const float bottom = rowSum[H - 2] / 500.0f / W;
+	const float middle = rowSum[H / 2] / 500.0f / W;
+	const float top = rowSum[0] / 500.0f / W;
+	printf("Mean heat: bottom %.1f, middle %.1f, top %.1f\n", bottom, middle, top);
+	TEST_ASSERT_TRUE(bottom > 2.0f * middle);
+	TEST_ASSERT_TRUE(middle > top);
+	TEST_ASSERT_TRUE(top < 2.0f);
+}
+
+void test_render_is_the_palette_lookup() {
+	CRGBPalette16 palette(HeatColors_p);
+	field.setPalette(palette);
+	for (int s = 0; s < 50; s++) {
+		sparkBoth();
+		stepBoth(COOLING_LOUD);
+	}
+	field.render(frame, serpentine);
+	for (uint8_t y = 0; y < H; y++) {
+		for (uint8_t x = 0; x < W; x++) {
+			const CRGB expected = ColorFromPalette(palette, scale8(field.heat(x, y), 240), 255, LINEARBLEND);
+			TEST_ASSERT_EQUAL_MEMORY(&expected, &frame[serpentine(x, y)], sizeof(CRGB));
+		}
+	}
+}
+
+void test_frame_benchmark() {
+	field.setPalette(CRGBPalette16(HeatColors_p));
+	volatile uint32_t sink = 0;
+	double stepNs = 0.0, renderNs = 0.0, referenceNs = 0.0;
+
+	for (int f = 0; f < BENCH_FRAMES; f++) {
+		sparkBoth();
+		auto start = std::chrono::steady_clock::now();
+		field.step(COOLING_LOUD);
+		const auto stepped = std::chrono::steady_clock::now();
+		field.render(frame, serpentine);
+		const auto rendered = std::chrono::steady_clock::now();
+		reference.step(COOLING_LOUD);
+		stepNs += std::chrono::duration<double, std::nano>(stepped - start).count();
+		renderNs += std::chrono::duration<double, std::nano>(rendered - stepped).count();
+		referenceNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - rendered).count();
+		sink += frame[f % (W * H)].r + reference.heat[H - 1][f % W];
+	}
+
+	stepNs /= BENCH_FRAMES;
+	renderNs /= BENCH_FRAMES;
+	referenceNs /= BENCH_FRAMES;
+	printf("%ux%u: step %.0f ns + render %.0f ns per frame, %.2f ns per cell; two-buffer step %.0f ns\n",
+	       W, H, stepNs, renderNs, (stepNs + renderNs) / (W * H), referenceNs);
+	TEST_ASSERT_TRUE(stepNs > 0.0);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_the_two_buffer_step);
+	RUN_TEST(test_average_is_within_a_step_of_divide_by_six);
+	RUN_TEST(test_fed_fire_cools_going_up);
+	RUN_TEST(test_render_is_the_palette_lookup);
+	RUN_TEST(test_frame_benchmark);
+	return UNITY_END();
+}
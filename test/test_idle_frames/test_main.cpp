@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define HEIGHT 22
+#define WIDTH 22
+#define NUM_SEGMENTS 1
+#define NUM_LEDS (WIDTH * HEIGHT)
+
+#include <FastLED.h>
+
+CRGB leds[NUM_LEDS];
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+
+#include "bleControl.h"
+#include "ledOutput.h"
+#include "audioTest.hpp"
+
+//=============================================================================
+// Idle throttling over a signal with gaps
+// Plays main.cpp's render loop - runAudioTest(), then showFrame() when it
+// returns true - on music broken up by short and long silences. One loop
+// iteration is one I2S block: it takes BLOCK_MS, or longer if the loop
+// slept. Per segment the run reports blocks, frames rendered, show() calls
+// and analysed vs idle blocks, for a bar mode (spectrum) and an animated
+// one (fire).
+//=============================================================================
+
+constexpr uint32_t BLOCK_MS = 12;		// 512 samples at 44.1 kHz
+
+struct Segment {
+	const char* name;
+	bool music;
+	uint32_t ms;
+};
+
+// A gap shorter than IDLE_ENTER_MS, then long ones
+const Segment SIGNAL_WITH_GAPS[] = {
+	{ "music", true, 3000 },
+	{ "silence 6 s", false, 6000 },
+	{ "music", true, 2000 },
+	{ "silence 1.5 s", false, 1500 },
+	{ "music", true, 1500 },
+	{ "silence 10 s", false, 10000 },
+	{ "music", true, 1000 },
+};
+constexpr uint8_t SEGMENTS = sizeof(SIGNAL_WITH_GAPS) / sizeof(SIGNAL_WITH_GAPS[0]);
+
+struct SegmentRun {
+	uint32_t blocks = 0;
+	uint32_t rendered = 0;
+	uint32_t shows = 0;
+	uint32_t active = 0;
+	uint32_t idle = 0;
+	uint32_t stageBlocks = 0;		// blocks the mode's analysis stage ran for
+	uint32_t wakeBlocks = 0;		// blocks until active again, music segments after idle
+};
+
+// 440 Hz tone with a 60 Hz kick every 500 ms; silence is a noise floor
+// well under the gate
+bool playingMusic = true;
+uint32_t samplePos = 0;
+void gappedSignal(int16_t* pcm, size_t n) {
+	for (size_t i = 0; i < n; i++, samplePos++) {
+		if (!playingMusic) {
+			pcm[i] = static_cast<int16_t>(rand() % 21 - 10);
+			continue;
+		}
+		const float t = samplePos / 44100.0f;
+		float s = 3000.0f * sinf(2.0f * float(M_PI) * 440.0f * t);
+		if (fmodf(t, 0.5f) < 0.05f) s += 8000.0f * sinf(2.0f * float(M_PI) * 60.0f * t);
+		pcm[i] = static_cast<int16_t>(s + (rand() % 200 - 100));
+	}
+}
+
+uint16_t serpentine(uint8_t x, uint8_t y) {
+	return (y & 1) ? y * WIDTH + (WIDTH - 1 - x) : y * WIDTH + x;
+}
+
+// One pass of main.cpp's loop() for the audio program
+bool loopOnce() {
+	const uint32_t start = mockMillis;
+	const bool rendered = audioTest::runAudioTest();
+	if (rendered) ledOutput::showFrame();
+	if (mockMillis - start < BLOCK_MS) mockMillis = start + BLOCK_MS;
+	return rendered;
+}
+
+uint32_t stageCounter(uint8_t visualizer) {
+	// Spectrum reads the spectrum stage; fire the STFT onsets
+	return visualizer == 0 ? myAudio::spectrumBlocks : myAudio::stftBlocks;
+}
+
+void runSignal(uint8_t mode, SegmentRun* runs) {
+	MODE = mode;
+	const uint8_t visualizer = audioTest::MODE_VISUALIZER[mode];
+	for (uint8_t s = 0; s < SEGMENTS; s++) {
+		const Segment& seg = SIGNAL_WITH_GAPS[s];
+		SegmentRun& run = runs[s];
+		playingMusic = seg.music;
+		const bool wasIdle = myAudio::isIdle();
+		const uint32_t shows = FastLED.shows;
+		const uint32_t active = myAudio::activeBlocks;
+		const uint32_t idle = myAudio::idleBlocks;
+		const uint32_t stages = stageCounter(visualizer);
+
+		const uint32_t end = mockMillis + seg.ms;
+		while (mockMillis < end) {
+			if (loopOnce()) run.rendered++;
+			run.blocks++;
+			if (seg.music && wasIdle && run.wakeBlocks == 0 && !myAudio::isIdle()) run.wakeBlocks = run.blocks;
+		}
+		run.shows = FastLED.shows - shows;
+		run.active = myAudio::activeBlocks - active;
+		run.idle = myAudio::idleBlocks - idle;
+		run.stageBlocks = stageCounter(visualizer) - stages;
+	}
+}
+
+void printRuns(const char* label, const SegmentRun* runs) {
+	printf("%s\n  %-14s %6s %8s %6s %7s %5s %7s\n", label, "segment", "blocks", "rendered", "shows", "active", "idle", "stages");
+	SegmentRun total;
+	for (uint8_t s = 0; s < SEGMENTS; s++) {
+		const SegmentRun& r = runs[s];
+		printf("  %-14s %6u %8u %6u %7u %5u %7u\n", SIGNAL_WITH_GAPS[s].name, (unsigned)r.blocks, (unsigned)r.rendered,
+		       (unsigned)r.shows, (unsigned)r.active, (unsigned)r.idle, (unsigned)r.stageBlocks);
+		total.blocks += r.blocks;
+		total.rendered += r.rendered;
+		total.shows += r.shows;
+		total.stageBlocks += r.stageBlocks;
+	}
+	printf("  %-14s %6u %8u %6u %7s %5s %7u (always on: %u of each)\n", "total", (unsigned)total.blocks,
+	       (unsigned)total.rendered, (unsigned)total.shows, "", "", (unsigned)total.stageBlocks, (unsigned)total.blocks);
+}
+
+// What holds for any mode
+void checkRuns(const SegmentRun* runs) {
+	const uint32_t idleFrameBlocks = audioTest::IDLE_FRAME_MS / BLOCK_MS;
+	for (uint8_t s = 0; s < SEGMENTS; s++) {
+		const Segment& seg = SIGNAL_WITH_GAPS[s];
+		const SegmentRun& r = runs[s];
+		TEST_ASSERT_EQUAL_UINT32(r.blocks, r.active + r.idle);
+		// Idle blocks skip every analysis stage
+		TEST_ASSERT_EQUAL_UINT32(r.active, r.stageBlocks);
+		TEST_ASSERT_LESS_OR_EQUAL_UINT32(r.rendered, r.shows);
+
+		if (seg.music) {
+			// Wake-up on the first loud block; every block is drawn from there
+			TEST_ASSERT_LESS_OR_EQUAL_UINT32(1, r.idle);
+			TEST_ASSERT_EQUAL_UINT32(r.blocks, r.rendered);
+			if (s > 0 && runs[s - 1].idle > 0) TEST_ASSERT_EQUAL_UINT32(1, r.wakeBlocks);
+		} else if (seg.ms < myAudio::IDLE_ENTER_MS) {
+			TEST_ASSERT_EQUAL_UINT32(0, r.idle);
+			TEST_ASSERT_EQUAL_UINT32(r.blocks, r.rendered);
+		} else {
+			// Idle after IDLE_ENTER_MS, then one frame per IDLE_FRAME_MS
+			const uint32_t activeBlocks = (myAudio::IDLE_ENTER_MS + BLOCK_MS - 1) / BLOCK_MS;
+			TEST_ASSERT_UINT32_WITHIN(2, activeBlocks, r.active);
+			TEST_ASSERT_LESS_OR_EQUAL_UINT32(r.active + r.idle / idleFrameBlocks + 1, r.rendered);
+			TEST_ASSERT_GREATER_OR_EQUAL_UINT32(r.active + r.idle / (idleFrameBlocks + 1), r.rendered);
+		}
+	}
+}
+
+void setUp() {
+	static bool started = false;
+	if (!started) {
+		FastLED[0].setLeds(leds, NUM_LEDS);
+		audioTest::initAudioTest(serpentine);
+		myAudio::audioSource->source = gappedSignal;
+		started = true;
+	}
+	srand(21);
+}
+
+void tearDown() {}
+
+void test_spectrum_goes_dark_and_stops_sending() {
+	SegmentRun runs[SEGMENTS];
+	runSignal(0, runs);
+	printRuns("Spectrum bars:", runs);
+	checkRuns(runs);
+
+	// Once the bars have fallen, an idle frame is the same as the last one
+	// shown, so the long silence sends almost nothing
+	const SegmentRun& longGap = runs[5];
+	TEST_ASSERT_LESS_THAN_UINT32(longGap.active + 20, longGap.shows);
+	TEST_ASSERT_GREATER_THAN_UINT32(longGap.shows + 50, longGap.rendered);
+}
+
+void test_fire_keeps_animating_at_the_idle_rate() {
+	SegmentRun runs[SEGMENTS];
+	runSignal(5, runs);
+	printRuns("Fire:", runs);
+	checkRuns(runs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_spectrum_goes_dark_and_stops_sending);
+	RUN_TEST(test_fire_keeps_animating_at_the_idle_rate);
+	return UNITY_END();
+}
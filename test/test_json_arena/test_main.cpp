@@ -0,0 +1,135 @@
+#include <unity.h>
+#include <stdio.h>
+
+#include "jsonArena.h"
+
+//=============================================================================
+// JsonArena with ArduinoJson
+// jsonHeapFallbacks counts every block the arena had to take from the heap,
+// so it is the control plane's heap allocation count: it must stay at zero
+// for the messages the firmware actually parses and builds, however many
+// of them go through one document.
+//=============================================================================
+
+constexpr int MESSAGES = 10000;
+
+void setUp() {
+	jsonHeapFallbacks = 0;
+}
+
+void tearDown() {}
+
+// The three JSON characteristics, parsed into one reused document like receivedJSON
+void test_control_writes_never_touch_the_heap() {
+	static JsonArena<jsonArenaSize(512)> arena;
+	ArduinoJson::JsonDocument doc(&arena);
+	const char* messages[] = {
+		"{\"id\":\"cx5\",\"val\":true}",
+		"{\"id\":\"inSpeed\",\"val\":0.734}",
+		"{\"id\":\"inColorPalette\",\"val\":12}",
+		"{\"id\":\"syncState\",\"val\":\"3141592653:1234\"}",
+		"{\"id\":\"presetExport\",\"val\":\"7\"}",
+	};
+
+	for (int n = 0; n < MESSAGES; n++) {
+		const char* msg = messages[n % 5];
+		TEST_ASSERT_TRUE(ArduinoJson::deserializeJson(doc, msg, strlen(msg)) == ArduinoJson::DeserializationError::Ok);
+		TEST_ASSERT_GREATER_THAN(0, arena.used());
+	}
+	TEST_ASSERT_EQUAL_UINT32(0, jsonHeapFallbacks);
+
+	const char* msg = "{\"id\":\"inSpeed\",\"val\":0.5}";
+	ArduinoJson::deserializeJson(doc, msg, strlen(msg));
+	TEST_ASSERT_EQUAL_STRING("inSpeed", doc["id"] | "");
+	TEST_ASSERT_EQUAL_FLOAT(0.5, doc["val"].as<double>());
+
+	// Releasing everything rewinds the arena
+	doc.clear();
+	TEST_ASSERT_EQUAL_size_t(0, arena.used());
+	TEST_ASSERT_EQUAL_UINT32(0, jsonHeapFallbacks);
+}
+
+// The parsed strings live in the arena and must survive the pool shrinking after the parse
+void test_values_survive_in_the_arena() {
+	static JsonArena<jsonArenaSize(512)> arena;
+	ArduinoJson::JsonDocument doc(&arena);
+	for (int n = 0; n < 100; n++) {
+		char msg[96];
+		char value[32];
+		snprintf(value, sizeof(value), "%d:%d", n * 7919, n);
+		snprintf(msg, sizeof(msg), "{\"id\":\"syncState\",\"val\":\"%s\",\"n\":%d}", value, n);
+		TEST_ASSERT_TRUE(ArduinoJson::deserializeJson(doc, msg, strlen(msg)) == ArduinoJson::DeserializationError::Ok);
+		TEST_ASSERT_EQUAL_STRING("syncState", doc["id"] | "");
+		TEST_ASSERT_EQUAL_STRING(value, doc["val"] | "");
+		TEST_ASSERT_EQUAL_INT(n, doc["n"].as<int>());
+	}
+	TEST_ASSERT_EQUAL_UINT32(0, jsonHeapFallbacks);
+}
+
+// Preset JSON at full size, built and parsed the way the preset worker does
+void test_preset_round_trip_fits_the_arena() {
+	static char json[3072];
+	static JsonArena<jsonArenaSize(sizeof(json))> arena;
+	const int params = 47;
+
+	for (int n = 0; n < 100; n++) {
+		size_t len;
+		{
+			ArduinoJson::JsonDocument preset(&arena);
+			preset["programNum"] = 0;
+			preset["modeNum"] = n % 10;
+			ArduinoJson::JsonObject values = preset["parameters"].to<ArduinoJson::JsonObject>();
+			for (int i = 0; i < params; i++) {
+				char key[24];
+				snprintf(key, sizeof(key), "Parameter%02d", i);
+				values[key] = 0.123456 * (i + n);
+			}
+			len = serializeJson(preset, json, sizeof(json));
+			TEST_ASSERT_LESS_THAN(sizeof(json) - 1, len);
+		}
+		TEST_ASSERT_EQUAL_size_t(0, arena.used());
+
+		ArduinoJson::JsonDocument preset(&arena);
+		TEST_ASSERT_TRUE(ArduinoJson::deserializeJson(preset, json, len) == ArduinoJson::DeserializationError::Ok);
+		ArduinoJson::JsonObjectConst values = preset["parameters"];
+		TEST_ASSERT_EQUAL_size_t(params, values.size());
+		TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.123456f * (3 + n), values["Parameter03"].as<float>());
+	}
+	TEST_ASSERT_EQUAL_UINT32(0, jsonHeapFallbacks);
+}
+
+// A message too big for the arena still parses; the fallback is counted and
+// the next small message is back in the arena
+void test_oversized_message_falls_back_and_recovers() {
+	static JsonArena<jsonArenaSize(256)> arena;
+	ArduinoJson::JsonDocument doc(&arena);
+
+	char big[2048];
+	const size_t prefix = snprintf(big, sizeof(big), "{\"id\":\"string\",\"val\":\"");
+	const size_t valueLen = 1500;
+	for (size_t i = 0; i < valueLen; i++) {
+		big[prefix + i] = 'a' + i % 26;
+	}
+	const size_t len = prefix + valueLen + snprintf(big + prefix + valueLen, sizeof(big) - prefix - valueLen, "\"}");
+
+	TEST_ASSERT_TRUE(ArduinoJson::deserializeJson(doc, big, len) == ArduinoJson::DeserializationError::Ok);
+	TEST_ASSERT_EQUAL_size_t(valueLen, strlen(doc["val"] | ""));
+	TEST_ASSERT_GREATER_THAN(0, jsonHeapFallbacks);
+
+	const uint32_t fallbacks = jsonHeapFallbacks;
+	const char* msg = "{\"id\":\"inSpeed\",\"val\":0.25}";
+	for (int n = 0; n < 100; n++) {
+		TEST_ASSERT_TRUE(ArduinoJson::deserializeJson(doc, msg, strlen(msg)) == ArduinoJson::DeserializationError::Ok);
+	}
+	TEST_ASSERT_EQUAL_FLOAT(0.25, doc["val"].as<double>());
+	TEST_ASSERT_EQUAL_UINT32(fallbacks, jsonHeapFallbacks);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_control_writes_never_touch_the_heap);
+	RUN_TEST(test_values_survive_in_the_arena);
+	RUN_TEST(test_preset_round_trip_fits_the_arena);
+	RUN_TEST(test_oversized_message_falls_back_and_recovers);
+	return UNITY_END();
+}
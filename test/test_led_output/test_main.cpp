@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <stdlib.h>
+
+#define NUM_LEDS 64
+#define NUM_SEGMENTS 1
+
+#include "ledOutput.h"
+
+CRGB leds[NUM_LEDS];
+
+//=============================================================================
+// Shadow-compare suppression in the LED output stage
+// The mock FastLED.show() only counts transmits, so each test drives
+// showFrame() with a known sequence of frames and checks which of them
+// actually went out on the wire.
+//=============================================================================
+
+void resetOutput() {
+	for (int i = 0; i < NUM_LEDS; i++) {
+		leds[i] = CRGB::Black;
+		ledOutput::lastShown[i] = CRGB::Black;
+	}
+	ledOutput::lastBrightness = 0;
+	ledOutput::primed = false;
+	ledOutput::framesShown = 0;
+	ledOutput::framesSkipped = 0;
+	ledOutput::partialFrames = 0;
+	ledOutput::busTimeSavedMs = 0;
+	ledOutput::busTimeSavedUs = 0;
+	FastLED = MockFastLED();
+	FastLED[0].setLeds(leds, NUM_LEDS);
+}
+
+void setUp() { resetOutput(); }
+void tearDown() {}
+
+void test_first_frame_is_always_sent() {
+	// All black matches the zeroed shadow, but nothing has been shown yet
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(1, FastLED.shows);
+	TEST_ASSERT_EQUAL_UINT32(1, ledOutput::framesShown);
+	TEST_ASSERT_EQUAL_UINT32(0, ledOutput::framesSkipped);
+}
+
+void test_unchanged_frames_are_skipped() {
+	leds[10] = CRGB::Red;
+	ledOutput::showFrame();
+	for (int i = 0; i < 9; i++) ledOutput::showFrame();
+
+	TEST_ASSERT_EQUAL_UINT32(1, FastLED.shows);
+	TEST_ASSERT_EQUAL_UINT32(1, ledOutput::framesShown);
+	TEST_ASSERT_EQUAL_UINT32(9, ledOutput::framesSkipped);
+}
+
+void test_changed_pixel_is_never_suppressed() {
+	ledOutput::showFrame();
+	srand(1234);
+	uint32_t expectedShows = 1;
+	for (int frame = 0; frame < 5000; frame++) {
+		// Mostly single-channel nudges by one step, the smallest change
+		// the compare has to catch, with some repeats mixed in
+		if (rand() % 4) {
+			CRGB& led = leds[rand() % NUM_LEDS];
+			switch (rand() % 3) {
+				case 0: led.r++; break;
+				case 1: led.g++; break;
+				default: led.b++; break;
+			}
+			expectedShows++;
+		}
+		ledOutput::showFrame();
+		TEST_ASSERT_EQUAL_UINT32(expectedShows, FastLED.shows);
+		TEST_ASSERT_EQUAL_MEMORY(leds, ledOutput::lastShown, sizeof(leds));
+	}
+	TEST_ASSERT_EQUAL_UINT32(5001, ledOutput::framesShown + ledOutput::framesSkipped);
+}
+
+void test_change_in_last_led_is_sent() {
+	ledOutput::showFrame();
+	leds[NUM_LEDS - 1].b = 1;
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(2, FastLED.shows);
+}
+
+void test_brightness_change_forces_a_frame() {
+	leds[0] = CRGB::White;
+	ledOutput::showFrame();
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(1, FastLED.shows);
+
+	FastLED.setBrightness(128);
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(2, FastLED.shows);
+
+	// Settled at the new brightness, so back to skipping
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(2, FastLED.shows);
+	TEST_ASSERT_EQUAL_UINT8(128, ledOutput::lastBrightness);
+}
+
+void test_invalidate_forces_a_frame() {
+	ledOutput::showFrame();
+	ledOutput::invalidate();
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(2, FastLED.shows);
+
+	ledOutput::showFrame();
+	TEST_ASSERT_EQUAL_UINT32(2, FastLED.shows);
+}
+
+void test_full_frames_without_partial_transmit() {
+	ledOutput::showFrame();
+	leds[3] = CRGB::Green;
+	ledOutput::showFrame();
+	if (!ledOutput::OUTPUT_PARTIAL_TRANSMIT) {
+		TEST_ASSERT_EQUAL_INT(NUM_LEDS, FastLED.lastShowCount);
+		TEST_ASSERT_EQUAL_UINT32(0, ledOutput::partialFrames);
+	} else {
+		TEST_ASSERT_EQUAL_INT(4, FastLED.lastShowCount);
+		TEST_ASSERT_EQUAL_UINT32(1, ledOutput::partialFrames);
+	}
+	// The controller is always left pointing at the whole strip
+	TEST_ASSERT_EQUAL_INT(NUM_LEDS, FastLED[0].count);
+}
+
+void test_skipped_frames_count_bus_time() {
+	ledOutput::showFrame();
+	for (int i = 0; i < 1000; i++) ledOutput::showFrame();
+
+	// 1000 skipped frames of NUM_LEDS LEDs at 30 us each
+	const uint32_t totalUs = 1000u * NUM_LEDS * ledOutput::WS2812_US_PER_LED;
+	TEST_ASSERT_EQUAL_UINT32(totalUs / 1000, ledOutput::busTimeSavedMs);
+	TEST_ASSERT_EQUAL_UINT32(totalUs % 1000, ledOutput::busTimeSavedUs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_first_frame_is_always_sent);
+	RUN_TEST(test_unchanged_frames_are_skipped);
+	RUN_TEST(test_changed_pixel_is_never_suppressed);
+	RUN_TEST(test_change_in_last_led_is_sent);
+	RUN_TEST(test_brightness_change_forces_a_frame);
+	RUN_TEST(test_invalidate_forces_a_frame);
+	RUN_TEST(test_full_frames_without_partial_transmit);
+	RUN_TEST(test_skipped_frames_count_bus_time);
+	return UNITY_END();
+}
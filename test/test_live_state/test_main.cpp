@@ -0,0 +1,242 @@
+#include <unity.h>
+#include <vector>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Live state write-behind on an in-memory LittleFS
+// A record that is cut short or has any byte changed must be rejected, and
+// power lost at any byte of a write must boot into either the previous or
+// the new state, never a mix and never the defaults.
+//=============================================================================
+
+// Every registry parameter to a distinct in-range value picked by seed
+void setAllParams(uint32_t seed) {
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		const ParamInfo& p = PARAM_REGISTRY[id];
+		const double t = ((seed * 37 + id * 13) % 100) / 100.0;
+		setParam(id, p.lo + (p.hi - p.lo) * t);
+	}
+	MODE = seed % MODE_COUNTS[AUDIOREACTIVE];
+}
+
+std::vector<double> snapshot() {
+	std::vector<double> values;
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		values.push_back(getParam(id));
+	}
+	values.push_back(MODE);
+	return values;
+}
+
+void assertState(const std::vector<double>& expected) {
+	const std::vector<double> actual = snapshot();
+	for (size_t i = 0; i < expected.size(); i++) {
+		TEST_ASSERT_TRUE_MESSAGE(expected[i] == actual[i], i < PID_COUNT ? PARAM_REGISTRY[i].wireId : "MODE");
+	}
+}
+
+// Runs whatever the render loop queued for the preset worker
+void runWorker() {
+	PresetJob job;
+	while (xQueueReceive(presetJobs, &job, 0) == pdTRUE) {
+		runPresetJob(job);
+	}
+}
+
+void writeState(const uint8_t* record, size_t len) {
+	memcpy(liveStateBuffer, record, len);
+	writeLiveStateFile(liveStateBuffer, len);
+}
+
+// Power cycle: the parameters go back to something else, then boot restores
+bool reboot() {
+	LittleFS.flash.reboot();
+	setAllParams(99);
+	return restoreLiveState();
+}
+
+void setUp() {
+	LittleFS.flash = fs::MockFlash();
+	if (presetJobs == NULL) startPresetWorker();
+	cGlideMs = 0;
+}
+
+void tearDown() {}
+
+void test_round_trip() {
+	setAllParams(1);
+	const std::vector<double> saved = snapshot();
+	uint8_t record[LIVE_STATE_MAX];
+	const size_t len = encodeLiveState(record, sizeof(record));
+	TEST_ASSERT_LESS_OR_EQUAL(LIVE_STATE_MAX, len);
+	TEST_ASSERT_TRUE(liveStateValid(record, len));
+
+	setAllParams(2);
+	applyLiveState(record, len);
+	assertState(saved);
+}
+
+void test_every_truncation_and_byte_flip_is_rejected() {
+	setAllParams(3);
+	uint8_t record[LIVE_STATE_MAX];
+	const size_t len = encodeLiveState(record, sizeof(record));
+
+	for (size_t n = 0; n < len; n++) {
+		TEST_ASSERT_FALSE_MESSAGE(liveStateValid(record, n), "truncated record accepted");
+	}
+	for (size_t i = 0; i < len; i++) {
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			record[i] ^= 1 << bit;
+			TEST_ASSERT_FALSE_MESSAGE(liveStateValid(record, len), "corrupted record accepted");
+			record[i] ^= 1 << bit;
+		}
+	}
+	TEST_ASSERT_TRUE(liveStateValid(record, len));
+}
+
+// Entries for parameters this build doesn't know, or that changed type, are skipped
+void test_unknown_and_retyped_entries_are_skipped() {
+	setAllParams(4);
+	const std::vector<double> saved = snapshot();
+	uint8_t record[LIVE_STATE_MAX];
+	size_t len = encodeLiveState(record, sizeof(record)) - 4;
+
+	// Entry 0 (Bright) gets a hash no parameter has; entry 1 (InputGain, one byte) claims to be a bool
+	record[LIVE_STATE_HEADER] ^= 0xFF;
+	record[LIVE_STATE_HEADER + 5 + 1 + 4] = PARAM_BOOL;
+	const uint32_t checksum = liveStateChecksum(record, len);
+	memcpy(&record[len], &checksum, 4);
+	len += 4;
+	TEST_ASSERT_TRUE(liveStateValid(record, len));
+
+	setAllParams(5);
+	const uint8_t bright = cBright;
+	const uint8_t gain = cInputGain;
+	applyLiveState(record, len);
+	TEST_ASSERT_EQUAL_UINT8(bright, cBright);
+	TEST_ASSERT_EQUAL_UINT8(gain, cInputGain);
+
+	// Everything after them still applies
+	TEST_ASSERT_TRUE(saved[PID_Speed] == cSpeed);
+	TEST_ASSERT_TRUE(saved[PID_DecayBase] == cDecayBase);
+	TEST_ASSERT_TRUE(saved[PID_TelemetryHz] == cTelemetryHz);
+}
+
+// Power is cut after every possible number of bytes of the second write
+void test_power_loss_mid_write_boots_a_whole_state() {
+	setAllParams(6);
+	const std::vector<double> before = snapshot();
+	uint8_t beforeRecord[LIVE_STATE_MAX];
+	const size_t beforeLen = encodeLiveState(beforeRecord, sizeof(beforeRecord));
+
+	setAllParams(7);
+	const std::vector<double> after = snapshot();
+	uint8_t afterRecord[LIVE_STATE_MAX];
+	const size_t afterLen = encodeLiveState(afterRecord, sizeof(afterRecord));
+
+	for (long budget = 0; budget <= (long)afterLen; budget++) {
+		LittleFS.flash = fs::MockFlash();
+		writeState(beforeRecord, beforeLen);
+
+		LittleFS.flash.writeBudget = budget;
+		writeState(afterRecord, afterLen);
+		TEST_ASSERT_TRUE_MESSAGE(reboot(), "no live state after power loss");
+
+		// The whole new record reached the flash only when the budget covered it
+		assertState(budget < (long)afterLen ? before : after);
+	}
+}
+
+// A complete temp file that missed its rename is newer than the live file
+void test_unrenamed_temp_file_wins_and_is_moved_into_place() {
+	setAllParams(8);
+	uint8_t oldRecord[LIVE_STATE_MAX];
+	const size_t oldLen = encodeLiveState(oldRecord, sizeof(oldRecord));
+	writeState(oldRecord, oldLen);
+
+	setAllParams(9);
+	const std::vector<double> newer = snapshot();
+	uint8_t newRecord[LIVE_STATE_MAX];
+	const size_t newLen = encodeLiveState(newRecord, sizeof(newRecord));
+	LittleFS.flash.files[LIVE_STATE_TEMP].assign(newRecord, newRecord + newLen);
+
+	TEST_ASSERT_TRUE(reboot());
+	assertState(newer);
+	TEST_ASSERT_FALSE(LittleFS.exists(LIVE_STATE_TEMP));
+
+	// And it is still there after the next boot
+	TEST_ASSERT_TRUE(reboot());
+	assertState(newer);
+}
+
+void test_nothing_on_flash_restores_nothing() {
+	TEST_ASSERT_FALSE(reboot());
+	LittleFS.flash.files[LIVE_STATE_FILE] = { 'L', 'S', LIVE_STATE_FORMAT_VERSION };
+	TEST_ASSERT_FALSE(reboot());
+}
+
+// Changes are written once they have been quiet for LIVE_STATE_QUIET_MS,
+// at most once per LIVE_STATE_MIN_INTERVAL_MS
+void test_writes_are_debounced() {
+	mockMillis = 100000;
+	persistLiveState();
+	runWorker();
+	const uint32_t writes = liveStateWrites;
+	const uint32_t renames = LittleFS.flash.renames;
+
+	// A burst of changes, one per frame
+	for (int i = 0; i < 60; i++) {
+		setParam(PID_Speed, i);
+		markParamDirty(PID_Speed);
+		persistLiveState();
+		mockMillis += 16;
+	}
+	runWorker();
+	TEST_ASSERT_EQUAL_UINT32(writes, liveStateWrites);
+
+	mockMillis += LIVE_STATE_QUIET_MS;
+	persistLiveState();
+	runWorker();
+	TEST_ASSERT_EQUAL_UINT32(writes + 1, liveStateWrites);
+	TEST_ASSERT_EQUAL_UINT32(renames + 1, LittleFS.flash.renames);
+
+	// Another change right away waits out the minimum interval
+	setParam(PID_Speed, 42);
+	markParamDirty(PID_Speed);
+	for (uint32_t t = 0; t < LIVE_STATE_MIN_INTERVAL_MS - LIVE_STATE_QUIET_MS; t += 500) {
+		persistLiveState();
+		runWorker();
+		mockMillis += 500;
+	}
+	TEST_ASSERT_EQUAL_UINT32(writes + 1, liveStateWrites);
+	mockMillis += LIVE_STATE_QUIET_MS;
+	persistLiveState();
+	runWorker();
+	TEST_ASSERT_EQUAL_UINT32(writes + 2, liveStateWrites);
+
+	// What was written is the latest state
+	const std::vector<double> latest = snapshot();
+	TEST_ASSERT_TRUE(reboot());
+	assertState(latest);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_round_trip);
+	RUN_TEST(test_every_truncation_and_byte_flip_is_rejected);
+	RUN_TEST(test_unknown_and_retyped_entries_are_skipped);
+	RUN_TEST(test_power_loss_mid_write_boots_a_whole_state);
+	RUN_TEST(test_unrenamed_temp_file_wins_and_is_moved_into_place);
+	RUN_TEST(test_nothing_on_flash_restores_nothing);
+	RUN_TEST(test_writes_are_debounced);
+	return UNITY_END();
+}
@@ -0,0 +1,255 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "audioLowBand.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Decimated low band against a full-rate FFT of the same resolution
+// The reference keeps the last 2048 full-rate samples and runs a 2048-point
+// Hann float FFT over them: 21.5 Hz bins over the same 46 ms window as the
+// decimated 256-point path. Its bins are summed over the analyser's band
+// edges, so both must report the same band levels (the reference scaled by
+// 1/8 for the 8x samples) up to the decimation filter and Q15 rounding.
+// A 512-point full-rate FFT at 86 Hz/bin is shown for comparison: it can't
+// tell the bass bands apart. The benchmark times one 512-sample block of
+// each path.
+//=============================================================================
+
+constexpr uint16_t BLOCK = 512;
+constexpr uint16_t REF_SIZE = 2048;
+constexpr uint8_t REF_LOG2 = 11;
+constexpr int BLOCKS = 4000;
+constexpr float BAND_TOLERANCE = 0.05f;		// of the loudest band
+
+LowBandAnalyzer lowBand;
+int16_t pcm[BLOCK];
+uint32_t sampleIndex = 0;
+
+//=============================================================================
+// Full-rate reference
+//=============================================================================
+
+struct FullRateFFT {
+	int16_t ring[REF_SIZE] = {};
+	uint16_t write = 0;
+	float window[REF_SIZE];
+	float cosTable[REF_SIZE / 2];
+	float sinTable[REF_SIZE / 2];
+	float re[REF_SIZE];
+	float im[REF_SIZE];
+	float mag[REF_SIZE / 2];
+
+	FullRateFFT() {
+		for (uint16_t i = 0; i < REF_SIZE; i++) window[i] = 0.5f - 0.5f * cosf(2.0f * float(M_PI) * i / REF_SIZE);
+		for (uint16_t i = 0; i < REF_SIZE / 2; i++) {
+			cosTable[i] = cosf(2.0f * float(M_PI) * i / REF_SIZE);
+			sinTable[i] = -sinf(2.0f * float(M_PI) * i / REF_SIZE);
+		}
+	}
+
+	static uint16_t bitReverse(uint16_t v) {
+		uint16_t r = 0;
+		for (uint8_t b = 0; b < REF_LOG2; b++) {
+			r = (r << 1) | (v & 1);
+			v >>= 1;
+		}
+		return r;
+	}
+
+	void process(const int16_t* in, uint16_t n) {
+		for (uint16_t i = 0; i < n; i++) {
+			ring[write] = in[i];
+			write = (write + 1) & (REF_SIZE - 1);
+		}
+		for (uint16_t i = 0; i < REF_SIZE; i++) {
+			const uint16_t dst = bitReverse(i);
+			re[dst] = ring[(write + i) & (REF_SIZE - 1)] * window[i] * (1.0f / 32768.0f);
+			im[dst] = 0.0f;
+		}
+		for (uint16_t len = 2; len <= REF_SIZE; len <<= 1) {
+			const uint16_t half = len >> 1;
+			const uint16_t step = REF_SIZE / len;
+			for (uint16_t i = 0; i < REF_SIZE; i += len) {
+				for (uint16_t j = 0; j < half; j++) {
+					const float wr = cosTable[j * step];
+					const float wi = sinTable[j * step];
+					const uint16_t a = i + j;
+					const uint16_t b = a + half;
+					const float tr = re[b] * wr - im[b] * wi;
+					const float ti = re[b] * wi + im[b] * wr;
+					re[b] = re[a] - tr;
+					im[b] = im[a] - ti;
+					re[a] += tr;
+					im[a] += ti;
+				}
+			}
+		}
+		for (uint16_t k = 0; k < REF_SIZE / 2; k++) mag[k] = sqrtf(re[k] * re[k] + im[k] * im[k]);
+	}
+
+	// Sum over [fLo, fHi) at this FFT's resolution, scaled to the 256-point path
+	float bandLevel(float fLo, float fHi, uint16_t size) const {
+		const float binHz = LOWBAND_INPUT_RATE / float(size);
+		const uint16_t step = REF_SIZE / size;
+		float sum = 0.0f;
+		for (uint16_t k = static_cast<uint16_t>(lrintf(fLo / binHz)); k < static_cast<uint16_t>(lrintf(fHi / binHz)); k++) {
+			sum += mag[k * step];
+		}
+		return sum / LOWBAND_DECIMATION;
+	}
+};
+
+FullRateFFT reference;
+
+// The analyser's band edges in Hz, rebuilt from its centres: edges are
+// whole bins, so centre = (lo + hi) / 2 gives them back in order
+float bandEdgeHz[LOWBAND_NUM_BANDS + 1];
+
+void buildBandEdges() {
+	const float binHz = LOWBAND_RATE / LOWBAND_FFT_SIZE;
+	bandEdgeHz[0] = lrintf(LOWBAND_MIN_FREQ / binHz) * binHz;
+	for (uint8_t b = 0; b < LOWBAND_NUM_BANDS; b++) {
+		bandEdgeHz[b + 1] = 2.0f * lowBand.bandFrequency(b) - bandEdgeHz[b];
+	}
+}
+
+struct Tone {
+	float hz;
+	float amplitude;
+};
+
+void fillBlock(const Tone* tones, uint8_t count) {
+	for (uint16_t i = 0; i < BLOCK; i++, sampleIndex++) {
+		const float t = sampleIndex / float(LOWBAND_INPUT_RATE);
+		float s = 0.0f;
+		for (uint8_t j = 0; j < count; j++) s += tones[j].amplitude * sinf(2.0f * float(M_PI) * tones[j].hz * t);
+		s += rand() % 64 - 32;
+		pcm[i] = static_cast<int16_t>(lrintf(s));
+	}
+}
+
+// Runs both paths until their windows hold only this signal
+void play(const Tone* tones, uint8_t count) {
+	for (int b = 0; b < 8; b++) {
+		fillBlock(tones, count);
+		lowBand.process(pcm, BLOCK, sampleIndex / 44);
+		reference.process(pcm, BLOCK);
+	}
+}
+
+uint8_t loudestBand() {
+	uint8_t best = 0;
+	for (uint8_t b = 1; b < LOWBAND_NUM_BANDS; b++) {
+		if (lowBand.band(b) > lowBand.band(best)) best = b;
+	}
+	return best;
+}
+
+void setUp() {
+	srand(27);
+	lowBand.reset();
+	buildBandEdges();
+}
+void tearDown() {}
+
+// Bass-heavy mix: every band within tolerance of the full-rate reference
+void test_bands_match_full_rate_reference() {
+	const Tone mix[] = { { 36.0f, 6000.0f }, { 62.0f, 9000.0f }, { 98.0f, 4000.0f },
+	                     { 180.0f, 3000.0f }, { 330.0f, 2000.0f }, { 1500.0f, 5000.0f } };
+	play(mix, 6);
+
+	float loudest = 0.0f;
+	for (uint8_t b = 0; b < LOWBAND_NUM_BANDS; b++) {
+		loudest = fmaxf(loudest, reference.bandLevel(bandEdgeHz[b], bandEdgeHz[b + 1], REF_SIZE));
+	}
+	for (uint8_t b = 0; b < LOWBAND_NUM_BANDS; b++) {
+		const float ref = reference.bandLevel(bandEdgeHz[b], bandEdgeHz[b + 1], REF_SIZE);
+		printf("band %u (%3.0f-%3.0f Hz): decimated %.3f, full-rate 2048 %.3f\n",
+		       b, bandEdgeHz[b], bandEdgeHz[b + 1], lowBand.band(b), ref);
+		TEST_ASSERT_FLOAT_WITHIN(BAND_TOLERANCE * loudest, ref, lowBand.band(b));
+	}
+}
+
+// A tone on each band's first bin is loudest in that band (most bands are
+// a single 21.5 Hz bin wide); at 86 Hz/bin the full-rate 512-point FFT puts
+// whole groups of bands on the same bins
+void test_resolution() {
+	uint8_t resolved512 = 0;
+	for (uint8_t b = 0; b < LOWBAND_NUM_BANDS; b++) {
+		const Tone tone = { bandEdgeHz[b], 8000.0f };
+		play(&tone, 1);
+		TEST_ASSERT_EQUAL_UINT8(b, loudestBand());
+
+		float best = 0.0f;
+		uint8_t bestBand = 0;
+		for (uint8_t c = 0; c < LOWBAND_NUM_BANDS; c++) {
+			const float level = reference.bandLevel(bandEdgeHz[c], bandEdgeHz[c + 1], BLOCK);
+			if (level > best) { best = level; bestBand = c; }
+		}
+		resolved512 += bestBand == b;
+	}
+	printf("Tones placed in their own band: decimated 256 %u/%u, full-rate 512 %u/%u\n",
+	       LOWBAND_NUM_BANDS, LOWBAND_NUM_BANDS, resolved512, LOWBAND_NUM_BANDS);
+	TEST_ASSERT_LESS_THAN_UINT8(LOWBAND_NUM_BANDS / 2, resolved512);
+}
+
+// The decimator passes the bass at unity and stops what would alias
+void test_decimator_response() {
+	PolyphaseDecimator decimator;
+	int16_t out[BLOCK / LOWBAND_DECIMATION + 1];
+	const float tones[] = { 60.0f, 400.0f, 4000.0f, 9000.0f };
+	for (float hz : tones) {
+		decimator.reset();
+		int32_t peak = 0;
+		for (int b = 0; b < 8; b++) {
+			for (uint16_t i = 0; i < BLOCK; i++) {
+				pcm[i] = static_cast<int16_t>(lrintf(16000.0f * sinf(2.0f * float(M_PI) * hz * (b * BLOCK + i) / LOWBAND_INPUT_RATE)));
+			}
+			const uint16_t got = decimator.process(pcm, BLOCK, out);
+			TEST_ASSERT_EQUAL_UINT16(BLOCK / LOWBAND_DECIMATION, got);
+			for (uint16_t i = 0; b > 1 && i < got; i++) peak = abs(out[i]) > peak ? abs(out[i]) : peak;
+		}
+		printf("%5.0f Hz: decimated peak %ld of 16000\n", hz, (long)peak);
+		if (hz <= 400.0f) TEST_ASSERT_INT_WITHIN(400, 16000, peak);
+		else TEST_ASSERT_LESS_THAN(800, peak);
+	}
+}
+
+void test_block_benchmark() {
+	const Tone mix[] = { { 55.0f, 8000.0f }, { 440.0f, 3000.0f } };
+	fillBlock(mix, 2);
+	volatile float sink = 0.0f;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BLOCKS; b++) {
+		pcm[b & (BLOCK - 1)] ^= 1;
+		lowBand.process(pcm, BLOCK, b * 12);
+		sink += lowBand.band(1);
+	}
+	const double decimatedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BLOCKS; b++) {
+		pcm[b & (BLOCK - 1)] ^= 1;
+		reference.process(pcm, BLOCK);
+		sink += reference.mag[3];
+	}
+	const double fullRateNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	printf("Per %u-sample block at 21.5 Hz/bin: decimate + 256-point FFT %.0f ns, 2048-point full-rate FFT %.0f ns\n",
+	       BLOCK, decimatedNs, fullRateNs);
+	TEST_ASSERT_TRUE(decimatedNs < fullRateNs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_bands_match_full_rate_reference);
+	RUN_TEST(test_resolution);
+	RUN_TEST(test_decimator_response);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
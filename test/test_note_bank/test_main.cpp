@@ -0,0 +1,179 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "audioFFTQ15.h"
+#include "audioNoteBank.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Note filterbank: CSR against a dense matrix
+// The reference builds the same filters in double from their definition
+// (triangles on equal-tempered notes, two-bin interpolation where a note is
+// narrower than a bin) as full 256-bin rows, normalized like the bank's.
+// Both run on the same random spectra and may differ only by the Q15
+// rounding of the weights. The benchmark times one apply() of the CSR bank
+// against the same filters as a dense Q15 matrix.
+//=============================================================================
+
+constexpr uint16_t BINS = Q15_FFT_COMPLEX;
+constexpr float BIN_HZ = Q15_FFT_SAMPLE_RATE / Q15_FFT_SIZE;
+constexpr int SPECTRA = 200;
+constexpr int APPLIES = 20000;
+constexpr uint16_t NOTE_TOLERANCE = 4;		// Q15 rounding of the weights plus the final truncation
+
+NoteFilterBank bank;
+double weight[NOTE_MAX_ROWS][BINS];
+uint16_t dense[NOTE_MAX_ROWS][BINS];
+uint8_t denseRows;
+uint16_t mag[BINS];
+uint16_t denseNote[NOTE_MAX_ROWS];
+
+// Row r is the note r steps above G3, up to D8
+void buildDense(uint8_t perOctave) {
+	memset(weight, 0, sizeof(weight));
+	const double ratio = pow(2.0, 1.0 / perOctave);
+	const int g3 = perOctave == 24 ? -28 : -14;		// steps from A4
+	denseRows = 0;
+	for (int r = 0; r < NOTE_MAX_ROWS; r++) {
+		const double fc = 440.0 * pow(2.0, double(g3 + r) / perOctave);
+		if (fc > NOTE_MAX_FREQ * 1.001) break;
+		const double fLo = fc / ratio;
+		const double fHi = fc * ratio;
+		int inside = 0;
+		for (uint16_t k = 0; k < BINS; k++) {
+			const double f = k * BIN_HZ;
+			const double tri = f <= fc ? (f - fLo) / (fc - fLo) : (fHi - f) / (fHi - fc);
+			if (tri > 0.0) { weight[r][k] = tri; inside++; }
+		}
+		if (inside < 2) {
+			memset(weight[r], 0, sizeof(weight[r]));
+			const double pos = fc / BIN_HZ;
+			const uint16_t k0 = static_cast<uint16_t>(pos);
+			weight[r][k0] = 1.0 - (pos - k0);
+			weight[r][k0 + 1] = pos - k0;
+		}
+		double sum = 0.0;
+		for (uint16_t k = 0; k < BINS; k++) sum += weight[r][k];
+		for (uint16_t k = 0; k < BINS; k++) {
+			weight[r][k] /= sum;
+			dense[r][k] = static_cast<uint16_t>(lrint(weight[r][k] * 32767.0));
+		}
+		denseRows = r + 1;
+	}
+}
+
+uint16_t denseNonZeros() {
+	uint16_t n = 0;
+	for (uint8_t r = 0; r < denseRows; r++) {
+		for (uint16_t k = 0; k < BINS; k++) n += dense[r][k] != 0;
+	}
+	return n;
+}
+
+// The multiply the CSR layout saves: every row against every bin
+void applyDense(const uint16_t* magnitudes) {
+	for (uint8_t r = 0; r < denseRows; r++) {
+		uint32_t acc = 0;
+		for (uint16_t k = 0; k < BINS; k++) {
+			acc += static_cast<uint32_t>(magnitudes[k]) * dense[r][k];
+		}
+		denseNote[r] = static_cast<uint16_t>(acc >> 15);
+	}
+}
+
+// Spectra like the STFT's: a few strong peaks over a low noise floor
+void fillSpectrum() {
+	for (uint16_t k = 0; k < BINS; k++) mag[k] = rand() % 300;
+	for (int p = 0; p < 6; p++) mag[1 + rand() % (BINS - 1)] = 2000 + rand() % 30000;
+}
+
+void setUp() { srand(11); }
+void tearDown() {}
+
+void checkAgainstDense(uint8_t perOctave) {
+	bank.init(perOctave, BIN_HZ, BINS);
+	buildDense(perOctave);
+	TEST_ASSERT_EQUAL_UINT8(denseRows, bank.rows());
+	TEST_ASSERT_EQUAL_UINT16(denseNonZeros(), bank.nonZeros());
+
+	uint16_t worst = 0;
+	for (int s = 0; s < SPECTRA; s++) {
+		fillSpectrum();
+		bank.apply(mag);
+		applyDense(mag);
+		for (uint8_t r = 0; r < denseRows; r++) {
+			TEST_ASSERT_UINT16_WITHIN(NOTE_TOLERANCE, denseNote[r], bank.note(r));
+			double exact = 0.0;
+			for (uint16_t k = 0; k < BINS; k++) exact += mag[k] * weight[r][k];
+			const uint16_t err = static_cast<uint16_t>(fabs(exact - bank.note(r)) + 0.5);
+			if (err > worst) worst = err;
+			TEST_ASSERT_UINT16_WITHIN(NOTE_TOLERANCE, static_cast<uint16_t>(lrint(exact)), bank.note(r));
+		}
+	}
+	printf("%u/octave: worst note error %u\n", perOctave, worst);
+}
+
+void test_csr_matches_dense_12() {
+	checkAgainstDense(12);
+	TEST_ASSERT_EQUAL_UINT8(56, bank.rows());
+}
+
+void test_csr_matches_dense_24() {
+	checkAgainstDense(24);
+	TEST_ASSERT_EQUAL_UINT8(111, bank.rows());
+}
+
+// A peak on a note's centre lands in that note's pitch class
+void test_peak_sets_the_pitch_class() {
+	bank.init(12, BIN_HZ, BINS);
+	const float a5 = 880.0f / BIN_HZ;		// between bins 10 and 11
+	memset(mag, 0, sizeof(mag));
+	mag[static_cast<uint16_t>(a5)] = 20000;
+	mag[static_cast<uint16_t>(a5) + 1] = 20000;
+	bank.apply(mag);
+	TEST_ASSERT_EQUAL_UINT8(9, bank.dominantPitchClass());
+}
+
+void benchmark(uint8_t perOctave) {
+	bank.init(perOctave, BIN_HZ, BINS);
+	buildDense(perOctave);
+	fillSpectrum();
+	volatile uint32_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < APPLIES; i++) {
+		mag[i & 255] ^= 1;
+		bank.apply(mag);
+		sink += bank.note(0);
+	}
+	const double csrNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / APPLIES;
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < APPLIES; i++) {
+		mag[i & 255] ^= 1;
+		applyDense(mag);
+		sink += denseNote[0];
+	}
+	const double denseNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / APPLIES;
+
+	printf("%u/octave: %u rows, %u non-zeros vs %u dense MACs; apply %.0f ns CSR, %.0f ns dense\n",
+	       perOctave, bank.rows(), bank.nonZeros(), bank.rows() * BINS, csrNs, denseNs);
+	TEST_ASSERT_LESS_THAN(bank.rows() * BINS / 20, bank.nonZeros());
+	TEST_ASSERT_TRUE(csrNs < denseNs);
+}
+
+void test_apply_benchmark() {
+	benchmark(12);
+	benchmark(24);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_csr_matches_dense_12);
+	RUN_TEST(test_csr_matches_dense_24);
+	RUN_TEST(test_peak_sets_the_pitch_class);
+	RUN_TEST(test_apply_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,260 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Parameter ramps against a per-parameter scan
+// The reference is the obvious layout: a ramp slot for every registry entry,
+// all PID_COUNT of them checked every frame, with the phase and the value
+// worked out in double. Driven with the same starts, retargets, cancels and
+// frames, the pool has to hold the same set of ramps, finish them on the
+// same frame with the exact double target, refuse starts once it is full,
+// and write in-between values within what its float phase costs. The
+// benchmark times update() per frame with 0 to PARAM_RAMP_SLOTS ramps in
+// flight against the scan, so the cost can be read against the number of
+// active ramps rather than the number of parameters.
+//=============================================================================
+
+constexpr uint8_t SLOTS = PARAM_RAMP_SLOTS;
+constexpr uint32_t FRAME_MS = 16;
+constexpr int FRAMES = 5000;
+constexpr int BENCH_FRAMES = 20000;
+constexpr uint8_t CURVES = 10;
+constexpr uint32_t BENCH_DURATION_MS = 0xF0000000u;	// never finishes in the run
+constexpr uint32_t BENCH_STEP_MS = 65536;			// sweeps a third of the curve
+constexpr uint8_t ACTIVE_COUNTS[] = { 0, 1, 4, 16, 32, SLOTS };
+
+struct PerParameterRamps {
+	bool active[PID_COUNT] = {};
+	uint8_t curve[PID_COUNT];
+	uint32_t start[PID_COUNT];
+	uint32_t duration[PID_COUNT];
+	float from[PID_COUNT];
+	double to[PID_COUNT];
+	uint8_t count = 0;
+
+	bool begin(uint8_t id, float f, double t, uint32_t now, uint32_t durationMs, fl::EaseType c) {
+		if (!active[id]) {
+			if (count >= SLOTS) return false;
+			active[id] = true;
+			count++;
+		}
+		curve[id] = c;
+		start[id] = now;
+		duration[id] = durationMs ? durationMs : 1;
+		from[id] = f;
+		to[id] = t;
+		return true;
+	}
+
+	void cancel(uint8_t id) {
+		if (active[id]) {
+			active[id] = false;
+			count--;
+		}
+	}
+
+	template <typename Write>
+	void update(uint32_t now, Write&& write) {
+		for (uint8_t id = 0; id < PID_COUNT; id++) {
+			if (!active[id]) continue;
+			const uint32_t elapsed = now - start[id];
+			if (elapsed >= duration[id]) {
+				write(id, to[id]);
+				active[id] = false;
+				count--;
+				continue;
+			}
+			const uint16_t phase = static_cast<uint16_t>(elapsed * 65535.0 / duration[id]);
+			const uint16_t eased = fl::ease16(static_cast<fl::EaseType>(curve[id]), phase);
+			write(id, from[id] + (to[id] - from[id]) * eased / 65535.0);
+		}
+	}
+};
+
+RampPool<SLOTS> pool;
+PerParameterRamps reference;
+double poolValues[PID_COUNT];
+double referenceValues[PID_COUNT];
+
+// A target in [-1000, 1000) that float can't hold exactly
+double randomTarget() {
+	return (rand() % 2000000 - 1000000) / 1000.0 + 1.0 / 3.0;
+}
+
+// From a frame up to a few seconds, now and then zero (stored as 1 ms)
+uint32_t randomDuration() {
+	return rand() % 8 == 0 ? 0 : 1 + rand() % 3000;
+}
+
+void setUp() {
+	srand(47);
+	pool.clear();
+	reference = PerParameterRamps();
+	for (uint8_t id = 0; id < PID_COUNT; id++) poolValues[id] = referenceValues[id] = 0.0;
+}
+void tearDown() {}
+
+void test_matches_the_per_parameter_scan() {
+	uint32_t now = 1000;
+	uint32_t started = 0, refused = 0;
+	float worst = 0.0f;
+
+	for (int f = 0; f < FRAMES; f++) {
+		// Mostly a few writes per frame; now and then a preset morph writes
+		// every parameter, more than the pool holds
+		const bool morph = f % 400 == 0;
+		const uint8_t writes = morph ? PID_COUNT : rand() % 4;
+		for (uint8_t w = 0; w < writes; w++) {
+			const uint8_t id = morph ? w : rand() % PID_COUNT;
+			if (rand() % 10 == 0) {
+				// A direct set, as rampParam() does with a zero glide
+				pool.cancel(id);
+				reference.cancel(id);
+				poolValues[id] = referenceValues[id] = randomTarget();
+				continue;
+			}
+			// Retargets start from where the ramp has got to, as rampParam() does
+			const float from = static_cast<float>(poolValues[id]);
+			const double to = randomTarget();
+			const uint32_t duration = randomDuration();
+			const fl::EaseType curve = static_cast<fl::EaseType>(rand() % CURVES);
+			const bool accepted = pool.start(id, from, to, now, duration, curve);
+			TEST_ASSERT_EQUAL(reference.begin(id, from, to, now, duration, curve), accepted);
+			started += accepted;
+			refused += !accepted;
+		}
+
+		now += FRAME_MS + rand() % 3;
+		pool.update(now, [](uint8_t id, double v) { poolValues[id] = v; });
+		reference.update(now, [](uint8_t id, double v) { referenceValues[id] = v; });
+		TEST_ASSERT_EQUAL_UINT8(reference.count, pool.count());
+
+		for (uint8_t id = 0; id < PID_COUNT; id++) {
+			TEST_ASSERT_EQUAL(reference.active[id], pool.active(id));
+			if (!reference.active[id]) {
+				// Finished, set directly or never started: the exact double both times
+				TEST_ASSERT_TRUE(poolValues[id] == referenceValues[id]);
+				continue;
+			}
+			double target;
+			TEST_ASSERT_TRUE(pool.target(id, target));
+			TEST_ASSERT_TRUE(target == reference.to[id]);
+			// A float phase and value: a few phase steps on the steepest curve
+			const double delta = fabs(reference.to[id] - reference.from[id]);
+			const double error = fabs(poolValues[id] - referenceValues[id]);
+			TEST_ASSERT_TRUE(error <= delta * 1e-3 + 1e-3);
+			if (delta > 0.0 && error / delta > worst) worst = static_cast<float>(error / delta);
+		}
+	}
+
+	// Let everything run out
+	now += 4000;
+	pool.update(now, [](uint8_t id, double v) { poolValues[id] = v; });
+	reference.update(now, [](uint8_t id, double v) { referenceValues[id] = v; });
+	TEST_ASSERT_EQUAL_UINT8(0, pool.count());
+	for (uint8_t id = 0; id < PID_COUNT; id++) TEST_ASSERT_TRUE(poolValues[id] == referenceValues[id]);
+
+	printf("%d frames over %u parameters: %lu ramps started, %lu refused at %u slots, "
+	       "worst in-between error %.2g of the ramp's span\n",
+	       FRAMES, PID_COUNT, (unsigned long)started, (unsigned long)refused, SLOTS, worst);
+	TEST_ASSERT_GREATER_THAN(0, refused);
+}
+
+// A double target isn't rounded through float on the way
+void test_finished_ramp_writes_the_exact_target() {
+	const double to = 0.1;
+	TEST_ASSERT_TRUE(pool.start(3, 0.5f, to, 100, 250, fl::EASE_IN_OUT_CUBIC));
+	double value = -1.0;
+	pool.update(349, [&](uint8_t, double v) { value = v; });
+	TEST_ASSERT_TRUE(value != to);
+	TEST_ASSERT_TRUE(pool.active(3));
+	pool.update(350, [&](uint8_t, double v) { value = v; });
+	TEST_ASSERT_TRUE(value == to);
+	TEST_ASSERT_FALSE(pool.active(3));
+}
+
+// Retargeting keeps one slot per id; a full pool refuses new ids only
+void test_retarget_and_full_pool() {
+	for (uint8_t id = 0; id < SLOTS; id++) {
+		TEST_ASSERT_TRUE(pool.start(id, 0.0f, 1.0, 0, 1000, fl::EASE_NONE));
+	}
+	TEST_ASSERT_TRUE(pool.start(5, 0.5f, 2.0, 10, 1000, fl::EASE_NONE));
+	TEST_ASSERT_EQUAL_UINT8(SLOTS, pool.count());
+	TEST_ASSERT_FALSE(pool.start(SLOTS, 0.0f, 1.0, 10, 1000, fl::EASE_NONE));
+	double target;
+	TEST_ASSERT_TRUE(pool.target(5, target));
+	TEST_ASSERT_TRUE(target == 2.0);
+	pool.cancel(0);
+	TEST_ASSERT_TRUE(pool.start(SLOTS, 0.0f, 1.0, 10, 1000, fl::EASE_NONE));
+}
+
+// Ramps that never finish, on parameters spread over the registry
+void startRamps(uint8_t active) {
+	uint8_t ids[PID_COUNT];
+	for (uint8_t i = 0; i < PID_COUNT; i++) ids[i] = i;
+	for (uint8_t i = PID_COUNT - 1; i > 0; i--) {
+		const uint8_t j = rand() % (i + 1);
+		const uint8_t t = ids[i];
+		ids[i] = ids[j];
+		ids[j] = t;
+	}
+	pool.clear();
+	reference = PerParameterRamps();
+	for (uint8_t k = 0; k < active; k++) {
+		const double to = randomTarget();
+		const fl::EaseType curve = static_cast<fl::EaseType>(rand() % CURVES);
+		TEST_ASSERT_TRUE(pool.start(ids[k], 0.0f, to, 0, BENCH_DURATION_MS, curve));
+		TEST_ASSERT_TRUE(reference.begin(ids[k], 0.0f, to, 0, BENCH_DURATION_MS, curve));
+	}
+}
+
+template <typename Ramps>
+double timeUpdates(Ramps& ramps, double* values) {
+	const auto start = std::chrono::steady_clock::now();
+	for (int f = 1; f <= BENCH_FRAMES; f++) {
+		ramps.update(f * BENCH_STEP_MS, [values](uint8_t id, double v) { values[id] = v; });
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_FRAMES;
+}
+
+void test_update_cost_benchmark() {
+	volatile double sink = 0.0;
+	double poolNs[sizeof(ACTIVE_COUNTS)];
+	double scanNs[sizeof(ACTIVE_COUNTS)];
+
+	for (uint8_t a = 0; a < sizeof(ACTIVE_COUNTS); a++) {
+		startRamps(ACTIVE_COUNTS[a]);
+		poolNs[a] = timeUpdates(pool, poolValues);
+		scanNs[a] = timeUpdates(reference, referenceValues);
+		TEST_ASSERT_EQUAL_UINT8(ACTIVE_COUNTS[a], pool.count());
+		sink = sink + poolValues[a] + referenceValues[a];
+		printf("%2u active ramps: pool %6.1f ns per frame", ACTIVE_COUNTS[a], poolNs[a]);
+		if (ACTIVE_COUNTS[a]) printf(" (%.1f ns per ramp)", poolNs[a] / ACTIVE_COUNTS[a]);
+		printf(", scan of all %u parameters %6.1f ns\n", PID_COUNT, scanNs[a]);
+	}
+	// With nothing in flight the pool has nothing to walk; the scan still
+	// checks every parameter
+	TEST_ASSERT_TRUE(poolNs[0] < scanNs[0]);
+	TEST_ASSERT_TRUE(poolNs[0] < poolNs[sizeof(ACTIVE_COUNTS) - 1]);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_the_per_parameter_scan);
+	RUN_TEST(test_finished_ramp_writes_the_exact_target);
+	RUN_TEST(test_retarget_and_full_pool);
+	RUN_TEST(test_update_cost_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <ctype.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Parameter registry lookup and range checks
+// findParam() is a binary search over the compile-time hash index plus one
+// strcasecmp. The benchmark compares it with a strcmp chain over the wire
+// ids in table order, which is what processNumber/processCheckbox did
+// before the registry.
+//=============================================================================
+
+// Found offline: 8-char strings with the same paramHash as a registered id
+struct Collision {
+	const char* text;
+	uint8_t id;
+};
+const Collision COLLISIONS[] = {
+	{ "5o3xlbaa", PID_TimeDrift },
+	{ "kq4rmbaa", PID_AutoGain },
+	{ "z31w0baa", PID_SpeedInt }
+};
+
+// The pre-registry lookup: compare against every wire id in turn
+int findParamByStrcmpChain(const char* wireId) {
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		if (strcmp(PARAM_REGISTRY[id].wireId, wireId) == 0) return id;
+	}
+	return -1;
+}
+
+void resetDefaults() {
+	for (uint8_t id = 0; id < PID_COUNT; id++) setParam(id, PARAM_REGISTRY[id].def);
+}
+
+void setUp() { resetDefaults(); }
+void tearDown() {}
+
+void test_every_wire_id_resolves_to_itself() {
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		TEST_ASSERT_EQUAL_INT(id, findParam(PARAM_REGISTRY[id].wireId));
+		TEST_ASSERT_EQUAL_INT(id, findParamByHash(PARAM_REGISTRY[id].hash));
+	}
+}
+
+void test_lookup_ignores_case() {
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		std::string upper = PARAM_REGISTRY[id].wireId;
+		std::string mixed = upper;
+		for (size_t i = 0; i < upper.size(); i++) {
+			upper[i] = toupper(upper[i]);
+			if (i & 1) mixed[i] = toupper(mixed[i]);
+		}
+		TEST_ASSERT_EQUAL_INT(id, findParam(upper.c_str()));
+		TEST_ASSERT_EQUAL_INT(id, findParam(mixed.c_str()));
+	}
+}
+
+void test_unknown_ids_are_rejected() {
+	const char* unknown[] = { "", "in", "inSpee", "inSpeedX", "xinSpeed", "cx", "cx1", "cx99", "syncState", "presetSave" };
+	for (const char* wireId : unknown) {
+		TEST_ASSERT_EQUAL_INT_MESSAGE(-1, findParam(wireId), wireId);
+	}
+}
+
+// Same hash as a registered id, different text: the strcasecmp catches it
+void test_hash_collisions_are_rejected() {
+	for (const Collision& c : COLLISIONS) {
+		TEST_ASSERT_EQUAL_UINT32(PARAM_REGISTRY[c.id].hash, paramHash(c.text));
+		TEST_ASSERT_EQUAL_INT(c.id, findParamByHash(paramHash(c.text)));
+		TEST_ASSERT_EQUAL_INT(-1, findParam(c.text));
+	}
+}
+
+void test_set_param_clamps_to_range() {
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		const ParamInfo& p = PARAM_REGISTRY[id];
+		const float tolerance = 1e-6f * (1.0f + fabsf(p.lo) + fabsf(p.hi));
+
+		setParam(id, p.hi + 1000.0);
+		TEST_ASSERT_FLOAT_WITHIN(tolerance, p.hi, getParam(id));
+		TEST_ASSERT_FALSE(setParam(id, p.hi));		// already there
+
+		setParam(id, p.lo - 1000.0);
+		TEST_ASSERT_FLOAT_WITHIN(tolerance, p.lo, getParam(id));
+		TEST_ASSERT_FALSE(setParam(id, p.lo));
+
+		// Changing back to the default is reported unless it is the bound
+		TEST_ASSERT_EQUAL(p.def != p.lo, setParam(id, p.def));
+	}
+}
+
+void test_set_param_rejects_non_finite_values() {
+	for (uint8_t id = 0; id < PID_COUNT; id++) {
+		const double before = getParam(id);
+		TEST_ASSERT_FALSE(setParam(id, NAN));
+		TEST_ASSERT_FALSE(setParam(id, INFINITY));
+		TEST_ASSERT_FALSE(setParam(id, -INFINITY));
+		TEST_ASSERT_FLOAT_WITHIN(0.0f, before, getParam(id));
+	}
+	TEST_ASSERT_FALSE(setParam(PID_COUNT, 1.0));
+	TEST_ASSERT_FALSE(setParam(255, 1.0));
+}
+
+// Host timing over every wire id plus a miss; prints ns per lookup
+void test_lookup_benchmark() {
+	constexpr int ROUNDS = 20000;
+	const char* miss = "inNotAParameter";
+	volatile int sink = 0;
+
+	auto timeLookups = [&](int (*lookup)(const char*)) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < ROUNDS; r++) {
+			for (uint8_t id = 0; id < PID_COUNT; id++) sink = sink + lookup(PARAM_REGISTRY[id].wireId);
+			sink = sink + lookup(miss);
+		}
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		return ns / (ROUNDS * (PID_COUNT + 1.0));
+	};
+
+	const double chainNs = timeLookups(findParamByStrcmpChain);
+	const double registryNs = timeLookups(findParam);
+	printf("Lookup over %u ids: strcmp chain %.1f ns, hash index %.1f ns\n",
+	       (unsigned)PID_COUNT, chainNs, registryNs);
+	TEST_ASSERT_TRUE(registryNs < chainNs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_every_wire_id_resolves_to_itself);
+	RUN_TEST(test_lookup_ignores_case);
+	RUN_TEST(test_unknown_ids_are_rejected);
+	RUN_TEST(test_hash_collisions_are_rejected);
+	RUN_TEST(test_set_param_clamps_to_range);
+	RUN_TEST(test_set_param_rejects_non_finite_values);
+	RUN_TEST(test_lookup_benchmark);
+	return UNITY_END();
+}
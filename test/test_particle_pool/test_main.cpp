@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "particles.h"
+
+//=============================================================================
+// Particle pool against a vector of structs, and 1,000 live particles
+// The reference is the plain way to write it: one struct per particle in a
+// std::vector, the same Q8.8 arithmetic, dead particles erased in place so
+// order is kept. Every frame the pool must hold as many particles and
+// render the same frame (kill() swaps the last one into the hole, but
+// additive drawing doesn't depend on order), through spawns, deaths by
+// life and by leaving the panel, and a full pool dropping spawns. The
+// benchmark keeps 1,000 particles alive on a 48x32 panel and times
+// update() + render() per frame against the vector; topping the pool back
+// up and fading the frame are left out, as in the budget particles.h
+// quotes.
+//=============================================================================
+
+constexpr uint8_t W = 48;
+constexpr uint8_t H = 32;
+constexpr uint16_t CAPACITY = 1024;
+constexpr uint16_t LIVE = 1000;
+constexpr int FRAMES = 2000;
+constexpr int BENCH_FRAMES = 5000;
+
+struct Particle {
+	int16_t x, y, vx, vy, ay;
+	uint8_t hue, decay, life;
+};
+
+struct VectorParticles {
+	std::vector<Particle> particles;
+	size_t capacity = CAPACITY;
+
+	bool spawn(const ParticleSpawn& p) {
+		if (particles.size() >= capacity) return false;
+		particles.push_back({ p.x, p.y, p.vx, p.vy, p.ay, p.hue, static_cast<uint8_t>(p.decay ? p.decay : 1), 255 });
+		return true;
+	}
+
+	void update() {
+		for (size_t i = 0; i < particles.size();) {
+			Particle& p = particles[i];
+			p.vy += p.ay;
+			const int32_t x = p.x + p.vx;
+			const int32_t y = p.y + p.vy;
+			if (p.life <= p.decay || x < 0 || x >= W * 256 || y < 0 || y >= H * 256) {
+				particles.erase(particles.begin() + i);
+				continue;
+			}
+			p.x = static_cast<int16_t>(x);
+			p.y = static_cast<int16_t>(y);
+			p.life -= p.decay;
+			i++;
+		}
+	}
+
+	void render(CRGB* out, const CRGBPalette16& palette) const {
+		for (const Particle& p : particles) {
+			out[xy(p.x >> 8, p.y >> 8)] += ColorFromPalette(palette, p.hue, p.life);
+		}
+	}
+
+	static uint16_t xy(uint8_t x, uint8_t y) {
+		return (y & 1) ? y * W + (W - 1 - x) : y * W + x;
+	}
+};
+
+ParticlePool<CAPACITY, W, H> pool;
+VectorParticles reference;
+CRGBPalette16 palette(RainbowColors_p);
+CRGB frame[W * H];
+CRGB referenceFrame[W * H];
+
+// Anywhere on the panel, up to a third of a pixel per frame either way,
+// some under gravity
+ParticleSpawn randomSpawn() {
+	ParticleSpawn p;
+	p.x = rand() % (W * 256);
+	p.y = rand() % (H * 256);
+	p.vx = rand() % 161 - 80;
+	p.vy = rand() % 161 - 80;
+	p.ay = rand() % 4 == 0 ? rand() % 9 : 0;
+	p.hue = rand();
+	p.decay = rand() % 6;		// 0 is stored as 1
+	return p;
+}
+
+void renderBoth() {
+	fill_solid(frame, W * H, CRGB::Black);
+	fill_solid(referenceFrame, W * H, CRGB::Black);
+	pool.render(frame, VectorParticles::xy, palette);
+	reference.render(referenceFrame, palette);
+}
+
+void setUp() {
+	srand(39);
+	pool.clear();
+	reference.particles.clear();
+}
+void tearDown() {}
+
+// Same live count and the same frame every step; the frame is additive and
+// saturating, so the order particles are drawn in doesn't matter
+void test_matches_the_vector_reference() {
+	uint32_t spawned = 0, dropped = 0;
+	for (int f = 0; f < FRAMES; f++) {
+		// Bursts now and then push the pool past capacity
+		const uint16_t spawns = f % 100 == 0 ? 600 : rand() % 24;
+		for (uint16_t s = 0; s < spawns; s++) {
+			const ParticleSpawn p = randomSpawn();
+			const bool accepted = pool.spawn(p);
+			TEST_ASSERT_EQUAL(reference.spawn(p), accepted);
+			spawned += accepted;
+			dropped += !accepted;
+		}
+		pool.update();
+		reference.update();
+		TEST_ASSERT_EQUAL_UINT16(reference.particles.size(), pool.count());
+		renderBoth();
+		TEST_ASSERT_EQUAL_MEMORY(referenceFrame, frame, sizeof(frame));
+	}
+	printf("%d frames: %lu spawned, %lu dropped at capacity, same live count and frame throughout\n",
+	       FRAMES, (unsigned long)spawned, (unsigned long)dropped);
+	TEST_ASSERT_GREATER_THAN(0, dropped);
+}
+
+// One particle per pixel, each with its own hue, so a frame identifies
+// every live particle: killing from the middle swaps the last one in and
+// the survivors are exactly the expected set
+void test_kill_keeps_the_survivors() {
+	for (uint8_t x = 0; x < W; x++) {
+		ParticleSpawn p = {};
+		p.x = x << 8;
+		p.y = 5 << 8;
+		p.hue = x * 5;
+		p.decay = x % 2 ? 200 : 1;		// odd columns die on the second update
+		TEST_ASSERT_TRUE(pool.spawn(p));
+		TEST_ASSERT_TRUE(reference.spawn(p));
+	}
+	pool.update();
+	pool.update();
+	reference.update();
+	reference.update();
+	TEST_ASSERT_EQUAL_UINT16(W / 2, pool.count());
+	renderBoth();
+	TEST_ASSERT_EQUAL_MEMORY(referenceFrame, frame, sizeof(frame));
+	for (uint8_t x = 1; x < W; x += 2) {
+		TEST_ASSERT_TRUE(frame[VectorParticles::xy(x, 5)] == CRGB(CRGB::Black));
+	}
+}
+
+void test_frame_benchmark() {
+	reference.particles.reserve(CAPACITY);
+	volatile uint32_t sink = 0;
+	double updateNs = 0.0, renderNs = 0.0, vectorNs = 0.0;
+	uint32_t poolLive = 0, vectorLive = 0;
+
+	srand(390);
+	for (int f = 0; f < BENCH_FRAMES; f++) {
+		// Top back up to LIVE, as the emitters would
+		while (pool.count() < LIVE) pool.spawn(randomSpawn());
+		fadeToBlackBy(frame, W * H, 64);
+		const auto start = std::chrono::steady_clock::now();
+		pool.update();
+		const auto updated = std::chrono::steady_clock::now();
+		pool.render(frame, VectorParticles::xy, palette);
+		updateNs += std::chrono::duration<double, std::nano>(updated - start).count();
+		renderNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - updated).count();
+		poolLive += pool.count();
+		sink += frame[f % (W * H)].r;
+	}
+
+	srand(390);
+	for (int f = 0; f < BENCH_FRAMES; f++) {
+		while (reference.particles.size() < LIVE) reference.spawn(randomSpawn());
+		fadeToBlackBy(referenceFrame, W * H, 64);
+		const auto start = std::chrono::steady_clock::now();
+		reference.update();
+		reference.render(referenceFrame, palette);
+		vectorNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		vectorLive += reference.particles.size();
+		sink += referenceFrame[f % (W * H)].r;
+	}
+
+	updateNs /= BENCH_FRAMES;
+	renderNs /= BENCH_FRAMES;
+	vectorNs /= BENCH_FRAMES;
+	printf("%u live particles on %ux%u (mean %.0f after update): pool %.0f ns per frame (update %.0f + render %.0f, "
+	       "%.1f ns per particle), vector %.0f ns\n",
+	       LIVE, W, H, poolLive / double(BENCH_FRAMES), updateNs + renderNs, updateNs, renderNs,
+	       (updateNs + renderNs) / LIVE, vectorNs);
+	TEST_ASSERT_EQUAL_UINT32(poolLive, vectorLive);
+	TEST_ASSERT_TRUE(updateNs > 0.0);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_the_vector_reference);
+	RUN_TEST(test_kill_keeps_the_survivors);
+	RUN_TEST(test_frame_benchmark);
+	return UNITY_END();
+}
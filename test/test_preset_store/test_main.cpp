@@ -0,0 +1,331 @@
+#include <unity.h>
+#include <chrono>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Binary preset records on an in-memory LittleFS
+// The codec must reject any record that is cut short or malformed, and a
+// save interrupted by power loss at any byte must leave a whole preset,
+// the old one or the new one, on the flash. The benchmark times a preset
+// load from the RAM cache against decoding the binary file and against
+// parsing the JSON file, the way loads used to work.
+//=============================================================================
+
+constexpr int BENCH_SLOTS = 20;
+constexpr int BENCH_LOADS = 20000;
+
+// Every preset parameter to a distinct in-range value picked by seed
+void setPresetParams(uint32_t seed) {
+	for (uint8_t i = 0; i < PRESET_PARAM_COUNT; i++) {
+		const ParamInfo& p = PARAM_REGISTRY[PID_PRESET_FIRST + i];
+		const double t = ((seed * 37 + i * 11) % 100) / 100.0;
+		setParam(PID_PRESET_FIRST + i, p.lo + (p.hi - p.lo) * t);
+	}
+}
+
+void assertSameValues(const PresetValues& expected, const PresetValues& actual) {
+	#define X(type, parameter, def, lo, hi) TEST_ASSERT_TRUE_MESSAGE(expected.parameter == actual.parameter, #parameter);
+	PARAMETER_TABLE
+	#undef X
+}
+
+// The live parameters, as a preset would save them
+PresetValues capturePresetValues() {
+	PresetSlot slot;
+	capturePresetSlot(slot);
+	return slot.values;
+}
+
+void assertDefaults(const PresetValues& values) {
+	assertSameValues(PRESET_DEFAULTS, values);
+}
+
+size_t encodeCurrent(uint8_t* out, uint32_t seed, uint8_t mode = 3) {
+	PresetSlot slot;
+	MODE = mode;
+	setPresetParams(seed);
+	capturePresetSlot(slot);
+	return encodePresetSlot(slot, out, PRESET_BIN_MAX);
+}
+
+// Runs whatever the render loop queued for the preset worker
+void runWorker() {
+	PresetJob job;
+	while (xQueueReceive(presetJobs, &job, 0) == pdTRUE) {
+		runPresetJob(job);
+	}
+}
+
+// Power cycle: whatever is on the flash is read back into a fresh cache
+void reboot() {
+	LittleFS.flash.reboot();
+	free(presetCache);
+	presetCache = nullptr;
+	loadPresetCache();
+}
+
+void setUp() {
+	LittleFS.flash = fs::MockFlash();
+	if (presetJobs == NULL) startPresetWorker();
+	reboot();
+}
+
+void tearDown() {}
+
+void test_round_trip() {
+	PresetSlot saved;
+	MODE = 4;
+	setPresetParams(1);
+	capturePresetSlot(saved);
+
+	uint8_t record[PRESET_BIN_MAX];
+	const size_t len = encodePresetSlot(saved, record, sizeof(record));
+	TEST_ASSERT_GREATER_THAN(PRESET_BIN_HEADER, len);
+	TEST_ASSERT_LESS_OR_EQUAL(PRESET_BIN_MAX, len);
+
+	PresetSlot loaded;
+	TEST_ASSERT_TRUE(decodePresetSlot(record, len, loaded));
+	TEST_ASSERT_TRUE(loaded.valid);
+	TEST_ASSERT_EQUAL_UINT8(0, loaded.programNum);
+	TEST_ASSERT_EQUAL_UINT8(4, loaded.modeNum);
+	assertSameValues(saved.values, loaded.values);
+}
+
+void test_every_truncation_is_rejected() {
+	uint8_t record[PRESET_BIN_MAX];
+	const size_t len = encodeCurrent(record, 2);
+	PresetSlot slot;
+	for (size_t n = 0; n < len; n++) {
+		TEST_ASSERT_FALSE_MESSAGE(decodePresetSlot(record, n, slot), "truncated record decoded");
+	}
+	TEST_ASSERT_TRUE(decodePresetSlot(record, len, slot));
+}
+
+void test_malformed_records_are_rejected() {
+	uint8_t record[PRESET_BIN_MAX];
+	const size_t len = encodeCurrent(record, 3);
+	PresetSlot slot;
+
+	for (size_t i : { (size_t)0, (size_t)1, (size_t)2 }) {		// magic and version
+		record[i] ^= 0x40;
+		TEST_ASSERT_FALSE(decodePresetSlot(record, len, slot));
+		record[i] ^= 0x40;
+	}
+
+	// An unknown type byte anywhere makes the rest unreadable
+	size_t pos = PRESET_BIN_HEADER;
+	for (uint8_t i = 0; i < PRESET_PARAM_COUNT; i++) {
+		const uint8_t type = record[pos + 1];
+		record[pos + 1] = PARAM_BOOL + 1;
+		TEST_ASSERT_FALSE(decodePresetSlot(record, len, slot));
+		record[pos + 1] = type;
+		pos += 2 + paramTypeSize((ParamType)type);
+	}
+	TEST_ASSERT_EQUAL(len, pos);
+	TEST_ASSERT_TRUE(decodePresetSlot(record, len, slot));
+}
+
+// Records for parameters this build doesn't have, or that changed type, are skipped
+void test_unknown_and_retyped_parameters_keep_defaults() {
+	uint8_t record[PRESET_BIN_MAX];
+	const size_t len = encodeCurrent(record, 4);
+
+	const size_t first = PRESET_BIN_HEADER;		// OverrideMapping, a uint8_t
+	record[first] = 250;
+	const size_t second = first + 2 + 1;		// ColorPalette, a uint8_t, now claims bool
+	record[second + 1] = PARAM_BOOL;
+
+	PresetSlot slot;
+	TEST_ASSERT_TRUE(decodePresetSlot(record, len, slot));
+	TEST_ASSERT_EQUAL_UINT8(PRESET_DEFAULTS.OverrideMapping, slot.values.OverrideMapping);
+	TEST_ASSERT_EQUAL_UINT8(PRESET_DEFAULTS.ColorPalette, slot.values.ColorPalette);
+	TEST_ASSERT_EQUAL_FLOAT(cSpeed, slot.values.Speed);
+}
+
+// A file from before parameters were appended: the new ones take their defaults
+void test_shorter_file_loads_with_defaults() {
+	uint8_t record[PRESET_BIN_MAX];
+	encodeCurrent(record, 5);
+	const uint8_t kept = 3;		// OverrideMapping, ColorPalette, ColOrd
+	record[5] = kept;
+	const size_t len = PRESET_BIN_HEADER + kept * (2 + 1);
+
+	PresetSlot slot;
+	TEST_ASSERT_TRUE(decodePresetSlot(record, len, slot));
+	TEST_ASSERT_EQUAL_UINT8(cColorPalette, slot.values.ColorPalette);
+	TEST_ASSERT_EQUAL_FLOAT(PRESET_DEFAULTS.Speed, slot.values.Speed);
+	TEST_ASSERT_TRUE(PRESET_DEFAULTS.DecayBase == slot.values.DecayBase);
+}
+
+void test_save_survives_a_reboot() {
+	MODE = 2;
+	setPresetParams(6);
+	TEST_ASSERT_TRUE(savePreset(7));
+	PresetSlot saved = *presetSlot(7);
+	runWorker();
+
+	setPresetParams(60);
+	reboot();
+	PresetSlot* loaded = presetSlot(7);
+	TEST_ASSERT_TRUE(loaded->valid);
+	TEST_ASSERT_EQUAL_UINT8(2, loaded->modeNum);
+	assertSameValues(saved.values, loaded->values);
+	TEST_ASSERT_FALSE(presetSlot(8)->valid);
+
+	// Loading applies it to the live parameters
+	cMorphBeats = 0;
+	cGlideMs = 0;
+	TEST_ASSERT_TRUE(loadPreset(7));
+	TEST_ASSERT_EQUAL_FLOAT(saved.values.Speed, cSpeed);
+	TEST_ASSERT_TRUE(saved.values.DecayBase == cDecayBase);
+	TEST_ASSERT_EQUAL_UINT8(2, MODE);
+}
+
+// Power is cut after every possible number of bytes of the second save
+void test_power_loss_mid_save_keeps_a_whole_preset() {
+	uint8_t before[PRESET_BIN_MAX];
+	uint8_t after[PRESET_BIN_MAX];
+	const size_t beforeLen = encodeCurrent(before, 7, 1);
+	const size_t afterLen = encodeCurrent(after, 8, 6);
+	PresetSlot oldSlot;
+	PresetSlot newSlot;
+	decodePresetSlot(before, beforeLen, oldSlot);
+	decodePresetSlot(after, afterLen, newSlot);
+
+	for (long budget = 0; budget <= (long)afterLen; budget++) {
+		LittleFS.flash = fs::MockFlash();
+		TEST_ASSERT_TRUE(writePresetFile(9, "bin", before, beforeLen));
+
+		LittleFS.flash.writeBudget = budget;
+		writePresetFile(9, "bin", after, afterLen);
+		reboot();
+
+		const PresetSlot* slot = presetSlot(9);
+		TEST_ASSERT_TRUE_MESSAGE(slot->valid, "no preset after power loss");
+		TEST_ASSERT_EQUAL_UINT8(oldSlot.modeNum, slot->modeNum);
+		assertSameValues(oldSlot.values, slot->values);
+	}
+
+	// With power to spare the new preset replaces the old one
+	LittleFS.flash = fs::MockFlash();
+	TEST_ASSERT_TRUE(writePresetFile(9, "bin", before, beforeLen));
+	TEST_ASSERT_TRUE(writePresetFile(9, "bin", after, afterLen));
+	reboot();
+	TEST_ASSERT_EQUAL_UINT8(newSlot.modeNum, presetSlot(9)->modeNum);
+	assertSameValues(newSlot.values, presetSlot(9)->values);
+	TEST_ASSERT_FALSE(LittleFS.exists("/preset_9.bin.tmp"));
+}
+
+// JSON export and re-import through the worker give back the same slot
+void test_json_export_and_import_round_trip() {
+	MODE = 5;
+	setPresetParams(9);
+	TEST_ASSERT_TRUE(savePreset(3));
+	runWorker();
+	PresetSlot saved = *presetSlot(3);
+
+	TEST_ASSERT_TRUE(exportPreset(3));
+	runWorker();
+	TEST_ASSERT_TRUE(LittleFS.exists("/preset_3.json"));
+
+	LittleFS.remove("/preset_3.bin");
+	reboot();		// no binary file: the slot is imported from JSON
+	const PresetSlot* imported = presetSlot(3);
+	TEST_ASSERT_TRUE(imported->valid);
+	TEST_ASSERT_EQUAL_UINT8(5, imported->modeNum);
+	#define X(type, parameter, def, lo, hi) \
+		TEST_ASSERT_FLOAT_WITHIN(1e-4f * (1.0f + fabsf((float)saved.values.parameter)), (float)saved.values.parameter, (float)imported->values.parameter);
+	PARAMETER_TABLE
+	#undef X
+	TEST_ASSERT_TRUE(LittleFS.exists("/preset_3.bin"));
+}
+
+double elapsedNs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// What a preset button costs the render loop. The mock flash is RAM, so
+// the two file paths leave out LittleFS read time: they are a lower bound
+// of what a file-based load costs on the device.
+void test_load_latency_benchmark() {
+	for (int n = 1; n <= BENCH_SLOTS; n++) {
+		MODE = n % 7;
+		setPresetParams(100 + n);
+		TEST_ASSERT_TRUE(savePreset(n));
+		runWorker();
+		TEST_ASSERT_TRUE(exportPreset(n));
+		runWorker();
+	}
+	cMorphBeats = 0;
+	cGlideMs = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < BENCH_LOADS; i++) loadPreset(1 + i % BENCH_SLOTS);
+	const double cachedNs = elapsedNs(start) / BENCH_LOADS;
+	assertSameValues(presetSlot(BENCH_SLOTS)->values, capturePresetValues());
+
+	// With a morph every float parameter starts a ramp instead
+	cMorphBeats = 4;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < BENCH_LOADS; i++) loadPreset(1 + i % BENCH_SLOTS);
+	const double morphNs = elapsedNs(start) / BENCH_LOADS;
+	cMorphBeats = 0;
+
+	uint8_t record[PRESET_BIN_MAX];
+	PresetSlot slot;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < BENCH_LOADS; i++) {
+		const int n = 1 + i % BENCH_SLOTS;
+		const size_t len = readPresetFile(n, "bin", record, sizeof(record));
+		TEST_ASSERT_TRUE(decodePresetSlot(record, len, slot));
+		applyPresetSlot(slot);
+	}
+	const double binaryFileNs = elapsedNs(start) / BENCH_LOADS;
+
+	const int jsonLoads = BENCH_LOADS / 10;
+	size_t jsonBytes = 0;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < jsonLoads; i++) {
+		const int n = 1 + i % BENCH_SLOTS;
+		const size_t len = readPresetFile(n, "json", (uint8_t*)presetJsonBuffer, sizeof(presetJsonBuffer));
+		TEST_ASSERT_TRUE(presetSlotFromJson(presetJsonBuffer, len, slot, &presetJsonArena));
+		applyPresetSlot(slot);
+		jsonBytes = len;
+	}
+	const double jsonFileNs = elapsedNs(start) / jsonLoads;
+	assertSameValues(presetSlot(BENCH_SLOTS)->values, capturePresetValues());
+
+	start = std::chrono::steady_clock::now();
+	reboot();
+	const double bootNs = elapsedNs(start);
+	TEST_ASSERT_TRUE(presetSlot(BENCH_SLOTS)->valid);
+
+	printf("Preset load: cache %.0f ns (%.0f ns morphing), binary file + decode %.0f ns, "
+	       "JSON file + parse %.0f ns (%u bytes)\n",
+	       cachedNs, morphNs, binaryFileNs, jsonFileNs, (unsigned)jsonBytes);
+	printf("Boot: %d slots cached (%d saved) in %.0f us\n", PRESET_SLOTS, BENCH_SLOTS, bootNs / 1000.0);
+	TEST_ASSERT_TRUE(cachedNs < jsonFileNs);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_round_trip);
+	RUN_TEST(test_every_truncation_is_rejected);
+	RUN_TEST(test_malformed_records_are_rejected);
+	RUN_TEST(test_unknown_and_retyped_parameters_keep_defaults);
+	RUN_TEST(test_shorter_file_loads_with_defaults);
+	RUN_TEST(test_save_survives_a_reboot);
+	RUN_TEST(test_power_loss_mid_save_keeps_a_whole_preset);
+	RUN_TEST(test_json_export_and_import_round_trip);
+	RUN_TEST(test_load_latency_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,203 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+#include <complex>
+
+#include "audioFFTQ15.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Q15 real FFT against a double-precision reference
+// The reference windows with the same Hann curve in double, runs a radix-2
+// complex FFT on all 512 samples and scales |X| by 1/256 like Q15Spectrum,
+// so both should read ~16384 for a full-scale sine. SNR is taken over all
+// 256 bins: reference power over the power of the difference.
+//=============================================================================
+
+constexpr uint16_t N = Q15_FFT_SIZE;
+constexpr uint16_t BINS = Q15_FFT_COMPLEX;
+
+// SNR floors; the header quotes ~65 dB at full scale and ~24 dB at 200
+constexpr float SINE_FULL_SCALE_SNR_DB = 60.0f;
+constexpr float SINE_QUIET_SNR_DB = 20.0f;
+constexpr float NOISE_SNR_DB = 50.0f;
+
+Q15Spectrum spectrum;
+int16_t pcm[N];
+uint16_t q15Mag[BINS];
+double refMag[BINS];
+
+void referenceSpectrum(const int16_t* x, double* mag) {
+	std::complex<double> a[N];
+	for (uint16_t i = 0; i < N; i++) {
+		// Bit-reversed load for the in-place radix-2 passes
+		uint16_t r = 0;
+		for (uint16_t b = 1, v = i; b < N; b <<= 1, v >>= 1) r = (r << 1) | (v & 1);
+		a[r] = x[i] * (0.5 - 0.5 * cos(2.0 * M_PI * i / N));
+	}
+	for (uint16_t len = 2; len <= N; len <<= 1) {
+		const std::complex<double> step = std::polar(1.0, -2.0 * M_PI / len);
+		for (uint16_t g = 0; g < N; g += len) {
+			std::complex<double> w = 1.0;
+			for (uint16_t j = 0; j < len / 2; j++, w *= step) {
+				const std::complex<double> t = w * a[g + j + len / 2];
+				a[g + j + len / 2] = a[g + j] - t;
+				a[g + j] += t;
+			}
+		}
+	}
+	for (uint16_t k = 0; k < BINS; k++) mag[k] = std::abs(a[k]) / BINS;
+}
+
+float snrDb() {
+	double signal = 0.0, error = 0.0;
+	for (uint16_t k = 0; k < BINS; k++) {
+		signal += refMag[k] * refMag[k];
+		error += (q15Mag[k] - refMag[k]) * (q15Mag[k] - refMag[k]);
+	}
+	return static_cast<float>(10.0 * log10(signal / (error > 0.0 ? error : 1e-12)));
+}
+
+template <typename T>
+uint16_t peakBin(const T* mag) {
+	uint16_t best = 0;
+	for (uint16_t k = 1; k < BINS; k++) {
+		if (mag[k] > mag[best]) best = k;
+	}
+	return best;
+}
+
+void fillSine(float amplitude, float bin) {
+	for (uint16_t i = 0; i < N; i++) {
+		pcm[i] = static_cast<int16_t>(lrintf(amplitude * sinf(2.0f * float(M_PI) * bin * i / N + 0.3f)));
+	}
+}
+
+void fillNoise(int amplitude) {
+	for (uint16_t i = 0; i < N; i++) pcm[i] = rand() % (2 * amplitude + 1) - amplitude;
+}
+
+float compare() {
+	spectrum.compute(pcm, N, q15Mag);
+	referenceSpectrum(pcm, refMag);
+	return snrDb();
+}
+
+void setUp() { srand(5); }
+void tearDown() {}
+
+void test_full_scale_sine() {
+	// Bin-centred and off-centre (not at half bins, where the peak is a tie)
+	const float bins[] = { 3.0f, 10.3f, 37.25f, 64.0f, 100.7f, 200.0f, 250.2f };
+	float worst = 1000.0f;
+	for (float bin : bins) {
+		fillSine(32000.0f, bin);
+		const float snr = compare();
+		worst = fminf(worst, snr);
+		TEST_ASSERT_GREATER_THAN(SINE_FULL_SCALE_SNR_DB, snr);
+		TEST_ASSERT_EQUAL_UINT16(peakBin(refMag), peakBin(q15Mag));
+	}
+	fillSine(32767.0f, 64.0f);
+	compare();
+	TEST_ASSERT_FLOAT_WITHIN(16.0f, 16384.0f, q15Mag[64]);
+	printf("Full-scale sine: worst SNR %.1f dB\n", worst);
+}
+
+void test_quiet_sine() {
+	const float bins[] = { 5.0f, 23.2f, 80.0f };
+	float worst = 1000.0f;
+	for (float bin : bins) {
+		fillSine(200.0f, bin);
+		const float snr = compare();
+		worst = fminf(worst, snr);
+		TEST_ASSERT_GREATER_THAN(SINE_QUIET_SNR_DB, snr);
+		TEST_ASSERT_EQUAL_UINT16(peakBin(refMag), peakBin(q15Mag));
+	}
+	printf("Sine at amplitude 200: worst SNR %.1f dB\n", worst);
+}
+
+void test_noise() {
+	float worst = 1000.0f;
+	for (int block = 0; block < 20; block++) {
+		fillNoise(16000);
+		const float snr = compare();
+		worst = fminf(worst, snr);
+		TEST_ASSERT_GREATER_THAN(NOISE_SNR_DB, snr);
+	}
+	printf("Noise at +-16000: worst SNR %.1f dB\n", worst);
+}
+
+// Clipped square wave: a full-scale signal with strong harmonics
+void test_clipped_input_keeps_its_peak() {
+	for (uint16_t i = 0; i < N; i++) pcm[i] = ((i / 8) & 1) ? 32767 : -32768;
+	compare();
+	TEST_ASSERT_EQUAL_UINT16(peakBin(refMag), peakBin(q15Mag));
+	TEST_ASSERT_GREATER_THAN(30.0f, snrDb());
+}
+
+// The complex core on random full-scale points, the worst case for the
+// radix-4 stages: a twiddle can rotate a component past int16 range, and a
+// wrapped butterfly would be off by thousands where saturation costs ~100
+void test_full_scale_complex_core() {
+	int16_t data[2 * BINS];
+	std::complex<double> x[BINS];
+	double worst = 0.0;
+	for (int block = 0; block < 200; block++) {
+		for (uint16_t m = 0; m < BINS; m++) {
+			const int16_t re = (rand() & 1) ? 32767 : -32768;
+			const int16_t im = (rand() & 1) ? 32767 : -32768;
+			data[2 * q15DigitReverse[m]] = re;
+			data[2 * q15DigitReverse[m] + 1] = im;
+			x[m] = std::complex<double>(re, im);
+		}
+		fftRadix4Q15(data);
+		for (uint16_t k = 0; k < BINS; k++) {
+			std::complex<double> X = 0.0;
+			for (uint16_t m = 0; m < BINS; m++) X += x[m] * std::polar(1.0, -2.0 * M_PI * m * k / BINS);
+			worst = fmax(worst, std::abs(X / double(BINS) - std::complex<double>(data[2 * k], data[2 * k + 1])));
+		}
+	}
+	printf("Full-scale complex core: worst bin error %.0f\n", worst);
+	TEST_ASSERT_LESS_THAN(1024.0, worst);
+}
+
+// Host timing per 512-sample block, with the double reference for scale.
+// Cycles are read from the TSC where there is one.
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+	inline uint64_t cycleCount() { return __rdtsc(); }
+#else
+	inline uint64_t cycleCount() { return 0; }
+#endif
+
+void test_block_benchmark() {
+	constexpr int BLOCKS = 2000;
+	fillNoise(12000);
+
+	auto start = std::chrono::steady_clock::now();
+	const uint64_t c0 = cycleCount();
+	for (int b = 0; b < BLOCKS; b++) spectrum.compute(pcm, N, q15Mag);
+	const uint64_t c1 = cycleCount();
+	const double q15Us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	start = std::chrono::steady_clock::now();
+	for (int b = 0; b < BLOCKS; b++) referenceSpectrum(pcm, refMag);
+	const double refUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BLOCKS;
+
+	printf("Per block: Q15 %.2f us (%llu TSC cycles), double reference %.2f us\n",
+	       q15Us, (unsigned long long)((c1 - c0) / BLOCKS), refUs);
+	TEST_ASSERT_TRUE(q15Us > 0.0);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_full_scale_sine);
+	RUN_TEST(test_quiet_sine);
+	RUN_TEST(test_noise);
+	RUN_TEST(test_clipped_input_keeps_its_peak);
+	RUN_TEST(test_full_scale_complex_core);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
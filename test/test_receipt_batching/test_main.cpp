@@ -0,0 +1,349 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// Receipt batching against mock characteristics
+// Client writes go through the real characteristic callbacks and the
+// control queue; drainControlCommands() + flushNotifications() then play
+// one frame of the render loop, and the tests read back what was notified.
+//=============================================================================
+
+struct Receipt {
+	std::string id;
+	std::string val;
+};
+
+// Splits a batch notification into its receipts; false if it isn't
+// exactly [{"id":"..","val":..}(,{..})*]
+bool parseBatch(const std::vector<uint8_t>& note, std::vector<Receipt>& out) {
+	const std::string s(note.begin(), note.end());
+	if (s.size() < 2 || s.front() != '[' || s.back() != ']') return false;
+	size_t pos = 1;
+	for (;;) {
+		const std::string head = "{\"id\":\"";
+		if (s.compare(pos, head.size(), head) != 0) return false;
+		pos += head.size();
+		const size_t idEnd = s.find('"', pos);
+		if (idEnd == std::string::npos) return false;
+		Receipt r;
+		r.id = s.substr(pos, idEnd - pos);
+		pos = idEnd;
+		const std::string mid = "\",\"val\":";
+		if (s.compare(pos, mid.size(), mid) != 0) return false;
+		pos += mid.size();
+		const size_t valEnd = s.find('}', pos);
+		if (valEnd == std::string::npos) return false;
+		r.val = s.substr(pos, valEnd - pos);
+		out.push_back(r);
+		pos = valEnd + 1;
+		if (s[pos] == ']' && pos == s.size() - 1) return true;
+		if (s[pos] != ',') return false;
+		pos++;
+	}
+}
+
+std::vector<Receipt> receiptsOn(BLECharacteristic* characteristic) {
+	std::vector<Receipt> all;
+	for (const std::vector<uint8_t>& note : characteristic->notifications) {
+		TEST_ASSERT_TRUE(parseBatch(note, all));
+	}
+	return all;
+}
+
+void writeNumber(const char* id, double value) {
+	char json[64];
+	snprintf(json, sizeof(json), "{\"id\":\"%s\",\"val\":%.6g}", id, value);
+	pNumberCharacteristic->mockWrite(json);
+}
+
+void writeCheckbox(const char* id, bool value) {
+	char json[64];
+	snprintf(json, sizeof(json), "{\"id\":\"%s\",\"val\":%s}", id, value ? "true" : "false");
+	pCheckboxCharacteristic->mockWrite(json);
+}
+
+// One render loop frame, as far as the control plane is concerned
+void frame(uint32_t ms = 16) {
+	drainControlCommands();
+	flushNotifications();
+	mockMillis += ms;
+}
+
+void clearNotifications() {
+	for (BLECharacteristic* c : { pButtonCharacteristic, pCheckboxCharacteristic, pNumberCharacteristic,
+	                              pStringCharacteristic, pBinaryCharacteristic, pTelemetryCharacteristic }) {
+		c->notifications.clear();
+	}
+}
+
+// Speed through OffDiff: FLOAT_IDS float parameters with a -100..100 range
+constexpr uint8_t FLOAT_IDS = PID_OffDiff - PID_Speed + 1;
+
+const char* floatId(uint8_t i) {
+	return PARAM_REGISTRY[PID_Speed + i % FLOAT_IDS].wireId;
+}
+
+void setUp() {
+	if (pServer == NULL) {
+		bleSetup();
+		pServer->mockConnect();
+	}
+	pServer->peerMtu = 517;
+	cGlideMs = 0;
+	frame(1000);		// settle anything the previous test left, refill the bucket
+	resetNotifications();
+	clearNotifications();
+}
+
+void tearDown() {}
+
+void test_receipts_fill_the_mtu() {
+	pServer->peerMtu = 185;
+	const uint8_t n = FLOAT_IDS;
+	for (uint8_t i = 0; i < n; i++) {
+		writeNumber(floatId(i), -1.234567 * (i + 1));
+	}
+	frame();
+
+	const std::vector<Receipt> receipts = receiptsOn(pNumberCharacteristic);
+	TEST_ASSERT_EQUAL(n, receipts.size());
+	for (uint8_t i = 0; i < n; i++) {
+		TEST_ASSERT_EQUAL_STRING(floatId(i), receipts[i].id.c_str());
+		TEST_ASSERT_FLOAT_WITHIN(1e-4, -1.234567 * (i + 1), atof(receipts[i].val.c_str()));
+	}
+
+	// Every batch fits the payload, and only the last one has room to spare
+	const std::vector<std::vector<uint8_t>>& notes = pNumberCharacteristic->notifications;
+	TEST_ASSERT_GREATER_THAN(1, notes.size());
+	TEST_ASSERT_LESS_THAN(n, notes.size());
+	for (size_t i = 0; i < notes.size(); i++) {
+		TEST_ASSERT_LESS_OR_EQUAL(185 - 3, notes[i].size());
+		if (i + 1 < notes.size()) TEST_ASSERT_GREATER_THAN(185 - 3 - 32, notes[i].size());
+	}
+}
+
+void test_large_mtu_sends_one_batch() {
+	for (uint8_t i = 0; i < 12; i++) {
+		writeNumber(floatId(i), i);
+	}
+	frame();
+	TEST_ASSERT_EQUAL(1, pNumberCharacteristic->notifications.size());
+	TEST_ASSERT_EQUAL(12, receiptsOn(pNumberCharacteristic).size());
+}
+
+// Values overwritten before the flush are never sent; the last one is
+void test_superseded_values_are_coalesced() {
+	const uint32_t superseded = receiptsSuperseded;
+	for (int i = 0; i < 10; i++) {
+		writeNumber("inSpeed", i);
+	}
+	frame();
+
+	const std::vector<Receipt> receipts = receiptsOn(pNumberCharacteristic);
+	TEST_ASSERT_EQUAL(1, receipts.size());
+	TEST_ASSERT_EQUAL_STRING("inSpeed", receipts[0].id.c_str());
+	TEST_ASSERT_EQUAL_STRING("9", receipts[0].val.c_str());
+	TEST_ASSERT_EQUAL_UINT32(superseded + 9, receiptsSuperseded);
+}
+
+// The receipt carries the stored value, not the one that was written
+void test_receipt_carries_the_clamped_value() {
+	writeNumber("inSpeed", 1000.0);
+	frame();
+	const std::vector<Receipt> receipts = receiptsOn(pNumberCharacteristic);
+	TEST_ASSERT_EQUAL(1, receipts.size());
+	TEST_ASSERT_EQUAL_STRING("100", receipts[0].val.c_str());
+}
+
+void test_unknown_ids_get_no_receipt() {
+	writeNumber("inNoSuchThing", 3);
+	writeCheckbox("cx99", true);
+	frame();
+	TEST_ASSERT_EQUAL(0, pNumberCharacteristic->notifications.size());
+	TEST_ASSERT_EQUAL(0, pCheckboxCharacteristic->notifications.size());
+}
+
+void test_checkboxes_and_numbers_stay_apart() {
+	writeCheckbox("cxLayer2", false);
+	writeNumber("inSpeed", 2);
+	writeCheckbox("cx13", true);
+	frame();
+
+	const std::vector<Receipt> checkboxes = receiptsOn(pCheckboxCharacteristic);
+	TEST_ASSERT_EQUAL(2, checkboxes.size());
+	TEST_ASSERT_EQUAL_STRING("cxLayer2", checkboxes[0].id.c_str());
+	TEST_ASSERT_EQUAL_STRING("false", checkboxes[0].val.c_str());
+	TEST_ASSERT_EQUAL_STRING("cx13", checkboxes[1].id.c_str());
+	TEST_ASSERT_EQUAL_STRING("true", checkboxes[1].val.c_str());
+
+	const std::vector<Receipt> numbers = receiptsOn(pNumberCharacteristic);
+	TEST_ASSERT_EQUAL(1, numbers.size());
+	TEST_ASSERT_EQUAL_STRING("inSpeed", numbers[0].id.c_str());
+}
+
+// At the default MTU every receipt needs its own notification, so the token
+// bucket decides: a burst, then NOTIFY_RATE_PER_SEC, and nothing is lost
+void test_rate_cap_defers_but_delivers_everything() {
+	pServer->peerMtu = 23;
+	const uint8_t n = FLOAT_IDS;
+	for (uint8_t i = 0; i < n; i++) {
+		writeNumber(floatId(i), i + 0.25);
+	}
+
+	frame(0);
+	TEST_ASSERT_EQUAL(NOTIFY_BURST, pNumberCharacteristic->notifications.size());
+	frame(0);
+	TEST_ASSERT_EQUAL(NOTIFY_BURST, pNumberCharacteristic->notifications.size());
+	TEST_ASSERT_TRUE(receiptsPending());
+
+	mockMillis += 1000 / NOTIFY_RATE_PER_SEC;
+	frame(0);
+	TEST_ASSERT_EQUAL(NOTIFY_BURST + 1, pNumberCharacteristic->notifications.size());
+
+	for (int i = 0; i < 100 && receiptsPending(); i++) {
+		frame();
+	}
+	TEST_ASSERT_FALSE(receiptsPending());
+
+	const std::vector<Receipt> receipts = receiptsOn(pNumberCharacteristic);
+	TEST_ASSERT_EQUAL(n, receipts.size());
+	for (uint8_t i = 0; i < n; i++) {
+		TEST_ASSERT_EQUAL_STRING(floatId(i), receipts[i].id.c_str());
+		TEST_ASSERT_EQUAL_FLOAT(i + 0.25, atof(receipts[i].val.c_str()));
+	}
+}
+
+// The rate cap holds across frames however many receipts are owed
+void test_rate_cap_over_a_second() {
+	pServer->peerMtu = 23;
+	uint32_t sent = 0;
+	for (int f = 0; f < 60; f++) {		// 1 s at 60 fps
+		writeNumber(floatId(f), f);
+		frame(1000 / 60);
+	}
+	sent = pNumberCharacteristic->notifications.size();
+	TEST_ASSERT_LESS_OR_EQUAL(NOTIFY_BURST + NOTIFY_RATE_PER_SEC, sent);
+	TEST_ASSERT_GREATER_OR_EQUAL(NOTIFY_RATE_PER_SEC, sent);
+}
+
+// Binary writes are echoed as binary records, batched the same way
+void test_binary_writes_are_echoed_in_binary() {
+	uint8_t write[1 + 3 * 6];
+	size_t len = 0;
+	write[len++] = BINARY_PROTOCOL_VERSION;
+	for (uint8_t i = 0; i < 3; i++) {
+		const float value = 10.0f + i;
+		write[len++] = PID_Speed + i;
+		write[len++] = BIN_F32;
+		memcpy(&write[len], &value, 4);
+		len += 4;
+	}
+	pBinaryCharacteristic->mockWrite(write, len);
+	frame();
+
+	TEST_ASSERT_EQUAL(1, pBinaryCharacteristic->notifications.size());
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(write, pBinaryCharacteristic->notifications[0].data(), len);
+	TEST_ASSERT_EQUAL(len, pBinaryCharacteristic->notifications[0].size());
+	TEST_ASSERT_EQUAL(3, receiptsOn(pNumberCharacteristic).size());
+}
+
+// A new connection owes nothing to the previous client
+void test_reconnect_drops_owed_receipts() {
+	writeNumber("inSpeed", 4);
+	pServer->mockDisconnect();
+	frame();
+	pServer->mockConnect();
+	frame();
+	TEST_ASSERT_EQUAL(0, pNumberCharacteristic->notifications.size());
+	TEST_ASSERT_FALSE(receiptsPending());
+	TEST_ASSERT_EQUAL_FLOAT(4, cSpeed);
+}
+
+// Loading a cached preset receipts only what it changed, batched: compared
+// with the one notification per changed parameter that was sent before
+// batching, in notifications and in bytes on air (each notification also
+// carries a 3-byte ATT header)
+void test_preset_load_batches_changed_params() {
+	constexpr uint16_t ATT_HEADER = 3;
+	constexpr int PRESET = 7;
+	if (presetCache == nullptr) loadPresetCache();
+	cMorphBeats = 0;
+
+	// Every other preset parameter differs from its default in the preset
+	for (uint8_t id = 0; id < PID_COUNT; id++) setParam(id, PARAM_REGISTRY[id].def);
+	std::vector<uint8_t> changed;
+	for (uint8_t i = 0; i < PRESET_PARAM_COUNT; i += 2) {
+		const uint8_t id = PID_PRESET_FIRST + i;
+		const ParamInfo& p = PARAM_REGISTRY[id];
+		setParam(id, p.def != p.lo ? p.lo : p.hi);
+		changed.push_back(id);
+	}
+	capturePresetSlot(*presetSlot(PRESET));
+	for (uint8_t id = 0; id < PID_COUNT; id++) setParam(id, PARAM_REGISTRY[id].def);
+	frame(1000);
+	clearNotifications();
+
+	const uint8_t button = 150 + PRESET;
+	pButtonCharacteristic->mockWrite(&button, 1);
+	for (int i = 0; i < 100 && (i == 0 || receiptsPending()); i++) frame();
+	TEST_ASSERT_FALSE(receiptsPending());
+
+	std::vector<Receipt> receipts = receiptsOn(pNumberCharacteristic);
+	const std::vector<Receipt> checkboxes = receiptsOn(pCheckboxCharacteristic);
+	receipts.insert(receipts.end(), checkboxes.begin(), checkboxes.end());
+	TEST_ASSERT_EQUAL(changed.size(), receipts.size());
+
+	uint32_t batchedNotifies = 0;
+	uint32_t batchedBytes = 0;
+	for (BLECharacteristic* c : { pNumberCharacteristic, pCheckboxCharacteristic }) {
+		for (const std::vector<uint8_t>& note : c->notifications) {
+			batchedNotifies++;
+			batchedBytes += ATT_HEADER + note.size();
+		}
+	}
+	uint32_t singleBytes = 0;
+	for (uint8_t id : changed) {
+		char entry[80];
+		const size_t n = formatReceipt(entry, sizeof(entry), id);
+		TEST_ASSERT_GREATER_THAN(0, n);
+		singleBytes += ATT_HEADER + n;
+		bool found = false;
+		for (const Receipt& r : receipts) found = found || r.id == PARAM_REGISTRY[id].wireId;
+		TEST_ASSERT_TRUE_MESSAGE(found, PARAM_REGISTRY[id].wireId);
+	}
+
+	printf("Preset load, %u changed: %u notifies / %u bytes batched, %u / %u one per parameter\n",
+	       (unsigned)changed.size(), (unsigned)batchedNotifies, (unsigned)batchedBytes,
+	       (unsigned)changed.size(), (unsigned)singleBytes);
+	// At MTU 517 the number receipts fit one batch, plus one for checkboxes
+	TEST_ASSERT_LESS_OR_EQUAL(2, batchedNotifies);
+	TEST_ASSERT_LESS_THAN(singleBytes, batchedBytes);
+	cMorphBeats = PARAM_REGISTRY[PID_MorphBeats].def;
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_receipts_fill_the_mtu);
+	RUN_TEST(test_large_mtu_sends_one_batch);
+	RUN_TEST(test_superseded_values_are_coalesced);
+	RUN_TEST(test_receipt_carries_the_clamped_value);
+	RUN_TEST(test_unknown_ids_get_no_receipt);
+	RUN_TEST(test_checkboxes_and_numbers_stay_apart);
+	RUN_TEST(test_rate_cap_defers_but_delivers_everything);
+	RUN_TEST(test_rate_cap_over_a_second);
+	RUN_TEST(test_binary_writes_are_echoed_in_binary);
+	RUN_TEST(test_reconnect_drops_owed_receipts);
+	RUN_TEST(test_preset_load_batches_changed_params);
+	return UNITY_END();
+}
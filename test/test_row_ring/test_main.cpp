@@ -0,0 +1,198 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "rowRing.h"
+
+//=============================================================================
+// RowRing against a copy-scrolled reference
+// The reference is the legacy scroll: every step copies each display row
+// down one through the xy mapping, then draws the new row on top. Both are
+// fed the same random rows for several trips round the ring, and every frame
+// must match LED for LED, on the firmware's square panel and on a
+// non-square one (so W and H can't be swapped unnoticed), for serpentine
+// and column-major wiring. With matrix rain's fade the reference fades the
+// whole image each step instead, as fadeToBlackBy(40) did; per-age factors
+// round once rather than every step, so that comparison gets a small
+// tolerance. The benchmark times one scroll step of each.
+//=============================================================================
+
+constexpr uint8_t FIRMWARE_SIZE = 22;
+constexpr uint8_t WRAPS = 4;
+constexpr uint8_t RAIN_FADE = 40;
+constexpr uint8_t FADE_TOLERANCE = 4;		// per channel, rounding once vs every step
+constexpr int STEPS = 20000;
+
+uint8_t panelW, panelH;
+
+uint16_t serpentine(uint8_t x, uint8_t y) {
+	return (y & 1) ? y * panelW + (panelW - 1 - x) : y * panelW + x;
+}
+
+uint16_t columnMajor(uint8_t x, uint8_t y) {
+	return x * panelH + (panelH - 1 - y);
+}
+
+CRGB randomColor() {
+	return CRGB(rand() & 255, rand() & 255, rand() & 255);
+}
+
+uint8_t absDiff(uint8_t a, uint8_t b) { return a > b ? a - b : b - a; }
+
+// Largest difference over the three channels
+uint8_t channelDiff(const CRGB& a, const CRGB& b) {
+	uint8_t d = absDiff(a.r, b.r);
+	if (absDiff(a.g, b.g) > d) d = absDiff(a.g, b.g);
+	if (absDiff(a.b, b.b) > d) d = absDiff(a.b, b.b);
+	return d;
+}
+
+// The legacy step: fade, copy every row down through xy, new row on top
+void copyScroll(CRGB* out, uint16_t (*xy)(uint8_t, uint8_t), const CRGB* newRow, uint8_t fadeBy) {
+	const uint16_t n = panelW * panelH;
+	if (fadeBy) fadeToBlackBy(out, n, fadeBy);
+	for (uint8_t y = panelH - 1; y > 0; y--) {
+		for (uint8_t x = 0; x < panelW; x++) {
+			out[xy(x, y)] = out[xy(x, y - 1)];
+		}
+	}
+	for (uint8_t x = 0; x < panelW; x++) out[xy(x, 0)] = newRow[x];
+}
+
+// matrix rain's table: FADE applied once per row of age
+template <uint8_t H>
+void buildFade(uint8_t* fadeByAge) {
+	uint8_t f = 255;
+	for (uint8_t age = 0; age < H; age++) {
+		fadeByAge[age] = f;
+		f = scale8(f, 255 - RAIN_FADE);
+	}
+}
+
+// Scrolls both for WRAPS trips round the ring; returns the worst channel
+// difference (0 when they must match exactly)
+template <uint8_t W, uint8_t H>
+uint8_t compareScroll(uint16_t (*xy)(uint8_t, uint8_t), bool fade) {
+	static RowRing<W, H> ring;
+	static CRGB ringOut[W * H];
+	static CRGB refOut[W * H];
+	static uint8_t fadeByAge[H];
+	panelW = W;
+	panelH = H;
+	buildFade<H>(fadeByAge);
+
+	ring.clear();
+	ring.buildIndex(xy);
+	// Ring output starts as a sentinel so a missed LED can't match by accident
+	fill_solid(ringOut, W * H, CRGB(1, 2, 3));
+	fill_solid(refOut, W * H, CRGB::Black);
+
+	uint8_t worst = 0;
+	for (uint16_t step = 0; step < WRAPS * H + H / 2; step++) {
+		CRGB* row = ring.nextRow();
+		for (uint8_t x = 0; x < W; x++) row[x] = randomColor();
+		copyScroll(refOut, xy, row, fade ? RAIN_FADE : 0);
+		ring.push();
+		ring.remap(ringOut, fade ? fadeByAge : nullptr);
+
+		for (uint16_t i = 0; i < W * H; i++) {
+			const uint8_t d = channelDiff(ringOut[i], refOut[i]);
+			if (d > worst) worst = d;
+			if (!fade) {
+				if (d != 0) printf("step %u, LED %u differs\n", step, i);
+				TEST_ASSERT_EQUAL_UINT8(0, d);
+			}
+		}
+	}
+	return worst;
+}
+
+void setUp() { srand(37); }
+void tearDown() {}
+
+void test_matches_copy_scroll_on_the_firmware_panel() {
+	compareScroll<FIRMWARE_SIZE, FIRMWARE_SIZE>(serpentine, false);
+	compareScroll<FIRMWARE_SIZE, FIRMWARE_SIZE>(columnMajor, false);
+}
+
+void test_matches_copy_scroll_on_a_wide_panel() {
+	compareScroll<16, 9>(serpentine, false);
+	compareScroll<16, 9>(columnMajor, false);
+}
+
+void test_age_fade_tracks_fade_every_step() {
+	const uint8_t square = compareScroll<FIRMWARE_SIZE, FIRMWARE_SIZE>(serpentine, true);
+	const uint8_t wide = compareScroll<16, 9>(columnMajor, true);
+	printf("Worst channel difference vs fadeToBlackBy(%u) per step: %u (22x22), %u (16x9)\n",
+	       RAIN_FADE, square, wide);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT(FADE_TOLERANCE, square);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT(FADE_TOLERANCE, wide);
+}
+
+// clear() blanks the image; a new mapping takes effect on the next remap
+void test_clear_and_remapping() {
+	panelW = panelH = FIRMWARE_SIZE;
+	static RowRing<FIRMWARE_SIZE, FIRMWARE_SIZE> ring;
+	static CRGB out[FIRMWARE_SIZE * FIRMWARE_SIZE];
+	ring.clear();
+	ring.buildIndex(serpentine);
+
+	CRGB* row = ring.nextRow();
+	for (uint8_t x = 0; x < FIRMWARE_SIZE; x++) row[x] = CRGB(x + 1, 0, 0);
+	ring.push();
+	ring.remap(out);
+	TEST_ASSERT_EQUAL_UINT8(FIRMWARE_SIZE, out[serpentine(FIRMWARE_SIZE - 1, 0)].r);
+
+	ring.buildIndex(columnMajor);
+	ring.remap(out);
+	TEST_ASSERT_EQUAL_UINT8(FIRMWARE_SIZE, out[columnMajor(FIRMWARE_SIZE - 1, 0)].r);
+	TEST_ASSERT_EQUAL_UINT8(1, out[columnMajor(0, 0)].r);
+
+	ring.clear();
+	ring.remap(out);
+	for (uint16_t i = 0; i < FIRMWARE_SIZE * FIRMWARE_SIZE; i++) TEST_ASSERT_TRUE(out[i] == CRGB(CRGB::Black));
+}
+
+void test_scroll_benchmark() {
+	panelW = panelH = FIRMWARE_SIZE;
+	static RowRing<FIRMWARE_SIZE, FIRMWARE_SIZE> ring;
+	static CRGB out[FIRMWARE_SIZE * FIRMWARE_SIZE];
+	static uint8_t fadeByAge[FIRMWARE_SIZE];
+	buildFade<FIRMWARE_SIZE>(fadeByAge);
+	ring.clear();
+	ring.buildIndex(serpentine);
+	CRGB newRow[FIRMWARE_SIZE];
+	for (uint8_t x = 0; x < FIRMWARE_SIZE; x++) newRow[x] = randomColor();
+	volatile uint8_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int s = 0; s < STEPS; s++) {
+		newRow[s % FIRMWARE_SIZE].r ^= 1;
+		memcpy(ring.nextRow(), newRow, sizeof(newRow));
+		ring.push();
+		ring.remap(out, fadeByAge);
+		sink += out[s % 64].g;
+	}
+	const double ringNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / STEPS;
+
+	start = std::chrono::steady_clock::now();
+	for (int s = 0; s < STEPS; s++) {
+		newRow[s % FIRMWARE_SIZE].r ^= 1;
+		copyScroll(out, serpentine, newRow, RAIN_FADE);
+		sink += out[s % 64].g;
+	}
+	const double copyNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / STEPS;
+
+	printf("Faded scroll step, 22x22: ring push + remap %.0f ns, fade + copy-down through xy %.0f ns\n", ringNs, copyNs);
+	TEST_ASSERT_TRUE(ringNs > 0.0);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_copy_scroll_on_the_firmware_panel);
+	RUN_TEST(test_matches_copy_scroll_on_a_wide_panel);
+	RUN_TEST(test_age_fade_tracks_fade_every_step);
+	RUN_TEST(test_clear_and_remapping);
+	RUN_TEST(test_scroll_benchmark);
+	return UNITY_END();
+}
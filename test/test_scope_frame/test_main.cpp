@@ -0,0 +1,262 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "scopeFrame.h"
+
+//=============================================================================
+// Oscilloscope frames at widths 22 and 48
+// Every frame ScopeFrame draws is compared with the same block drawn from
+// scratch: trigger found by a plain scan, min/max taken over each column's
+// samples, amplitude companded with log10f/powf per column. A steady tone
+// has to hold still from block to block where the old free-running
+// sampler (one sample every n / W, no trigger) drifts, and a one-sample
+// spike has to show in its column where the sampler mostly misses it. The
+// benchmark times one fade + frame at 22x22 and 48x32 against that sampler.
+//=============================================================================
+
+constexpr uint16_t BLOCK = 512;
+constexpr float SAMPLE_RATE = 44100.0f;
+constexpr int FRAMES = 500;
+constexpr int BENCH_FRAMES = 20000;
+constexpr uint8_t BENCH_SIGNAL_BLOCKS = 64;
+constexpr uint8_t PERSISTENCE = 160;
+
+int16_t pcm[BLOCK];
+uint32_t sampleIndex = 0;
+
+template <uint8_t W, uint8_t H>
+struct Panel {
+	static uint16_t xy(uint8_t x, uint8_t y) {
+		return (y & 1) ? y * W + (W - 1 - x) : y * W + x;
+	}
+	CRGB leds[W * H];
+	CRGB golden[W * H];
+	ScopeFrame<W, H> scope;
+};
+
+CRGB swingColor(uint8_t swing) { return CRGB(swing, 255 - swing, 40); }
+
+float compandReference(uint8_t magnitude) {
+	const float a = (magnitude + 0.5f) / 256.0f;
+	return powf(log10f(1.0f + a * 9.0f), 0.6f) * 255.0f;
+}
+
+// A tone plus noise, continuing from the last block
+void fillBlock(float hz, float amplitude, int noise) {
+	for (uint16_t i = 0; i < BLOCK; i++, sampleIndex++) {
+		const float s = amplitude * sinf(2.0f * float(M_PI) * hz * sampleIndex / SAMPLE_RATE) + rand() % (2 * noise + 1) - noise;
+		pcm[i] = static_cast<int16_t>(fmaxf(-32768.0f, fminf(32767.0f, s)));
+	}
+}
+
+// The same frame drawn the obvious way onto a black panel
+template <uint8_t W, uint8_t H>
+size_t drawFromScratch(Panel<W, H>& panel, const int16_t* in, size_t n) {
+	fill_solid(panel.golden, W * H, CRGB::Black);
+	const size_t span = n / 2;
+	size_t start = 0;
+	int16_t lowest = 0;
+	// Armed by any sample from index 1 on that dips below the hysteresis
+	for (size_t i = 1; i < n - span; i++) {
+		if (i > 1 && in[i - 1] < lowest) lowest = in[i - 1];
+		if (lowest < SCOPE_TRIGGER_LEVEL - SCOPE_TRIGGER_HYSTERESIS && in[i - 1] < SCOPE_TRIGGER_LEVEL && in[i] >= SCOPE_TRIGGER_LEVEL) {
+			start = i;
+			break;
+		}
+	}
+	const size_t perColumn = span / W;
+	for (uint8_t x = 0; x < W; x++) {
+		int lo = 0, hi = 0;
+		for (size_t i = start + x * perColumn; i < start + (x + 1) * perColumn; i++) {
+			if (i == start + x * perColumn || in[i] < lo) lo = in[i];
+			if (i == start + x * perColumn || in[i] > hi) hi = in[i];
+		}
+		const uint8_t up = hi > 0 ? lrintf(compandReference(hi / 128)) : 0;
+		const uint8_t down = lo < 0 ? lrintf(compandReference((-lo - 1) / 128)) : 0;
+		const int top = H / 2 - up * (H / 2) / 256;
+		const int bottom = H / 2 + down * (H / 2) / 256;
+		for (int y = top < 0 ? 0 : top; y <= bottom && y < H; y++) {
+			panel.golden[Panel<W, H>::xy(x, y)] = swingColor(up > down ? up : down);
+		}
+	}
+	return start;
+}
+
+// The sampler the scope replaced: one sample per column, free-running,
+// log10f/powf per column
+template <uint8_t W, uint8_t H>
+void drawSampled(CRGB* leds, const int16_t* in, size_t n) {
+	const size_t step = n / W;
+	for (uint8_t x = 0; x < W; x++) {
+		const int16_t s = in[x * step];
+		const float a = powf(log10f(1.0f + fabsf(s / 32768.0f) * 9.0f), 0.6f);
+		const uint8_t px = static_cast<uint8_t>(a * (H / 2));
+		const int top = s > 0 ? H / 2 - px : H / 2;
+		const int bottom = s > 0 ? H / 2 : H / 2 + px;
+		for (int y = top < 0 ? 0 : top; y <= bottom && y < H; y++) {
+			leds[Panel<W, H>::xy(x, y)] = swingColor(static_cast<uint8_t>(a * 255.0f));
+		}
+	}
+}
+
+// Pixels lit in one frame and dark in the other
+template <uint8_t W, uint8_t H>
+uint16_t changedPixels(const CRGB* a, const CRGB* b) {
+	uint16_t changed = 0;
+	for (uint16_t i = 0; i < W * H; i++) changed += (a[i] == CRGB(CRGB::Black)) != (b[i] == CRGB(CRGB::Black));
+	return changed;
+}
+
+// Row a full-scale swing reaches above the centre line
+template <uint8_t H>
+uint8_t fullScaleRow() {
+	return H / 2 - ((255 * (H / 2)) >> 8);
+}
+
+void setUp() { srand(38); }
+void tearDown() {}
+
+// The LUT is within rounding of the float curve for every magnitude
+void test_compand_lut_matches_the_curve() {
+	static Panel<22, 22> panel;
+	for (uint16_t m = 0; m < 256; m++) {
+		TEST_ASSERT_INT_WITHIN(1, lrintf(compandReference(m)), panel.scope.compand(m));
+	}
+}
+
+template <uint8_t W, uint8_t H>
+void checkGoldenFrames() {
+	static Panel<W, H> panel;
+	uint16_t triggered = 0;
+	for (int f = 0; f < FRAMES; f++) {
+		fillBlock(60.0f + rand() % 2000, 500.0f + rand() % 30000, 50 + rand() % 3000);
+		if (f % 7 == 0) pcm[rand() % BLOCK] = (rand() & 1) ? 32767 : -32768;
+		fill_solid(panel.leds, W * H, CRGB::Black);
+		const size_t start = panel.scope.draw(panel.leds, Panel<W, H>::xy, pcm, BLOCK, swingColor);
+		const size_t expected = drawFromScratch(panel, pcm, BLOCK);
+		TEST_ASSERT_EQUAL_UINT32(expected, start);
+		TEST_ASSERT_EQUAL_MEMORY(panel.golden, panel.leds, sizeof(panel.leds));
+		triggered += start > 0;
+	}
+	printf("%ux%u: %d frames match a from-scratch draw, %u triggered\n", W, H, FRAMES, triggered);
+	TEST_ASSERT_GREATER_THAN(FRAMES / 2, triggered);
+}
+
+void test_golden_frames() {
+	checkGoldenFrames<22, 22>();
+	checkGoldenFrames<48, 32>();
+}
+
+// A steady 440 Hz tone: consecutive triggered frames light all but the same
+// pixels; the free-running sampler's trace moves every block
+template <uint8_t W, uint8_t H>
+void checkStableTrace() {
+	static Panel<W, H> panel;
+	static CRGB previous[W * H];
+	static CRGB previousSampled[W * H];
+	static CRGB sampled[W * H];
+	uint32_t changed = 0, changedSampled = 0;
+	for (int f = 0; f < 100; f++) {
+		fillBlock(440.0f, 12000.0f, 0);
+		fill_solid(panel.leds, W * H, CRGB::Black);
+		fill_solid(sampled, W * H, CRGB::Black);
+		panel.scope.draw(panel.leds, Panel<W, H>::xy, pcm, BLOCK, swingColor);
+		drawSampled<W, H>(sampled, pcm, BLOCK);
+		if (f > 0) {
+			changed += changedPixels<W, H>(previous, panel.leds);
+			changedSampled += changedPixels<W, H>(previousSampled, sampled);
+		}
+		memcpy(previous, panel.leds, sizeof(previous));
+		memcpy(previousSampled, sampled, sizeof(previousSampled));
+	}
+	printf("%ux%u, steady 440 Hz: %.1f pixels change per frame triggered, %.1f free-running\n",
+	       W, H, changed / 99.0f, changedSampled / 99.0f);
+	TEST_ASSERT_LESS_THAN(W, changed / 99);
+	TEST_ASSERT_GREATER_THAN(4 * (changed / 99 + 1), changedSampled / 99);
+}
+
+void test_trigger_holds_a_tone_still() {
+	checkStableTrace<22, 22>();
+	checkStableTrace<48, 32>();
+}
+
+// A full-scale one-sample spike on silence, anywhere in the drawn half:
+// the scope always shows it full height, the sampler only when it lands on
+// a sampled index
+template <uint8_t W, uint8_t H>
+void checkSpikes() {
+	static Panel<W, H> panel;
+	static CRGB sampled[W * H];
+	uint16_t sampledHits = 0;
+	for (uint16_t at = 0; at < BLOCK / 2; at++) {
+		memset(pcm, 0, sizeof(pcm));
+		pcm[at] = 32767;
+		fill_solid(panel.leds, W * H, CRGB::Black);
+		fill_solid(sampled, W * H, CRGB::Black);
+		panel.scope.draw(panel.leds, Panel<W, H>::xy, pcm, BLOCK, swingColor);
+		drawSampled<W, H>(sampled, pcm, BLOCK);
+		const uint8_t column = at / (BLOCK / 2 / W);
+		if (column < W) {
+			const bool topLit = panel.leds[Panel<W, H>::xy(column, fullScaleRow<H>())] != CRGB(CRGB::Black);
+			TEST_ASSERT_TRUE(topLit);
+		}
+		bool seen = false;
+		for (uint8_t x = 0; x < W; x++) seen |= sampled[Panel<W, H>::xy(x, fullScaleRow<H>())] != CRGB(CRGB::Black);
+		sampledHits += seen;
+	}
+	printf("%ux%u: one-sample spikes shown %u/%u by the scope, %u/%u by the sampler\n",
+	       W, H, BLOCK / 2, BLOCK / 2, sampledHits, BLOCK / 2);
+	TEST_ASSERT_LESS_THAN(BLOCK / 8, sampledHits);
+}
+
+void test_spikes_are_never_lost() {
+	checkSpikes<22, 22>();
+	checkSpikes<48, 32>();
+}
+
+template <uint8_t W, uint8_t H>
+void benchmark() {
+	static Panel<W, H> panel;
+	static int16_t blocks[BENCH_SIGNAL_BLOCKS][BLOCK];
+	for (uint8_t b = 0; b < BENCH_SIGNAL_BLOCKS; b++) {
+		fillBlock(80.0f + rand() % 1500, 2000.0f + rand() % 20000, 200);
+		memcpy(blocks[b], pcm, sizeof(pcm));
+	}
+	volatile uint32_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int f = 0; f < BENCH_FRAMES; f++) {
+		fadeToBlackBy(panel.leds, W * H, 255 - PERSISTENCE);
+		sink += panel.scope.draw(panel.leds, Panel<W, H>::xy, blocks[f % BENCH_SIGNAL_BLOCKS], BLOCK, swingColor);
+	}
+	const double scopeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_FRAMES;
+
+	start = std::chrono::steady_clock::now();
+	for (int f = 0; f < BENCH_FRAMES; f++) {
+		fadeToBlackBy(panel.golden, W * H, 255 - PERSISTENCE);
+		drawSampled<W, H>(panel.golden, blocks[f % BENCH_SIGNAL_BLOCKS], BLOCK);
+		sink += panel.golden[W].r;
+	}
+	const double sampledNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_FRAMES;
+
+	printf("%ux%u: triggered min/max scope %.0f ns per frame, free-running sampler %.0f ns (fade included)\n",
+	       W, H, scopeNs, sampledNs);
+	TEST_ASSERT_TRUE(scopeNs > 0.0);
+}
+
+void test_frame_benchmark() {
+	benchmark<22, 22>();
+	benchmark<48, 32>();
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_compand_lut_matches_the_curve);
+	RUN_TEST(test_golden_frames);
+	RUN_TEST(test_trigger_holds_a_tone_still);
+	RUN_TEST(test_spikes_are_never_lost);
+	RUN_TEST(test_frame_benchmark);
+	return UNITY_END();
+}
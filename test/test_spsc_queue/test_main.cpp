@@ -0,0 +1,125 @@
+#include <unity.h>
+#include <thread>
+
+#include "spscQueue.h"
+
+//=============================================================================
+// SpscQueue under contention
+// A producer thread floods a small ring while the main thread drains it.
+// Each item carries its sequence number twice, so a lost, repeated,
+// reordered or half-published slot all show up on the consumer side.
+//=============================================================================
+
+struct Item {
+	uint32_t seq;
+	uint32_t check;
+};
+
+constexpr uint32_t FLOOD_ITEMS = 200000;
+
+void setUp() {}
+void tearDown() {}
+
+void test_capacity_is_one_less_than_size() {
+	SpscQueue<Item, 8> queue;
+	for (uint32_t i = 0; i < 7; i++) {
+		TEST_ASSERT_TRUE(queue.push({i, ~i}));
+	}
+	TEST_ASSERT_FALSE(queue.push({7, ~7u}));
+	TEST_ASSERT_EQUAL_UINT32(1, queue.dropped());
+
+	Item item;
+	for (uint32_t i = 0; i < 7; i++) {
+		TEST_ASSERT_TRUE(queue.pop(item));
+		TEST_ASSERT_EQUAL_UINT32(i, item.seq);
+	}
+	TEST_ASSERT_FALSE(queue.pop(item));
+	TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_wraps_around() {
+	SpscQueue<Item, 4> queue;
+	Item item;
+	for (uint32_t i = 0; i < 1000; i++) {
+		TEST_ASSERT_TRUE(queue.push({i, ~i}));
+		TEST_ASSERT_TRUE(queue.push({i + 1, ~(i + 1)}));
+		TEST_ASSERT_TRUE(queue.pop(item));
+		TEST_ASSERT_EQUAL_UINT32(i, item.seq);
+		TEST_ASSERT_TRUE(queue.pop(item));
+		TEST_ASSERT_EQUAL_UINT32(i + 1, item.seq);
+	}
+	TEST_ASSERT_TRUE(queue.empty());
+}
+
+// The producer retries a full ring, so every item must arrive, in order
+void test_flood_loses_nothing() {
+	static SpscQueue<Item, 16> queue;
+	uint32_t retries = 0;
+
+	std::thread producer([&retries] {
+		for (uint32_t i = 0; i < FLOOD_ITEMS; i++) {
+			while (!queue.push({i, ~i})) {
+				retries++;
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint32_t expected = 0;
+	uint32_t bad = 0;
+	Item item;
+	while (expected < FLOOD_ITEMS) {
+		if (!queue.pop(item)) {
+			std::this_thread::yield();
+			continue;
+		}
+		if (item.seq != expected || item.check != ~expected) bad++;
+		expected = item.seq + 1;
+	}
+	producer.join();
+
+	TEST_ASSERT_EQUAL_UINT32(0, bad);
+	TEST_ASSERT_FALSE(queue.pop(item));
+	TEST_ASSERT_EQUAL_UINT32(retries, queue.dropped());
+}
+
+// A producer that never retries drops items but must not corrupt the rest
+void test_flood_drops_are_counted() {
+	static SpscQueue<Item, 16> queue;
+	std::atomic<bool> done{false};
+
+	std::thread producer([&done] {
+		for (uint32_t i = 0; i < FLOOD_ITEMS; i++) {
+			queue.push({i, ~i});
+		}
+		done.store(true, std::memory_order_release);
+	});
+
+	uint32_t received = 0;
+	uint32_t bad = 0;
+	int64_t last = -1;
+	Item item;
+	for (;;) {
+		const bool finished = done.load(std::memory_order_acquire);
+		while (queue.pop(item)) {
+			if (item.check != ~item.seq || (int64_t)item.seq <= last) bad++;
+			last = item.seq;
+			received++;
+		}
+		if (finished) break;
+		std::this_thread::yield();
+	}
+	producer.join();
+
+	TEST_ASSERT_EQUAL_UINT32(0, bad);
+	TEST_ASSERT_EQUAL_UINT32(FLOOD_ITEMS, received + queue.dropped());
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_capacity_is_one_less_than_size);
+	RUN_TEST(test_wraps_around);
+	RUN_TEST(test_flood_loses_nothing);
+	RUN_TEST(test_flood_drops_are_counted);
+	return UNITY_END();
+}
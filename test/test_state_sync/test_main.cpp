@@ -0,0 +1,338 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bleControl.h"
+
+uint8_t PROGRAM = 0;
+uint8_t MODE = 0;
+uint8_t BRIGHTNESS = 75;
+bool mappingOverride = false;
+namespace myAudio {
+	float currentBPM = 0.0f;
+}
+
+//=============================================================================
+// State sync against a mock web UI client
+// The client writes syncState and button 93 through the real characteristic
+// callbacks and reads back every notification the way index.html does:
+// receipt batches into its copy of the parameters, syncVersion into the
+// version it would store, schema pages into the schema it would cache.
+// Each frame is drainControlCommands() + flushNotifications().
+//
+// The mock characteristics don't truncate notifications to the MTU, so at
+// MTU 23 the schema test checks the paging itself (one entry per page once
+// nothing else fits), not what the BLE stack would deliver.
+//=============================================================================
+
+constexpr int MAX_FRAMES = 2000;
+
+struct MockClient {
+	std::map<std::string, std::string> receipts;	// wire id -> last receipt entry
+	std::vector<uint8_t> buttons;
+	uint32_t receiptCount = 0;
+	uint32_t receiptBytes = 0;
+
+	std::string version;			// last syncVersion value
+	bool versionThisFrame = false;
+	uint32_t versionsSeen = 0;
+
+	std::vector<std::string> schema;
+	std::vector<size_t> schemaPageSizes;
+	bool schemaDone = false;
+
+	void reset() { *this = MockClient(); }
+
+	// Splits [{..},{..}] into entries and keeps the latest one per id
+	void readBatch(const std::vector<uint8_t>& note) {
+		const std::string s(note.begin(), note.end());
+		TEST_ASSERT_TRUE(s.size() > 2 && s.front() == '[' && s.back() == ']');
+		receiptBytes += s.size();
+		size_t pos = 1;
+		while (pos < s.size() - 1) {
+			const size_t end = s.find('}', pos);
+			TEST_ASSERT_TRUE(end != std::string::npos);
+			const std::string entry = s.substr(pos, end + 1 - pos);
+			const std::string head = "{\"id\":\"";
+			TEST_ASSERT_EQUAL(0, entry.compare(0, head.size(), head));
+			const std::string id = entry.substr(head.size(), entry.find('"', head.size()) - head.size());
+			receipts[id] = entry;
+			receiptCount++;
+			pos = end + 1;
+			if (s[pos] == ',') pos++;
+		}
+	}
+
+	// {"id":"schema","val":{"v":hash,"i":first,"e":[entries],"end":bool}}
+	void readSchemaPage(const std::string& s) {
+		char head[64];
+		snprintf(head, sizeof(head), "{\"id\":\"schema\",\"val\":{\"v\":%lu,\"i\":%u,\"e\":[",
+		         (unsigned long)SCHEMA_HASH, (unsigned)schema.size());
+		TEST_ASSERT_EQUAL_MESSAGE(0, s.compare(0, strlen(head), head), "schema page out of sequence");
+		TEST_ASSERT_FALSE(schemaDone);
+		schemaPageSizes.push_back(s.size());
+
+		// Top-level entries of the e array: track nesting, skip strings
+		size_t pos = strlen(head);
+		size_t start = pos;
+		int depth = 0;
+		bool inString = false;
+		for (; pos < s.size(); pos++) {
+			const char c = s[pos];
+			if (inString) { if (c == '"') inString = false; continue; }
+			if (c == '"') inString = true;
+			else if (c == '[' || c == '{') depth++;
+			else if ((c == ',' || c == ']') && depth == 0) {
+				schema.push_back(s.substr(start, pos - start));
+				start = pos + 1;
+				if (c == ']') break;
+			}
+			else if (c == ']' || c == '}') depth--;
+		}
+		const std::string rest = s.substr(pos);
+		TEST_ASSERT_TRUE(rest == "],\"end\":true}}" || rest == "],\"end\":false}}");
+		schemaDone = rest == "],\"end\":true}}";
+	}
+
+	void readString(const std::vector<uint8_t>& note) {
+		const std::string s(note.begin(), note.end());
+		const std::string versionHead = "{\"id\":\"syncVersion\",\"val\":\"";
+		if (s.compare(0, versionHead.size(), versionHead) == 0) {
+			version = s.substr(versionHead.size(), s.size() - versionHead.size() - 2);
+			versionThisFrame = true;
+			versionsSeen++;
+		} else if (s.compare(0, 14, "{\"id\":\"schema\"") == 0) {
+			readSchemaPage(s);
+		}
+	}
+
+	void poll() {
+		versionThisFrame = false;
+		for (BLECharacteristic* c : { pNumberCharacteristic, pCheckboxCharacteristic }) {
+			for (const std::vector<uint8_t>& note : c->notifications) readBatch(note);
+			c->notifications.clear();
+		}
+		for (const std::vector<uint8_t>& note : pButtonCharacteristic->notifications) {
+			buttons.push_back(atoi(std::string(note.begin(), note.end()).c_str()));
+		}
+		pButtonCharacteristic->notifications.clear();
+		for (const std::vector<uint8_t>& note : pStringCharacteristic->notifications) readString(note);
+		pStringCharacteristic->notifications.clear();
+	}
+
+	void writeSyncState(const char* value) {
+		char json[96];
+		snprintf(json, sizeof(json), "{\"id\":\"syncState\",\"val\":\"%s\"}", value);
+		pStringCharacteristic->mockWrite(json);
+	}
+
+	void writeNumber(const char* id, double value) {
+		char json[64];
+		snprintf(json, sizeof(json), "{\"id\":\"%s\",\"val\":%.6g}", id, value);
+		pNumberCharacteristic->mockWrite(json);
+	}
+
+	void writeButton(uint8_t button) {
+		pButtonCharacteristic->mockWrite(&button, 1);
+	}
+
+	// Every parameter's receipt matches what the device holds now
+	bool matchesDevice() const {
+		for (uint8_t id = 0; id < PID_COUNT; id++) {
+			char expected[80];
+			formatReceipt(expected, sizeof(expected), id);
+			auto it = receipts.find(PARAM_REGISTRY[id].wireId);
+			if (it == receipts.end() || it->second != expected) return false;
+		}
+		return true;
+	}
+};
+
+MockClient client;
+
+// One render loop frame; the client reads what it was sent
+void frame(uint32_t ms = 16) {
+	drainControlCommands();
+	flushNotifications();
+	client.poll();
+	mockMillis += ms;
+}
+
+// Frames until a syncVersion arrives; false if it never does
+bool syncUntilVersion() {
+	for (int i = 0; i < MAX_FRAMES; i++) {
+		frame();
+		if (client.versionThisFrame) return true;
+	}
+	return false;
+}
+
+std::string currentVersion() {
+	char version[40];
+	snprintf(version, sizeof(version), "%lu:%lu:%lu",
+	         (unsigned long)syncEpoch, (unsigned long)stateVersion, (unsigned long)SCHEMA_HASH);
+	return version;
+}
+
+// "<epoch>:<version>" from a syncVersion value, as the UI writes it back
+std::string syncStateFrom(const std::string& version) {
+	return version.substr(0, version.rfind(':'));
+}
+
+void reconnect() {
+	pServer->mockDisconnect();
+	frame(1000);
+	pServer->mockConnect();
+	frame(1000);		// refills the rate bucket
+	client.reset();
+}
+
+void setUp() {
+	if (pServer == NULL) {
+		bleSetup();
+	}
+	pServer->peerMtu = 517;
+	cGlideMs = 0;
+	reconnect();
+}
+
+void tearDown() {}
+
+void test_epoch_mismatch_sends_everything() {
+	char stale[32];
+	snprintf(stale, sizeof(stale), "%lu:%lu", (unsigned long)(syncEpoch + 2), (unsigned long)stateVersion);
+	client.writeSyncState(stale);
+	TEST_ASSERT_TRUE(syncUntilVersion());
+
+	TEST_ASSERT_EQUAL(PID_COUNT, client.receipts.size());
+	TEST_ASSERT_EQUAL_UINT32(PID_COUNT, client.receiptCount);
+	TEST_ASSERT_TRUE(client.matchesDevice());
+	TEST_ASSERT_EQUAL_STRING(currentVersion().c_str(), client.version.c_str());
+	// Program and mode buttons come along with a full sync
+	TEST_ASSERT_EQUAL(2, client.buttons.size());
+	TEST_ASSERT_EQUAL_UINT8(PROGRAM, client.buttons[0]);
+	TEST_ASSERT_EQUAL_UINT8(MODE + 20, client.buttons[1]);
+
+	// No version at all is a first connect: also everything
+	reconnect();
+	client.writeSyncState("");
+	TEST_ASSERT_TRUE(syncUntilVersion());
+	TEST_ASSERT_EQUAL_UINT32(PID_COUNT, client.receiptCount);
+}
+
+void test_delta_sends_only_params_stamped_after_since() {
+	client.writeSyncState("");
+	TEST_ASSERT_TRUE(syncUntilVersion());
+	const std::string held = client.version;
+	const uint32_t fullBytes = client.receiptBytes;
+
+	// Changed while the client is away
+	pServer->mockDisconnect();
+	frame();
+	const char* changed[] = { "inSpeed", "inZoom", "cx10" };
+	processNumber("inSpeed", 0.37);
+	processNumber("inZoom", 1.9);
+	processCheckbox("cx10", !rotateWaves);
+	frame();
+	pServer->mockConnect();
+	frame(1000);
+	client.reset();
+
+	client.writeSyncState(syncStateFrom(held).c_str());
+	TEST_ASSERT_TRUE(syncUntilVersion());
+	TEST_ASSERT_EQUAL(3, client.receipts.size());
+	for (const char* id : changed) {
+		TEST_ASSERT_TRUE_MESSAGE(client.receipts.count(id) == 1, id);
+	}
+	TEST_ASSERT_TRUE(client.buttons.empty());
+	TEST_ASSERT_EQUAL_STRING(currentVersion().c_str(), client.version.c_str());
+	printf("Reconnect: full sync %u bytes, after 3 changes %u bytes\n",
+	       (unsigned)fullBytes, (unsigned)client.receiptBytes);
+	TEST_ASSERT_LESS_THAN(fullBytes / 4, client.receiptBytes);
+
+	// Nothing changed since: only the version marker
+	const std::string now = client.version;
+	reconnect();
+	client.writeSyncState(syncStateFrom(now).c_str());
+	TEST_ASSERT_TRUE(syncUntilVersion());
+	TEST_ASSERT_EQUAL_UINT32(0, client.receiptCount);
+	TEST_ASSERT_EQUAL_STRING(now.c_str(), client.version.c_str());
+}
+
+// At MTU 23 a full sync takes many rate-capped frames; the version may only
+// go out once the client holds every value it covers, including changes
+// made while the sync was in flight
+void test_version_waits_for_receipts() {
+	pServer->peerMtu = 23;
+	client.writeSyncState("");
+	int frames = 0;
+	bool changedMidway = false;
+	for (; frames < MAX_FRAMES; frames++) {
+		frame();
+		if (client.versionThisFrame) {
+			TEST_ASSERT_FALSE(receiptsPending());
+			TEST_ASSERT_TRUE(client.matchesDevice());
+			TEST_ASSERT_EQUAL_STRING(currentVersion().c_str(), client.version.c_str());
+			if (changedMidway) break;
+		}
+		if (frames == 5) {
+			TEST_ASSERT_EQUAL_UINT32(0, client.versionsSeen);
+			client.writeNumber("inSpeed", -0.42);
+			changedMidway = true;
+		}
+	}
+	TEST_ASSERT_LESS_THAN(MAX_FRAMES, frames);
+	TEST_ASSERT_GREATER_THAN(20, frames);
+	TEST_ASSERT_EQUAL_UINT32(1, client.versionsSeen);
+
+	// A later change gets receipted, then a fresh version. The receipt
+	// flush normally spends the tokens first; with tokens to spare, the
+	// version alone still waits for the receipt.
+	client.writeNumber("inZoom", 0.5);
+	drainControlCommands();
+	mockMillis += 1000;
+	flushStateSync();
+	client.poll();
+	TEST_ASSERT_FALSE(client.versionThisFrame);
+	TEST_ASSERT_TRUE(syncUntilVersion());
+	TEST_ASSERT_TRUE(client.matchesDevice());
+	TEST_ASSERT_EQUAL_STRING(currentVersion().c_str(), client.version.c_str());
+}
+
+void readSchemaAtMtu(uint16_t mtu) {
+	pServer->peerMtu = mtu;
+	client.writeButton(93);
+	for (int i = 0; i < MAX_FRAMES && !client.schemaDone; i++) frame();
+	TEST_ASSERT_TRUE(client.schemaDone);
+
+	TEST_ASSERT_EQUAL(SCHEMA_ENTRY_COUNT, client.schema.size());
+	for (uint16_t i = 0; i < SCHEMA_ENTRY_COUNT; i++) {
+		char expected[SCHEMA_ENTRY_MAX];
+		const size_t n = formatSchemaEntry(expected, sizeof(expected), i);
+		TEST_ASSERT_EQUAL_STRING(std::string(expected, n).c_str(), client.schema[i].c_str());
+	}
+}
+
+void test_schema_reassembles_at_large_mtu() {
+	readSchemaAtMtu(517);
+	for (size_t size : client.schemaPageSizes) TEST_ASSERT_LESS_OR_EQUAL(517 - 3, size);
+	TEST_ASSERT_LESS_THAN(SCHEMA_ENTRY_COUNT / 4, client.schemaPageSizes.size());
+}
+
+void test_schema_reassembles_at_minimum_mtu() {
+	readSchemaAtMtu(23);
+	// Nothing but the header fits 20 bytes, so every page carries one entry
+	TEST_ASSERT_EQUAL(SCHEMA_ENTRY_COUNT, client.schemaPageSizes.size());
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_epoch_mismatch_sends_everything);
+	RUN_TEST(test_delta_sends_only_params_stamped_after_since);
+	RUN_TEST(test_version_waits_for_receipts);
+	RUN_TEST(test_schema_reassembles_at_large_mtu);
+	RUN_TEST(test_schema_reassembles_at_minimum_mtu);
+	return UNITY_END();
+}
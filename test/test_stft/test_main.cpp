@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "audioSTFT.h"
+
+using namespace myAudio;
+
+//=============================================================================
+// Overlapping STFT per hop
+// Frames windowed straight out of the ring must be bit-identical to
+// Q15Spectrum::compute() on a copy of the same 512 samples, across ring
+// wraps, for every hop. Onset timing is measured by feeding a noise floor
+// with short bursts in CHUNK-sample pieces and noting how long after each
+// burst's start the stage reports it; bursts start at varying offsets from
+// the frame grid, and each must count once however many overlapping frames
+// see it. The benchmark times a 512-sample block at each hop, which is what
+// audioSTFT.h's table quotes, over changing noise so no two frames repeat.
+//=============================================================================
+
+constexpr uint16_t BLOCK = Q15_FFT_SIZE;
+constexpr uint16_t CHUNK = 16;
+constexpr uint16_t HOPS[] = { 64, 128, 256, 512 };
+constexpr uint8_t HOP_COUNT = sizeof(HOPS) / sizeof(HOPS[0]);
+constexpr uint32_t BURST_EVERY = 22016;		// ~0.5 s, a whole number of chunks
+constexpr uint16_t BURST_LENGTH = 96;
+constexpr int BURSTS = 40;
+constexpr int BENCH_BLOCKS = 4000;
+constexpr uint8_t BENCH_NOISE_BLOCKS = 64;
+
+StftStage stft;
+Q15Spectrum reference;
+int16_t history[2 * BLOCK];
+int16_t pcm[BLOCK];
+uint16_t refMag[Q15_FFT_COMPLEX];
+
+void noise(int16_t* out, uint16_t n, int amplitude) {
+	for (uint16_t i = 0; i < n; i++) out[i] = static_cast<int16_t>(rand() % (2 * amplitude + 1) - amplitude);
+}
+
+void freshStage(uint16_t hop) {
+	stft = StftStage();
+	stft.setHop(hop);
+}
+
+void setUp() { srand(29); }
+void tearDown() {}
+
+void test_ring_frames_match_a_copied_window() {
+	for (uint16_t hop : HOPS) {
+		freshStage(hop);
+		memset(history, 0, sizeof(history));
+		for (int b = 0; b < 9; b++) {
+			noise(pcm, BLOCK, 12000);
+			const uint32_t frames = stft.frameCount();
+			stft.process(pcm, BLOCK);
+			memmove(history, history + BLOCK, BLOCK * sizeof(int16_t));
+			memcpy(history + BLOCK, pcm, sizeof(pcm));
+
+			// The first frame waits for a full window; after that the hop
+			// divides the block, so the last frame ends on the block
+			const uint8_t expected = b == 0 ? 1 : BLOCK / hop;
+			TEST_ASSERT_EQUAL_UINT32(expected, stft.frameCount() - frames);
+			TEST_ASSERT_EQUAL_UINT8(expected, stft.framesThisBlock());
+			reference.compute(history + BLOCK, BLOCK, refMag);
+			TEST_ASSERT_EQUAL_UINT16_ARRAY(refMag, stft.magnitudes(), Q15_FFT_COMPLEX);
+		}
+	}
+}
+
+// An odd-sized feed: frames still land every hop samples
+void test_frames_follow_the_hop_not_the_block() {
+	freshStage(96);
+	uint32_t fed = 0;
+	while (fed < 20000) {
+		const uint16_t n = 100 + rand() % 400;
+		noise(pcm, n, 3000);
+		stft.process(pcm, n);
+		fed += n;
+	}
+	TEST_ASSERT_EQUAL_UINT32((fed - BLOCK) / 96 + 1, stft.frameCount());
+}
+
+struct OnsetRun {
+	uint16_t detected = 0;
+	uint32_t delaySum = 0;
+	uint32_t worstDelay = 0;
+};
+
+// A burst about every BURST_EVERY samples, moved off the frame grid by a
+// whole number of chunks; delay is in samples from burst start to the end
+// of the chunk in which the stage reported it
+OnsetRun measureOnsets(uint16_t hop) {
+	freshStage(hop);
+	OnsetRun run;
+	int16_t chunk[CHUNK];
+	uint32_t lastBurst = 0;
+	uint32_t nextBurst = BURST_EVERY;
+	bool pending = false;
+	for (uint32_t t = 0; run.detected < BURSTS && t < (BURSTS + 2) * (BURST_EVERY + BLOCK); t += CHUNK) {
+		noise(chunk, CHUNK, 40);
+		if (t == nextBurst) {
+			lastBurst = t;
+			pending = true;
+			nextBurst += BURST_EVERY + (rand() % (BLOCK / CHUNK)) * CHUNK;
+		}
+		if (pending && t - lastBurst < BURST_LENGTH) {
+			for (uint16_t i = 0; i < CHUNK; i++) chunk[i] = static_cast<int16_t>(rand() % 20001 - 10000);
+		}
+		stft.process(chunk, CHUNK);
+		if (stft.onsetDetected()) {
+			TEST_ASSERT_TRUE(pending);		// at most once per burst, never on the floor
+			pending = false;
+			const uint32_t delay = t + CHUNK - lastBurst;
+			run.detected++;
+			run.delaySum += delay;
+			if (delay > run.worstDelay) run.worstDelay = delay;
+		}
+	}
+	return run;
+}
+
+void test_onset_timing_per_hop() {
+	float lastMean = 0.0f;
+	for (uint16_t hop : HOPS) {
+		const OnsetRun run = measureOnsets(hop);
+		const float meanMs = run.delaySum * 1000.0f / run.detected / Q15_FFT_SAMPLE_RATE;
+		printf("hop %3u: %u/%d bursts, onset %.2f ms after the burst on average, worst %.2f ms\n",
+		       hop, run.detected, BURSTS, meanMs, run.worstDelay * 1000.0f / Q15_FFT_SAMPLE_RATE);
+		TEST_ASSERT_EQUAL_INT(BURSTS, run.detected);
+		// Reported no later than one hop (plus the chunk) after the frame
+		// that first holds the whole burst
+		TEST_ASSERT_LESS_OR_EQUAL_UINT32(uint32_t(BURST_LENGTH + hop + CHUNK), run.worstDelay);
+		TEST_ASSERT_TRUE(meanMs > lastMean);
+		lastMean = meanMs;
+	}
+}
+
+void test_block_benchmark() {
+	static int16_t noiseBlocks[BENCH_NOISE_BLOCKS][BLOCK];
+	for (uint8_t b = 0; b < BENCH_NOISE_BLOCKS; b++) noise(noiseBlocks[b], BLOCK, 8000);
+	volatile uint32_t sink = 0;
+	double hop512Ns = 0.0;
+	for (uint8_t h = HOP_COUNT; h-- > 0;) {
+		freshStage(HOPS[h]);
+		const auto start = std::chrono::steady_clock::now();
+		for (int b = 0; b < BENCH_BLOCKS; b++) {
+			stft.process(noiseBlocks[b % BENCH_NOISE_BLOCKS], BLOCK);
+			sink += stft.magnitudes()[3];
+		}
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_BLOCKS;
+		if (HOPS[h] == 512) hop512Ns = ns;
+		printf("hop %3u: %u frames per block, %.2f ms step, %.0f ns per block (%.1fx hop 512)\n", HOPS[h],
+		       BLOCK / HOPS[h], HOPS[h] * 1000.0f / Q15_FFT_SAMPLE_RATE, ns, ns / hop512Ns);
+		TEST_ASSERT_TRUE(ns >= hop512Ns);
+	}
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_ring_frames_match_a_copied_window);
+	RUN_TEST(test_frames_follow_the_hop_not_the_block);
+	RUN_TEST(test_onset_timing_per_hop);
+	RUN_TEST(test_block_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,177 @@
+#include <unity.h>
+#include <stdlib.h>
+
+#include "audioTelemetry.h"
+
+//=============================================================================
+// TelemetryEncoder against a reference decoder
+// The decoder applies each packet to its own copy of the record, as the
+// web UI does, so the tests can check what the receiver ends up holding.
+//=============================================================================
+
+constexpr uint8_t DEFAULT_BUDGET = 20;	// ATT_MTU 23 - 3
+
+struct Receiver {
+	uint8_t fields[TELEM_FIELDS] = {};
+	uint8_t lastSeq = 0;
+	uint32_t packets = 0;
+	uint32_t gaps = 0;
+
+	// Returns the mask, so tests can see which fields a packet carried
+	uint32_t apply(const uint8_t* packet, uint8_t len) {
+		TEST_ASSERT_GREATER_OR_EQUAL(TELEM_PACKET_HEADER, len);
+		if (packets > 0 && packet[0] != (uint8_t)(lastSeq + 1)) gaps++;
+		lastSeq = packet[0];
+		packets++;
+
+		uint32_t mask = 0;
+		for (uint8_t i = 0; i < TELEM_MASK_BYTES; i++) {
+			mask |= (uint32_t)packet[1 + i] << (8 * i);
+		}
+		uint8_t pos = TELEM_PACKET_HEADER;
+		for (uint8_t i = 0; i < TELEM_FIELDS; i++) {
+			if (!(mask & (1u << i))) continue;
+			TEST_ASSERT_LESS_THAN(len, pos);
+			fields[i] = packet[pos++];
+		}
+		TEST_ASSERT_EQUAL_UINT8(len, pos);
+		return mask;
+	}
+};
+
+TelemetryEncoder encoder;
+Receiver receiver;
+uint8_t packet[TELEM_PACKET_MAX];
+
+void randomRecord(uint8_t* record) {
+	for (uint8_t i = 0; i < TELEM_FIELDS; i++) record[i] = rand() & 0xFF;
+}
+
+void setUp() {
+	encoder = TelemetryEncoder();
+	receiver = Receiver();
+	srand(1);
+}
+
+void tearDown() {}
+
+void test_packets_fit_the_budget() {
+	uint8_t record[TELEM_FIELDS];
+	for (uint8_t budget = TELEM_PACKET_HEADER + 1; budget <= TELEM_PACKET_MAX + 4; budget++) {
+		for (int n = 0; n < 50; n++) {
+			randomRecord(record);
+			const uint8_t len = encoder.encode(record, packet, budget);
+			TEST_ASSERT_LESS_OR_EQUAL(budget, len);
+			receiver.apply(packet, len);
+		}
+	}
+}
+
+void test_header_fields_go_first() {
+	uint8_t record[TELEM_FIELDS];
+	randomRecord(record);
+	const uint32_t mask = receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+	for (uint8_t i = 0; i < TELEM_BIN0; i++) {
+		TEST_ASSERT_TRUE(mask & (1u << i));
+	}
+}
+
+// Every bin changes every record: the bins that didn't fit go first next time
+void test_bins_take_turns() {
+	uint8_t record[TELEM_FIELDS];
+	uint8_t age[TELEM_BINS] = {};
+	for (int n = 0; n < 200; n++) {
+		randomRecord(record);
+		memset(record, 0, TELEM_BIN0);
+		const uint32_t mask = receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+		for (uint8_t b = 0; b < TELEM_BINS; b++) {
+			age[b] = (mask & (1u << (TELEM_BIN0 + b))) ? 0 : age[b] + 1;
+			TEST_ASSERT_LESS_OR_EQUAL(2, age[b]);
+		}
+	}
+}
+
+void test_receiver_converges() {
+	uint8_t record[TELEM_FIELDS];
+	randomRecord(record);
+	for (int n = 0; n < 3; n++) {
+		receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+	}
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(record, receiver.fields, TELEM_FIELDS);
+}
+
+// Once the receiver is in sync, a steady record costs one refresh field
+void test_unchanged_record_sends_one_field() {
+	uint8_t record[TELEM_FIELDS];
+	randomRecord(record);
+	for (int n = 0; n < 3; n++) {
+		encoder.encode(record, packet, DEFAULT_BUDGET);
+	}
+	for (int n = 0; n < 2 * TELEM_FIELDS; n++) {
+		TEST_ASSERT_EQUAL_UINT8(TELEM_PACKET_HEADER + 1, encoder.encode(record, packet, DEFAULT_BUDGET));
+	}
+}
+
+void test_only_changed_fields_are_sent() {
+	uint8_t record[TELEM_FIELDS];
+	randomRecord(record);
+	for (int n = 0; n < 3; n++) {
+		receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+	}
+	record[TELEM_BPM]++;
+	record[TELEM_BIN0 + 5]++;
+	const uint8_t len = encoder.encode(record, packet, DEFAULT_BUDGET);
+	const uint32_t mask = receiver.apply(packet, len);
+	TEST_ASSERT_TRUE(mask & (1u << TELEM_BPM));
+	TEST_ASSERT_TRUE(mask & (1u << (TELEM_BIN0 + 5)));
+	TEST_ASSERT_LESS_OR_EQUAL(TELEM_PACKET_HEADER + 3, len);	// + the refresh field
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(record, receiver.fields, TELEM_FIELDS);
+}
+
+// A lost notification shows as a seq gap and is repaired by the round-robin refresh
+void test_dropped_packet_is_repaired() {
+	uint8_t record[TELEM_FIELDS];
+	randomRecord(record);
+	for (int n = 0; n < 3; n++) {
+		receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+	}
+
+	record[TELEM_TREBLE] ^= 0x5A;
+	encoder.encode(record, packet, DEFAULT_BUDGET);		// never arrives
+	TEST_ASSERT_NOT_EQUAL(record[TELEM_TREBLE], receiver.fields[TELEM_TREBLE]);
+
+	for (int n = 0; n < TELEM_FIELDS; n++) {
+		receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+	}
+	TEST_ASSERT_EQUAL_UINT32(1, receiver.gaps);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(record, receiver.fields, TELEM_FIELDS);
+}
+
+void test_reset_resends_everything() {
+	uint8_t record[TELEM_FIELDS];
+	randomRecord(record);
+	for (int n = 0; n < 3; n++) {
+		encoder.encode(record, packet, DEFAULT_BUDGET);
+	}
+
+	// New subscriber
+	encoder.reset();
+	receiver = Receiver();
+	for (int n = 0; n < 3; n++) {
+		receiver.apply(packet, encoder.encode(record, packet, DEFAULT_BUDGET));
+	}
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(record, receiver.fields, TELEM_FIELDS);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_packets_fit_the_budget);
+	RUN_TEST(test_header_fields_go_first);
+	RUN_TEST(test_bins_take_turns);
+	RUN_TEST(test_receiver_converges);
+	RUN_TEST(test_unchanged_record_sends_one_field);
+	RUN_TEST(test_only_changed_fields_are_sent);
+	RUN_TEST(test_dropped_packet_is_repaired);
+	RUN_TEST(test_reset_resends_everything);
+	return UNITY_END();
+}